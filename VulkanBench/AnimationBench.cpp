@@ -0,0 +1,259 @@
+#include "Animation.h"
+#include "AnimationSampler.h"
+#include "ParallelFor.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Animation sampling of a crowd : VulkanCore::model::SampleAnimation() (keys searched and slerped per node) vs
+// SampleAnimationSoa() on the scalar and SSE paths, then spread over 1 to N threads. 1000 characters of 96 nodes
+// and 64 bones play a 2 s clip keyed at 30 Hz, each from its own time, for a second at 60 Hz.
+// Every path must give the bone matrices of the reference one, up to the slerp approximation.
+
+namespace
+{
+
+constexpr uint32_t kNumCharacters = 1000;
+constexpr uint32_t kNumNodes = 96;
+constexpr uint32_t kNumBones = 64;
+constexpr float kClipDuration = 2.0f;
+constexpr float kKeyRate = 30.0f;
+constexpr uint32_t kNumFrames = 60;
+constexpr float kFrameTime = 1.0f / 60.0f;
+constexpr float kMaxError = 1e-3f; // per matrix element, relative to the largest one
+
+using namespace VulkanCore::model;
+
+// Limbs : every node hangs from one of the few previous ones, so the hierarchy is a few nodes deep
+Skeleton createSkeleton(std::mt19937& generator)
+{
+    std::uniform_real_distribution<float> offset(-1.0f, 1.0f);
+    Skeleton skeleton;
+    for (uint32_t node = 0; node < kNumNodes; node++)
+    {
+        int32_t parent = node == 0 ? -1 : static_cast<int32_t>(std::uniform_int_distribution<uint32_t>(
+                                               node > 4 ? node - 4 : 0, node - 1)(generator));
+        glm::mat4 transformation(1.0f);
+        transformation[3] = glm::vec4(offset(generator), offset(generator) + 1.0f, offset(generator), 1.0f);
+        skeleton.Nodes.push_back({parent, transformation});
+        skeleton.NodeNames.push_back("Node" + std::to_string(node));
+    }
+    for (uint32_t bone = 0; bone < kNumBones; bone++)
+    {
+        glm::mat4 boneOffset(1.0f);
+        boneOffset[3] = glm::vec4(offset(generator), offset(generator), offset(generator), 1.0f);
+        skeleton.BoneNodes.push_back(kNumNodes - kNumBones + bone);
+        skeleton.BoneOffsets.push_back(boneOffset);
+    }
+    return skeleton;
+}
+
+glm::quat randomRotation(std::mt19937& generator, float maxAngle)
+{
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+    glm::vec3 axis = glm::normalize(glm::vec3(value(generator), value(generator), value(generator)) + 1e-3f);
+    float angle = value(generator) * maxAngle;
+    glm::vec3 xyz = axis * std::sin(angle * 0.5f);
+    return glm::quat(std::cos(angle * 0.5f), xyz.x, xyz.y, xyz.z);
+}
+
+// Rotation keys on most nodes, translation keys on some, scale keys on a few, like a skeletal clip
+AnimationClip createClip(std::mt19937& generator)
+{
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+    AnimationClip clip;
+    clip.Name = "Walk";
+    clip.Duration = kClipDuration;
+    uint32_t numKeys = static_cast<uint32_t>(kClipDuration * kKeyRate) + 1;
+    for (uint32_t node = 0; node < kNumNodes; node++)
+    {
+        if (node % 10 == 9)
+        {
+            continue; // not animated
+        }
+        AnimationChannel channel;
+        channel.Node = node;
+        glm::quat rotation = randomRotation(generator, 3.0f);
+        for (uint32_t key = 0; key < numKeys; key++)
+        {
+            channel.Rotations.push_back({key / kKeyRate, rotation});
+            rotation = randomRotation(generator, 0.3f) * rotation;
+        }
+        if (node % 3 == 0)
+        {
+            for (uint32_t key = 0; key < numKeys; key++)
+            {
+                channel.Positions.push_back(
+                    {key / kKeyRate, glm::vec3(value(generator), value(generator) + 1.0f, value(generator))});
+            }
+        }
+        if (node % 8 == 0)
+        {
+            channel.Scales.push_back({0.0f, glm::vec3(1.0f)});
+            channel.Scales.push_back({kClipDuration, glm::vec3(1.0f + 0.2f * value(generator))});
+        }
+        clip.Channels.push_back(std::move(channel));
+    }
+    return clip;
+}
+
+float getMaxError(const std::vector<AnimationPose>& reference, const std::vector<AnimationPose>& poses)
+{
+    float maxError = 0.0f;
+    for (size_t character = 0; character < poses.size(); character++)
+    {
+        for (size_t bone = 0; bone < kNumBones; bone++)
+        {
+            const glm::mat4& a = reference[character].BoneMatrices[bone];
+            const glm::mat4& b = poses[character].BoneMatrices[bone];
+            float scale = 1.0f;
+            for (int column = 0; column < 4; column++)
+            {
+                for (int row = 0; row < 4; row++)
+                {
+                    scale = std::max(scale, std::fabs(a[column][row]));
+                }
+            }
+            for (int column = 0; column < 4; column++)
+            {
+                for (int row = 0; row < 4; row++)
+                {
+                    maxError = std::max(maxError, std::fabs(a[column][row] - b[column][row]) / scale);
+                }
+            }
+        }
+    }
+    return maxError;
+}
+
+// Average time of a frame of the crowd, in milliseconds. The poses are left at the last frame.
+template <typename SampleCrowd> double runPath(const SampleCrowd& sampleCrowd)
+{
+    sampleCrowd(0.0f); // warm up, the poses reach their size
+
+    auto start = std::chrono::steady_clock::now();
+    for (uint32_t frame = 1; frame <= kNumFrames; frame++)
+    {
+        sampleCrowd(frame * kFrameTime);
+    }
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / kNumFrames;
+}
+
+} // namespace
+
+int main()
+{
+    std::mt19937 generator(1234);
+    Skeleton skeleton = createSkeleton(generator);
+    AnimationClip clip = createClip(generator);
+    SoaAnimationClip soaClip = BuildSoaAnimationClip(clip, kNumNodes);
+
+    std::uniform_real_distribution<float> startTime(0.0f, kClipDuration);
+    std::vector<float> startTimes(kNumCharacters);
+    for (float& time : startTimes)
+    {
+        time = startTime(generator);
+    }
+
+    uint64_t numBones = static_cast<uint64_t>(kNumCharacters) * kNumBones;
+    std::cout << "Animation sampling, " << kNumCharacters << " characters, " << kNumNodes << " nodes and "
+              << kNumBones << " bones each, average of " << kNumFrames << " frames" << std::endl;
+    std::cout << std::left << std::setw(24) << "Path" << std::right << std::setw(12) << "Time (ms)" << std::setw(14)
+              << "Bones / ms" << std::setw(10) << "Speedup" << std::setw(12) << "Max error" << std::endl;
+
+    std::vector<AnimationPose> reference(kNumCharacters);
+    double referenceTime = runPath(
+        [&](float time)
+        {
+            for (uint32_t character = 0; character < kNumCharacters; character++)
+            {
+                SampleAnimation(skeleton, &clip, startTimes[character] + time, reference[character]);
+            }
+        });
+
+    auto printRow = [&](const std::string& name, double time, float maxError)
+    {
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(3)
+                  << std::setw(12) << time << std::setprecision(0) << std::setw(14) << numBones / time
+                  << std::setprecision(2) << std::setw(9) << referenceTime / time << "x" << std::scientific
+                  << std::setprecision(1) << std::setw(12) << maxError << std::defaultfloat << std::endl;
+    };
+    printRow("Per node, glm::slerp", referenceTime, 0.0f);
+
+    bool allMatch = true;
+    auto check = [&](const std::string& name, const std::vector<AnimationPose>& poses, double time)
+    {
+        float maxError = getMaxError(reference, poses);
+        if (maxError > kMaxError)
+        {
+            std::cout << "Mismatch with the reference path: " << name << std::endl;
+            allMatch = false;
+        }
+        printRow(name, time, maxError);
+    };
+
+    for (AnimationPath path : {AnimationPath_Scalar, AnimationPath_SSE})
+    {
+        if (!IsAnimationPathSupported(path))
+        {
+            continue;
+        }
+        std::vector<AnimationPose> poses(kNumCharacters);
+        double time = runPath(
+            [&](float time)
+            {
+                for (uint32_t character = 0; character < kNumCharacters; character++)
+                {
+                    SampleAnimationSoa(skeleton, &soaClip, startTimes[character] + time, poses[character], path);
+                }
+            });
+        check(std::string("SoA, ") + GetAnimationPathName(path), poses, time);
+    }
+
+    // Characters spread over the threads, best path
+    uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<uint32_t> threadCounts;
+    for (uint32_t numThreads = 2; numThreads < maxThreads; numThreads *= 2)
+    {
+        threadCounts.push_back(numThreads);
+    }
+    if (maxThreads > 1)
+    {
+        threadCounts.push_back(maxThreads);
+    }
+    for (uint32_t numThreads : threadCounts)
+    {
+        std::vector<AnimationPose> poses(kNumCharacters);
+        std::vector<AnimationJob> jobs(kNumCharacters);
+        for (uint32_t character = 0; character < kNumCharacters; character++)
+        {
+            jobs[character] = {&skeleton, nullptr, 0.0f, &poses[character], &soaClip};
+        }
+        WorkerPool pool(numThreads);
+        double time = runPath(
+            [&](float time)
+            {
+                for (uint32_t character = 0; character < kNumCharacters; character++)
+                {
+                    jobs[character].Time = startTimes[character] + time;
+                }
+                SampleAnimations(jobs, pool);
+            });
+        check(std::string("SoA, ") + GetAnimationPathName(GetBestAnimationPath()) + ", " +
+                  std::to_string(numThreads) + " threads",
+              poses, time);
+    }
+
+    return allMatch ? 0 : 1;
+}
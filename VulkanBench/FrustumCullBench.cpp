@@ -0,0 +1,109 @@
+#include "FrustumCuller.h"
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <vector>
+
+// Scalar vs SIMD paths of VulkanCore::FrustumCuller on random spheres, 10k to 1M objects.
+// Every path must return the same visible set as the scalar one.
+
+namespace
+{
+
+constexpr uint64_t kSpheresPerRun = 50'000'000; // per path and object count, sets the number of repetitions
+
+void fillSpheres(VulkanCore::FrustumCuller& culler, uint32_t numSpheres)
+{
+    std::mt19937 generator(1234);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+    std::uniform_real_distribution<float> radius(0.5f, 5.0f);
+
+    culler.clear();
+    for (uint32_t i = 0; i < numSpheres; i++)
+    {
+        culler.addSphere(glm::vec4(position(generator), position(generator), position(generator), radius(generator)));
+    }
+}
+
+// Best time of a cull call, in nanoseconds
+double runPath(const VulkanCore::FrustumCuller& culler, const glm::mat4& viewProj, VulkanCore::CullPath path,
+               uint32_t numRuns, std::vector<uint32_t>& visible)
+{
+    culler.cull(viewProj, path, visible); // warm up, visible keeps its capacity
+
+    double bestTime = 0.0;
+    for (uint32_t run = 0; run < numRuns; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        culler.cull(viewProj, path, visible);
+        double time = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+        bestTime = run == 0 ? time : std::min(bestTime, time);
+    }
+    return bestTime;
+}
+
+} // namespace
+
+int main()
+{
+    // Camera in the middle of the spheres, about a tenth of them are visible
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 1000.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::mat4 viewProj = projection * view;
+
+    const VulkanCore::CullPath paths[] = {VulkanCore::CullPath_Scalar, VulkanCore::CullPath_SSE,
+                                          VulkanCore::CullPath_AVX2};
+
+    std::cout << "Frustum culling, best of N runs" << std::endl;
+    std::cout << std::left << std::setw(10) << "Objects" << std::setw(8) << "Path" << std::right << std::setw(10)
+              << "Visible" << std::setw(12) << "Time (us)" << std::setw(14) << "ns / object" << std::setw(10)
+              << "Speedup" << std::endl;
+
+    bool allMatch = true;
+    for (uint32_t numSpheres : {10'000u, 100'000u, 1'000'000u})
+    {
+        VulkanCore::FrustumCuller culler;
+        fillSpheres(culler, numSpheres);
+        uint32_t numRuns = static_cast<uint32_t>(std::max<uint64_t>(kSpheresPerRun / numSpheres, 5));
+
+        std::vector<uint32_t> reference;
+        double scalarTime = 0.0;
+        for (VulkanCore::CullPath path : paths)
+        {
+            if (!VulkanCore::FrustumCuller::isPathSupported(path))
+            {
+                std::cout << std::left << std::setw(10) << numSpheres << std::setw(8)
+                          << VulkanCore::GetCullPathName(path) << "not supported by this CPU" << std::endl;
+                continue;
+            }
+
+            std::vector<uint32_t> visible;
+            double time = runPath(culler, viewProj, path, numRuns, visible);
+            if (path == VulkanCore::CullPath_Scalar)
+            {
+                reference = visible;
+                scalarTime = time;
+            }
+            else if (visible != reference)
+            {
+                std::cout << "Mismatch with the scalar path: " << VulkanCore::GetCullPathName(path) << std::endl;
+                allMatch = false;
+            }
+
+            std::cout << std::left << std::setw(10) << numSpheres << std::setw(8) << VulkanCore::GetCullPathName(path)
+                      << std::right << std::setw(10) << visible.size() << std::fixed << std::setprecision(1)
+                      << std::setw(12) << time / 1000.0 << std::setprecision(3) << std::setw(14)
+                      << time / numSpheres << std::setprecision(2) << std::setw(9) << scalarTime / time << "x"
+                      << std::endl;
+        }
+    }
+
+    return allMatch ? 0 : 1;
+}
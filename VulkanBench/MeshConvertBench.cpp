@@ -0,0 +1,226 @@
+#include "MeshConverter.h"
+
+#include <assimp/mesh.h>
+#include <glm/glm.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+// aiMesh to vertex and index arrays as done by Model::initAllMeshes() : the former serial loop branching on the
+// attributes per vertex vs VulkanCore::model::ConvertMeshes() on 1 to N threads. The scene is synthetic, 1.6M
+// vertices over meshes of 2k to 400k vertices with and without normals, texture coordinates and tangents.
+// Every path must produce the same arrays as the reference one.
+
+namespace
+{
+
+constexpr uint32_t kNumRuns = 10;
+
+// Model::Vertex
+struct Vertex
+{
+    glm::vec3 pos;
+    glm::vec2 texCoord;
+    glm::vec3 normal;
+    glm::vec3 tangent;
+    glm::vec3 bitangent;
+};
+
+std::unique_ptr<aiMesh> createMesh(std::mt19937& generator, uint32_t numVertices, bool normals, bool texCoords,
+                                   bool tangents)
+{
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+    auto randomVector = [&]() { return aiVector3D(value(generator), value(generator), value(generator)); };
+
+    auto pMesh = std::make_unique<aiMesh>();
+    pMesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+    pMesh->mNumVertices = numVertices;
+    pMesh->mVertices = new aiVector3D[numVertices];
+    pMesh->mNormals = normals ? new aiVector3D[numVertices] : nullptr;
+    pMesh->mTextureCoords[0] = texCoords ? new aiVector3D[numVertices] : nullptr;
+    pMesh->mNumUVComponents[0] = texCoords ? 2 : 0;
+    pMesh->mTangents = tangents ? new aiVector3D[numVertices] : nullptr;
+    pMesh->mBitangents = tangents ? new aiVector3D[numVertices] : nullptr;
+    for (uint32_t i = 0; i < numVertices; i++)
+    {
+        pMesh->mVertices[i] = randomVector();
+        if (normals)
+        {
+            pMesh->mNormals[i] = randomVector();
+        }
+        if (texCoords)
+        {
+            pMesh->mTextureCoords[0][i] = randomVector();
+        }
+        if (tangents)
+        {
+            pMesh->mTangents[i] = randomVector();
+            pMesh->mBitangents[i] = randomVector();
+        }
+    }
+
+    // About two triangles per vertex, like a closed surface
+    std::uniform_int_distribution<uint32_t> index(0, numVertices - 1);
+    pMesh->mNumFaces = numVertices * 2;
+    pMesh->mFaces = new aiFace[pMesh->mNumFaces];
+    for (uint32_t i = 0; i < pMesh->mNumFaces; i++)
+    {
+        aiFace& face = pMesh->mFaces[i];
+        face.mNumIndices = 3;
+        face.mIndices = new unsigned int[3]{index(generator), index(generator), index(generator)};
+    }
+    return pMesh;
+}
+
+// The loop Model::initSingleMesh() used to run on every mesh
+void convertReference(std::span<const VulkanCore::model::MeshConversionRange> meshes, Vertex* pVertices,
+                      uint32_t* pIndices)
+{
+    for (const VulkanCore::model::MeshConversionRange& range : meshes)
+    {
+        const aiMesh* mesh = range.pMesh;
+        Vertex vertex;
+        for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+        {
+            vertex.pos = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+            if (mesh->HasNormals())
+            {
+                vertex.normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
+            }
+            else
+            {
+                vertex.normal = glm::vec3(0.0f, 0.0f, 0.0f);
+            }
+            if (mesh->HasTextureCoords(0))
+            {
+                vertex.texCoord = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
+            }
+            else
+            {
+                vertex.texCoord = glm::vec2(0.0f, 0.0f);
+            }
+            if (mesh->HasTangentsAndBitangents())
+            {
+                vertex.tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
+                vertex.bitangent = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
+            }
+            else
+            {
+                vertex.tangent = glm::vec3(0.0f, 0.0f, 0.0f);
+                vertex.bitangent = glm::vec3(0.0f, 0.0f, 0.0f);
+            }
+            pVertices[range.BaseVertex + i] = vertex;
+        }
+
+        uint32_t indexOffset = 0;
+        for (uint32_t i = 0; i < mesh->mNumFaces; i++)
+        {
+            const aiFace& face = mesh->mFaces[i];
+            for (uint32_t j = 0; j < face.mNumIndices; j++)
+            {
+                pIndices[range.BaseIndex + indexOffset] = face.mIndices[j];
+                indexOffset++;
+            }
+        }
+    }
+}
+
+// Best time of a conversion, in milliseconds
+template <typename Convert> double runPath(const Convert& convert)
+{
+    convert(); // warm up, the destination pages are touched
+
+    double bestTime = 0.0;
+    for (uint32_t run = 0; run < kNumRuns; run++)
+    {
+        auto start = std::chrono::steady_clock::now();
+        convert();
+        double time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        bestTime = run == 0 ? time : std::min(bestTime, time);
+    }
+    return bestTime;
+}
+
+} // namespace
+
+int main()
+{
+    // Sizes and attributes of the meshes : a few large ones and many small ones
+    std::mt19937 generator(1234);
+    std::vector<std::unique_ptr<aiMesh>> meshes;
+    meshes.push_back(createMesh(generator, 400'000, true, true, true));
+    meshes.push_back(createMesh(generator, 250'000, true, true, false));
+    meshes.push_back(createMesh(generator, 150'000, true, false, false));
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        meshes.push_back(createMesh(generator, 2'000 + i * 350, true, i % 4 != 0, i % 2 == 0));
+    }
+
+    std::vector<VulkanCore::model::MeshConversionRange> ranges;
+    uint32_t numVertices = 0;
+    uint32_t numIndices = 0;
+    for (const std::unique_ptr<aiMesh>& pMesh : meshes)
+    {
+        ranges.push_back({pMesh.get(), numVertices, numIndices});
+        numVertices += pMesh->mNumVertices;
+        numIndices += pMesh->mNumFaces * 3;
+    }
+
+    std::vector<Vertex> referenceVertices(numVertices);
+    std::vector<uint32_t> referenceIndices(numIndices);
+    double referenceTime =
+        runPath([&]() { convertReference(ranges, referenceVertices.data(), referenceIndices.data()); });
+
+    std::cout << "Mesh conversion, " << meshes.size() << " meshes, " << numVertices << " vertices, " << numIndices
+              << " indices, best of " << kNumRuns << " runs" << std::endl;
+    std::cout << std::left << std::setw(24) << "Path" << std::right << std::setw(12) << "Time (ms)" << std::setw(14)
+              << "ns / vertex" << std::setw(10) << "Speedup" << std::endl;
+    auto printRow = [&](const std::string& name, double time)
+    {
+        std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(2)
+                  << std::setw(12) << time << std::setw(14) << time * 1e6 / numVertices << std::setw(9)
+                  << referenceTime / time << "x" << std::endl;
+    };
+    printRow("Per vertex branches", referenceTime);
+
+    uint32_t maxThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    std::vector<uint32_t> threadCounts = {1};
+    for (uint32_t numThreads = 2; numThreads < maxThreads; numThreads *= 2)
+    {
+        threadCounts.push_back(numThreads);
+    }
+    if (maxThreads > 1)
+    {
+        threadCounts.push_back(maxThreads);
+    }
+
+    bool allMatch = true;
+    for (uint32_t numThreads : threadCounts)
+    {
+        std::vector<Vertex> vertices(numVertices);
+        std::vector<uint32_t> indices(numIndices);
+        double time = runPath(
+            [&]()
+            { VulkanCore::model::ConvertMeshes<Vertex>(ranges, vertices.data(), indices.data(), numThreads); });
+
+        if (memcmp(vertices.data(), referenceVertices.data(), numVertices * sizeof(Vertex)) != 0 ||
+            indices != referenceIndices)
+        {
+            std::cout << "Mismatch with the reference path: " << numThreads << " threads" << std::endl;
+            allMatch = false;
+        }
+        printRow("Specialized, " + std::to_string(numThreads) + " thread" + (numThreads > 1 ? "s" : ""), time);
+    }
+
+    return allMatch ? 0 : 1;
+}
@@ -0,0 +1,259 @@
+#include "BindlessRegistry.h"
+#include "Core.h"
+#include "DescriptorSetLayoutCache.h"
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace VulkanCore
+{
+
+BindlessRegistry::BindlessRegistry(VulkanCore* pVulkanCore, uint32_t maxTextures, uint32_t maxGeometries)
+    : mVulkanCore{pVulkanCore}, mDevice{pVulkanCore->getDevice()}, mNumImages{pVulkanCore->getSwapchainImageCount()},
+      mMaxTextures{maxTextures}, mMaxGeometries{maxGeometries}, mNumTextures{0}, mNumGeometries{0}, mTextureSlots{},
+      mDescriptorSetLayout{VK_NULL_HANDLE}, mDescriptorPool{VK_NULL_HANDLE}, mDescriptorSets{}
+{
+    if (!mVulkanCore->isBindlessSupported())
+    {
+        throw std::runtime_error("Bindless rendering requires descriptor indexing support.");
+    }
+
+    // Clamp the texture array to what the device can bind
+    VkPhysicalDeviceDescriptorIndexingProperties limits =
+        mVulkanCore->getPhysicalDevice().getSelectedPhysicalDeviceProperties().mDescriptorIndexingProperties;
+    mMaxTextures = std::min({mMaxTextures, limits.maxDescriptorSetUpdateAfterBindSampledImages,
+                             limits.maxPerStageDescriptorUpdateAfterBindSampledImages});
+    mMaxGeometries = std::min(mMaxGeometries, limits.maxPerStageDescriptorUpdateAfterBindStorageBuffers / 3);
+
+    createDescriptorSetLayout();
+    createDescriptorSets();
+}
+
+BindlessRegistry::~BindlessRegistry()
+{
+    destroy();
+}
+
+void BindlessRegistry::destroy()
+{
+    // The layout is owned by the DescriptorSetLayoutCache, sets are freed with the pool
+    if (mDescriptorPool != VK_NULL_HANDLE)
+    {
+        vkDestroyDescriptorPool(mDevice, mDescriptorPool, nullptr);
+        mDescriptorPool = VK_NULL_HANDLE;
+    }
+    mDescriptorSets.clear();
+    mTextureSlots.clear();
+}
+
+uint32_t BindlessRegistry::registerTexture(VkImageView imageView, VkSampler sampler)
+{
+    auto it = mTextureSlots.find(imageView);
+    if (it != mTextureSlots.end())
+    {
+        return it->second;
+    }
+
+    if (mNumTextures >= mMaxTextures)
+    {
+        throw std::runtime_error("Bindless texture array is full (" + std::to_string(mMaxTextures) + " textures).");
+    }
+
+    uint32_t slot = mNumTextures++;
+
+    VkDescriptorImageInfo imageInfo = {
+        .sampler = sampler,
+        .imageView = imageView,
+        .imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL,
+    };
+
+    std::vector<VkWriteDescriptorSet> writeDescriptorSets(mNumImages);
+    for (int32_t imageIndex = 0; imageIndex < mNumImages; imageIndex++)
+    {
+        writeDescriptorSets[imageIndex] = {
+            .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+            .dstSet = mDescriptorSets[imageIndex],
+            .dstBinding = BindlessBinding_Textures,
+            .dstArrayElement = slot,
+            .descriptorCount = 1,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .pImageInfo = &imageInfo,
+        };
+    }
+    vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(), 0,
+                           nullptr);
+
+    mTextureSlots.emplace(imageView, slot);
+    return slot;
+}
+
+uint32_t BindlessRegistry::registerGeometry(VkBuffer vertexBuffer, VkBuffer indexBuffer,
+                                            const std::vector<VkBuffer>& transformBuffers)
+{
+    if (mNumGeometries >= mMaxGeometries)
+    {
+        throw std::runtime_error("Bindless geometry arrays are full (" + std::to_string(mMaxGeometries) +
+                                 " geometries).");
+    }
+    if (static_cast<int32_t>(transformBuffers.size()) != mNumImages)
+    {
+        throw std::runtime_error("Bindless geometry needs one transform buffer per swapchain image.");
+    }
+
+    uint32_t slot = mNumGeometries++;
+    for (int32_t imageIndex = 0; imageIndex < mNumImages; imageIndex++)
+    {
+        writeBuffer(imageIndex, BindlessBinding_VertexBuffers, slot, vertexBuffer);
+        writeBuffer(imageIndex, BindlessBinding_IndexBuffers, slot, indexBuffer);
+        writeBuffer(imageIndex, BindlessBinding_Transforms, slot, transformBuffers[imageIndex]);
+    }
+    return slot;
+}
+
+void BindlessRegistry::bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t imageIndex,
+                            VkPipelineBindPoint bindPoint) const
+{
+    vkCmdBindDescriptorSets(commandBuffer, bindPoint, pipelineLayout, 0, 1, &mDescriptorSets[imageIndex], 0, nullptr);
+}
+
+void BindlessRegistry::validateInterface(const ShaderReflection& reflection, bool hasDrawSet) const
+{
+    for (const ReflectedBinding& binding : reflection.mBindings)
+    {
+        if (hasDrawSet && binding.mSet == 1)
+        {
+            continue;
+        }
+
+        std::string location = "'" + binding.mName + "' (set " + std::to_string(binding.mSet) + ", binding " +
+                               std::to_string(binding.mBinding) + ")";
+
+        VkDescriptorType expectedType = binding.mBinding == BindlessBinding_Textures
+                                            ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER
+                                            : VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+
+        if (binding.mSet != 0 || binding.mBinding >= BindlessBinding_Count)
+        {
+            throw std::runtime_error("Shader/bindless mismatch: " + location + " is not part of the bindless set.");
+        }
+        if (binding.mType != expectedType)
+        {
+            throw std::runtime_error("Shader/bindless mismatch: " + location + " is a " +
+                                     GetDescriptorTypeName(binding.mType) + ", the bindless set has a " +
+                                     GetDescriptorTypeName(expectedType) + " array.");
+        }
+        if (binding.mCount != 0)
+        {
+            throw std::runtime_error("Shader/bindless mismatch: " + location + " must be a runtime sized array.");
+        }
+    }
+
+    if (reflection.mPushConstants.size > sizeof(BindlessDrawConstants))
+    {
+        throw std::runtime_error("Shader/bindless mismatch: push constant block is " +
+                                 std::to_string(reflection.mPushConstants.size) + " bytes, BindlessDrawConstants is " +
+                                 std::to_string(sizeof(BindlessDrawConstants)) + " bytes.");
+    }
+}
+
+void BindlessRegistry::createDescriptorSetLayout()
+{
+    // Compute : the IndirectDrawList cull pass reads the transforms. Task and mesh : MeshletDrawList.
+    VkShaderStageFlags stages = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+    if (mVulkanCore->isMeshShaderSupported())
+    {
+        stages |= VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+    }
+
+    std::vector<VkDescriptorSetLayoutBinding> bindings = {
+        {BindlessBinding_VertexBuffers, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, mMaxGeometries, stages, nullptr},
+        {BindlessBinding_IndexBuffers, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, mMaxGeometries, stages, nullptr},
+        {BindlessBinding_Transforms, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, mMaxGeometries, stages, nullptr},
+        {BindlessBinding_Textures, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, mMaxTextures, stages, nullptr},
+    };
+
+    // Slots are filled as assets are registered, possibly after the set was bound in a recorded command buffer
+    VkDescriptorBindingFlags bufferFlags = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT |
+                                           VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT |
+                                           VK_DESCRIPTOR_BINDING_UPDATE_UNUSED_WHILE_PENDING_BIT;
+    VkDescriptorBindingFlags textureFlags = bufferFlags | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT;
+    std::vector<VkDescriptorBindingFlags> bindingFlags = {bufferFlags, bufferFlags, bufferFlags, textureFlags};
+
+    mDescriptorSetLayout = mVulkanCore->getDescriptorSetLayoutCache()->getLayout(
+        bindings, VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT, bindingFlags);
+}
+
+void BindlessRegistry::createDescriptorSets()
+{
+    uint32_t numSets = static_cast<uint32_t>(mNumImages);
+    std::vector<VkDescriptorPoolSize> poolSizes = {
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, mMaxGeometries * 3 * numSets}, // VB + IB + transforms
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, mMaxTextures * numSets},
+    };
+
+    VkDescriptorPoolCreateInfo poolInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT,
+        .maxSets = numSets,
+        .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
+        .pPoolSizes = poolSizes.data(),
+    };
+
+    if (vkCreateDescriptorPool(mDevice, &poolInfo, nullptr, &mDescriptorPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create bindless descriptor pool.");
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts(numSets, mDescriptorSetLayout);
+    std::vector<uint32_t> textureCounts(numSets, mMaxTextures);
+
+    VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO,
+        .descriptorSetCount = numSets,
+        .pDescriptorCounts = textureCounts.data(),
+    };
+
+    VkDescriptorSetAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .pNext = &variableCountInfo,
+        .descriptorPool = mDescriptorPool,
+        .descriptorSetCount = numSets,
+        .pSetLayouts = layouts.data(),
+    };
+
+    mDescriptorSets.resize(numSets);
+    if (vkAllocateDescriptorSets(mDevice, &allocInfo, mDescriptorSets.data()) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate bindless descriptor sets.");
+    }
+
+    std::cout << "Bindless descriptor sets allocated: " << mMaxTextures << " textures, " << mMaxGeometries
+              << " geometries." << std::endl;
+}
+
+void BindlessRegistry::writeBuffer(uint32_t imageIndex, BindlessBinding binding, uint32_t arrayElement,
+                                   VkBuffer buffer)
+{
+    VkDescriptorBufferInfo bufferInfo = {
+        .buffer = buffer,
+        .offset = 0,
+        .range = VK_WHOLE_SIZE,
+    };
+
+    VkWriteDescriptorSet writeDescriptorSet = {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = mDescriptorSets[imageIndex],
+        .dstBinding = binding,
+        .dstArrayElement = arrayElement,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .pBufferInfo = &bufferInfo,
+    };
+    vkUpdateDescriptorSets(mDevice, 1, &writeDescriptorSet, 0, nullptr);
+}
+
+} // namespace VulkanCore
@@ -0,0 +1,133 @@
+#include "ComputePipeline.h"
+#include "DescriptorSetLayoutCache.h"
+#include "Shader.h"
+
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace VulkanCore
+{
+
+ComputePipeline::ComputePipeline(VkDevice device, const std::string& shaderPath,
+                                 DescriptorSetLayoutCache* pLayoutCache, uint32_t localSizeX,
+                                 const std::vector<std::string>& defines, VkDescriptorSetLayout sharedSetLayout)
+    : mDevice{device}, mShaderModule{VK_NULL_HANDLE}, mPipelineLayout{VK_NULL_HANDLE}, mPipeline{VK_NULL_HANDLE},
+      mDescriptorSetLayout{VK_NULL_HANDLE}, mReflection{}, mPoolSizes{}, mLocalSizeX{localSizeX},
+      mSetIndex{sharedSetLayout != VK_NULL_HANDLE ? 1u : 0u}
+{
+    std::vector<uint32_t> spirvCode = CompileShaderToSpirv(shaderPath, defines);
+    mReflection = ReflectSpirv(spirvCode);
+    mShaderModule = CreateShaderModuleFromSpirv(mDevice, spirvCode);
+
+    for (const ReflectedBinding& binding : mReflection.mBindings)
+    {
+        if (binding.mSet != mSetIndex && !(sharedSetLayout != VK_NULL_HANDLE && binding.mSet == 0))
+        {
+            throw std::runtime_error("Compute shader " + shaderPath + ": '" + binding.mName +
+                                     "' uses an unexpected descriptor set " + std::to_string(binding.mSet) + ".");
+        }
+    }
+
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings = GetSetLayoutBindings(mReflection, mSetIndex);
+    mPoolSizes = GetPoolSizes(layoutBindings, 1);
+    mDescriptorSetLayout = pLayoutCache->getLayout(layoutBindings);
+
+    std::vector<VkDescriptorSetLayout> setLayouts = {mDescriptorSetLayout};
+    if (sharedSetLayout != VK_NULL_HANDLE)
+    {
+        setLayouts = {sharedSetLayout, mDescriptorSetLayout};
+    }
+
+    VkPushConstantRange pushConstantRange = mReflection.mPushConstants;
+    VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
+        .setLayoutCount = static_cast<uint32_t>(setLayouts.size()),
+        .pSetLayouts = setLayouts.data(),
+        .pushConstantRangeCount = pushConstantRange.size > 0 ? 1u : 0u,
+        .pPushConstantRanges = pushConstantRange.size > 0 ? &pushConstantRange : nullptr,
+    };
+
+    if (vkCreatePipelineLayout(mDevice, &pipelineLayoutCreateInfo, nullptr, &mPipelineLayout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create compute pipeline layout.");
+    }
+
+    // constant_id 0 : workgroup size
+    VkSpecializationMapEntry localSizeEntry{.constantID = 0, .offset = 0, .size = sizeof(uint32_t)};
+    VkSpecializationInfo specializationInfo{
+        .mapEntryCount = 1,
+        .pMapEntries = &localSizeEntry,
+        .dataSize = sizeof(uint32_t),
+        .pData = &mLocalSizeX,
+    };
+
+    VkComputePipelineCreateInfo pipelineCreateInfo{
+        .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
+        .stage =
+            {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .stage = VK_SHADER_STAGE_COMPUTE_BIT,
+                .module = mShaderModule,
+                .pName = "main",
+                .pSpecializationInfo = &specializationInfo,
+            },
+        .layout = mPipelineLayout,
+        .basePipelineHandle = VK_NULL_HANDLE,
+        .basePipelineIndex = -1,
+    };
+
+    if (vkCreateComputePipelines(mDevice, VK_NULL_HANDLE, 1, &pipelineCreateInfo, nullptr, &mPipeline) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create compute pipeline (" + shaderPath + ").");
+    }
+
+    std::cout << "Compute pipeline created successfully (" << shaderPath << ")." << std::endl;
+}
+
+ComputePipeline::~ComputePipeline()
+{
+    destroy();
+}
+
+void ComputePipeline::destroy()
+{
+    // The set layout is owned by the DescriptorSetLayoutCache
+    if (mPipeline != VK_NULL_HANDLE)
+    {
+        vkDestroyPipeline(mDevice, mPipeline, nullptr);
+        mPipeline = VK_NULL_HANDLE;
+    }
+    if (mPipelineLayout != VK_NULL_HANDLE)
+    {
+        vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr);
+        mPipelineLayout = VK_NULL_HANDLE;
+    }
+    if (mShaderModule != VK_NULL_HANDLE)
+    {
+        vkDestroyShaderModule(mDevice, mShaderModule, nullptr);
+        mShaderModule = VK_NULL_HANDLE;
+    }
+}
+
+void ComputePipeline::bind(VkCommandBuffer commandBuffer) const
+{
+    vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipeline);
+}
+
+void ComputePipeline::bindDescriptorSet(VkCommandBuffer commandBuffer, VkDescriptorSet descriptorSet) const
+{
+    vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, mPipelineLayout, mSetIndex, 1,
+                            &descriptorSet, 0, nullptr);
+}
+
+void ComputePipeline::pushConstants(VkCommandBuffer commandBuffer, const void* pData, uint32_t size) const
+{
+    if (size > mReflection.mPushConstants.size)
+    {
+        throw std::runtime_error("Compute push constants larger than the shader push constant block.");
+    }
+    vkCmdPushConstants(commandBuffer, mPipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, size, pData);
+}
+
+} // namespace VulkanCore
@@ -1,4 +1,6 @@
 #include "Core.h"
+#include "DescriptorAllocator.h"
+#include "DescriptorSetLayoutCache.h"
 #include "Texture.h"
 #include <cstdint>
 #include <iostream>
@@ -24,7 +26,9 @@ namespace VulkanCore
 VulkanCore::VulkanCore()
     : mVulkanInstance(VK_NULL_HANDLE), mDebugMessenger(VK_NULL_HANDLE), mWindow(nullptr),
       mSurface(VK_NULL_HANDLE), mPhysicalDevice{}, mQueueFamilyIndex{0},
-      mLogicalDevice(VK_NULL_HANDLE), mSwapchainSurfaceFormat{},
+      mLogicalDevice(VK_NULL_HANDLE), mDescriptorSetLayoutCache(nullptr), mDescriptorAllocator(nullptr),
+      mFrameDescriptorAllocators{}, mBindlessSupported(false), mGpuDrivenSupported(false),
+      mMeshShaderSupported(false), mSwapchainSurfaceFormat{},
       mSwapchain(VK_NULL_HANDLE), mSwapchainImages{}, mSwapchainImageViews{},
       mCommandPool(VK_NULL_HANDLE), mGraphicsQueue{}, mFrameBuffers{}, mCopyCmdBuffer(VK_NULL_HANDLE),
       mDepthEnabled(false), mInstanceVersion{}
@@ -70,6 +74,25 @@ VulkanCore::~VulkanCore()
     }
     mSwapchain = VK_NULL_HANDLE;
 
+    if (mDescriptorAllocator != nullptr)
+    {
+        delete mDescriptorAllocator;
+        mDescriptorAllocator = nullptr;
+    }
+    for (DescriptorAllocator* pAllocator : mFrameDescriptorAllocators)
+    {
+        delete pAllocator;
+    }
+    mFrameDescriptorAllocators.clear();
+    std::cout << "Descriptor allocators destroyed." << std::endl;
+
+    if (mDescriptorSetLayoutCache != nullptr)
+    {
+        delete mDescriptorSetLayoutCache;
+        mDescriptorSetLayoutCache = nullptr;
+        std::cout << "Descriptor set layout cache destroyed." << std::endl;
+    }
+
     // Destroy logical device
     if (mLogicalDevice != VK_NULL_HANDLE)
     {
@@ -113,8 +136,10 @@ void VulkanCore::initialize(std::string appName, GLFWwindow* window, bool depthE
     mPhysicalDevice.init(mVulkanInstance, mSurface);
     mQueueFamilyIndex = mPhysicalDevice.selectPhysicalDevice(VK_QUEUE_GRAPHICS_BIT, true);
     createLogicalDevice();
+    mDescriptorSetLayoutCache = new DescriptorSetLayoutCache(mLogicalDevice);
     createSwapChain();
     createCommandBufferPool();
+    createDescriptorAllocators();
 
     // Initialize graphics queue
     mGraphicsQueue.init(mLogicalDevice, mSwapchain, mQueueFamilyIndex, 0);
@@ -127,6 +152,30 @@ void VulkanCore::initialize(std::string appName, GLFWwindow* window, bool depthE
     }
 }
 
+void VulkanCore::createDescriptorAllocators()
+{
+    // Descriptors per set, typical of the model / skybox layouts : VB + IB + uniform + two textures
+    std::vector<DescriptorPoolRatio> ratios = {
+        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 2.0f},
+        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1.0f},
+        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 2.0f},
+    };
+
+    mDescriptorAllocator = new DescriptorAllocator(mLogicalDevice, "persistent", 64, ratios);
+
+    mFrameDescriptorAllocators.resize(mSwapchainImages.size());
+    for (size_t imageIndex = 0; imageIndex < mSwapchainImages.size(); imageIndex++)
+    {
+        mFrameDescriptorAllocators[imageIndex] =
+            new DescriptorAllocator(mLogicalDevice, "frame " + std::to_string(imageIndex), 16, ratios);
+    }
+}
+
+void VulkanCore::resetFrameDescriptors(uint32_t imageIndex)
+{
+    mFrameDescriptorAllocators[imageIndex]->reset();
+}
+
 void VulkanCore::createInstance(std::string appName)
 {
     getInstanceVersion();
@@ -304,6 +353,90 @@ void VulkanCore::createLogicalDevice()
         .dynamicRendering = VK_TRUE,
     };
 
+    // Descriptor indexing (core in Vulkan 1.2) for the bindless path, enabled only when the device has
+    // everything BindlessRegistry relies on
+    const VkPhysicalDeviceVulkan12Features& supported12 = physicalDeviceProps.mFeatures12;
+    mBindlessSupported = supported12.descriptorIndexing && supported12.runtimeDescriptorArray &&
+                         supported12.descriptorBindingPartiallyBound &&
+                         supported12.descriptorBindingVariableDescriptorCount &&
+                         supported12.shaderSampledImageArrayNonUniformIndexing &&
+                         supported12.descriptorBindingSampledImageUpdateAfterBind &&
+                         supported12.descriptorBindingStorageBufferUpdateAfterBind &&
+                         supported12.descriptorBindingUpdateUnusedWhilePending;
+
+    VkPhysicalDeviceVulkan12Features features12 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES,
+        .pNext = nullptr,
+    };
+    if (mBindlessSupported)
+    {
+        features12.descriptorIndexing = VK_TRUE;
+        features12.runtimeDescriptorArray = VK_TRUE;
+        features12.descriptorBindingPartiallyBound = VK_TRUE;
+        features12.descriptorBindingVariableDescriptorCount = VK_TRUE;
+        features12.shaderSampledImageArrayNonUniformIndexing = VK_TRUE;
+        features12.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+        features12.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+        features12.descriptorBindingUpdateUnusedWhilePending = VK_TRUE;
+        dynamicRenderingFeature.pNext = &features12;
+        std::cout << "Descriptor indexing enabled (bindless)." << std::endl;
+    }
+    else
+    {
+        std::cout << "Descriptor indexing not supported, bindless path disabled." << std::endl;
+    }
+
+    // GPU-driven rendering (IndirectDrawList) : bindless set + compute built draws + vkCmdDrawIndirectCount
+    // with gl_DrawID in the vertex shader. The cull pass reads the transforms of any geometry per invocation.
+    const VkQueueFamilyProperties& queueFamily = physicalDeviceProps.mQueueFamilyProperties[mQueueFamilyIndex];
+    mGpuDrivenSupported = mBindlessSupported && physicalDeviceProps.mFeatures11.shaderDrawParameters &&
+                          supported12.drawIndirectCount && physicalDeviceProps.mFeatures.multiDrawIndirect &&
+                          supported12.shaderStorageBufferArrayNonUniformIndexing &&
+                          (queueFamily.queueFlags & VK_QUEUE_COMPUTE_BIT) != 0;
+
+    VkPhysicalDeviceVulkan11Features features11 = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES,
+        .pNext = nullptr,
+    };
+    if (mGpuDrivenSupported)
+    {
+        deviceFeatures.multiDrawIndirect = VK_TRUE;
+        features11.shaderDrawParameters = VK_TRUE;
+        features12.drawIndirectCount = VK_TRUE;
+        features12.shaderStorageBufferArrayNonUniformIndexing = VK_TRUE;
+        features11.pNext = &features12;
+        dynamicRenderingFeature.pNext = &features11;
+        std::cout << "Draw indirect count enabled (GPU-driven rendering)." << std::endl;
+    }
+    else
+    {
+        std::cout << "Draw indirect count not supported, GPU-driven path disabled." << std::endl;
+    }
+
+    // Mesh shaders (MeshletDrawList) : task and mesh stages reading the bindless set, on top of the GPU-driven
+    // requirements. Without them meshlets go through IndirectDrawList.
+    const VkPhysicalDeviceMeshShaderFeaturesEXT& supportedMeshShader = physicalDeviceProps.mMeshShaderFeatures;
+    mMeshShaderSupported = mGpuDrivenSupported &&
+                           physicalDeviceProps.isExtensionSupported(VK_EXT_MESH_SHADER_EXTENSION_NAME) &&
+                           supportedMeshShader.taskShader && supportedMeshShader.meshShader;
+
+    VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT,
+        .pNext = nullptr,
+    };
+    if (mMeshShaderSupported)
+    {
+        deviceExtensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+        meshShaderFeatures.taskShader = VK_TRUE;
+        meshShaderFeatures.meshShader = VK_TRUE;
+        features12.pNext = &meshShaderFeatures;
+        std::cout << "Mesh shaders enabled (meshlet rendering)." << std::endl;
+    }
+    else
+    {
+        std::cout << "Mesh shaders not supported, meshlets use the indirect draw path." << std::endl;
+    }
+
     VkDeviceCreateInfo deviceCreateInfo = {.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO,
                                            .pNext = &dynamicRenderingFeature,
                                            .flags = 0,
@@ -639,6 +772,17 @@ void VulkanCore::destroyFramebuffers(std::vector<VkFramebuffer>& framebuffers)
 }
 
 BufferAndMemory VulkanCore::createVertexBuffer(const void* pVertices, size_t size)
+{
+    void* pData;
+    BufferAndMemory stagingVB = createStagingBuffer(size, pData);
+
+    // Copy the vertices to the staging buffer
+    memcpy(pData, pVertices, size);
+
+    return createVertexBuffer(stagingVB, size);
+}
+
+BufferAndMemory VulkanCore::createStagingBuffer(VkDeviceSize size, void*& pData)
 {
     // Step1 : create staging buffer
     VkBufferUsageFlags usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT;
@@ -646,19 +790,20 @@ BufferAndMemory VulkanCore::createVertexBuffer(const void* pVertices, size_t siz
     BufferAndMemory stagingVB = createBuffer(size, usage, memProperties);
 
     // Step2 : map the memory of the stage buffer
-    void* pData;
     VkDeviceSize offset = 0;
     VkMemoryMapFlags flags = 0;
     if (vkMapMemory(mLogicalDevice, stagingVB.mMemory, offset, stagingVB.mAllocationSize, flags, &pData) != VK_SUCCESS)
     {
+        stagingVB.Destroy(mLogicalDevice);
         throw std::runtime_error("Failed to map vertex buffer memory!");
     }
+    return stagingVB;
+}
 
-    // Step 3 : copy the vertices to the staging buffer
-    memcpy(pData, pVertices, size);
-
+BufferAndMemory VulkanCore::createVertexBuffer(BufferAndMemory& stagingBuffer, VkDeviceSize size)
+{
     // step4 : unmao/release the mapped meory
-    vkUnmapMemory(mLogicalDevice, stagingVB.mMemory);
+    vkUnmapMemory(mLogicalDevice, stagingBuffer.mMemory);
 
     // Step 5 : create the final vertex buffer with device local memory propertys
     // usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
@@ -667,19 +812,25 @@ BufferAndMemory VulkanCore::createVertexBuffer(const void* pVertices, size_t siz
     // (PVP) approach so we don't need VK_BUFFER_USAGE_VERTEX_BUFFER_BIT in the
     // usage flags but STORAGE_BUFFER_BIT is required to use the buffer in the
     // descriptor set as storage buffer
-    usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
-    memProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    VkMemoryPropertyFlags memProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
     BufferAndMemory vertexBuffer = createBuffer(size, usage, memProperties);
 
     // Step 6 : copy data from staging buffer to vertex buffer
-    copyBuffer(stagingVB.mBuffer, vertexBuffer.mBuffer, size);
+    copyBuffer(stagingBuffer.mBuffer, vertexBuffer.mBuffer, size);
 
     // Step 7 : destroy staging buffer and free its memory
-    stagingVB.Destroy(mLogicalDevice);
+    stagingBuffer.Destroy(mLogicalDevice);
 
     return vertexBuffer;
 }
 
+BufferAndMemory VulkanCore::createStorageBuffer(VkDeviceSize size, VkBufferUsageFlags additionalUsage)
+{
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | additionalUsage;
+    return createBuffer(size, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+}
+
 BufferAndMemory VulkanCore::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage,
                                          VkMemoryPropertyFlags reqMemPropFlags)
 {
@@ -773,7 +924,8 @@ std::vector<BufferAndMemory> VulkanCore::createUniformBuffers(size_t size)
 
     for (int32_t i{0}; i < static_cast<int32_t>(mSwapchainImages.size()); ++i)
     {
-        VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT;
+        // storage usage as well so the bindless path can index them from a buffer array
+        VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT;
         VkMemoryPropertyFlags memProperties =
             VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT;
         uniformBuffers[i] = createBuffer(size, usage, memProperties);
@@ -806,6 +958,16 @@ void BufferAndMemory::update(VkDevice device, const void* pData, VkDeviceSize si
     }
 }
 
+void BufferAndMemory::read(VkDevice device, void* pData, VkDeviceSize size) const
+{
+    void* mappedData = nullptr;
+    if (vkMapMemory(device, mMemory, 0, size, 0, &mappedData) == VK_SUCCESS)
+    {
+        memcpy(pData, mappedData, static_cast<size_t>(size));
+        vkUnmapMemory(device, mMemory);
+    }
+}
+
 void VulkanCore::createTexture(std::string filePath, Texture& outTexture)
 {
     // Step1 : Load image using stb_image
@@ -915,7 +1077,8 @@ void VulkanCore::createTextureFromData(const void* pixels, uint32_t width, uint3
 }
 
 void VulkanCore::createImage(Texture& outTexture, uint32_t width, uint32_t height, VkFormat format,
-                             VkImageUsageFlags usage, VkMemoryPropertyFlags reqMemPropFlags, bool isCubemap)
+                             VkImageUsageFlags usage, VkMemoryPropertyFlags reqMemPropFlags, bool isCubemap,
+                             uint32_t mipLevels)
 {
     // Step 1: Create image
     VkImageCreateInfo imageCreateInfo = {
@@ -925,7 +1088,7 @@ void VulkanCore::createImage(Texture& outTexture, uint32_t width, uint32_t heigh
         .imageType = VK_IMAGE_TYPE_2D,
         .format = format,
         .extent = {.width = static_cast<uint32_t>(width), .height = static_cast<uint32_t>(height), .depth = 1},
-        .mipLevels = 1,
+        .mipLevels = mipLevels,
         .arrayLayers = isCubemap ? 6U : 1U,
         .samples = VK_SAMPLE_COUNT_1_BIT,
         .tiling = VK_IMAGE_TILING_OPTIMAL,
@@ -966,6 +1129,47 @@ void VulkanCore::createImage(Texture& outTexture, uint32_t width, uint32_t heigh
     }
 }
 
+void VulkanCore::createStorageImage(Texture& outTexture, uint32_t width, uint32_t height, VkFormat format,
+                                    uint32_t mipLevels, const VkClearColorValue& clearValue)
+{
+    VkImageUsageFlags usage =
+        VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+    createImage(outTexture, width, height, format, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false, mipLevels);
+    outTexture.mWidth = width;
+    outTexture.mHeight = height;
+
+    VkImageSubresourceRange range = {
+        .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+        .baseMipLevel = 0,
+        .levelCount = mipLevels,
+        .baseArrayLayer = 0,
+        .layerCount = 1,
+    };
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = 0,
+        .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .oldLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .newLayout = VK_IMAGE_LAYOUT_GENERAL,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = outTexture.mImage,
+        .subresourceRange = range,
+    };
+
+    BeginCommandBuffer(mCopyCmdBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+    vkCmdPipelineBarrier(mCopyCmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0,
+                         nullptr, 0, nullptr, 1, &barrier);
+    vkCmdClearColorImage(mCopyCmdBuffer, outTexture.mImage, VK_IMAGE_LAYOUT_GENERAL, &clearValue, 1, &range);
+
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+    vkCmdPipelineBarrier(mCopyCmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 0,
+                         nullptr, 0, nullptr, 1, &barrier);
+    submitCopyCommand();
+}
+
 void VulkanCore::updateTextureImage(Texture& outTexture, uint32_t width, uint32_t height, VkFormat format,
                                     int32_t layerCount, const void* pixels, bool isCubemap)
 {
@@ -1047,8 +1251,8 @@ void VulkanCore::createDepthResources()
     VkFormat depthFormat = mPhysicalDevice.getSelectedPhysicalDeviceProperties().mDepthFormat;
     for (int32_t i = 0; i < numSwapChainImages; ++i)
     {
-        // Create depth image
-        VkImageUsageFlagBits usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
+        // Create depth image, sampled by the HiZ pyramid build
+        VkImageUsageFlags usage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
         VkMemoryPropertyFlagBits memProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT;
         createImage(mDepthImages[i], surfaceCaps.currentExtent.width, surfaceCaps.currentExtent.height, depthFormat,
                     usage, memProperties, false);
@@ -1084,6 +1288,15 @@ VkImageView VulkanCore::getDepthImageView(uint32_t index) const
     return mDepthImages[index].mImageView;
 }
 
+VkImage VulkanCore::getDepthImage(uint32_t index) const
+{
+    if (index >= mDepthImages.size())
+    {
+        throw std::out_of_range("Depth image index out of range: " + std::to_string(index));
+    }
+    return mDepthImages[index].mImage;
+}
+
 VkImageView VulkanCore::getSwapchainImageView(uint32_t index) const
 {
     if (index >= mSwapchainImageViews.size())
@@ -1157,4 +1370,56 @@ void VulkanCore::beginDynamicRendering(VkCommandBuffer commandBuffer, uint32_t i
     vkCmdBeginRendering(commandBuffer, &renderingInfo);
 }
 
+void VulkanCore::beginDepthOnlyRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex, VkClearValue* clearDepth)
+{
+    VkRenderingAttachmentInfoKHR depthAttachment = {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO_KHR,
+        .pNext = nullptr,
+        .imageView = getDepthImageView(imageIndex),
+        .imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+        .resolveMode = VK_RESOLVE_MODE_NONE,
+        .resolveImageView = VK_NULL_HANDLE,
+        .resolveImageLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+        .loadOp = clearDepth ? VK_ATTACHMENT_LOAD_OP_CLEAR : VK_ATTACHMENT_LOAD_OP_LOAD,
+        .storeOp = VK_ATTACHMENT_STORE_OP_STORE,
+    };
+    if (clearDepth)
+    {
+        depthAttachment.clearValue = *clearDepth;
+    }
+
+    int32_t windowWidth{0}, windowHeight{0};
+    glfwGetFramebufferSize(mWindow, &windowWidth, &windowHeight);
+
+    VkRenderingInfoKHR renderingInfo = {
+        .sType = VK_STRUCTURE_TYPE_RENDERING_INFO_KHR,
+        .pNext = nullptr,
+        .flags = 0,
+        .renderArea = {.offset = {0, 0},
+                       .extent = {static_cast<uint32_t>(windowWidth), static_cast<uint32_t>(windowHeight)}},
+        .layerCount = 1,
+        .viewMask = 0,
+        .colorAttachmentCount = 0,
+        .pColorAttachments = nullptr,
+        .pDepthAttachment = &depthAttachment,
+        .pStencilAttachment = nullptr,
+    };
+    vkCmdBeginRendering(commandBuffer, &renderingInfo);
+}
+
+void VulkanCore::endDepthOnlyRendering(VkCommandBuffer commandBuffer)
+{
+    vkCmdEndRendering(commandBuffer);
+
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext = nullptr,
+        .srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+    };
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                         VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, 0, 1,
+                         &barrier, 0, nullptr, 0, nullptr);
+}
+
 } // namespace VulkanCore
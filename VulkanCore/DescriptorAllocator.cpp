@@ -0,0 +1,260 @@
+#include "DescriptorAllocator.h"
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace VulkanCore
+{
+
+namespace
+{
+
+constexpr uint32_t MaxSetsPerPool = 4096;
+
+uint32_t getCount(const std::vector<VkDescriptorPoolSize>& sizes, VkDescriptorType type)
+{
+    for (const VkDescriptorPoolSize& size : sizes)
+    {
+        if (size.type == type)
+        {
+            return size.descriptorCount;
+        }
+    }
+    return 0;
+}
+
+void addCount(std::vector<VkDescriptorPoolSize>& sizes, VkDescriptorType type, uint32_t count)
+{
+    for (VkDescriptorPoolSize& size : sizes)
+    {
+        if (size.type == type)
+        {
+            size.descriptorCount += count;
+            return;
+        }
+    }
+    sizes.push_back({type, count});
+}
+
+} // namespace
+
+DescriptorAllocator::DescriptorAllocator(VkDevice device, std::string name, uint32_t setsPerPool,
+                                         std::vector<DescriptorPoolRatio> ratios, VkDescriptorPoolCreateFlags flags)
+    : mDevice{device}, mName{std::move(name)}, mSetsPerPool{std::max(setsPerPool, 1u)}, mRatios{std::move(ratios)},
+      mFlags{flags}, mReadyPools{}, mFullPools{}
+{
+}
+
+DescriptorAllocator::~DescriptorAllocator()
+{
+    destroy();
+}
+
+void DescriptorAllocator::destroy()
+{
+    for (Pool& pool : mReadyPools)
+    {
+        vkDestroyDescriptorPool(mDevice, pool.mPool, nullptr);
+    }
+    for (Pool& pool : mFullPools)
+    {
+        vkDestroyDescriptorPool(mDevice, pool.mPool, nullptr);
+    }
+    mReadyPools.clear();
+    mFullPools.clear();
+}
+
+void DescriptorAllocator::allocate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorPoolSize>& setSizes,
+                                   uint32_t count, VkDescriptorSet* pDescriptorSets, const void* pNext)
+{
+    if (count == 0)
+    {
+        return;
+    }
+
+    // Try the ready pools, newest first, retiring the ones that are out of space
+    while (!mReadyPools.empty())
+    {
+        if (tryAllocate(mReadyPools.back(), layout, setSizes, count, pDescriptorSets, pNext))
+        {
+            return;
+        }
+        mFullPools.push_back(std::move(mReadyPools.back()));
+        mReadyPools.pop_back();
+    }
+
+    // New pool, large enough for this request even if it exceeds the ratios
+    std::vector<VkDescriptorPoolSize> requestSizes = setSizes;
+    for (VkDescriptorPoolSize& size : requestSizes)
+    {
+        size.descriptorCount *= count;
+    }
+    mReadyPools.push_back(createPool(count, requestSizes));
+    mSetsPerPool = std::min(mSetsPerPool * 2, MaxSetsPerPool);
+
+    if (!tryAllocate(mReadyPools.back(), layout, setSizes, count, pDescriptorSets, pNext))
+    {
+        throw std::runtime_error("Failed to allocate descriptor sets from a new pool (" + mName + ").");
+    }
+}
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout layout,
+                                              const std::vector<VkDescriptorPoolSize>& setSizes, const void* pNext)
+{
+    VkDescriptorSet descriptorSet = VK_NULL_HANDLE;
+    allocate(layout, setSizes, 1, &descriptorSet, pNext);
+    return descriptorSet;
+}
+
+void DescriptorAllocator::reset()
+{
+    for (Pool& pool : mFullPools)
+    {
+        mReadyPools.push_back(std::move(pool));
+    }
+    mFullPools.clear();
+
+    for (Pool& pool : mReadyPools)
+    {
+        vkResetDescriptorPool(mDevice, pool.mPool, 0);
+        pool.mSetsAllocated = 0;
+        pool.mUsed.clear();
+    }
+}
+
+DescriptorAllocatorStats DescriptorAllocator::getStats() const
+{
+    DescriptorAllocatorStats stats;
+    stats.mNumPools = static_cast<uint32_t>(mReadyPools.size() + mFullPools.size());
+    stats.mNumFullPools = static_cast<uint32_t>(mFullPools.size());
+
+    auto accumulate = [&stats](const Pool& pool) {
+        stats.mSetCapacity += pool.mMaxSets;
+        stats.mSetsAllocated += pool.mSetsAllocated;
+        for (const VkDescriptorPoolSize& capacity : pool.mCapacity)
+        {
+            auto it = std::find_if(stats.mTypes.begin(), stats.mTypes.end(),
+                                   [&capacity](const DescriptorTypeUsage& x) { return x.mType == capacity.type; });
+            if (it == stats.mTypes.end())
+            {
+                stats.mTypes.push_back({capacity.type, 0, 0});
+                it = stats.mTypes.end() - 1;
+            }
+            it->mCapacity += capacity.descriptorCount;
+            it->mUsed += getCount(pool.mUsed, capacity.type);
+        }
+    };
+
+    for (const Pool& pool : mReadyPools)
+    {
+        accumulate(pool);
+    }
+    for (const Pool& pool : mFullPools)
+    {
+        accumulate(pool);
+    }
+    return stats;
+}
+
+void DescriptorAllocator::printStats() const
+{
+    DescriptorAllocatorStats stats = getStats();
+    std::cout << "Descriptor allocator '" << mName << "': " << stats.mNumPools << " pools (" << stats.mNumFullPools
+              << " full), sets " << stats.mSetsAllocated << "/" << stats.mSetCapacity << std::endl;
+    for (const DescriptorTypeUsage& usage : stats.mTypes)
+    {
+        float percent = usage.mCapacity ? 100.0f * usage.mUsed / usage.mCapacity : 0.0f;
+        std::cout << "    " << GetDescriptorTypeName(usage.mType) << ": " << usage.mUsed << "/" << usage.mCapacity
+                  << " (" << percent << "%)" << std::endl;
+    }
+}
+
+DescriptorAllocator::Pool DescriptorAllocator::createPool(uint32_t minSets,
+                                                          const std::vector<VkDescriptorPoolSize>& minSizes)
+{
+    Pool pool;
+    pool.mMaxSets = std::max(mSetsPerPool, minSets);
+
+    for (const DescriptorPoolRatio& ratio : mRatios)
+    {
+        uint32_t count = static_cast<uint32_t>(std::ceil(ratio.mRatio * pool.mMaxSets));
+        addCount(pool.mCapacity, ratio.mType, count);
+    }
+    for (const VkDescriptorPoolSize& size : minSizes)
+    {
+        uint32_t missing = size.descriptorCount > getCount(pool.mCapacity, size.type)
+                               ? size.descriptorCount - getCount(pool.mCapacity, size.type)
+                               : 0;
+        if (missing > 0)
+        {
+            addCount(pool.mCapacity, size.type, missing);
+        }
+    }
+
+    VkDescriptorPoolCreateInfo poolInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
+        .flags = mFlags,
+        .maxSets = pool.mMaxSets,
+        .poolSizeCount = static_cast<uint32_t>(pool.mCapacity.size()),
+        .pPoolSizes = pool.mCapacity.data(),
+    };
+
+    if (vkCreateDescriptorPool(mDevice, &poolInfo, nullptr, &pool.mPool) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create descriptor pool (" + mName + ").");
+    }
+
+    std::cout << "Descriptor pool created (" << mName << "): " << pool.mMaxSets << " sets." << std::endl;
+    return pool;
+}
+
+bool DescriptorAllocator::tryAllocate(Pool& pool, VkDescriptorSetLayout layout,
+                                      const std::vector<VkDescriptorPoolSize>& setSizes, uint32_t count,
+                                      VkDescriptorSet* pDescriptorSets, const void* pNext)
+{
+    // Check our own bookkeeping first, drivers are not required to report exhaustion precisely
+    if (pool.mSetsAllocated + count > pool.mMaxSets)
+    {
+        return false;
+    }
+    for (const VkDescriptorPoolSize& size : setSizes)
+    {
+        if (getCount(pool.mUsed, size.type) + size.descriptorCount * count > getCount(pool.mCapacity, size.type))
+        {
+            return false;
+        }
+    }
+
+    std::vector<VkDescriptorSetLayout> layouts(count, layout);
+    VkDescriptorSetAllocateInfo allocInfo{
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
+        .pNext = pNext,
+        .descriptorPool = pool.mPool,
+        .descriptorSetCount = count,
+        .pSetLayouts = layouts.data(),
+    };
+
+    VkResult result = vkAllocateDescriptorSets(mDevice, &allocInfo, pDescriptorSets);
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+    {
+        return false;
+    }
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to allocate descriptor sets (" + mName + ").");
+    }
+
+    pool.mSetsAllocated += count;
+    for (const VkDescriptorPoolSize& size : setSizes)
+    {
+        addCount(pool.mUsed, size.type, size.descriptorCount * count);
+    }
+    return true;
+}
+
+} // namespace VulkanCore
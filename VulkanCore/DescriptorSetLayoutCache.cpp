@@ -0,0 +1,126 @@
+#include "DescriptorSetLayoutCache.h"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <vector>
+
+namespace VulkanCore
+{
+
+DescriptorSetLayoutCache::DescriptorSetLayoutCache(VkDevice device) : mDevice{device}, mLayouts{}
+{
+}
+
+DescriptorSetLayoutCache::~DescriptorSetLayoutCache()
+{
+    destroy();
+}
+
+void DescriptorSetLayoutCache::destroy()
+{
+    for (auto& [key, layout] : mLayouts)
+    {
+        vkDestroyDescriptorSetLayout(mDevice, layout, nullptr);
+    }
+    mLayouts.clear();
+}
+
+VkDescriptorSetLayout DescriptorSetLayoutCache::getLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+                                                          VkDescriptorSetLayoutCreateFlags flags,
+                                                          const std::vector<VkDescriptorBindingFlags>& bindingFlags)
+{
+    if (!bindingFlags.empty() && bindingFlags.size() != bindings.size())
+    {
+        throw std::runtime_error("Descriptor binding flags do not match the number of bindings.");
+    }
+
+    std::vector<size_t> order(bindings.size());
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(),
+              [&bindings](size_t a, size_t b) { return bindings[a].binding < bindings[b].binding; });
+
+    LayoutKey key{flags, {}, {}};
+    for (size_t i : order)
+    {
+        key.mBindings.push_back(bindings[i]);
+        if (!bindingFlags.empty())
+        {
+            key.mBindingFlags.push_back(bindingFlags[i]);
+        }
+    }
+
+    auto it = mLayouts.find(key);
+    if (it != mLayouts.end())
+    {
+        return it->second;
+    }
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO,
+        .bindingCount = static_cast<uint32_t>(key.mBindingFlags.size()),
+        .pBindingFlags = key.mBindingFlags.data(),
+    };
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .pNext = key.mBindingFlags.empty() ? nullptr : &bindingFlagsInfo,
+        .flags = flags,
+        .bindingCount = static_cast<uint32_t>(key.mBindings.size()),
+        .pBindings = key.mBindings.data(),
+    };
+
+    VkDescriptorSetLayout layout = VK_NULL_HANDLE;
+    if (vkCreateDescriptorSetLayout(mDevice, &layoutInfo, nullptr, &layout) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create descriptor set layout.");
+    }
+
+    mLayouts.emplace(std::move(key), layout);
+    std::cout << "Descriptor set layout cached (" << mLayouts.size() << " layouts)." << std::endl;
+    return layout;
+}
+
+bool DescriptorSetLayoutCache::LayoutKey::operator==(const LayoutKey& other) const
+{
+    if (mFlags != other.mFlags || mBindings.size() != other.mBindings.size() ||
+        mBindingFlags != other.mBindingFlags)
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < mBindings.size(); i++)
+    {
+        const VkDescriptorSetLayoutBinding& a = mBindings[i];
+        const VkDescriptorSetLayoutBinding& b = other.mBindings[i];
+        if (a.binding != b.binding || a.descriptorType != b.descriptorType || a.descriptorCount != b.descriptorCount ||
+            a.stageFlags != b.stageFlags || a.pImmutableSamplers != b.pImmutableSamplers)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+size_t DescriptorSetLayoutCache::LayoutKeyHash::operator()(const LayoutKey& key) const
+{
+    size_t hash = std::hash<uint32_t>()(key.mFlags);
+    for (const VkDescriptorSetLayoutBinding& binding : key.mBindings)
+    {
+        size_t bindingHash = binding.binding | (static_cast<size_t>(binding.descriptorType) << 8) |
+                             (static_cast<size_t>(binding.descriptorCount) << 16) |
+                             (static_cast<size_t>(binding.stageFlags) << 32);
+        hash ^= std::hash<size_t>()(bindingHash) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+    for (VkDescriptorBindingFlags bindingFlags : key.mBindingFlags)
+    {
+        hash ^= std::hash<uint32_t>()(bindingFlags) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    }
+    return hash;
+}
+
+} // namespace VulkanCore
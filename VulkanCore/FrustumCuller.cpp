@@ -0,0 +1,279 @@
+#include "FrustumCuller.h"
+
+#include <bit>
+#include <stdexcept>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FRUSTUM_CULLER_X86
+#include <immintrin.h>
+#endif
+
+namespace VulkanCore
+{
+
+namespace
+{
+
+constexpr uint32_t kNumPlanes = 6;
+
+uint32_t getPaddedSize(uint32_t numSpheres)
+{
+    return (numSpheres + 7) & ~7u;
+}
+
+// Lanes past the last sphere are padding and never visible
+uint32_t getValidLanes(uint32_t first, uint32_t numSpheres, uint32_t width)
+{
+    uint32_t remaining = numSpheres - first;
+    return remaining >= width ? (1u << width) - 1 : (1u << remaining) - 1;
+}
+
+void appendVisible(uint32_t first, uint32_t mask, std::vector<uint32_t>& visible)
+{
+    while (mask)
+    {
+        visible.push_back(first + std::countr_zero(mask));
+        mask &= mask - 1;
+    }
+}
+
+} // namespace
+
+const char* GetCullPathName(CullPath path)
+{
+    switch (path)
+    {
+    case CullPath_None:
+        return "Off";
+    case CullPath_Scalar:
+        return "Scalar";
+    case CullPath_SSE:
+        return "SSE";
+    case CullPath_AVX2:
+        return "AVX2";
+    default:
+        return "Unknown";
+    }
+}
+
+FrustumCuller::FrustumCuller()
+    : mPath{getBestPath()}, mNumSpheres{0}, mCenterX{}, mCenterY{}, mCenterZ{}, mRadius{}
+{
+}
+
+uint32_t FrustumCuller::addSphere(const glm::vec4& sphere)
+{
+    uint32_t index = mNumSpheres++;
+    uint32_t paddedSize = getPaddedSize(mNumSpheres);
+    mCenterX.resize(paddedSize, 0.0f);
+    mCenterY.resize(paddedSize, 0.0f);
+    mCenterZ.resize(paddedSize, 0.0f);
+    mRadius.resize(paddedSize, 0.0f);
+    setSphere(index, sphere);
+    return index;
+}
+
+void FrustumCuller::setSphere(uint32_t index, const glm::vec4& sphere)
+{
+    if (index >= mNumSpheres)
+    {
+        throw std::runtime_error("Invalid sphere index " + std::to_string(index) + " for frustum culling.");
+    }
+    mCenterX[index] = sphere.x;
+    mCenterY[index] = sphere.y;
+    mCenterZ[index] = sphere.z;
+    mRadius[index] = sphere.w;
+}
+
+void FrustumCuller::clear()
+{
+    mNumSpheres = 0;
+    mCenterX.clear();
+    mCenterY.clear();
+    mCenterZ.clear();
+    mRadius.clear();
+}
+
+void FrustumCuller::setPath(CullPath path)
+{
+    if (!isPathSupported(path))
+    {
+        throw std::runtime_error(std::string("Cull path not supported by this CPU: ") + GetCullPathName(path));
+    }
+    mPath = path;
+}
+
+void FrustumCuller::cull(const glm::mat4& viewProj, std::vector<uint32_t>& visible) const
+{
+    cull(viewProj, mPath, visible);
+}
+
+void FrustumCuller::cull(const glm::mat4& viewProj, CullPath path, std::vector<uint32_t>& visible) const
+{
+    if (!isPathSupported(path))
+    {
+        throw std::runtime_error(std::string("Cull path not supported by this CPU: ") + GetCullPathName(path));
+    }
+    visible.clear();
+    visible.reserve(mNumSpheres);
+
+    FrustumPlanes planes = extractPlanes(viewProj);
+    switch (path)
+    {
+    case CullPath_None:
+        for (uint32_t index = 0; index < mNumSpheres; index++)
+        {
+            visible.push_back(index);
+        }
+        break;
+    case CullPath_Scalar:
+        cullScalar(planes, visible);
+        break;
+    case CullPath_SSE:
+        cullSSE(planes, visible);
+        break;
+    case CullPath_AVX2:
+        cullAVX2(planes, visible);
+        break;
+    default:
+        throw std::runtime_error("Invalid cull path " + std::to_string(path));
+    }
+}
+
+FrustumPlanes FrustumCuller::extractPlanes(const glm::mat4& viewProj)
+{
+    // glm is column major : row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i])
+    glm::mat4 m = glm::transpose(viewProj);
+    glm::vec4 clipPlanes[kNumPlanes] = {m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[2], m[3] - m[2]};
+
+    FrustumPlanes planes;
+    for (uint32_t i = 0; i < kNumPlanes; i++)
+    {
+        // Normalized so the signed distance compares directly with the radius
+        glm::vec4 plane = clipPlanes[i] / glm::length(glm::vec3(clipPlanes[i]));
+        planes.mNormalX[i] = plane.x;
+        planes.mNormalY[i] = plane.y;
+        planes.mNormalZ[i] = plane.z;
+        planes.mDistance[i] = plane.w;
+    }
+    return planes;
+}
+
+CullPath FrustumCuller::getBestPath()
+{
+    if (isPathSupported(CullPath_AVX2))
+    {
+        return CullPath_AVX2;
+    }
+    if (isPathSupported(CullPath_SSE))
+    {
+        return CullPath_SSE;
+    }
+    return CullPath_Scalar;
+}
+
+bool FrustumCuller::isPathSupported(CullPath path)
+{
+    switch (path)
+    {
+    case CullPath_None:
+    case CullPath_Scalar:
+        return true;
+#ifdef FRUSTUM_CULLER_X86
+    case CullPath_SSE:
+        return __builtin_cpu_supports("sse2");
+    case CullPath_AVX2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+void FrustumCuller::cullScalar(const FrustumPlanes& planes, std::vector<uint32_t>& visible) const
+{
+    for (uint32_t index = 0; index < mNumSpheres; index++)
+    {
+        bool outside = false;
+        for (uint32_t i = 0; i < kNumPlanes && !outside; i++)
+        {
+            float distance = planes.mNormalX[i] * mCenterX[index] + planes.mNormalY[i] * mCenterY[index] +
+                             planes.mNormalZ[i] * mCenterZ[index] + planes.mDistance[i];
+            outside = distance < -mRadius[index];
+        }
+        if (!outside)
+        {
+            visible.push_back(index);
+        }
+    }
+}
+
+#ifdef FRUSTUM_CULLER_X86
+
+__attribute__((target("sse2"))) void FrustumCuller::cullSSE(const FrustumPlanes& planes,
+                                                              std::vector<uint32_t>& visible) const
+{
+    for (uint32_t first = 0; first < mNumSpheres; first += 4)
+    {
+        __m128 centerX = _mm_loadu_ps(&mCenterX[first]);
+        __m128 centerY = _mm_loadu_ps(&mCenterY[first]);
+        __m128 centerZ = _mm_loadu_ps(&mCenterZ[first]);
+        __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&mRadius[first]));
+
+        __m128 outside = _mm_setzero_ps();
+        for (uint32_t i = 0; i < kNumPlanes; i++)
+        {
+            __m128 distance = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.mNormalX[i]), centerX),
+                                         _mm_mul_ps(_mm_set1_ps(planes.mNormalY[i]), centerY));
+            distance = _mm_add_ps(distance, _mm_mul_ps(_mm_set1_ps(planes.mNormalZ[i]), centerZ));
+            distance = _mm_add_ps(distance, _mm_set1_ps(planes.mDistance[i]));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, negRadius));
+        }
+
+        uint32_t mask = ~static_cast<uint32_t>(_mm_movemask_ps(outside)) & getValidLanes(first, mNumSpheres, 4);
+        appendVisible(first, mask, visible);
+    }
+}
+
+__attribute__((target("avx2"))) void FrustumCuller::cullAVX2(const FrustumPlanes& planes,
+                                                               std::vector<uint32_t>& visible) const
+{
+    for (uint32_t first = 0; first < mNumSpheres; first += 8)
+    {
+        __m256 centerX = _mm256_loadu_ps(&mCenterX[first]);
+        __m256 centerY = _mm256_loadu_ps(&mCenterY[first]);
+        __m256 centerZ = _mm256_loadu_ps(&mCenterZ[first]);
+        __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&mRadius[first]));
+
+        __m256 outside = _mm256_setzero_ps();
+        for (uint32_t i = 0; i < kNumPlanes; i++)
+        {
+            __m256 distance = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.mNormalX[i]), centerX),
+                                            _mm256_mul_ps(_mm256_set1_ps(planes.mNormalY[i]), centerY));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(_mm256_set1_ps(planes.mNormalZ[i]), centerZ));
+            distance = _mm256_add_ps(distance, _mm256_set1_ps(planes.mDistance[i]));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, negRadius, _CMP_LT_OQ));
+        }
+
+        uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_ps(outside)) & getValidLanes(first, mNumSpheres, 8);
+        appendVisible(first, mask, visible);
+    }
+}
+
+#else
+
+// No SIMD path on this architecture, isPathSupported() keeps them unused
+void FrustumCuller::cullSSE(const FrustumPlanes& planes, std::vector<uint32_t>& visible) const
+{
+    cullScalar(planes, visible);
+}
+
+void FrustumCuller::cullAVX2(const FrustumPlanes& planes, std::vector<uint32_t>& visible) const
+{
+    cullScalar(planes, visible);
+}
+
+#endif
+
+} // namespace VulkanCore
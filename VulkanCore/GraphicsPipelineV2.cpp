@@ -1,37 +1,91 @@
 #include "GraphicsPipelineV2.h"
+#include "DescriptorAllocator.h"
+#include "DescriptorSetLayoutCache.h"
+#include "ShaderReflection.h"
 
 #include <cstddef>
 #include <cstdint>
 #include <iostream>
+#include <stdexcept>
+#include <string>
 #include <vector>
 
 namespace VulkanCore
 {
 
+namespace
+{
+
+// Descriptor type the engine writes to each V2_Binding, see updateDescriptorSets
+VkDescriptorType getExpectedDescriptorType(uint32_t binding)
+{
+    switch (binding)
+    {
+        case V2_BindingVB:
+        case V2_BindingIB:
+        case V2_BindingInstances:
+            return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        case V2_BindingUniform:
+            return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        case V2_BindingTexture2D:
+        case V2_BindingTextureCube:
+        case V2_BindingNormalMap:
+            return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+        default:
+            return VK_DESCRIPTOR_TYPE_MAX_ENUM;
+    }
+}
+
+} // namespace
+
 GraphicsPipelineV2::GraphicsPipelineV2(VkDevice device, GLFWwindow* window, VkRenderPass renderPass,
                                        VkShaderModule vsModule, VkShaderModule fsModule, int32_t numImages,
                                        VkFormat colorFormat, VkFormat depthFormat)
     : mDevice(device), mGraphicsPipeline(VK_NULL_HANDLE), mPipelineLayout(VK_NULL_HANDLE),
-      mDescriptorPool(VK_NULL_HANDLE), mDescriptorSetLayout(VK_NULL_HANDLE), mNumImages(numImages)
+      mDescriptorAllocator(nullptr), mOwnsDescriptorAllocator(false), mDescriptorSetLayout(VK_NULL_HANDLE),
+      mOwnsDescriptorSetLayout(true), mDrawSetLayout(VK_NULL_HANDLE), mPoolSizes{}, mPushConstantRange{0, 0, 0},
+      mBindingMask(0), mNumImages(numImages)
 {
-    createDescriptorSetLayout(true, true, true, true, false); // VB, IB, Uniform, Tex2D, Cubemap
+    createDescriptorSetLayout(true, true, true, true, false, false); // VB, IB, Uniform, Tex2D, Cubemap, NormalMap
     initCommon(window, renderPass, vsModule, fsModule, numImages, colorFormat, depthFormat, VK_COMPARE_OP_LESS,
                VK_CULL_MODE_BACK_BIT);
 }
 
 GraphicsPipelineV2::GraphicsPipelineV2(PipelineDesc const& pd)
     : mDevice(pd.mDevice), mGraphicsPipeline(VK_NULL_HANDLE), mPipelineLayout(VK_NULL_HANDLE),
-      mDescriptorPool(VK_NULL_HANDLE), mDescriptorSetLayout(VK_NULL_HANDLE), mNumImages(pd.mNumSwapchainImages)
+      mDescriptorAllocator(pd.mpDescriptorAllocator), mOwnsDescriptorAllocator(false),
+      mDescriptorSetLayout(VK_NULL_HANDLE), mOwnsDescriptorSetLayout(true), mDrawSetLayout(pd.mDrawSetLayout),
+      mPoolSizes{}, mPushConstantRange{0, 0, 0}, mBindingMask(0), mNumImages(pd.mNumSwapchainImages)
 {
-    createDescriptorSetLayout(pd.mIsVB, pd.mIsIB, pd.mIsUniform, pd.mIsTex2D, pd.mIsCubemap);
+    if (pd.mExternalSetLayout != VK_NULL_HANDLE)
+    {
+        mDescriptorSetLayout = pd.mExternalSetLayout;
+        mOwnsDescriptorSetLayout = false;
+        mPushConstantRange = pd.mPushConstantRange;
+    }
+    else if (pd.mpReflection)
+    {
+        createDescriptorSetLayoutFromReflection(*pd.mpReflection, pd.mpLayoutCache);
+    }
+    else
+    {
+        createDescriptorSetLayout(pd.mIsVB, pd.mIsIB, pd.mIsUniform, pd.mIsTex2D, pd.mIsCubemap, pd.mIsNormalMap);
+    }
     initCommon(pd.mWindow, nullptr, pd.mVertexShaderModule, pd.mFragmentShaderModule, pd.mNumSwapchainImages,
-               pd.mColorFormat, pd.mDepthFormat, pd.mDepthCompareOp, pd.mCullMode);
+               pd.mColorFormat, pd.mDepthFormat, pd.mDepthCompareOp, pd.mCullMode, pd.mpSpecializationInfo,
+               pd.mTaskShaderModule, pd.mMeshShaderModule);
 }
 
 GraphicsPipelineV2::~GraphicsPipelineV2()
 {
-    vkDestroyDescriptorPool(mDevice, mDescriptorPool, nullptr);
-    vkDestroyDescriptorSetLayout(mDevice, mDescriptorSetLayout, nullptr);
+    if (mOwnsDescriptorAllocator)
+    {
+        delete mDescriptorAllocator;
+    }
+    if (mOwnsDescriptorSetLayout)
+    {
+        vkDestroyDescriptorSetLayout(mDevice, mDescriptorSetLayout, nullptr);
+    }
     vkDestroyPipelineLayout(mDevice, mPipelineLayout, nullptr);
     vkDestroyPipeline(mDevice, mGraphicsPipeline, nullptr);
 }
@@ -44,7 +98,14 @@ void GraphicsPipelineV2::bind(VkCommandBuffer commandBuffer)
 void GraphicsPipelineV2::allocateDescriptorSets(int32_t numSubmeshes,
                                                 std::vector<std::vector<VkDescriptorSet>>& descriptorSets)
 {
-    createDescriptorPool(numSubmeshes * mNumImages);
+    if (!mOwnsDescriptorSetLayout && mPoolSizes.empty())
+    {
+        throw std::runtime_error("Pipeline uses an external descriptor set layout, it cannot allocate sets.");
+    }
+    if (mDescriptorAllocator == nullptr)
+    {
+        createDescriptorAllocator(numSubmeshes * mNumImages);
+    }
     allocateDescriptorSetsInternal(numSubmeshes, descriptorSets);
 }
 
@@ -57,7 +118,9 @@ void GraphicsPipelineV2::updateDescriptorSets(const ModelDesc& modelDesc,
     std::vector<VkDescriptorBufferInfo> BufferInfo_VBs(numSubmeshes);
     std::vector<VkDescriptorBufferInfo> BufferInfo_IBs(numSubmeshes);
     std::vector<std::vector<VkDescriptorBufferInfo>> BufferInfo_Uniforms(mNumImages);
+    std::vector<VkDescriptorBufferInfo> BufferInfo_Instances(mNumImages);
     std::vector<VkDescriptorImageInfo> ImageInfo(numSubmeshes);
+    std::vector<VkDescriptorImageInfo> NormalMapInfo(numSubmeshes);
 
     // Prepare buffer and image infos
     for (int32_t submeshIndex = 0; submeshIndex < numSubmeshes; submeshIndex++)
@@ -73,11 +136,23 @@ void GraphicsPipelineV2::updateDescriptorSets(const ModelDesc& modelDesc,
         ImageInfo[submeshIndex].sampler = modelDesc.mMaterials[submeshIndex].mSampler;
         ImageInfo[submeshIndex].imageView = modelDesc.mMaterials[submeshIndex].mImageView;
         ImageInfo[submeshIndex].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+        if (hasBinding(V2_BindingNormalMap) && submeshIndex < static_cast<int32_t>(modelDesc.mNormalMaps.size()))
+        {
+            NormalMapInfo[submeshIndex].sampler = modelDesc.mNormalMaps[submeshIndex].mSampler;
+            NormalMapInfo[submeshIndex].imageView = modelDesc.mNormalMaps[submeshIndex].mImageView;
+            NormalMapInfo[submeshIndex].imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+        }
     }
 
     // Create descriptor writes only for valid resources
     for (int32_t imageIndex{0}; imageIndex < mNumImages; ++imageIndex)
     {
+        if (imageIndex < static_cast<int32_t>(modelDesc.mInstanceBuffers.size()))
+        {
+            BufferInfo_Instances[imageIndex] = {modelDesc.mInstanceBuffers[imageIndex], 0, VK_WHOLE_SIZE};
+        }
+
         BufferInfo_Uniforms[imageIndex].resize(numSubmeshes);
         for (int32_t submeshIndex = 0; submeshIndex < numSubmeshes; submeshIndex++)
         {
@@ -86,8 +161,10 @@ void GraphicsPipelineV2::updateDescriptorSets(const ModelDesc& modelDesc,
                 modelDesc.mRanges[submeshIndex].mUniformRange.mOffset;
             BufferInfo_Uniforms[imageIndex][submeshIndex].range = modelDesc.mRanges[submeshIndex].mUniformRange.mRange;
 
-            // VB - always valid
-            if (BufferInfo_VBs[submeshIndex].buffer != VK_NULL_HANDLE)
+            // Bindings the layout does not have are skipped
+
+            // VB
+            if (hasBinding(V2_BindingVB) && BufferInfo_VBs[submeshIndex].buffer != VK_NULL_HANDLE)
             {
                 writeDescriptorSets.push_back({
                     .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
@@ -100,8 +177,8 @@ void GraphicsPipelineV2::updateDescriptorSets(const ModelDesc& modelDesc,
                 });
             }
 
-            // IB - always valid
-            if (BufferInfo_IBs[submeshIndex].buffer != VK_NULL_HANDLE)
+            // IB
+            if (hasBinding(V2_BindingIB) && BufferInfo_IBs[submeshIndex].buffer != VK_NULL_HANDLE)
             {
                 writeDescriptorSets.push_back({
                     .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
@@ -114,8 +191,8 @@ void GraphicsPipelineV2::updateDescriptorSets(const ModelDesc& modelDesc,
                 });
             }
 
-            // Uniform - always valid
-            if (BufferInfo_Uniforms[imageIndex][submeshIndex].buffer != VK_NULL_HANDLE)
+            // Uniform
+            if (hasBinding(V2_BindingUniform) && BufferInfo_Uniforms[imageIndex][submeshIndex].buffer != VK_NULL_HANDLE)
             {
                 writeDescriptorSets.push_back({
                     .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
@@ -128,8 +205,22 @@ void GraphicsPipelineV2::updateDescriptorSets(const ModelDesc& modelDesc,
                 });
             }
 
+            // Instances - shared by all the submeshes of the image
+            if (hasBinding(V2_BindingInstances) && BufferInfo_Instances[imageIndex].buffer != VK_NULL_HANDLE)
+            {
+                writeDescriptorSets.push_back({
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = descriptorSets[imageIndex][submeshIndex],
+                    .dstBinding = V2_BindingInstances,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+                    .pBufferInfo = &BufferInfo_Instances[imageIndex],
+                });
+            }
+
             // Tex2D - only if texture exists
-            if (ImageInfo[submeshIndex].imageView != VK_NULL_HANDLE &&
+            if (hasBinding(V2_BindingTexture2D) && ImageInfo[submeshIndex].imageView != VK_NULL_HANDLE &&
                 ImageInfo[submeshIndex].sampler != VK_NULL_HANDLE)
             {
                 writeDescriptorSets.push_back({
@@ -143,6 +234,21 @@ void GraphicsPipelineV2::updateDescriptorSets(const ModelDesc& modelDesc,
                 });
             }
 
+            // Normal map - only if the layout has the binding and the material has a normal map
+            if (NormalMapInfo[submeshIndex].imageView != VK_NULL_HANDLE &&
+                NormalMapInfo[submeshIndex].sampler != VK_NULL_HANDLE)
+            {
+                writeDescriptorSets.push_back({
+                    .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                    .dstSet = descriptorSets[imageIndex][submeshIndex],
+                    .dstBinding = V2_BindingNormalMap,
+                    .dstArrayElement = 0,
+                    .descriptorCount = 1,
+                    .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                    .pImageInfo = &NormalMapInfo[submeshIndex],
+                });
+            }
+
             // // Cubemap - only if cubemap exists
             // if(isCubemap)
             // {
@@ -168,22 +274,40 @@ void GraphicsPipelineV2::updateDescriptorSets(const ModelDesc& modelDesc,
 
 void GraphicsPipelineV2::initCommon(GLFWwindow* window, VkRenderPass renderPass, VkShaderModule vsModule,
                                     VkShaderModule fsModule, int32_t numImages, VkFormat colorFormat,
-                                    VkFormat depthFormat, VkCompareOp depthCompareOp, VkCullModeFlags cullMode)
+                                    VkFormat depthFormat, VkCompareOp depthCompareOp, VkCullModeFlags cullMode,
+                                    const VkSpecializationInfo* pSpecializationInfo, VkShaderModule taskModule,
+                                    VkShaderModule meshModule)
 {
-
-    VkPipelineShaderStageCreateInfo shaderStagesCreateInfo[2]{
-        {
+    // Vertex + fragment, or [task +] mesh + fragment. Depth only pipelines have no fragment stage.
+    std::vector<VkPipelineShaderStageCreateInfo> shaderStagesCreateInfo;
+    auto addStage = [&](VkShaderStageFlagBits stage, VkShaderModule module)
+    {
+        shaderStagesCreateInfo.push_back({
             .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .stage = VK_SHADER_STAGE_VERTEX_BIT,
-            .module = vsModule,
+            .stage = stage,
+            .module = module,
             .pName = "main",
-        },
+            .pSpecializationInfo = pSpecializationInfo,
+        });
+    };
+    bool isMeshPipeline = meshModule != VK_NULL_HANDLE;
+    if (isMeshPipeline)
+    {
+        if (taskModule != VK_NULL_HANDLE)
         {
-            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-            .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-            .module = fsModule,
-            .pName = "main",
-        }};
+            addStage(VK_SHADER_STAGE_TASK_BIT_EXT, taskModule);
+        }
+        addStage(VK_SHADER_STAGE_MESH_BIT_EXT, meshModule);
+    }
+    else
+    {
+        addStage(VK_SHADER_STAGE_VERTEX_BIT, vsModule);
+    }
+    if (fsModule != VK_NULL_HANDLE)
+    {
+        addStage(VK_SHADER_STAGE_FRAGMENT_BIT, fsModule);
+    }
+    uint32_t colorAttachmentCount = colorFormat != VK_FORMAT_UNDEFINED ? 1 : 0;
 
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
@@ -258,22 +382,25 @@ void GraphicsPipelineV2::initCommon(GLFWwindow* window, VkRenderPass renderPass,
         .sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO,
         .logicOpEnable = VK_FALSE,
         .logicOp = VK_LOGIC_OP_COPY,
-        .attachmentCount = 1,
+        .attachmentCount = colorAttachmentCount,
         .pAttachments = &colorBlendAttachment,
     };
 
     VkPipelineRenderingCreateInfo renderingCreateInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO,
-        .colorAttachmentCount = 1,
+        .colorAttachmentCount = colorAttachmentCount,
         .pColorAttachmentFormats = &colorFormat,
         .depthAttachmentFormat = depthFormat,
         .stencilAttachmentFormat = VK_FORMAT_UNDEFINED,
     };
 
+    VkDescriptorSetLayout setLayouts[2] = {mDescriptorSetLayout, mDrawSetLayout};
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{
         .sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO,
-        .setLayoutCount = 1,
-        .pSetLayouts = &mDescriptorSetLayout,
+        .setLayoutCount = mDrawSetLayout != VK_NULL_HANDLE ? 2u : 1u,
+        .pSetLayouts = setLayouts,
+        .pushConstantRangeCount = mPushConstantRange.size > 0 ? 1u : 0u,
+        .pPushConstantRanges = mPushConstantRange.size > 0 ? &mPushConstantRange : nullptr,
     };
 
     if (vkCreatePipelineLayout(mDevice, &pipelineLayoutCreateInfo, nullptr, &mPipelineLayout) != VK_SUCCESS)
@@ -284,10 +411,10 @@ void GraphicsPipelineV2::initCommon(GLFWwindow* window, VkRenderPass renderPass,
     VkGraphicsPipelineCreateInfo pipelineCreateInfo{
         .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
         .pNext = renderPass ? NULL : &renderingCreateInfo,
-        .stageCount = 2,
-        .pStages = &shaderStagesCreateInfo[0],
-        .pVertexInputState = &vertexInputInfo,
-        .pInputAssemblyState = &inputAssemblyCreateInfo,
+        .stageCount = static_cast<uint32_t>(shaderStagesCreateInfo.size()),
+        .pStages = shaderStagesCreateInfo.data(),
+        .pVertexInputState = isMeshPipeline ? nullptr : &vertexInputInfo,
+        .pInputAssemblyState = isMeshPipeline ? nullptr : &inputAssemblyCreateInfo,
         .pViewportState = &viewportStateCreateInfo,
         .pRasterizationState = &rasterizerCreateInfo,
         .pMultisampleState = &multisamplingCreateInfo,
@@ -309,31 +436,22 @@ void GraphicsPipelineV2::initCommon(GLFWwindow* window, VkRenderPass renderPass,
     std::cout << "Graphics pipeline created successfully." << std::endl;
 }
 
-void GraphicsPipelineV2::createDescriptorPool(int32_t maxSets)
+void GraphicsPipelineV2::createDescriptorAllocator(int32_t maxSets)
 {
-    std::vector<VkDescriptorPoolSize> poolSizes = {
-        {VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, static_cast<uint32_t>(maxSets * 2)}, // VB + IB
-        {VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, static_cast<uint32_t>(maxSets)},
-        {VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, static_cast<uint32_t>(maxSets)},
-    };
-
-    VkDescriptorPoolCreateInfo poolInfo{
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
-        .flags = 0,
-        .maxSets = static_cast<uint32_t>(maxSets),
-        .poolSizeCount = static_cast<uint32_t>(poolSizes.size()),
-        .pPoolSizes = poolSizes.data(),
-    };
-
-    if (vkCreateDescriptorPool(mDevice, &poolInfo, nullptr, &mDescriptorPool) != VK_SUCCESS)
+    // Private allocator sized for the first request, it grows if the pipeline allocates again
+    std::vector<DescriptorPoolRatio> ratios;
+    for (const VkDescriptorPoolSize& poolSize : mPoolSizes)
     {
-        throw std::runtime_error("Failed to create descriptor pool.");
+        ratios.push_back({poolSize.type, static_cast<float>(poolSize.descriptorCount)});
     }
 
-    std::cout << "Descriptor pool created successfully." << std::endl;
+    mDescriptorAllocator =
+        new DescriptorAllocator(mDevice, "GraphicsPipelineV2", static_cast<uint32_t>(maxSets), ratios);
+    mOwnsDescriptorAllocator = true;
 }
 
-void GraphicsPipelineV2::createDescriptorSetLayout(bool isVB, bool isIB, bool isUniform, bool isTex2D, bool isCubemap)
+void GraphicsPipelineV2::createDescriptorSetLayout(bool isVB, bool isIB, bool isUniform, bool isTex2D, bool isCubemap,
+                                                   bool isNormalMap)
 {
     std::vector<VkDescriptorSetLayoutBinding> layoutBindings;
 
@@ -397,6 +515,24 @@ void GraphicsPipelineV2::createDescriptorSetLayout(bool isVB, bool isIB, bool is
         layoutBindings.push_back(FragmentShaderLayoutBinding_TexCube);
     }
 
+    if (isNormalMap)
+    {
+        VkDescriptorSetLayoutBinding FragmentShaderLayoutBinding_NormalMap = {
+            .binding = V2_BindingNormalMap,
+            .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+            .descriptorCount = 1,
+            .stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT,
+        };
+
+        layoutBindings.push_back(FragmentShaderLayoutBinding_NormalMap);
+    }
+
+    for (const VkDescriptorSetLayoutBinding& binding : layoutBindings)
+    {
+        mBindingMask |= 1u << binding.binding;
+    }
+    mPoolSizes = GetPoolSizes(layoutBindings, 1);
+
     VkDescriptorSetLayoutCreateInfo LayoutInfo = {
         .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
         .pNext = NULL,
@@ -413,27 +549,84 @@ void GraphicsPipelineV2::createDescriptorSetLayout(bool isVB, bool isIB, bool is
     std::cout << "Descriptor set layout created successfully." << std::endl;
 }
 
-void GraphicsPipelineV2::allocateDescriptorSetsInternal(int32_t numSubmeshes,
-                                                        std::vector<std::vector<VkDescriptorSet>>& descriptorSets)
+void GraphicsPipelineV2::createDescriptorSetLayoutFromReflection(const ShaderReflection& reflection,
+                                                                 DescriptorSetLayoutCache* pLayoutCache)
 {
-    VkDescriptorSetAllocateInfo allocInfo{
-        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO,
-        .descriptorPool = mDescriptorPool,
-        .descriptorSetCount = static_cast<uint32_t>(numSubmeshes),
-        .pSetLayouts = nullptr, // will be set later
+    validateReflection(reflection);
+
+    std::vector<VkDescriptorSetLayoutBinding> layoutBindings = GetSetLayoutBindings(reflection, 0);
+    for (const VkDescriptorSetLayoutBinding& binding : layoutBindings)
+    {
+        mBindingMask |= 1u << binding.binding;
+    }
+    mPoolSizes = GetPoolSizes(layoutBindings, 1);
+    mPushConstantRange = reflection.mPushConstants;
+
+    if (pLayoutCache)
+    {
+        mDescriptorSetLayout = pLayoutCache->getLayout(layoutBindings);
+        mOwnsDescriptorSetLayout = false;
+        return;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO,
+        .bindingCount = static_cast<uint32_t>(layoutBindings.size()),
+        .pBindings = layoutBindings.data(),
     };
 
-    descriptorSets.resize(mNumImages);
-    for (int32_t imageIndex{0}; imageIndex < mNumImages; ++imageIndex)
+    if (vkCreateDescriptorSetLayout(mDevice, &layoutInfo, nullptr, &mDescriptorSetLayout) != VK_SUCCESS)
     {
-        descriptorSets[imageIndex].resize(numSubmeshes);
-        std::vector<VkDescriptorSetLayout> layouts(numSubmeshes, mDescriptorSetLayout);
-        allocInfo.pSetLayouts = layouts.data();
+        throw std::runtime_error("Failed to create descriptor set layout.");
+    }
+
+    std::cout << "Descriptor set layout created from shader reflection." << std::endl;
+}
 
-        if (vkAllocateDescriptorSets(mDevice, &allocInfo, descriptorSets[imageIndex].data()) != VK_SUCCESS)
+void GraphicsPipelineV2::validateReflection(const ShaderReflection& reflection) const
+{
+    for (const ReflectedBinding& binding : reflection.mBindings)
+    {
+        std::string location = "'" + binding.mName + "' (set " + std::to_string(binding.mSet) + ", binding " +
+                               std::to_string(binding.mBinding) + ")";
+
+        if (binding.mSet != 0)
         {
-            throw std::runtime_error("Failed to allocate descriptor sets.");
+            throw std::runtime_error("Shader/engine mismatch: " + location +
+                                     " uses a descriptor set other than 0, GraphicsPipelineV2 only binds set 0.");
         }
+
+        VkDescriptorType expectedType = getExpectedDescriptorType(binding.mBinding);
+        if (expectedType == VK_DESCRIPTOR_TYPE_MAX_ENUM)
+        {
+            throw std::runtime_error("Shader/engine mismatch: " + location +
+                                     " is not a V2_Binding, the engine never writes it.");
+        }
+
+        if (binding.mType != expectedType)
+        {
+            throw std::runtime_error("Shader/engine mismatch: " + location + " is a " +
+                                     GetDescriptorTypeName(binding.mType) + ", the engine writes a " +
+                                     GetDescriptorTypeName(expectedType) + ".");
+        }
+
+        if (binding.mCount != 1)
+        {
+            throw std::runtime_error("Shader/engine mismatch: " + location +
+                                     " is an array, the engine writes a single descriptor.");
+        }
+    }
+}
+
+void GraphicsPipelineV2::allocateDescriptorSetsInternal(int32_t numSubmeshes,
+                                                        std::vector<std::vector<VkDescriptorSet>>& descriptorSets)
+{
+    descriptorSets.resize(mNumImages);
+    for (int32_t imageIndex{0}; imageIndex < mNumImages; ++imageIndex)
+    {
+        descriptorSets[imageIndex].resize(numSubmeshes);
+        mDescriptorAllocator->allocate(mDescriptorSetLayout, mPoolSizes, static_cast<uint32_t>(numSubmeshes),
+                                       descriptorSets[imageIndex].data());
     }
 
     std::cout << "Descriptor sets allocated successfully." << std::endl;
@@ -0,0 +1,240 @@
+#include "HiZPyramid.h"
+#include "ComputePipeline.h"
+#include "DescriptorAllocator.h"
+#include "Wrapper.h"
+
+#include <algorithm>
+#include <bit>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace VulkanCore
+{
+
+namespace
+{
+
+// Bindings of hiz_build.comp
+enum HiZBinding
+{
+    HiZBinding_Source = 0,
+    HiZBinding_Destination = 1,
+};
+
+struct HiZBuildConstants
+{
+    int32_t mSrcSize[2];
+    int32_t mDstSize[2];
+};
+
+VkImageAspectFlags getDepthAspect(VkFormat format)
+{
+    // Depth / stencil images are transitioned as a whole
+    bool hasStencil = format == VK_FORMAT_D16_UNORM_S8_UINT || format == VK_FORMAT_D24_UNORM_S8_UINT ||
+                      format == VK_FORMAT_D32_SFLOAT_S8_UINT;
+    return hasStencil ? VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT : VK_IMAGE_ASPECT_DEPTH_BIT;
+}
+
+void imageBarrier(VkCommandBuffer commandBuffer, VkImage image, VkImageAspectFlags aspect, uint32_t baseLevel,
+                  uint32_t levelCount, VkImageLayout oldLayout, VkImageLayout newLayout, VkAccessFlags srcAccess,
+                  VkAccessFlags dstAccess, VkPipelineStageFlags srcStage, VkPipelineStageFlags dstStage)
+{
+    VkImageMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+        .srcAccessMask = srcAccess,
+        .dstAccessMask = dstAccess,
+        .oldLayout = oldLayout,
+        .newLayout = newLayout,
+        .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+        .image = image,
+        .subresourceRange = {aspect, baseLevel, levelCount, 0, 1},
+    };
+    vkCmdPipelineBarrier(commandBuffer, srcStage, dstStage, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+} // namespace
+
+HiZPyramid::HiZPyramid(VulkanCore* pVulkanCore)
+    : mVulkanCore{pVulkanCore}, mDevice{pVulkanCore->getDevice()}, mNumImages{pVulkanCore->getSwapchainImageCount()},
+      mImage{}, mNumLevels{0}, mLevelViews{}, mBuildPipeline{nullptr}, mDepthSampler{VK_NULL_HANDLE},
+      mDepthSets{}, mLevelSets{}
+{
+    VkExtent2D extent = mVulkanCore->getSwapchainExtent();
+    mNumLevels = std::bit_width(std::max(extent.width, extent.height));
+
+    // Far plane : nothing is occluded until the first build
+    VkClearColorValue farDepth = {{1.0f, 0.0f, 0.0f, 0.0f}};
+    mVulkanCore->createStorageImage(mImage, extent.width, extent.height, VK_FORMAT_R32_SFLOAT, mNumLevels, farDepth);
+    createImageViews();
+
+    mImage.mSampler = createTextureSampler(mDevice, VK_FILTER_NEAREST, VK_FILTER_NEAREST,
+                                           VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+    mDepthSampler = createTextureSampler(mDevice, VK_FILTER_NEAREST, VK_FILTER_NEAREST,
+                                         VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE);
+
+    mBuildPipeline = new ComputePipeline(mDevice, "VulkanCore/shaders/hiz_build.comp",
+                                         mVulkanCore->getDescriptorSetLayoutCache());
+    createDescriptorSets();
+
+    std::cout << "HiZ pyramid created: " << extent.width << "x" << extent.height << ", " << mNumLevels << " levels."
+              << std::endl;
+}
+
+HiZPyramid::~HiZPyramid()
+{
+    destroy();
+}
+
+void HiZPyramid::destroy()
+{
+    // Descriptor sets are owned by the VulkanCore allocator
+    if (mBuildPipeline)
+    {
+        delete mBuildPipeline;
+        mBuildPipeline = nullptr;
+    }
+    for (VkImageView levelView : mLevelViews)
+    {
+        vkDestroyImageView(mDevice, levelView, nullptr);
+    }
+    mLevelViews.clear();
+    if (mDepthSampler != VK_NULL_HANDLE)
+    {
+        vkDestroySampler(mDevice, mDepthSampler, nullptr);
+        mDepthSampler = VK_NULL_HANDLE;
+    }
+    mImage.destroy(mDevice);
+    mDepthSets.clear();
+    mLevelSets.clear();
+}
+
+void HiZPyramid::recordBuild(VkCommandBuffer commandBuffer, uint32_t imageIndex) const
+{
+    VkImage depthImage = mVulkanCore->getDepthImage(imageIndex);
+    VkImageAspectFlags depthAspect = getDepthAspect(mVulkanCore->getDepthFormat());
+
+    // Scene depth writes -> compute reads
+    imageBarrier(commandBuffer, depthImage, depthAspect, 0, 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL,
+                 VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                 VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    // This frame's cull pass reads -> pyramid writes
+    imageBarrier(commandBuffer, mImage.mImage, VK_IMAGE_ASPECT_COLOR_BIT, 0, mNumLevels, VK_IMAGE_LAYOUT_GENERAL,
+                 VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    mBuildPipeline->bind(commandBuffer);
+
+    HiZBuildConstants constants = {
+        .mSrcSize = {static_cast<int32_t>(mImage.mWidth), static_cast<int32_t>(mImage.mHeight)},
+        .mDstSize = {static_cast<int32_t>(mImage.mWidth), static_cast<int32_t>(mImage.mHeight)},
+    };
+    for (uint32_t level = 0; level < mNumLevels; level++)
+    {
+        constants.mDstSize[0] = std::max(static_cast<int32_t>(mImage.mWidth >> level), 1);
+        constants.mDstSize[1] = std::max(static_cast<int32_t>(mImage.mHeight >> level), 1);
+
+        mBuildPipeline->bindDescriptorSet(commandBuffer, level == 0 ? mDepthSets[imageIndex] : mLevelSets[level - 1]);
+        mBuildPipeline->pushConstants(commandBuffer, &constants, sizeof(constants));
+        uint32_t numTexels = static_cast<uint32_t>(constants.mDstSize[0] * constants.mDstSize[1]);
+        vkCmdDispatch(commandBuffer, mBuildPipeline->getNumGroups(numTexels), 1, 1);
+
+        // Read by the next level, the last one by the next frame's cull pass
+        imageBarrier(commandBuffer, mImage.mImage, VK_IMAGE_ASPECT_COLOR_BIT, level, 1, VK_IMAGE_LAYOUT_GENERAL,
+                     VK_IMAGE_LAYOUT_GENERAL, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+        constants.mSrcSize[0] = constants.mDstSize[0];
+        constants.mSrcSize[1] = constants.mDstSize[1];
+    }
+
+    // Back to the layout expected by VulkanCore::beginDynamicRendering
+    imageBarrier(commandBuffer, depthImage, depthAspect, 0, 1, VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL,
+                 VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_ACCESS_SHADER_READ_BIT,
+                 VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+                 VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                 VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT);
+}
+
+void HiZPyramid::createImageViews()
+{
+    VkImageViewCreateInfo viewCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+        .image = mImage.mImage,
+        .viewType = VK_IMAGE_VIEW_TYPE_2D,
+        .format = VK_FORMAT_R32_SFLOAT,
+        .components = {VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY,
+                       VK_COMPONENT_SWIZZLE_IDENTITY},
+        .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, mNumLevels, 0, 1},
+    };
+    if (vkCreateImageView(mDevice, &viewCreateInfo, nullptr, &mImage.mImageView) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create HiZ pyramid image view.");
+    }
+
+    mLevelViews.resize(mNumLevels);
+    for (uint32_t level = 0; level < mNumLevels; level++)
+    {
+        viewCreateInfo.subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1};
+        if (vkCreateImageView(mDevice, &viewCreateInfo, nullptr, &mLevelViews[level]) != VK_SUCCESS)
+        {
+            throw std::runtime_error("Failed to create HiZ pyramid level view " + std::to_string(level) + ".");
+        }
+    }
+}
+
+void HiZPyramid::createDescriptorSets()
+{
+    DescriptorAllocator* pAllocator = mVulkanCore->getDescriptorAllocator();
+    VkDescriptorSetLayout layout = mBuildPipeline->getDescriptorSetLayout();
+
+    mDepthSets.resize(mNumImages);
+    pAllocator->allocate(layout, mBuildPipeline->getPoolSizes(), mNumImages, mDepthSets.data());
+    mLevelSets.resize(mNumLevels - 1);
+    if (!mLevelSets.empty())
+    {
+        pAllocator->allocate(layout, mBuildPipeline->getPoolSizes(), static_cast<uint32_t>(mLevelSets.size()),
+                             mLevelSets.data());
+    }
+
+    auto writeSet = [this](VkDescriptorSet descriptorSet, const VkDescriptorImageInfo& source, uint32_t dstLevel)
+    {
+        VkDescriptorImageInfo destination = {VK_NULL_HANDLE, mLevelViews[dstLevel], VK_IMAGE_LAYOUT_GENERAL};
+        VkWriteDescriptorSet writes[] = {
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = descriptorSet,
+                .dstBinding = HiZBinding_Source,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .pImageInfo = &source,
+            },
+            {
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = descriptorSet,
+                .dstBinding = HiZBinding_Destination,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE,
+                .pImageInfo = &destination,
+            },
+        };
+        vkUpdateDescriptorSets(mDevice, 2, writes, 0, nullptr);
+    };
+
+    for (int32_t imageIndex = 0; imageIndex < mNumImages; imageIndex++)
+    {
+        VkDescriptorImageInfo depth = {mDepthSampler, mVulkanCore->getDepthImageView(imageIndex),
+                                       VK_IMAGE_LAYOUT_DEPTH_STENCIL_READ_ONLY_OPTIMAL};
+        writeSet(mDepthSets[imageIndex], depth, 0);
+    }
+    for (uint32_t level = 1; level < mNumLevels; level++)
+    {
+        VkDescriptorImageInfo previousLevel = {mImage.mSampler, mLevelViews[level - 1], VK_IMAGE_LAYOUT_GENERAL};
+        writeSet(mLevelSets[level - 1], previousLevel, level);
+    }
+}
+
+} // namespace VulkanCore
@@ -0,0 +1,352 @@
+#include "IndirectDrawList.h"
+#include "BindlessRegistry.h"
+#include "ComputePipeline.h"
+#include "DescriptorAllocator.h"
+#include "DescriptorSetLayoutCache.h"
+#include "GraphicsPipelineV2.h"
+#include "HiZPyramid.h"
+#include "ShaderReflection.h"
+#include "Wrapper.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace VulkanCore
+{
+
+namespace
+{
+
+// Bindings of set 1 of the build compute shader, see indirect_build.comp
+enum BuildBinding
+{
+    BuildBinding_Records = 0,
+    BuildBinding_Batches = 1,
+    BuildBinding_Commands = 2,
+    BuildBinding_Counts = 3,
+    BuildBinding_CullData = 4,
+    BuildBinding_HiZ = 5, // OCCLUSION_CULLING only
+};
+
+struct BuildConstants
+{
+    uint32_t mNumDraws;
+    uint32_t mHiZWidth;
+    uint32_t mHiZHeight;
+    uint32_t mHiZLevels;
+};
+
+VkWriteDescriptorSet makeBufferWrite(VkDescriptorSet descriptorSet, uint32_t binding,
+                                     const VkDescriptorBufferInfo* pBufferInfo)
+{
+    return {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = descriptorSet,
+        .dstBinding = binding,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .pBufferInfo = pBufferInfo,
+    };
+}
+
+} // namespace
+
+IndirectDrawList::IndirectDrawList(VulkanCore* pVulkanCore, const BindlessRegistry* pRegistry, const HiZPyramid* pHiZ)
+    : mVulkanCore{pVulkanCore}, mRegistry{pRegistry}, mHiZ{pHiZ}, mDevice{pVulkanCore->getDevice()},
+      mNumImages{pVulkanCore->getSwapchainImageCount()}, mPendingKeys{}, mRecords{}, mBatches{},
+      mBuildPipeline{nullptr}, mDrawSetLayout{VK_NULL_HANDLE}, mRecordBuffer{}, mBatchBuffer{}, mCommandBuffers{},
+      mCountBuffers{}, mCullBuffers{}, mBuildSets{}, mDrawSets{}
+{
+    if (!mVulkanCore->isGpuDrivenSupported())
+    {
+        throw std::runtime_error("GPU-driven rendering requires draw indirect count and shader draw parameters.");
+    }
+
+    // Set 0 is the bindless set : the cull pass reads the draw transforms from it
+    std::vector<std::string> defines;
+    if (mHiZ)
+    {
+        defines.push_back("OCCLUSION_CULLING");
+    }
+    mBuildPipeline = new ComputePipeline(mDevice, "VulkanCore/shaders/indirect_build.comp",
+                                         mVulkanCore->getDescriptorSetLayoutCache(), 64, defines,
+                                         mRegistry->getDescriptorSetLayout());
+    mRegistry->validateInterface(mBuildPipeline->getReflection(), true);
+
+    // Frustum and backface culling (and occlusion culling when available) until the first updateCullData()
+    GpuCullData cullData = {};
+    cullData.mFlags = CullFlag_Frustum | CullFlag_Backface | (mHiZ ? CullFlag_Occlusion : 0);
+    mCullBuffers = mVulkanCore->createUniformBuffers(sizeof(GpuCullData));
+    for (BufferAndMemory& buffer : mCullBuffers)
+    {
+        buffer.update(mDevice, &cullData, sizeof(cullData));
+    }
+
+    std::vector<VkDescriptorSetLayoutBinding> bindings = {
+        {IndirectDrawBinding_Records, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
+        {IndirectDrawBinding_Commands, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_VERTEX_BIT, nullptr},
+    };
+    mDrawSetLayout = mVulkanCore->getDescriptorSetLayoutCache()->getLayout(bindings);
+}
+
+IndirectDrawList::~IndirectDrawList()
+{
+    destroy();
+}
+
+void IndirectDrawList::destroy()
+{
+    // Descriptor sets are owned by the VulkanCore allocator, the set layouts by the layout cache
+    if (mBuildPipeline)
+    {
+        delete mBuildPipeline;
+        mBuildPipeline = nullptr;
+    }
+
+    mRecordBuffer.Destroy(mDevice);
+    mBatchBuffer.Destroy(mDevice);
+    for (BufferAndMemory& buffer : mCommandBuffers)
+    {
+        buffer.Destroy(mDevice);
+    }
+    for (BufferAndMemory& buffer : mCountBuffers)
+    {
+        buffer.Destroy(mDevice);
+    }
+    for (BufferAndMemory& buffer : mCullBuffers)
+    {
+        buffer.Destroy(mDevice);
+    }
+    mCommandBuffers.clear();
+    mCountBuffers.clear();
+    mCullBuffers.clear();
+    mBuildSets.clear();
+    mDrawSets.clear();
+}
+
+void IndirectDrawList::addDraw(const ShaderPermutationKey& key, const GpuDrawRecord& record)
+{
+    if (!mBatches.empty())
+    {
+        throw std::runtime_error("IndirectDrawList: draws cannot be added after upload().");
+    }
+    mPendingKeys.push_back(key.hash());
+    mRecords.push_back(record);
+}
+
+void IndirectDrawList::upload()
+{
+    if (mRecords.empty())
+    {
+        throw std::runtime_error("IndirectDrawList: nothing to upload.");
+    }
+
+    // Records of a batch are contiguous, so are their commands
+    std::vector<uint32_t> order(mRecords.size());
+    for (uint32_t drawIndex = 0; drawIndex < order.size(); drawIndex++)
+    {
+        order[drawIndex] = drawIndex;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [this](uint32_t a, uint32_t b) { return mPendingKeys[a] < mPendingKeys[b]; });
+
+    std::vector<GpuDrawRecord> records(mRecords.size());
+    std::vector<uint32_t> firstCommands;
+    for (uint32_t drawIndex = 0; drawIndex < order.size(); drawIndex++)
+    {
+        uint64_t key = mPendingKeys[order[drawIndex]];
+        if (mBatches.empty() || mBatches.back().mKey != key)
+        {
+            mBatches.push_back({key, drawIndex, 0});
+            firstCommands.push_back(drawIndex);
+        }
+        mBatches.back().mMaxDraws++;
+
+        records[drawIndex] = mRecords[order[drawIndex]];
+        records[drawIndex].mBatchIndex = static_cast<uint32_t>(mBatches.size() - 1);
+    }
+    mRecords = std::move(records);
+    mPendingKeys.clear();
+
+    mRecordBuffer = mVulkanCore->createVertexBuffer(mRecords.data(), mRecords.size() * sizeof(GpuDrawRecord));
+    mBatchBuffer = mVulkanCore->createVertexBuffer(firstCommands.data(), firstCommands.size() * sizeof(uint32_t));
+
+    mCommandBuffers.resize(mNumImages);
+    mCountBuffers.resize(mNumImages);
+    for (int32_t imageIndex = 0; imageIndex < mNumImages; imageIndex++)
+    {
+        mCommandBuffers[imageIndex] = mVulkanCore->createStorageBuffer(mRecords.size() * sizeof(GpuDrawCommand),
+                                                                       VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+        mCountBuffers[imageIndex] =
+            mVulkanCore->createStorageBuffer(mBatches.size() * sizeof(uint32_t), VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT);
+    }
+
+    createDescriptorSets();
+
+    std::cout << "Indirect draw list uploaded: " << mRecords.size() << " draws in " << mBatches.size()
+              << " batches." << std::endl;
+}
+
+void IndirectDrawList::recordBuild(VkCommandBuffer commandBuffer, uint32_t imageIndex) const
+{
+    VkBuffer commands = mCommandBuffers[imageIndex].mBuffer;
+    VkBuffer counts = mCountBuffers[imageIndex].mBuffer;
+
+    vkCmdFillBuffer(commandBuffer, counts, 0, VK_WHOLE_SIZE, 0);
+    bufferMemBarrier(commandBuffer, counts, VK_ACCESS_TRANSFER_WRITE_BIT,
+                     VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+
+    BuildConstants constants = {
+        .mNumDraws = static_cast<uint32_t>(mRecords.size()),
+        .mHiZWidth = mHiZ ? mHiZ->getWidth() : 0,
+        .mHiZHeight = mHiZ ? mHiZ->getHeight() : 0,
+        .mHiZLevels = mHiZ ? mHiZ->getNumLevels() : 0,
+    };
+    mBuildPipeline->bind(commandBuffer);
+    mRegistry->bind(commandBuffer, mBuildPipeline->getPipelineLayout(), imageIndex, VK_PIPELINE_BIND_POINT_COMPUTE);
+    mBuildPipeline->bindDescriptorSet(commandBuffer, mBuildSets[imageIndex]);
+    mBuildPipeline->pushConstants(commandBuffer, &constants, sizeof(constants));
+    vkCmdDispatch(commandBuffer, mBuildPipeline->getNumGroups(constants.mNumDraws), 1, 1);
+
+    // Commands are read as indirect arguments and by the vertex shader (gl_DrawID -> draw record)
+    bufferMemBarrier(commandBuffer, commands, VK_ACCESS_SHADER_WRITE_BIT,
+                     VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_SHADER_READ_BIT,
+                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+                     VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT);
+    bufferMemBarrier(commandBuffer, counts, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT,
+                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT);
+    // Counters read back by updateCullData() once the image fence is signaled
+    bufferMemBarrier(commandBuffer, mCullBuffers[imageIndex].mBuffer, VK_ACCESS_SHADER_WRITE_BIT,
+                     VK_ACCESS_HOST_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_HOST_BIT);
+}
+
+GpuCullData IndirectDrawList::updateCullData(uint32_t imageIndex, uint32_t cullFlags)
+{
+    GpuCullData previous = {};
+    mCullBuffers[imageIndex].read(mDevice, &previous, sizeof(previous));
+
+    if (!mHiZ)
+    {
+        cullFlags &= ~CullFlag_Occlusion;
+    }
+    GpuCullData next = {.mFlags = cullFlags};
+    mCullBuffers[imageIndex].update(mDevice, &next, sizeof(next));
+    return previous;
+}
+
+void IndirectDrawList::recordDraws(VkCommandBuffer commandBuffer, const PipelineVariantMap& pipelines,
+                                   uint32_t imageIndex) const
+{
+    VkPushConstantRange pushConstantRange = BindlessRegistry::getPushConstantRange();
+
+    GraphicsPipelineV2* pBoundPipeline = nullptr;
+    for (uint32_t batchIndex = 0; batchIndex < mBatches.size(); batchIndex++)
+    {
+        const Batch& batch = mBatches[batchIndex];
+        auto it = pipelines.find(batch.mKey);
+        if (it == pipelines.end())
+        {
+            throw std::runtime_error("No pipeline for the shader permutation of batch " + std::to_string(batchIndex));
+        }
+
+        GraphicsPipelineV2* pPipeline = it->second;
+        VkPipelineLayout pipelineLayout = pPipeline->getPipelineLayout();
+        if (pBoundPipeline == nullptr)
+        {
+            // All GPU-driven pipelines share the set layouts, both sets stay bound across pipeline changes
+            mRegistry->bind(commandBuffer, pipelineLayout, imageIndex);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1,
+                                    &mDrawSets[imageIndex], 0, nullptr);
+        }
+        if (pPipeline != pBoundPipeline)
+        {
+            pBoundPipeline = pPipeline;
+            pBoundPipeline->bind(commandBuffer);
+        }
+
+        // gl_DrawID restarts at 0 for every batch
+        vkCmdPushConstants(commandBuffer, pipelineLayout, pushConstantRange.stageFlags, 0, sizeof(uint32_t),
+                           &batch.mFirstCommand);
+
+        vkCmdDrawIndirectCount(commandBuffer, mCommandBuffers[imageIndex].mBuffer,
+                               batch.mFirstCommand * sizeof(GpuDrawCommand), mCountBuffers[imageIndex].mBuffer,
+                               batchIndex * sizeof(uint32_t), batch.mMaxDraws, sizeof(GpuDrawCommand));
+    }
+}
+
+void IndirectDrawList::validateInterface(const ShaderReflection& reflection) const
+{
+    for (const ReflectedBinding& binding : reflection.mBindings)
+    {
+        if (binding.mSet != 1)
+        {
+            continue;
+        }
+
+        std::string location = "'" + binding.mName + "' (set 1, binding " + std::to_string(binding.mBinding) + ")";
+        if (binding.mBinding >= IndirectDrawBinding_Count)
+        {
+            throw std::runtime_error("Shader/indirect draw mismatch: " + location + " is not part of the draw set.");
+        }
+        if (binding.mType != VK_DESCRIPTOR_TYPE_STORAGE_BUFFER || binding.mCount != 1)
+        {
+            throw std::runtime_error("Shader/indirect draw mismatch: " + location + " must be a single " +
+                                     GetDescriptorTypeName(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) + ".");
+        }
+    }
+}
+
+void IndirectDrawList::createDescriptorSets()
+{
+    DescriptorAllocator* pAllocator = mVulkanCore->getDescriptorAllocator();
+    std::vector<VkDescriptorPoolSize> drawSetSizes = {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, IndirectDrawBinding_Count}};
+
+    mBuildSets.resize(mNumImages);
+    mDrawSets.resize(mNumImages);
+    for (int32_t imageIndex = 0; imageIndex < mNumImages; imageIndex++)
+    {
+        mBuildSets[imageIndex] =
+            pAllocator->allocate(mBuildPipeline->getDescriptorSetLayout(), mBuildPipeline->getPoolSizes());
+        mDrawSets[imageIndex] = pAllocator->allocate(mDrawSetLayout, drawSetSizes);
+
+        VkDescriptorBufferInfo records = {mRecordBuffer.mBuffer, 0, VK_WHOLE_SIZE};
+        VkDescriptorBufferInfo batches = {mBatchBuffer.mBuffer, 0, VK_WHOLE_SIZE};
+        VkDescriptorBufferInfo commands = {mCommandBuffers[imageIndex].mBuffer, 0, VK_WHOLE_SIZE};
+        VkDescriptorBufferInfo counts = {mCountBuffers[imageIndex].mBuffer, 0, VK_WHOLE_SIZE};
+        VkDescriptorBufferInfo cullData = {mCullBuffers[imageIndex].mBuffer, 0, VK_WHOLE_SIZE};
+
+        std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+            makeBufferWrite(mBuildSets[imageIndex], BuildBinding_Records, &records),
+            makeBufferWrite(mBuildSets[imageIndex], BuildBinding_Batches, &batches),
+            makeBufferWrite(mBuildSets[imageIndex], BuildBinding_Commands, &commands),
+            makeBufferWrite(mBuildSets[imageIndex], BuildBinding_Counts, &counts),
+            makeBufferWrite(mBuildSets[imageIndex], BuildBinding_CullData, &cullData),
+            makeBufferWrite(mDrawSets[imageIndex], IndirectDrawBinding_Records, &records),
+            makeBufferWrite(mDrawSets[imageIndex], IndirectDrawBinding_Commands, &commands),
+        };
+
+        VkDescriptorImageInfo hiz = {};
+        if (mHiZ)
+        {
+            hiz = mHiZ->getDescriptorImageInfo();
+            writeDescriptorSets.push_back({
+                .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+                .dstSet = mBuildSets[imageIndex],
+                .dstBinding = BuildBinding_HiZ,
+                .dstArrayElement = 0,
+                .descriptorCount = 1,
+                .descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER,
+                .pImageInfo = &hiz,
+            });
+        }
+        vkUpdateDescriptorSets(mDevice, static_cast<uint32_t>(writeDescriptorSets.size()), writeDescriptorSets.data(),
+                               0, nullptr);
+    }
+}
+
+} // namespace VulkanCore
@@ -0,0 +1,289 @@
+#include "MeshletDrawList.h"
+#include "BindlessRegistry.h"
+#include "DescriptorAllocator.h"
+#include "DescriptorSetLayoutCache.h"
+#include "GraphicsPipelineV2.h"
+#include "Shader.h"
+#include "ShaderReflection.h"
+#include "Wrapper.h"
+
+#include <algorithm>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace VulkanCore
+{
+
+namespace
+{
+
+// Minimum VkPhysicalDeviceMeshShaderPropertiesEXT::maxTaskWorkGroupCount[0], larger batches are split
+constexpr uint32_t kMaxTaskGroups = 65535;
+
+VkWriteDescriptorSet makeBufferWrite(VkDescriptorSet descriptorSet, uint32_t binding,
+                                     const VkDescriptorBufferInfo* pBufferInfo)
+{
+    return {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = descriptorSet,
+        .dstBinding = binding,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .pBufferInfo = pBufferInfo,
+    };
+}
+
+} // namespace
+
+MeshletDrawList::MeshletDrawList(VulkanCore* pVulkanCore, const BindlessRegistry* pRegistry)
+    : mVulkanCore{pVulkanCore}, mRegistry{pRegistry}, mDevice{pVulkanCore->getDevice()},
+      mNumImages{pVulkanCore->getSwapchainImageCount()}, mPendingKeys{}, mMeshlets{}, mVertices{}, mTriangles{},
+      mBatches{}, mTaskShaderModule{VK_NULL_HANDLE}, mDrawSetLayout{VK_NULL_HANDLE}, mCmdDrawMeshTasks{nullptr},
+      mMeshletBuffer{}, mVertexBuffer{}, mTriangleBuffer{}, mCullBuffers{}, mDrawSets{}
+{
+    if (!mVulkanCore->isMeshShaderSupported())
+    {
+        throw std::runtime_error("Meshlet rendering requires the task and mesh shaders of VK_EXT_mesh_shader.");
+    }
+
+    mCmdDrawMeshTasks =
+        reinterpret_cast<PFN_vkCmdDrawMeshTasksEXT>(vkGetDeviceProcAddr(mDevice, "vkCmdDrawMeshTasksEXT"));
+    if (mCmdDrawMeshTasks == nullptr)
+    {
+        throw std::runtime_error("Failed to load vkCmdDrawMeshTasksEXT.");
+    }
+
+    // The task shader culls : it reads the transforms of the bindless set and the meshlets of set 1
+    std::vector<uint32_t> spirvCode = CompileShaderToSpirv("VulkanCore/shaders/meshlet_cull.task", {});
+    ShaderReflection reflection = ReflectSpirv(spirvCode);
+    mRegistry->validateInterface(reflection, true);
+    validateInterface(reflection);
+    mTaskShaderModule = CreateShaderModuleFromSpirv(mDevice, spirvCode);
+
+    // Frustum and backface culling until the first updateCullData()
+    GpuCullData cullData = {.mFlags = CullFlag_Frustum | CullFlag_Backface};
+    mCullBuffers = mVulkanCore->createUniformBuffers(sizeof(GpuCullData));
+    for (BufferAndMemory& buffer : mCullBuffers)
+    {
+        buffer.update(mDevice, &cullData, sizeof(cullData));
+    }
+
+    VkShaderStageFlags stages = VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+    std::vector<VkDescriptorSetLayoutBinding> bindings = {
+        {MeshletDrawBinding_Meshlets, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, stages, nullptr},
+        {MeshletDrawBinding_Vertices, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, stages, nullptr},
+        {MeshletDrawBinding_Triangles, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, stages, nullptr},
+        {MeshletDrawBinding_CullData, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, stages, nullptr},
+    };
+    mDrawSetLayout = mVulkanCore->getDescriptorSetLayoutCache()->getLayout(bindings);
+}
+
+MeshletDrawList::~MeshletDrawList()
+{
+    destroy();
+}
+
+void MeshletDrawList::destroy()
+{
+    // Descriptor sets are owned by the VulkanCore allocator, the set layout by the layout cache
+    if (mTaskShaderModule != VK_NULL_HANDLE)
+    {
+        vkDestroyShaderModule(mDevice, mTaskShaderModule, nullptr);
+        mTaskShaderModule = VK_NULL_HANDLE;
+    }
+
+    mMeshletBuffer.Destroy(mDevice);
+    mVertexBuffer.Destroy(mDevice);
+    mTriangleBuffer.Destroy(mDevice);
+    for (BufferAndMemory& buffer : mCullBuffers)
+    {
+        buffer.Destroy(mDevice);
+    }
+    mCullBuffers.clear();
+    mDrawSets.clear();
+}
+
+uint32_t MeshletDrawList::addVertices(const std::vector<uint32_t>& vertices)
+{
+    uint32_t offset = static_cast<uint32_t>(mVertices.size());
+    mVertices.insert(mVertices.end(), vertices.begin(), vertices.end());
+    return offset;
+}
+
+uint32_t MeshletDrawList::addTriangles(const std::vector<uint32_t>& triangles)
+{
+    uint32_t offset = static_cast<uint32_t>(mTriangles.size());
+    mTriangles.insert(mTriangles.end(), triangles.begin(), triangles.end());
+    return offset;
+}
+
+void MeshletDrawList::addMeshlet(const ShaderPermutationKey& key, const GpuMeshlet& meshlet)
+{
+    if (!mBatches.empty())
+    {
+        throw std::runtime_error("MeshletDrawList: meshlets cannot be added after upload().");
+    }
+    mPendingKeys.push_back(key.hash());
+    mMeshlets.push_back(meshlet);
+}
+
+void MeshletDrawList::upload()
+{
+    if (mMeshlets.empty())
+    {
+        throw std::runtime_error("MeshletDrawList: nothing to upload.");
+    }
+
+    // Meshlets of a batch are contiguous, a task workgroup only sees meshlets of its batch
+    std::vector<uint32_t> order(mMeshlets.size());
+    for (uint32_t meshletIndex = 0; meshletIndex < order.size(); meshletIndex++)
+    {
+        order[meshletIndex] = meshletIndex;
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [this](uint32_t a, uint32_t b) { return mPendingKeys[a] < mPendingKeys[b]; });
+
+    std::vector<GpuMeshlet> meshlets(mMeshlets.size());
+    for (uint32_t meshletIndex = 0; meshletIndex < order.size(); meshletIndex++)
+    {
+        uint64_t key = mPendingKeys[order[meshletIndex]];
+        if (mBatches.empty() || mBatches.back().mKey != key)
+        {
+            mBatches.push_back({key, meshletIndex, 0});
+        }
+        mBatches.back().mNumMeshlets++;
+        meshlets[meshletIndex] = mMeshlets[order[meshletIndex]];
+    }
+    mMeshlets = std::move(meshlets);
+    mPendingKeys.clear();
+
+    mMeshletBuffer = mVulkanCore->createVertexBuffer(mMeshlets.data(), mMeshlets.size() * sizeof(GpuMeshlet));
+    mVertexBuffer = mVulkanCore->createVertexBuffer(mVertices.data(), mVertices.size() * sizeof(uint32_t));
+    mTriangleBuffer = mVulkanCore->createVertexBuffer(mTriangles.data(), mTriangles.size() * sizeof(uint32_t));
+
+    createDescriptorSets();
+
+    std::cout << "Meshlet draw list uploaded: " << mMeshlets.size() << " meshlets in " << mBatches.size()
+              << " batches." << std::endl;
+}
+
+void MeshletDrawList::recordDraws(VkCommandBuffer commandBuffer, const PipelineVariantMap& pipelines,
+                                  uint32_t imageIndex) const
+{
+    VkPushConstantRange pushConstantRange = getPushConstantRange();
+
+    GraphicsPipelineV2* pBoundPipeline = nullptr;
+    for (uint32_t batchIndex = 0; batchIndex < mBatches.size(); batchIndex++)
+    {
+        const Batch& batch = mBatches[batchIndex];
+        auto it = pipelines.find(batch.mKey);
+        if (it == pipelines.end())
+        {
+            throw std::runtime_error("No pipeline for the shader permutation of batch " + std::to_string(batchIndex));
+        }
+
+        GraphicsPipelineV2* pPipeline = it->second;
+        VkPipelineLayout pipelineLayout = pPipeline->getPipelineLayout();
+        if (pBoundPipeline == nullptr)
+        {
+            // All mesh shader pipelines share the set layouts, both sets stay bound across pipeline changes
+            mRegistry->bind(commandBuffer, pipelineLayout, imageIndex);
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipelineLayout, 1, 1,
+                                    &mDrawSets[imageIndex], 0, nullptr);
+        }
+        if (pPipeline != pBoundPipeline)
+        {
+            pBoundPipeline = pPipeline;
+            pBoundPipeline->bind(commandBuffer);
+        }
+
+        // One task workgroup per kMeshletTaskGroupSize meshlets, split when the batch exceeds the group count limit
+        const uint32_t maxMeshletsPerDraw = kMaxTaskGroups * kMeshletTaskGroupSize;
+        for (uint32_t first = 0; first < batch.mNumMeshlets; first += maxMeshletsPerDraw)
+        {
+            MeshletBatchConstants constants = {
+                .mFirstMeshlet = batch.mFirstMeshlet + first,
+                .mNumMeshlets = std::min(batch.mNumMeshlets - first, maxMeshletsPerDraw),
+            };
+            vkCmdPushConstants(commandBuffer, pipelineLayout, pushConstantRange.stageFlags, 0, sizeof(constants),
+                               &constants);
+            uint32_t numGroups = (constants.mNumMeshlets + kMeshletTaskGroupSize - 1) / kMeshletTaskGroupSize;
+            mCmdDrawMeshTasks(commandBuffer, numGroups, 1, 1);
+        }
+    }
+}
+
+void MeshletDrawList::recordCullDataBarrier(VkCommandBuffer commandBuffer, uint32_t imageIndex) const
+{
+    bufferMemBarrier(commandBuffer, mCullBuffers[imageIndex].mBuffer, VK_ACCESS_SHADER_WRITE_BIT,
+                     VK_ACCESS_HOST_READ_BIT, VK_PIPELINE_STAGE_TASK_SHADER_BIT_EXT, VK_PIPELINE_STAGE_HOST_BIT);
+}
+
+GpuCullData MeshletDrawList::updateCullData(uint32_t imageIndex, uint32_t cullFlags)
+{
+    GpuCullData previous = {};
+    mCullBuffers[imageIndex].read(mDevice, &previous, sizeof(previous));
+
+    GpuCullData next = {.mFlags = cullFlags & ~CullFlag_Occlusion};
+    mCullBuffers[imageIndex].update(mDevice, &next, sizeof(next));
+    return previous;
+}
+
+void MeshletDrawList::validateInterface(const ShaderReflection& reflection) const
+{
+    for (const ReflectedBinding& binding : reflection.mBindings)
+    {
+        if (binding.mSet != 1)
+        {
+            continue;
+        }
+
+        std::string location = "'" + binding.mName + "' (set 1, binding " + std::to_string(binding.mBinding) + ")";
+        if (binding.mBinding >= MeshletDrawBinding_Count)
+        {
+            throw std::runtime_error("Shader/meshlet draw mismatch: " + location + " is not part of the meshlet set.");
+        }
+        if (binding.mType != VK_DESCRIPTOR_TYPE_STORAGE_BUFFER || binding.mCount != 1)
+        {
+            throw std::runtime_error("Shader/meshlet draw mismatch: " + location + " must be a single " +
+                                     GetDescriptorTypeName(VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) + ".");
+        }
+    }
+    if (reflection.mPushConstants.size > sizeof(MeshletBatchConstants))
+    {
+        throw std::runtime_error("Shader/meshlet draw mismatch: push constant block is " +
+                                 std::to_string(reflection.mPushConstants.size) +
+                                 " bytes, MeshletBatchConstants is " + std::to_string(sizeof(MeshletBatchConstants)) +
+                                 " bytes.");
+    }
+}
+
+void MeshletDrawList::createDescriptorSets()
+{
+    DescriptorAllocator* pAllocator = mVulkanCore->getDescriptorAllocator();
+    std::vector<VkDescriptorPoolSize> drawSetSizes = {{VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, MeshletDrawBinding_Count}};
+
+    mDrawSets.resize(mNumImages);
+    for (int32_t imageIndex = 0; imageIndex < mNumImages; imageIndex++)
+    {
+        mDrawSets[imageIndex] = pAllocator->allocate(mDrawSetLayout, drawSetSizes);
+
+        VkDescriptorBufferInfo meshlets = {mMeshletBuffer.mBuffer, 0, VK_WHOLE_SIZE};
+        VkDescriptorBufferInfo vertices = {mVertexBuffer.mBuffer, 0, VK_WHOLE_SIZE};
+        VkDescriptorBufferInfo triangles = {mTriangleBuffer.mBuffer, 0, VK_WHOLE_SIZE};
+        VkDescriptorBufferInfo cullData = {mCullBuffers[imageIndex].mBuffer, 0, VK_WHOLE_SIZE};
+
+        VkWriteDescriptorSet writeDescriptorSets[] = {
+            makeBufferWrite(mDrawSets[imageIndex], MeshletDrawBinding_Meshlets, &meshlets),
+            makeBufferWrite(mDrawSets[imageIndex], MeshletDrawBinding_Vertices, &vertices),
+            makeBufferWrite(mDrawSets[imageIndex], MeshletDrawBinding_Triangles, &triangles),
+            makeBufferWrite(mDrawSets[imageIndex], MeshletDrawBinding_CullData, &cullData),
+        };
+        vkUpdateDescriptorSets(mDevice, MeshletDrawBinding_Count, writeDescriptorSets, 0, nullptr);
+    }
+}
+
+} // namespace VulkanCore
@@ -0,0 +1,221 @@
+#include "ModelLoader.h"
+#include "VulkanModel.h"
+
+#include <exception>
+#include <iostream>
+
+namespace VulkanCore
+{
+
+const char* GetModelLoadStageName(ModelLoadStage stage)
+{
+    switch (stage)
+    {
+    case ModelLoadStage_Queued:
+        return "Queued";
+    case ModelLoadStage_Import:
+        return "Import";
+    case ModelLoadStage_Decode:
+        return "Decode";
+    case ModelLoadStage_Upload:
+        return "Upload";
+    case ModelLoadStage_Resident:
+        return "Resident";
+    case ModelLoadStage_Failed:
+        return "Failed";
+    default:
+        return "Unknown";
+    }
+}
+
+float ModelLoad::getElapsedTime() const
+{
+    return std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - mStart).count();
+}
+
+VulkanModel* ModelLoad::releaseModel()
+{
+    if (!isResident())
+    {
+        return nullptr;
+    }
+    VulkanModel* pModel = mpModel;
+    mpModel = nullptr;
+    return pModel;
+}
+
+void ModelLoad::setStage(ModelLoadStage stage)
+{
+    auto now = std::chrono::steady_clock::now();
+    mStageTimes[getStage()] = std::chrono::duration<float, std::milli>(now - mStageStart).count();
+    mStageStart = now;
+    mStage.store(stage, std::memory_order_release);
+}
+
+ModelLoader::ModelLoader(VulkanCore* pVulkanCore, VkDeviceSize uploadBudget)
+    : mVulkanCore{pVulkanCore}, mUploadBudget{uploadBudget}, mUploadStream(pVulkanCore)
+{
+    mWorker = std::thread(&ModelLoader::runWorker, this);
+}
+
+ModelLoader::~ModelLoader()
+{
+    destroy();
+}
+
+void ModelLoader::destroy()
+{
+    if (mWorker.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStopping = true;
+        }
+        mCondition.notify_one();
+        mWorker.join();
+    }
+
+    // The streamed targets must not be in use anymore
+    mUploadStream.destroy();
+    mpStreamingLoad = nullptr;
+    for (std::unique_ptr<ModelLoad>& load : mLoads)
+    {
+        if (load->mpModel)
+        {
+            load->mpModel->destroy();
+            delete load->mpModel;
+            load->mpModel = nullptr;
+        }
+    }
+    mLoads.clear();
+}
+
+ModelLoad* ModelLoader::load(const std::string& modelPath, VertexLayout vertexLayout, bool positionStream)
+{
+    mLoads.push_back(std::make_unique<ModelLoad>());
+    ModelLoad* pLoad = mLoads.back().get();
+    pLoad->mPath = modelPath;
+    pLoad->mVertexLayout = vertexLayout;
+    pLoad->mPositionStream = positionStream;
+    pLoad->mStart = std::chrono::steady_clock::now();
+    pLoad->mStageStart = pLoad->mStart;
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mQueue.push_back(pLoad);
+    }
+    mCondition.notify_one();
+    return pLoad;
+}
+
+void ModelLoader::runWorker()
+{
+    for (;;)
+    {
+        ModelLoad* pLoad = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mMutex);
+            mCondition.wait(lock, [this]() { return mStopping || !mQueue.empty(); });
+            if (mStopping)
+            {
+                return;
+            }
+            pLoad = mQueue.front();
+            mQueue.pop_front();
+        }
+        importModel(*pLoad);
+    }
+}
+
+void ModelLoader::importModel(ModelLoad& load)
+{
+    // Nothing is submitted here, see the deferUploads argument of VulkanModel
+    VulkanModel* pModel = nullptr;
+    try
+    {
+        load.setStage(ModelLoadStage_Import);
+        pModel = new VulkanModel(load.mPath, mVulkanCore, load.mVertexLayout, load.mPositionStream, true);
+        load.setStage(ModelLoadStage_Decode);
+        pModel->decodeTextures();
+    }
+    catch (const std::exception& e)
+    {
+        if (pModel)
+        {
+            pModel->destroy();
+            delete pModel;
+        }
+        failLoad(load, e.what());
+        return;
+    }
+
+    load.mpModel = pModel;
+    load.setStage(ModelLoadStage_Upload);
+}
+
+void ModelLoader::update()
+{
+    if (!mUploadStream.isComplete())
+    {
+        return;
+    }
+
+    if (mpStreamingLoad && !mpStreamingLoad->mpModel->hasPendingUploads())
+    {
+        finishUploads(*mpStreamingLoad);
+        mpStreamingLoad = nullptr;
+    }
+    if (!mpStreamingLoad)
+    {
+        // Imported first, streamed first
+        for (std::unique_ptr<ModelLoad>& load : mLoads)
+        {
+            if (load->getStage() == ModelLoadStage_Upload)
+            {
+                mpStreamingLoad = load.get();
+                break;
+            }
+        }
+        if (!mpStreamingLoad)
+        {
+            return;
+        }
+    }
+
+    ModelLoad& load = *mpStreamingLoad;
+    try
+    {
+        load.mpModel->streamUploads(mUploadStream, mUploadBudget);
+        load.mUploadSize += mUploadStream.getBatchSize();
+        mUploadStream.submit();
+    }
+    catch (const std::exception& e)
+    {
+        // The copies recorded so far write into the model, it can only go once they are done
+        mUploadStream.submit();
+        mUploadStream.wait();
+        load.mpModel->destroy();
+        delete load.mpModel;
+        load.mpModel = nullptr;
+        mpStreamingLoad = nullptr;
+        failLoad(load, e.what());
+    }
+}
+
+void ModelLoader::finishUploads(ModelLoad& load)
+{
+    load.setStage(ModelLoadStage_Resident);
+    std::cout << "Model " << load.mPath << " resident in " << load.getElapsedTime() << " ms : import "
+              << load.getStageTime(ModelLoadStage_Import) << " ms, decode " << load.getStageTime(ModelLoadStage_Decode)
+              << " ms, upload " << load.getStageTime(ModelLoadStage_Upload) << " ms, " << load.mUploadSize / 1024
+              << " KB uploaded" << std::endl;
+}
+
+void ModelLoader::failLoad(ModelLoad& load, const std::string& error)
+{
+    load.mError = error;
+    load.setStage(ModelLoadStage_Failed);
+    std::cout << "Warning! Failed to load the model " << load.mPath << " : " << error << std::endl;
+}
+
+} // namespace VulkanCore
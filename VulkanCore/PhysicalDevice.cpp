@@ -127,6 +127,39 @@ void PhysicalDevice::init(const VkInstance& instance, const VkSurfaceKHR& surfac
         // Get supported features : like geometry shader, tessellation shader, wide lines etc.,
         vkGetPhysicalDeviceFeatures(PhysDev, &mDevices[i].mFeatures);
 
+        // Vulkan 1.1 features (shader draw parameters etc.,)
+        // Vulkan 1.2 features (descriptor indexing, draw indirect count, 8/16 bit storage etc.,)
+        // Mesh shader features (task and mesh stages) when the device has VK_EXT_mesh_shader
+        mDevices[i].mFeatures11 = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_1_FEATURES};
+        mDevices[i].mFeatures12 = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES};
+        mDevices[i].mMeshShaderFeatures = {.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT};
+        mDevices[i].mDescriptorIndexingProperties = {
+            .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES};
+        if (VK_API_VERSION_MINOR(mDevices[i].mDeviceProperties.apiVersion) >= 2 ||
+            VK_API_VERSION_MAJOR(mDevices[i].mDeviceProperties.apiVersion) > 1)
+        {
+            mDevices[i].mFeatures11.pNext = &mDevices[i].mFeatures12;
+            if (mDevices[i].isExtensionSupported(VK_EXT_MESH_SHADER_EXTENSION_NAME))
+            {
+                mDevices[i].mFeatures12.pNext = &mDevices[i].mMeshShaderFeatures;
+            }
+            VkPhysicalDeviceFeatures2 features2 = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+                .pNext = &mDevices[i].mFeatures11,
+            };
+            vkGetPhysicalDeviceFeatures2(PhysDev, &features2);
+            mDevices[i].mFeatures11.pNext = nullptr;
+            mDevices[i].mFeatures12.pNext = nullptr;
+            mDevices[i].mMeshShaderFeatures.pNext = nullptr;
+
+            VkPhysicalDeviceProperties2 properties2 = {
+                .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2,
+                .pNext = &mDevices[i].mDescriptorIndexingProperties,
+            };
+            vkGetPhysicalDeviceProperties2(PhysDev, &properties2);
+            mDevices[i].mDescriptorIndexingProperties.pNext = nullptr;
+        }
+
         // Find a suitable depth format
         mDevices[i].mDepthFormat = findDepthFormat(PhysDev);
     }
@@ -150,6 +150,26 @@ void VulkanQueue::submitSync(VkCommandBuffer commandBuffer)
     waitIdle();
 }
 
+void VulkanQueue::submit(VkCommandBuffer commandBuffer, VkFence fence)
+{
+    VkSubmitInfo submitInfo = {
+        .sType = VK_STRUCTURE_TYPE_SUBMIT_INFO,
+        .pNext = nullptr,
+        .waitSemaphoreCount = 0,
+        .pWaitSemaphores = nullptr,
+        .pWaitDstStageMask = nullptr,
+        .commandBufferCount = 1,
+        .pCommandBuffers = &commandBuffer,
+        .signalSemaphoreCount = 0,
+        .pSignalSemaphores = nullptr,
+    };
+
+    if (vkQueueSubmit(mQueue, 1, &submitInfo, fence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to submit command buffer to queue.");
+    }
+}
+
 void VulkanQueue::submitAsync(VkCommandBuffer commandBuffer)
 {
     submitAsync(&commandBuffer, 1);
@@ -18,17 +18,21 @@ shaderc_shader_kind getShaderKindFromExtension(const std::string& filename)
         return shaderc_fragment_shader;
     else if (filename.ends_with(".comp"))
         return shaderc_compute_shader;
+    else if (filename.ends_with(".task"))
+        return shaderc_task_shader;
+    else if (filename.ends_with(".mesh"))
+        return shaderc_mesh_shader;
     else
         throw std::runtime_error("Unsupported shader file extension: " + filename);
 }
 
-VkShaderModule CreateShaderModuleFromText(const VkDevice& device, const std::string& shaderCode)
+std::vector<uint32_t> CompileShaderToSpirv(const std::string& shaderFile, const std::vector<std::string>& defines)
 {
     // Read shader source code from file
-    std::ifstream file(shaderCode);
+    std::ifstream file(shaderFile);
     if (!file.is_open())
     {
-        throw std::runtime_error("Failed to open shader file: " + shaderCode);
+        throw std::runtime_error("Failed to open shader file: " + shaderFile);
     }
     std::string sourceCode((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
     file.close();
@@ -37,18 +41,38 @@ VkShaderModule CreateShaderModuleFromText(const VkDevice& device, const std::str
     shaderc::Compiler compiler;
     shaderc::CompileOptions options;
     options.SetOptimizationLevel(shaderc_optimization_level_performance);
-    shaderc_shader_kind shaderKind = getShaderKindFromExtension(shaderCode);
+    for (const std::string& define : defines)
+    {
+        size_t equalPos = define.find('=');
+        if (equalPos == std::string::npos)
+        {
+            options.AddMacroDefinition(define);
+        }
+        else
+        {
+            options.AddMacroDefinition(define.substr(0, equalPos), define.substr(equalPos + 1));
+        }
+    }
+    shaderc_shader_kind shaderKind = getShaderKindFromExtension(shaderFile);
+    if (shaderKind == shaderc_task_shader || shaderKind == shaderc_mesh_shader)
+    {
+        // GL_EXT_mesh_shader needs SPIR-V 1.4
+        options.SetTargetEnvironment(shaderc_target_env_vulkan, shaderc_env_version_vulkan_1_3);
+    }
 
     shaderc::SpvCompilationResult module =
-        compiler.CompileGlslToSpv(sourceCode, shaderKind, shaderCode.c_str(), options);
+        compiler.CompileGlslToSpv(sourceCode, shaderKind, shaderFile.c_str(), options);
 
     if (module.GetCompilationStatus() != shaderc_compilation_status_success)
     {
         throw std::runtime_error("Shader compilation failed: " + module.GetErrorMessage());
     }
 
-    std::vector<uint32_t> spirvCode(module.cbegin(), module.cend());
+    return std::vector<uint32_t>(module.cbegin(), module.cend());
+}
 
+VkShaderModule CreateShaderModuleFromSpirv(const VkDevice& device, const std::vector<uint32_t>& spirvCode)
+{
     // Create Vulkan shader module
     VkShaderModuleCreateInfo createInfo = {};
     createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
@@ -61,6 +85,14 @@ VkShaderModule CreateShaderModuleFromText(const VkDevice& device, const std::str
         throw std::runtime_error("Failed to create shader module.");
     }
 
+    return shaderModule;
+}
+
+VkShaderModule CreateShaderModuleFromText(const VkDevice& device, const std::string& shaderCode)
+{
+    std::vector<uint32_t> spirvCode = CompileShaderToSpirv(shaderCode, {});
+    VkShaderModule shaderModule = CreateShaderModuleFromSpirv(device, spirvCode);
+
     // Once spriv binary code is generated, we can save it to a file for future use
     // next time, we can load the SPIR-V binary directly from the file instead of recompiling
     std::string spirvFilename = shaderCode + ".spv";
@@ -0,0 +1,138 @@
+#include "ShaderPermutation.h"
+#include "Shader.h"
+
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace VulkanCore
+{
+
+ShaderPermutationCache::ShaderPermutationCache(VkDevice device, std::string vertexShaderPath,
+                                               std::string fragmentShaderPath)
+    : mDevice{device}, mVertexShaderPath{std::move(vertexShaderPath)},
+      mFragmentShaderPath{std::move(fragmentShaderPath)}, mVariants{}, mVertexModules{}, mFragmentModules{}
+{
+}
+
+ShaderPermutationCache::~ShaderPermutationCache()
+{
+    destroy();
+}
+
+void ShaderPermutationCache::destroy()
+{
+    for (auto& [mask, module] : mVertexModules)
+    {
+        vkDestroyShaderModule(mDevice, module.mModule, nullptr);
+    }
+    for (auto& [mask, module] : mFragmentModules)
+    {
+        vkDestroyShaderModule(mDevice, module.mModule, nullptr);
+    }
+
+    mVertexModules.clear();
+    mFragmentModules.clear();
+    mVariants.clear();
+}
+
+const ShaderVariant& ShaderPermutationCache::getVariant(const ShaderPermutationKey& key)
+{
+    auto it = mVariants.find(key.hash());
+    if (it != mVariants.end())
+    {
+        return *it->second;
+    }
+
+    uint32_t interfaceFeatures = key.mFeatures & ShaderFeature_InterfaceMask;
+
+    auto variant = std::make_unique<ShaderVariant>();
+    variant->mKey = key;
+    const CompiledModule& vertexModule = getModule(mVertexModules, mVertexShaderPath, interfaceFeatures);
+    const CompiledModule& fragmentModule = getModule(mFragmentModules, mFragmentShaderPath, interfaceFeatures);
+    variant->mVertexModule = vertexModule.mModule;
+    variant->mFragmentModule = fragmentModule.mModule;
+    variant->mReflection = MergeReflection(vertexModule.mReflection, fragmentModule.mReflection);
+
+    variant->mSpecData = {
+        .mFeatureMask = key.mFeatures,
+        .mVertexLayout = key.mVertexLayout,
+        .mAlphaCutoff = 0.5f,
+    };
+
+    variant->mSpecEntries = {{
+        {
+            .constantID = SpecConstant_FeatureMask,
+            .offset = offsetof(SpecializationData, mFeatureMask),
+            .size = sizeof(uint32_t),
+        },
+        {
+            .constantID = SpecConstant_VertexLayout,
+            .offset = offsetof(SpecializationData, mVertexLayout),
+            .size = sizeof(uint32_t),
+        },
+        {
+            .constantID = SpecConstant_AlphaCutoff,
+            .offset = offsetof(SpecializationData, mAlphaCutoff),
+            .size = sizeof(float),
+        },
+    }};
+
+    variant->mSpecializationInfo = {
+        .mapEntryCount = static_cast<uint32_t>(variant->mSpecEntries.size()),
+        .pMapEntries = variant->mSpecEntries.data(),
+        .dataSize = sizeof(variant->mSpecData),
+        .pData = &variant->mSpecData,
+    };
+
+    std::cout << "Shader variant created: features 0x" << std::hex << key.mFeatures << std::dec << ", vertex layout "
+              << key.mVertexLayout << " (" << mVariants.size() + 1 << " variants, " << getNumModules()
+              << " modules)" << std::endl;
+
+    const ShaderVariant& result = *variant;
+    mVariants.emplace(key.hash(), std::move(variant));
+    return result;
+}
+
+const ShaderPermutationCache::CompiledModule& ShaderPermutationCache::getModule(
+    std::unordered_map<uint32_t, CompiledModule>& modules, const std::string& shaderPath, uint32_t interfaceFeatures)
+{
+    auto it = modules.find(interfaceFeatures);
+    if (it != modules.end())
+    {
+        return it->second;
+    }
+
+    std::vector<uint32_t> spirvCode = CompileShaderToSpirv(shaderPath, getDefines(interfaceFeatures));
+
+    CompiledModule module;
+    module.mReflection = ReflectSpirv(spirvCode);
+    module.mModule = CreateShaderModuleFromSpirv(mDevice, spirvCode);
+    return modules.emplace(interfaceFeatures, std::move(module)).first->second;
+}
+
+std::vector<std::string> ShaderPermutationCache::getDefines(uint32_t interfaceFeatures)
+{
+    std::vector<std::string> defines;
+    if (interfaceFeatures & ShaderFeature_NormalMap)
+    {
+        defines.push_back("HAS_NORMAL_MAP");
+    }
+    if (interfaceFeatures & ShaderFeature_PushConstants)
+    {
+        defines.push_back("USE_PUSH_CONSTANTS");
+    }
+    if (interfaceFeatures & ShaderFeature_GpuDriven)
+    {
+        defines.push_back("GPU_DRIVEN");
+    }
+    if (interfaceFeatures & ShaderFeature_Instanced)
+    {
+        defines.push_back("INSTANCED");
+    }
+    return defines;
+}
+
+} // namespace VulkanCore
@@ -0,0 +1,540 @@
+#include "ShaderReflection.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace VulkanCore
+{
+
+namespace
+{
+
+// SPIR-V constants, see the SPIR-V specification (spirv.h is not part of our dependencies)
+constexpr uint32_t SpvMagicNumber = 0x07230203;
+constexpr uint32_t SpvHeaderWords = 5;
+
+enum SpvOp : uint32_t
+{
+    SpvOpName = 5,
+    SpvOpEntryPoint = 15,
+    SpvOpTypeBool = 20,
+    SpvOpTypeInt = 21,
+    SpvOpTypeFloat = 22,
+    SpvOpTypeVector = 23,
+    SpvOpTypeMatrix = 24,
+    SpvOpTypeImage = 25,
+    SpvOpTypeSampler = 26,
+    SpvOpTypeSampledImage = 27,
+    SpvOpTypeArray = 28,
+    SpvOpTypeRuntimeArray = 29,
+    SpvOpTypeStruct = 30,
+    SpvOpTypePointer = 32,
+    SpvOpConstant = 43,
+    SpvOpSpecConstant = 50,
+    SpvOpVariable = 59,
+    SpvOpDecorate = 71,
+    SpvOpMemberDecorate = 72,
+    SpvOpTypeAccelerationStructureKHR = 5341,
+};
+
+enum SpvDecoration : uint32_t
+{
+    SpvDecorationBlock = 2,
+    SpvDecorationBufferBlock = 3,
+    SpvDecorationArrayStride = 6,
+    SpvDecorationMatrixStride = 7,
+    SpvDecorationBinding = 33,
+    SpvDecorationDescriptorSet = 34,
+    SpvDecorationOffset = 35,
+};
+
+enum SpvStorageClass : uint32_t
+{
+    SpvStorageClassUniformConstant = 0,
+    SpvStorageClassUniform = 2,
+    SpvStorageClassPushConstant = 9,
+    SpvStorageClassStorageBuffer = 12,
+};
+
+enum SpvExecutionModel : uint32_t
+{
+    SpvExecutionModelVertex = 0,
+    SpvExecutionModelTessellationControl = 1,
+    SpvExecutionModelTessellationEvaluation = 2,
+    SpvExecutionModelGeometry = 3,
+    SpvExecutionModelFragment = 4,
+    SpvExecutionModelGLCompute = 5,
+    SpvExecutionModelTaskEXT = 5364,
+    SpvExecutionModelMeshEXT = 5365,
+};
+
+constexpr uint32_t SpvDimBuffer = 5;
+
+struct SpvId
+{
+    uint32_t mOpcode{0};
+    std::vector<uint32_t> mOperands; // operands of the defining instruction, without opcode and result id
+    std::string mName;
+
+    // decorations
+    uint32_t mSet{UINT32_MAX};
+    uint32_t mBinding{UINT32_MAX};
+    uint32_t mArrayStride{0};
+    bool mIsBlock{false};
+    bool mIsBufferBlock{false};
+    std::vector<uint32_t> mMemberOffsets;
+    std::vector<uint32_t> mMemberMatrixStrides;
+};
+
+VkShaderStageFlags getStageFromExecutionModel(uint32_t executionModel)
+{
+    switch (executionModel)
+    {
+        case SpvExecutionModelVertex:
+            return VK_SHADER_STAGE_VERTEX_BIT;
+        case SpvExecutionModelTessellationControl:
+            return VK_SHADER_STAGE_TESSELLATION_CONTROL_BIT;
+        case SpvExecutionModelTessellationEvaluation:
+            return VK_SHADER_STAGE_TESSELLATION_EVALUATION_BIT;
+        case SpvExecutionModelGeometry:
+            return VK_SHADER_STAGE_GEOMETRY_BIT;
+        case SpvExecutionModelFragment:
+            return VK_SHADER_STAGE_FRAGMENT_BIT;
+        case SpvExecutionModelGLCompute:
+            return VK_SHADER_STAGE_COMPUTE_BIT;
+        case SpvExecutionModelTaskEXT:
+            return VK_SHADER_STAGE_TASK_BIT_EXT;
+        case SpvExecutionModelMeshEXT:
+            return VK_SHADER_STAGE_MESH_BIT_EXT;
+        default:
+            return 0;
+    }
+}
+
+// Result id is the first operand for types and the second one for OpConstant / OpVariable
+bool hasResultTypeAndId(uint32_t opcode)
+{
+    return opcode == SpvOpConstant || opcode == SpvOpSpecConstant || opcode == SpvOpVariable;
+}
+
+bool isType(uint32_t opcode)
+{
+    return (opcode >= SpvOpTypeBool && opcode <= SpvOpTypePointer) || opcode == SpvOpTypeAccelerationStructureKHR;
+}
+
+class SpirvParser
+{
+  public:
+    explicit SpirvParser(const std::vector<uint32_t>& spirvCode) : mIds{}
+    {
+        if (spirvCode.size() < SpvHeaderWords || spirvCode[0] != SpvMagicNumber)
+        {
+            throw std::runtime_error("Shader reflection: invalid SPIR-V module.");
+        }
+
+        uint32_t idBound = spirvCode[3];
+        mIds.resize(idBound);
+
+        size_t wordIndex = SpvHeaderWords;
+        while (wordIndex < spirvCode.size())
+        {
+            uint32_t opcode = spirvCode[wordIndex] & 0xFFFF;
+            uint32_t wordCount = spirvCode[wordIndex] >> 16;
+            if (wordCount == 0 || wordIndex + wordCount > spirvCode.size())
+            {
+                throw std::runtime_error("Shader reflection: truncated SPIR-V instruction.");
+            }
+
+            const uint32_t* pOperands = &spirvCode[wordIndex + 1];
+            uint32_t numOperands = wordCount - 1;
+            parseInstruction(opcode, pOperands, numOperands);
+
+            wordIndex += wordCount;
+        }
+    }
+
+    VkShaderStageFlags mStages{0};
+    std::vector<uint32_t> mVariables;
+    std::vector<SpvId> mIds;
+
+    const SpvId& get(uint32_t id) const
+    {
+        if (id >= mIds.size())
+        {
+            throw std::runtime_error("Shader reflection: SPIR-V id out of range.");
+        }
+        return mIds[id];
+    }
+
+    // Size in bytes of a type in an explicitly laid out block (push constants)
+    uint32_t getTypeSize(uint32_t typeId, uint32_t matrixStride = 0) const
+    {
+        const SpvId& type = get(typeId);
+        switch (type.mOpcode)
+        {
+            case SpvOpTypeBool:
+                return 4;
+            case SpvOpTypeInt:
+            case SpvOpTypeFloat:
+                return type.mOperands[0] / 8;
+            case SpvOpTypeVector:
+                return getTypeSize(type.mOperands[0]) * type.mOperands[1];
+            case SpvOpTypeMatrix:
+            {
+                uint32_t columnSize = matrixStride ? matrixStride : getTypeSize(type.mOperands[0]);
+                return columnSize * type.mOperands[1];
+            }
+            case SpvOpTypeArray:
+            {
+                uint32_t length = getConstantValue(type.mOperands[1]);
+                uint32_t stride = type.mArrayStride ? type.mArrayStride : getTypeSize(type.mOperands[0]);
+                return stride * length;
+            }
+            case SpvOpTypeRuntimeArray:
+                return 0;
+            case SpvOpTypeStruct:
+            {
+                uint32_t size = 0;
+                for (size_t member = 0; member < type.mOperands.size(); member++)
+                {
+                    uint32_t offset = member < type.mMemberOffsets.size() ? type.mMemberOffsets[member] : size;
+                    uint32_t stride = member < type.mMemberMatrixStrides.size() ? type.mMemberMatrixStrides[member] : 0;
+                    size = std::max(size, offset + getTypeSize(type.mOperands[member], stride));
+                }
+                return size;
+            }
+            default:
+                throw std::runtime_error("Shader reflection: unsupported type in push constant block.");
+        }
+    }
+
+    uint32_t getConstantValue(uint32_t constantId) const
+    {
+        const SpvId& constant = get(constantId);
+        if (constant.mOpcode != SpvOpConstant && constant.mOpcode != SpvOpSpecConstant)
+        {
+            throw std::runtime_error("Shader reflection: array length is not a constant.");
+        }
+        return constant.mOperands[0];
+    }
+
+  private:
+    void parseInstruction(uint32_t opcode, const uint32_t* pOperands, uint32_t numOperands)
+    {
+        switch (opcode)
+        {
+            case SpvOpEntryPoint:
+                mStages |= getStageFromExecutionModel(pOperands[0]);
+                return;
+
+            case SpvOpName:
+                at(pOperands[0]).mName = reinterpret_cast<const char*>(&pOperands[1]);
+                return;
+
+            case SpvOpDecorate:
+            {
+                SpvId& target = at(pOperands[0]);
+                switch (pOperands[1])
+                {
+                    case SpvDecorationBinding:
+                        target.mBinding = pOperands[2];
+                        break;
+                    case SpvDecorationDescriptorSet:
+                        target.mSet = pOperands[2];
+                        break;
+                    case SpvDecorationArrayStride:
+                        target.mArrayStride = pOperands[2];
+                        break;
+                    case SpvDecorationBlock:
+                        target.mIsBlock = true;
+                        break;
+                    case SpvDecorationBufferBlock:
+                        target.mIsBufferBlock = true;
+                        break;
+                    default:
+                        break;
+                }
+                return;
+            }
+
+            case SpvOpMemberDecorate:
+            {
+                SpvId& target = at(pOperands[0]);
+                uint32_t member = pOperands[1];
+                if (pOperands[2] == SpvDecorationOffset)
+                {
+                    if (target.mMemberOffsets.size() <= member)
+                    {
+                        target.mMemberOffsets.resize(member + 1, 0);
+                    }
+                    target.mMemberOffsets[member] = pOperands[3];
+                }
+                else if (pOperands[2] == SpvDecorationMatrixStride)
+                {
+                    if (target.mMemberMatrixStrides.size() <= member)
+                    {
+                        target.mMemberMatrixStrides.resize(member + 1, 0);
+                    }
+                    target.mMemberMatrixStrides[member] = pOperands[3];
+                }
+                return;
+            }
+
+            default:
+                break;
+        }
+
+        if (isType(opcode) && numOperands >= 1)
+        {
+            SpvId& id = at(pOperands[0]);
+            id.mOpcode = opcode;
+            id.mOperands.assign(pOperands + 1, pOperands + numOperands);
+        }
+        else if (hasResultTypeAndId(opcode) && numOperands >= 2)
+        {
+            SpvId& id = at(pOperands[1]);
+            id.mOpcode = opcode;
+            id.mOperands.assign(pOperands + 2, pOperands + numOperands);
+            id.mOperands.insert(id.mOperands.begin(), pOperands[0]); // keep the result type first
+            if (opcode == SpvOpVariable)
+            {
+                mVariables.push_back(pOperands[1]);
+            }
+            else
+            {
+                // constants : operands = { value }
+                id.mOperands.erase(id.mOperands.begin());
+            }
+        }
+    }
+
+    SpvId& at(uint32_t id)
+    {
+        if (id >= mIds.size())
+        {
+            throw std::runtime_error("Shader reflection: SPIR-V id out of range.");
+        }
+        return mIds[id];
+    }
+};
+
+VkDescriptorType getDescriptorType(const SpirvParser& parser, uint32_t typeId, uint32_t storageClass)
+{
+    const SpvId& type = parser.get(typeId);
+
+    switch (type.mOpcode)
+    {
+        case SpvOpTypeSampledImage:
+            return VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+
+        case SpvOpTypeSampler:
+            return VK_DESCRIPTOR_TYPE_SAMPLER;
+
+        case SpvOpTypeImage:
+        {
+            // operands : sampled type, dim, depth, arrayed, ms, sampled, format
+            bool isBuffer = type.mOperands[1] == SpvDimBuffer;
+            bool isStorage = type.mOperands[5] == 2;
+            if (isBuffer)
+            {
+                return isStorage ? VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER : VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER;
+            }
+            return isStorage ? VK_DESCRIPTOR_TYPE_STORAGE_IMAGE : VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        }
+
+        case SpvOpTypeAccelerationStructureKHR:
+            return VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+
+        case SpvOpTypeStruct:
+            if (storageClass == SpvStorageClassStorageBuffer || type.mIsBufferBlock)
+            {
+                return VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            }
+            return VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+
+        default:
+            throw std::runtime_error("Shader reflection: unsupported descriptor type.");
+    }
+}
+
+} // namespace
+
+ShaderReflection ReflectSpirv(const std::vector<uint32_t>& spirvCode)
+{
+    SpirvParser parser(spirvCode);
+
+    ShaderReflection reflection;
+    reflection.mStages = parser.mStages;
+
+    for (uint32_t variableId : parser.mVariables)
+    {
+        const SpvId& variable = parser.get(variableId);
+        const SpvId& pointer = parser.get(variable.mOperands[0]);
+        uint32_t storageClass = variable.mOperands[1];
+
+        if (pointer.mOpcode != SpvOpTypePointer)
+        {
+            continue;
+        }
+
+        if (storageClass == SpvStorageClassPushConstant)
+        {
+            reflection.mPushConstants = {
+                .stageFlags = parser.mStages,
+                .offset = 0,
+                .size = parser.getTypeSize(pointer.mOperands[1]),
+            };
+            continue;
+        }
+
+        if (storageClass != SpvStorageClassUniformConstant && storageClass != SpvStorageClassUniform &&
+            storageClass != SpvStorageClassStorageBuffer)
+        {
+            continue;
+        }
+
+        // Unwrap descriptor arrays
+        uint32_t typeId = pointer.mOperands[1];
+        uint32_t count = 1;
+        const SpvId* pType = &parser.get(typeId);
+        if (pType->mOpcode == SpvOpTypeArray)
+        {
+            count = parser.getConstantValue(pType->mOperands[1]);
+            typeId = pType->mOperands[0];
+        }
+        else if (pType->mOpcode == SpvOpTypeRuntimeArray)
+        {
+            count = 0;
+            typeId = pType->mOperands[0];
+        }
+
+        ReflectedBinding binding;
+        binding.mSet = variable.mSet == UINT32_MAX ? 0 : variable.mSet;
+        binding.mBinding = variable.mBinding == UINT32_MAX ? 0 : variable.mBinding;
+        binding.mType = getDescriptorType(parser, typeId, storageClass);
+        binding.mCount = count;
+        binding.mStages = parser.mStages;
+        binding.mName = !variable.mName.empty() ? variable.mName : parser.get(typeId).mName;
+        reflection.mBindings.push_back(binding);
+    }
+
+    std::sort(reflection.mBindings.begin(), reflection.mBindings.end(),
+              [](const ReflectedBinding& a, const ReflectedBinding& b) {
+                  return a.mSet != b.mSet ? a.mSet < b.mSet : a.mBinding < b.mBinding;
+              });
+
+    return reflection;
+}
+
+ShaderReflection MergeReflection(const ShaderReflection& a, const ShaderReflection& b)
+{
+    ShaderReflection merged = a;
+    merged.mStages |= b.mStages;
+
+    for (const ReflectedBinding& binding : b.mBindings)
+    {
+        auto it = std::find_if(merged.mBindings.begin(), merged.mBindings.end(), [&binding](const ReflectedBinding& x) {
+            return x.mSet == binding.mSet && x.mBinding == binding.mBinding;
+        });
+
+        if (it == merged.mBindings.end())
+        {
+            merged.mBindings.push_back(binding);
+            continue;
+        }
+
+        if (it->mType != binding.mType || it->mCount != binding.mCount)
+        {
+            throw std::runtime_error("Shader interface mismatch at set " + std::to_string(binding.mSet) +
+                                     ", binding " + std::to_string(binding.mBinding) + ": " +
+                                     GetDescriptorTypeName(it->mType) + " '" + it->mName + "' vs " +
+                                     GetDescriptorTypeName(binding.mType) + " '" + binding.mName + "'");
+        }
+        it->mStages |= binding.mStages;
+    }
+
+    if (b.mPushConstants.size > 0)
+    {
+        merged.mPushConstants.stageFlags |= b.mPushConstants.stageFlags;
+        merged.mPushConstants.size = std::max(merged.mPushConstants.size, b.mPushConstants.size);
+    }
+
+    std::sort(merged.mBindings.begin(), merged.mBindings.end(),
+              [](const ReflectedBinding& x, const ReflectedBinding& y) {
+                  return x.mSet != y.mSet ? x.mSet < y.mSet : x.mBinding < y.mBinding;
+              });
+
+    return merged;
+}
+
+std::vector<VkDescriptorSetLayoutBinding> GetSetLayoutBindings(const ShaderReflection& reflection, uint32_t set)
+{
+    std::vector<VkDescriptorSetLayoutBinding> bindings;
+    for (const ReflectedBinding& binding : reflection.mBindings)
+    {
+        if (binding.mSet != set)
+        {
+            continue;
+        }
+
+        bindings.push_back({
+            .binding = binding.mBinding,
+            .descriptorType = binding.mType,
+            .descriptorCount = binding.mCount,
+            .stageFlags = binding.mStages,
+            .pImmutableSamplers = nullptr,
+        });
+    }
+    return bindings;
+}
+
+std::vector<VkDescriptorPoolSize> GetPoolSizes(const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+                                               uint32_t numSets)
+{
+    std::vector<VkDescriptorPoolSize> poolSizes;
+    for (const VkDescriptorSetLayoutBinding& binding : bindings)
+    {
+        auto it = std::find_if(poolSizes.begin(), poolSizes.end(),
+                               [&binding](const VkDescriptorPoolSize& x) { return x.type == binding.descriptorType; });
+        if (it == poolSizes.end())
+        {
+            poolSizes.push_back({binding.descriptorType, 0});
+            it = poolSizes.end() - 1;
+        }
+        it->descriptorCount += std::max(binding.descriptorCount, 1u) * numSets;
+    }
+    return poolSizes;
+}
+
+const char* GetDescriptorTypeName(VkDescriptorType type)
+{
+    switch (type)
+    {
+        case VK_DESCRIPTOR_TYPE_SAMPLER:
+            return "sampler";
+        case VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER:
+            return "combined image sampler";
+        case VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE:
+            return "sampled image";
+        case VK_DESCRIPTOR_TYPE_STORAGE_IMAGE:
+            return "storage image";
+        case VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER:
+            return "uniform texel buffer";
+        case VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER:
+            return "storage texel buffer";
+        case VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER:
+            return "uniform buffer";
+        case VK_DESCRIPTOR_TYPE_STORAGE_BUFFER:
+            return "storage buffer";
+        case VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR:
+            return "acceleration structure";
+        default:
+            return "unknown";
+    }
+}
+
+} // namespace VulkanCore
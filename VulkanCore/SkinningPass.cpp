@@ -0,0 +1,100 @@
+#include "SkinningPass.h"
+#include "ComputePipeline.h"
+#include "DescriptorAllocator.h"
+
+#include <vector>
+
+namespace VulkanCore
+{
+
+namespace
+{
+
+// Bindings of skinning.comp
+enum SkinningBinding
+{
+    SkinningBinding_BindPose = 0,
+    SkinningBinding_Influences = 1,
+    SkinningBinding_Bones = 2,
+    SkinningBinding_Vertices = 3,
+    SkinningBinding_Positions = 4,
+};
+
+VkWriteDescriptorSet makeBufferWrite(VkDescriptorSet descriptorSet, uint32_t binding,
+                                     const VkDescriptorBufferInfo* pBufferInfo)
+{
+    return {
+        .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
+        .dstSet = descriptorSet,
+        .dstBinding = binding,
+        .dstArrayElement = 0,
+        .descriptorCount = 1,
+        .descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER,
+        .pBufferInfo = pBufferInfo,
+    };
+}
+
+} // namespace
+
+SkinningPass::SkinningPass(VulkanCore* pVulkanCore) : mVulkanCore{pVulkanCore}, mPipeline{nullptr}
+{
+    mPipeline = new ComputePipeline(mVulkanCore->getDevice(), "VulkanCore/shaders/skinning.comp",
+                                    mVulkanCore->getDescriptorSetLayoutCache());
+}
+
+SkinningPass::~SkinningPass()
+{
+    destroy();
+}
+
+void SkinningPass::destroy()
+{
+    // Descriptor sets are owned by the VulkanCore allocator
+    if (mPipeline)
+    {
+        delete mPipeline;
+        mPipeline = nullptr;
+    }
+}
+
+VkDescriptorSet SkinningPass::createDescriptorSet(const BufferAndMemory& bindPose, const BufferAndMemory& influences,
+                                                  const BufferAndMemory& bones, const BufferAndMemory& vertices,
+                                                  const BufferAndMemory& positions) const
+{
+    VkDescriptorSet descriptorSet =
+        mVulkanCore->getDescriptorAllocator()->allocate(mPipeline->getDescriptorSetLayout(), mPipeline->getPoolSizes());
+
+    VkDescriptorBufferInfo bindPoseInfo = {bindPose.mBuffer, 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo influencesInfo = {influences.mBuffer, 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo bonesInfo = {bones.mBuffer, 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo verticesInfo = {vertices.mBuffer, 0, VK_WHOLE_SIZE};
+    VkDescriptorBufferInfo positionsInfo = {positions.mBuffer, 0, VK_WHOLE_SIZE};
+    std::vector<VkWriteDescriptorSet> writeDescriptorSets = {
+        makeBufferWrite(descriptorSet, SkinningBinding_BindPose, &bindPoseInfo),
+        makeBufferWrite(descriptorSet, SkinningBinding_Influences, &influencesInfo),
+        makeBufferWrite(descriptorSet, SkinningBinding_Bones, &bonesInfo),
+        makeBufferWrite(descriptorSet, SkinningBinding_Vertices, &verticesInfo),
+        makeBufferWrite(descriptorSet, SkinningBinding_Positions, &positionsInfo),
+    };
+    vkUpdateDescriptorSets(mVulkanCore->getDevice(), static_cast<uint32_t>(writeDescriptorSets.size()),
+                           writeDescriptorSets.data(), 0, nullptr);
+    return descriptorSet;
+}
+
+void SkinningPass::recordDispatches(VkCommandBuffer commandBuffer, VkDescriptorSet descriptorSet,
+                                    std::span<const GpuSkinningConstants> dispatches) const
+{
+    mPipeline->bind(commandBuffer);
+    mPipeline->bindDescriptorSet(commandBuffer, descriptorSet);
+    for (const GpuSkinningConstants& constants : dispatches)
+    {
+        if (constants.mNumVertices == 0)
+        {
+            continue;
+        }
+        mPipeline->pushConstants(commandBuffer, &constants, sizeof(constants));
+        vkCmdDispatch(commandBuffer, mPipeline->getNumGroups(constants.mNumVertices), 1, 1);
+    }
+}
+
+} // namespace VulkanCore
@@ -1,5 +1,6 @@
 #include "SkyBox.h"
 #include "Shader.h"
+#include "ShaderReflection.h"
 #include "Wrapper.h"
 
 #include <cassert>
@@ -20,8 +21,11 @@ SkyBox::SkyBox(VulkanCore* vulkanCore, std::string fileName)
 
     mCubemapTexture->loadEctCubemap(fileName);
 
-    mVertexShaderModule = CreateShaderModuleFromText(mVulkanCore->getDevice(), "VulkanCore/shaders/skybox.vert");
-    mFragmentShaderModule = CreateShaderModuleFromText(mVulkanCore->getDevice(), "VulkanCore/shaders/skybox.frag");
+    std::vector<uint32_t> vertexSpirv = CompileShaderToSpirv("VulkanCore/shaders/skybox.vert", {});
+    std::vector<uint32_t> fragmentSpirv = CompileShaderToSpirv("VulkanCore/shaders/skybox.frag", {});
+    mVertexShaderModule = CreateShaderModuleFromSpirv(mVulkanCore->getDevice(), vertexSpirv);
+    mFragmentShaderModule = CreateShaderModuleFromSpirv(mVulkanCore->getDevice(), fragmentSpirv);
+    ShaderReflection reflection = MergeReflection(ReflectSpirv(vertexSpirv), ReflectSpirv(fragmentSpirv));
 
     PipelineDesc pd;
     pd.mDevice = mVulkanCore->getDevice();
@@ -33,8 +37,9 @@ SkyBox::SkyBox(VulkanCore* vulkanCore, std::string fileName)
     pd.mDepthFormat = mVulkanCore->getDepthFormat();
     pd.mDepthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL; // important for skybox
     pd.mCullMode = VK_CULL_MODE_FRONT_BIT;            // Cull front faces since we're inside the cube
-    pd.mIsUniform = true;
-    pd.mIsCubemap = true;
+    pd.mpReflection = &reflection; // uniform + cubemap
+    pd.mpLayoutCache = mVulkanCore->getDescriptorSetLayoutCache();
+    pd.mpDescriptorAllocator = mVulkanCore->getDescriptorAllocator();
 
     mGraphicsPipeline = new GraphicsPipelineV2(pd);
     createDescriptorSets();
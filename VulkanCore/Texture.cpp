@@ -1,6 +1,8 @@
 #include "Texture.h"
 #include "stb_image.h"
 
+#include <stdexcept>
+
 namespace VulkanCore
 {
 
@@ -9,18 +11,32 @@ void Texture::LoadFromFile(const std::string& filePath)
     m_pVulkanCore->createTexture(filePath.c_str(), *this);
 }
 
-void Texture::Load(uint32_t bufferSize, void* pImageData)
+void Texture::Load(uint32_t bufferSize, const void* pImageData)
 {
     int Width = 0;
     int Height = 0;
     int BPP = 0;
 
-    void* pLoadedImageData = stbi_load_from_memory((const stbi_uc*)pImageData, bufferSize, &Width, &Height, &BPP, 0);
+    // Always RGBA, as the uploaded image, whatever the channels of the file
+    void* pLoadedImageData =
+        stbi_load_from_memory((const stbi_uc*)pImageData, bufferSize, &Width, &Height, &BPP, STBI_rgb_alpha);
+    if (!pLoadedImageData)
+    {
+        throw std::runtime_error(std::string("Failed to decode texture image: ") + stbi_failure_reason());
+    }
 
-    m_pVulkanCore->createTextureImageFromData(*this, pLoadedImageData, Width, Height, VK_FORMAT_R8G8B8A8_SRGB, false);
+    LoadPixels(pLoadedImageData, static_cast<uint32_t>(Width), static_cast<uint32_t>(Height));
     stbi_image_free(pLoadedImageData);
 }
 
+void Texture::LoadPixels(const void* pPixels, uint32_t width, uint32_t height)
+{
+    // Same format, view and sampler as LoadFromFile()
+    m_pVulkanCore->createTextureFromData(pPixels, width, height, VK_FORMAT_R8G8B8A8_UNORM, false, *this);
+    mWidth = width;
+    mHeight = height;
+}
+
 void Texture::destroy(VkDevice device)
 {
     if (mSampler != VK_NULL_HANDLE)
@@ -0,0 +1,200 @@
+#include "UploadStream.h"
+#include "Texture.h"
+#include "Wrapper.h"
+
+#include <stdexcept>
+
+namespace VulkanCore
+{
+
+UploadStream::UploadStream(VulkanCore* pVulkanCore)
+    : mVulkanCore{pVulkanCore}, mCommandBuffer{VK_NULL_HANDLE}, mFence{VK_NULL_HANDLE}, mRecording{false},
+      mInFlight{false}, mBatchSize{0}
+{
+    mVulkanCore->createCommandBuffers(&mCommandBuffer, 1);
+
+    VkFenceCreateInfo fenceCreateInfo = {
+        .sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO,
+        .pNext = nullptr,
+        .flags = 0,
+    };
+    if (vkCreateFence(mVulkanCore->getDevice(), &fenceCreateInfo, nullptr, &mFence) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to create upload fence!");
+    }
+}
+
+UploadStream::~UploadStream()
+{
+    destroy();
+}
+
+void UploadStream::destroy()
+{
+    if (mFence == VK_NULL_HANDLE)
+    {
+        return;
+    }
+
+    if (mRecording)
+    {
+        submit(); // the targets were created already, let them be filled
+    }
+    wait();
+
+    vkDestroyFence(mVulkanCore->getDevice(), mFence, nullptr);
+    mFence = VK_NULL_HANDLE;
+    mVulkanCore->freeCommandBuffers(&mCommandBuffer, 1);
+    mCommandBuffer = VK_NULL_HANDLE;
+}
+
+void UploadStream::begin()
+{
+    if (mInFlight)
+    {
+        throw std::runtime_error("UploadStream: a batch is still in flight.");
+    }
+    if (!mRecording)
+    {
+        BeginCommandBuffer(mCommandBuffer, VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT);
+        mRecording = true;
+        mBatchSize = 0;
+    }
+}
+
+VkDeviceSize UploadStream::record(PendingBufferUpload& upload)
+{
+    begin();
+
+    VkDevice device = mVulkanCore->getDevice();
+    vkUnmapMemory(device, upload.mStaging.mMemory);
+
+    // Same buffer as VulkanCore::createVertexBuffer(), read by vertex pulling
+    VkBufferUsageFlags usage = VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    *upload.mpTarget = mVulkanCore->createBuffer(upload.mSize, usage, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    VkBufferCopy copyRegion = {.srcOffset = 0, .dstOffset = 0, .size = upload.mSize};
+    vkCmdCopyBuffer(mCommandBuffer, upload.mStaging.mBuffer, upload.mpTarget->mBuffer, 1, &copyRegion);
+
+    mStagingBuffers.push_back(upload.mStaging);
+    upload.mStaging = BufferAndMemory();
+    mBatchSize += upload.mSize;
+    return upload.mSize;
+}
+
+VkDeviceSize UploadStream::record(PendingTextureUpload& upload)
+{
+    begin();
+
+    VkDevice device = mVulkanCore->getDevice();
+    vkUnmapMemory(device, upload.mStaging.mMemory);
+
+    // Same image as VulkanCore::createTexture()
+    Texture& texture = *upload.mpTarget;
+    VkImageUsageFlags usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    mVulkanCore->createImage(texture, upload.mWidth, upload.mHeight, upload.mFormat, usage,
+                             VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, false);
+    texture.mWidth = upload.mWidth;
+    texture.mHeight = upload.mHeight;
+
+    imageMemBarrier(mCommandBuffer, texture.mImage, upload.mFormat, VK_IMAGE_LAYOUT_UNDEFINED,
+                    VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1);
+    VkBufferImageCopy copyRegion = {.bufferOffset = 0,
+                                    .bufferRowLength = 0,
+                                    .bufferImageHeight = 0,
+                                    .imageSubresource =
+                                        {
+                                            .aspectMask = VK_IMAGE_ASPECT_COLOR_BIT,
+                                            .mipLevel = 0,
+                                            .baseArrayLayer = 0,
+                                            .layerCount = 1,
+                                        },
+                                    .imageOffset = {0, 0, 0},
+                                    .imageExtent = {upload.mWidth, upload.mHeight, 1}};
+    vkCmdCopyBufferToImage(mCommandBuffer, upload.mStaging.mBuffer, texture.mImage,
+                           VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &copyRegion);
+    imageMemBarrier(mCommandBuffer, texture.mImage, upload.mFormat, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+                    VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, 1);
+
+    texture.mImageView = createImageView(device, texture.mImage, upload.mFormat, VK_IMAGE_ASPECT_COLOR_BIT, false);
+    texture.mSampler =
+        createTextureSampler(device, VK_FILTER_LINEAR, VK_FILTER_LINEAR, VK_SAMPLER_ADDRESS_MODE_REPEAT);
+
+    VkDeviceSize size = static_cast<VkDeviceSize>(upload.mWidth) * upload.mHeight * 4;
+    mStagingBuffers.push_back(upload.mStaging);
+    upload.mStaging = BufferAndMemory();
+    mBatchSize += size;
+    return size;
+}
+
+void UploadStream::submit()
+{
+    if (!mRecording)
+    {
+        return;
+    }
+
+    // The buffers are read by the shaders of every later submission
+    VkMemoryBarrier barrier = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER,
+        .pNext = nullptr,
+        .srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+        .dstAccessMask = VK_ACCESS_SHADER_READ_BIT,
+    };
+    vkCmdPipelineBarrier(mCommandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, 0, 1,
+                         &barrier, 0, nullptr, 0, nullptr);
+    vkEndCommandBuffer(mCommandBuffer);
+
+    mVulkanCore->getGraphicsQueue()->submit(mCommandBuffer, mFence);
+    mRecording = false;
+    mInFlight = true;
+}
+
+bool UploadStream::isComplete()
+{
+    if (!mInFlight)
+    {
+        return !mRecording;
+    }
+
+    VkResult result = vkGetFenceStatus(mVulkanCore->getDevice(), mFence);
+    if (result == VK_NOT_READY)
+    {
+        return false;
+    }
+    if (result != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to get the upload fence status!");
+    }
+    releaseStaging();
+    return true;
+}
+
+void UploadStream::wait()
+{
+    if (!mInFlight)
+    {
+        return;
+    }
+
+    if (vkWaitForFences(mVulkanCore->getDevice(), 1, &mFence, VK_TRUE, UINT64_MAX) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to wait for the upload fence!");
+    }
+    releaseStaging();
+}
+
+void UploadStream::releaseStaging()
+{
+    VkDevice device = mVulkanCore->getDevice();
+    for (BufferAndMemory& staging : mStagingBuffers)
+    {
+        staging.Destroy(device);
+    }
+    mStagingBuffers.clear();
+
+    vkResetFences(device, 1, &mFence);
+    mInFlight = false;
+}
+
+} // namespace VulkanCore
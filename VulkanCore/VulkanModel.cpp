@@ -1,10 +1,21 @@
 #include "VulkanModel.h"
 #include "Material.h"
+#include "ParallelFor.h"
+#include "TexturePacking.h"
+#include "Wrapper.h"
+#include "stb_image.h"
+#include <algorithm>
+#include <cfloat>
+#include <chrono>
 #include <cstddef>
 #include <cstdint>
 
 #include <iostream>
+#include <limits>
+#include <numeric>
+#include <span>
 #include <stdexcept>
+#include <unordered_map>
 #include <vector>
 
 #include <glm/ext/matrix_float4x4.hpp>
@@ -12,94 +23,550 @@
 
 namespace VulkanCore
 {
-VulkanModel::VulkanModel(std::string modelPath, VulkanCore* pVulkanCore) : Model(), mVulkanCore(pVulkanCore)
+
+namespace
+{
+
+// Model buffers written straight into mapped staging buffers, the device local buffers are then copied from them
+class StagingBufferWriter : public model::MeshBufferWriter
+{
+  public:
+    enum Buffer
+    {
+        Buffer_Vertices,
+        Buffer_Indices,
+        Buffer_Positions,
+        Buffer_Count
+    };
+
+    explicit StagingBufferWriter(VulkanCore* pVulkanCore) : mVulkanCore(pVulkanCore) {}
+
+    // Staging buffers left by an exception
+    ~StagingBufferWriter() override
+    {
+        for (BufferAndMemory& staging : mStaging)
+        {
+            staging.Destroy(mVulkanCore->getDevice());
+        }
+    }
+
+    model::MeshBufferTargets map(uint64_t vertexBufferSize, uint64_t indexBufferSize,
+                                 uint64_t positionBufferSize) override
+    {
+        mSizes[Buffer_Vertices] = vertexBufferSize;
+        mSizes[Buffer_Indices] = indexBufferSize;
+        mSizes[Buffer_Positions] = positionBufferSize;
+        void* pData[Buffer_Count] = {};
+        for (uint32_t buffer = 0; buffer < Buffer_Count; buffer++)
+        {
+            if (mSizes[buffer] > 0)
+            {
+                mStaging[buffer] = mVulkanCore->createStagingBuffer(mSizes[buffer], pData[buffer]);
+            }
+        }
+        return {static_cast<uint8_t*>(pData[Buffer_Vertices]), static_cast<uint8_t*>(pData[Buffer_Indices]),
+                static_cast<uint8_t*>(pData[Buffer_Positions])};
+    }
+
+    // Once written, empty for a buffer of size 0
+    BufferAndMemory createVertexBuffer(Buffer buffer)
+    {
+        if (mSizes[buffer] == 0)
+        {
+            return {};
+        }
+        return mVulkanCore->createVertexBuffer(mStaging[buffer], mSizes[buffer]);
+    }
+
+    // Same, the copy is left to an UploadStream : the staging buffer is handed over still mapped
+    void deferVertexBuffer(Buffer buffer, BufferAndMemory& target, std::vector<PendingBufferUpload>& uploads)
+    {
+        if (mSizes[buffer] == 0)
+        {
+            return;
+        }
+        uploads.push_back({&target, mStaging[buffer], mSizes[buffer]});
+        mStaging[buffer] = BufferAndMemory();
+    }
+
+  private:
+    VulkanCore* mVulkanCore;
+    BufferAndMemory mStaging[Buffer_Count];
+    VkDeviceSize mSizes[Buffer_Count] = {};
+};
+
+// Image of a texture load, decoded by stb_image or pointing into the embedded texels
+struct DecodedImage
 {
-    initScene(modelPath);
+    model::TextureImage Image;
+    stbi_uc* pDecoded{nullptr};
+};
+
+// Texture types packed into TEX_TYPE_ORM, in its channel order
+constexpr model::TEXTURE_TYPE kOrmSources[model::kPackedChannels] = {
+    model::TEX_TYPE_AMBIENT_OCCLUSION, model::TEX_TYPE_ROUGHNESS, model::TEX_TYPE_METALNESS};
+
+} // namespace
+
+VulkanModel::VulkanModel(std::string modelPath, VulkanCore* pVulkanCore, VertexLayout vertexLayout,
+                         bool positionStream, bool deferUploads)
+    : Model(), mVulkanCore(pVulkanCore), mVertexLayout(vertexLayout), mUsePositionStream(positionStream),
+      mDeferUploads(deferUploads)
+{
+    // Textures are always decoded in parallel, see decodeTextures()
+    m_DeferTextureLoads = true;
+    if (model::IsBakedModelPath(modelPath))
+    {
+        loadBaked(modelPath);
+    }
+    else
+    {
+        initScene(modelPath);
+    }
+
+    if (!mDeferUploads)
+    {
+        // The textures are the only pending uploads, copied in a single submission
+        decodeTextures();
+        UploadStream uploadStream(mVulkanCore);
+        streamUploads(uploadStream, std::numeric_limits<VkDeviceSize>::max());
+        uploadStream.submit();
+        uploadStream.wait();
+    }
 }
 
 void VulkanModel::populateBuffer(std::vector<Vertex>& vertices)
 {
     // Populate the vertex using PVP style
-    mVertexSize = sizeof(Vertex);
+    mSubmeshLods.assign(m_Meshes.size(), 0);
+
+    // Vertices and indices go straight to the staging buffers at their final offsets
+    VkDeviceSize alignment = mVulkanCore->getPhysicalDeviceLimits().minStorageBufferOffsetAlignment;
+    StagingBufferWriter writer(mVulkanCore);
+    model::MeshBuffers buffers =
+        writeMeshBuffers(vertices, mVertexLayout == VertexLayout_Quantized, mUsePositionStream, alignment, writer);
+    mVertexSize = buffers.VertexSize;
+    mPositionSize = buffers.PositionSize;
+    mAlignedMeshes = std::move(buffers.Ranges);
+    mDequantizations = std::move(buffers.Dequantizations);
 
-    updateAlignedMeshesArray();
-    createBuffers(vertices);
+    if (mDeferUploads)
+    {
+        writer.deferVertexBuffer(StagingBufferWriter::Buffer_Vertices, mVertexBuffer, mPendingBuffers);
+        writer.deferVertexBuffer(StagingBufferWriter::Buffer_Indices, mIndexBuffer, mPendingBuffers);
+        writer.deferVertexBuffer(StagingBufferWriter::Buffer_Positions, mPositionBuffer, mPendingBuffers);
+    }
+    else
+    {
+        mVertexBuffer = writer.createVertexBuffer(StagingBufferWriter::Buffer_Vertices);
+        mIndexBuffer = writer.createVertexBuffer(StagingBufferWriter::Buffer_Indices);
+        mPositionBuffer = writer.createVertexBuffer(StagingBufferWriter::Buffer_Positions);
+    }
+    mUniformBuffers = mVulkanCore->createUniformBuffers(sizeof(glm::mat4) * m_Meshes.size());
 }
 
-void VulkanModel::updateAlignedMeshesArray()
+void VulkanModel::populateBufferSkinned(std::vector<SkinnedVertex>& vertices)
 {
-    mAlignedMeshes.resize(m_Meshes.size());
+    // The pass reads and writes whole Model::Vertex words
+    if (mVertexLayout != VertexLayout_Full)
+    {
+        std::cout << "Warning! Skinned models are uploaded with the full vertex layout." << std::endl;
+        mVertexLayout = VertexLayout_Full;
+    }
+    mSubmeshLods.assign(m_Meshes.size(), 0);
+
+    // Bind pose and influences, both in model vertex order
+    std::vector<Vertex> bindPose(vertices.size());
+    std::vector<GpuBoneInfluence> influences(vertices.size());
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        const SkinnedVertex& vertex = vertices[i];
+        bindPose[i] = {vertex.pos, vertex.texCoord, vertex.normal, vertex.tangent, vertex.bitangent};
+        std::copy(vertex.boneIds, vertex.boneIds + model::kMaxBoneInfluences, influences[i].mBoneIds);
+        std::copy(vertex.weights, vertex.weights + model::kMaxBoneInfluences, influences[i].mWeights);
+    }
+
     VkDeviceSize alignment = mVulkanCore->getPhysicalDeviceLimits().minStorageBufferOffsetAlignment;
+    model::MeshBuffers buffers = buildMeshBuffers(bindPose, false, mUsePositionStream, alignment);
+    mVertexSize = buffers.VertexSize;
+    mPositionSize = buffers.PositionSize;
+    mAlignedMeshes = std::move(buffers.Ranges);
 
-    size_t BaseVertexOffset{0};
-    size_t BaseIndexOffset{0};
+    // The vertex buffer starts as a copy of the bind pose, the skinned vertices replace it
+    createBuffers(buffers.Vertices.data(), buffers.Vertices.size(), buffers.Indices.data(), buffers.Indices.size(),
+                  buffers.Positions.data(), buffers.Positions.size());
+    uploadBuffer(mBindPoseBuffer, buffers.Vertices.data(), buffers.Vertices.size());
+    uploadBuffer(mInfluenceBuffer, influences.data(), influences.size() * sizeof(GpuBoneInfluence));
+
+    mSkinningDispatches.resize(m_Meshes.size());
     for (size_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
     {
-        // VB offset - align to storage buffer alignment
-        mAlignedMeshes[meshIndex].VertexBufferOffset = BaseVertexOffset;
-        mAlignedMeshes[meshIndex].VertexBufferRange = m_Meshes[meshIndex].NumVertices * mVertexSize;
+        const model::MeshBufferRange& range = mAlignedMeshes[meshIndex];
+        mSkinningDispatches[meshIndex] = {
+            .mNumVertices = m_Meshes[meshIndex].NumVertices,
+            .mFirstInfluence = m_Meshes[meshIndex].BaseVertex,
+            .mFirstVertexWord = static_cast<uint32_t>(range.VertexBufferOffset / sizeof(float)),
+            .mFirstPositionWord = mPositionSize > 0 ? static_cast<uint32_t>(range.PositionBufferOffset / sizeof(float))
+                                                    : kSkinningNoPositionStream,
+        };
+    }
+
+    // Bind pose until the first updatePose()
+    model::AnimationPose pose;
+    model::SampleAnimation(getSkeleton(), nullptr, 0.0f, pose);
+    mBoneBuffers = mVulkanCore->createUniformBuffers(sizeof(glm::mat4) * pose.BoneMatrices.size());
+    for (int32_t imageIndex = 0; imageIndex < static_cast<int32_t>(mBoneBuffers.size()); imageIndex++)
+    {
+        updatePose(imageIndex, pose);
+    }
+}
 
-        BaseVertexOffset += mAlignedMeshes[meshIndex].VertexBufferRange;
-        BaseVertexOffset = (BaseVertexOffset + alignment - 1) & ~(alignment - 1); // align to next boundary
+void VulkanModel::enableSkinning(SkinningPass* pSkinningPass)
+{
+    if (!isSkinned())
+    {
+        throw std::runtime_error("Skinning needs a model with bones or animations");
+    }
+    mSkinningPass = pSkinningPass;
 
-        // IB offset - align to storage buffer alignment
-        mAlignedMeshes[meshIndex].IndexBufferOffset = BaseIndexOffset;
-        mAlignedMeshes[meshIndex].IndexBufferRange = m_Meshes[meshIndex].NumIndices * sizeof(uint32_t);
+    // Without position stream the vertex buffer stands in for it, it is not written through that binding
+    const BufferAndMemory& positions = mPositionSize > 0 ? mPositionBuffer : mVertexBuffer;
+    mSkinningSets.resize(mBoneBuffers.size());
+    for (size_t imageIndex = 0; imageIndex < mBoneBuffers.size(); imageIndex++)
+    {
+        mSkinningSets[imageIndex] = mSkinningPass->createDescriptorSet(mBindPoseBuffer, mInfluenceBuffer,
+                                                                       mBoneBuffers[imageIndex], mVertexBuffer,
+                                                                       positions);
+    }
+}
 
-        BaseIndexOffset += mAlignedMeshes[meshIndex].IndexBufferRange;
-        BaseIndexOffset = (BaseIndexOffset + alignment - 1) & ~(alignment - 1); // align to next boundary
+void VulkanModel::updatePose(int currentImage, const model::AnimationPose& pose)
+{
+    if (pose.BoneMatrices.size() != getSkeleton().BoneNodes.size())
+    {
+        throw std::runtime_error("Animation pose does not match the skeleton of the model");
     }
+    mBoneBuffers[currentImage].update(mVulkanCore->getDevice(), pose.BoneMatrices.data(),
+                                      sizeof(glm::mat4) * pose.BoneMatrices.size());
 }
 
-void VulkanModel::createBuffers(std::vector<Vertex>& vertices)
+void VulkanModel::recordSkinning(VkCommandBuffer commandBuffer, uint32_t imageIndex) const
 {
-    size_t numSubMeshes = m_Meshes.size();
-    // std::cout << "Creating buffers for " << numSubMeshes << " submeshes" << std::endl;
+    if (!mSkinningPass)
+    {
+        return;
+    }
+
+    // The draws of the previous frame read the skinned buffers -> this frame's pass writes them
+    VkPipelineStageFlags drawStages = VK_PIPELINE_STAGE_ALL_GRAPHICS_BIT;
+    bufferMemBarrier(commandBuffer, mVertexBuffer.mBuffer, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+                     drawStages, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    if (mPositionSize > 0)
+    {
+        bufferMemBarrier(commandBuffer, mPositionBuffer.mBuffer, VK_ACCESS_SHADER_READ_BIT,
+                         VK_ACCESS_SHADER_WRITE_BIT, drawStages, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT);
+    }
+
+    mSkinningPass->recordDispatches(commandBuffer, mSkinningSets[imageIndex], mSkinningDispatches);
 
-    // Calculate total sizes : last buffer = offset + range
-    size_t vertexBufferSize =
-        mAlignedMeshes[numSubMeshes - 1].VertexBufferOffset + mAlignedMeshes[numSubMeshes - 1].VertexBufferRange;
+    // Skinned vertices -> vertex pulling of this frame's draws
+    bufferMemBarrier(commandBuffer, mVertexBuffer.mBuffer, VK_ACCESS_SHADER_WRITE_BIT, VK_ACCESS_SHADER_READ_BIT,
+                     VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, drawStages);
+    if (mPositionSize > 0)
+    {
+        bufferMemBarrier(commandBuffer, mPositionBuffer.mBuffer, VK_ACCESS_SHADER_WRITE_BIT,
+                         VK_ACCESS_SHADER_READ_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, drawStages);
+    }
+}
 
-    // Calculate total sizes : last buffer = offset + range
-    size_t indexBufferSize =
-        mAlignedMeshes[numSubMeshes - 1].IndexBufferOffset + mAlignedMeshes[numSubMeshes - 1].IndexBufferRange;
+void VulkanModel::loadBaked(const std::string& bakedPath)
+{
+    auto start = std::chrono::high_resolution_clock::now();
 
-    char* pAlignedVertices = (char*)malloc(vertexBufferSize);
-    char* pSrcVertices = (char*)vertices.data();
+    model::BakedModelFile file(bakedPath);
+    const model::BakedModelHeader& header = file.getHeader();
 
-    char* pAlignedIndices = (char*)malloc(indexBufferSize);
-    char* pSrcIndices = (char*)m_Indices.data();
+    if ((header.Flags & model::BakedModelFlag_GpuBuffers) == 0)
+    {
+        throw std::runtime_error("Baked model " + bakedPath + " has no GPU buffers, bake it with ModelBake");
+    }
+    bool quantized = (header.Flags & model::BakedModelFlag_Quantized) != 0;
+    if (quantized != (mVertexLayout == VertexLayout_Quantized))
+    {
+        throw std::runtime_error("Baked model " + bakedPath + " was baked with another vertex layout");
+    }
+    if (mUsePositionStream && (header.Flags & model::BakedModelFlag_PositionStream) == 0)
+    {
+        throw std::runtime_error("Baked model " + bakedPath + " has no position stream");
+    }
+    VkDeviceSize alignment = mVulkanCore->getPhysicalDeviceLimits().minStorageBufferOffsetAlignment;
+    if (header.Alignment % alignment != 0)
+    {
+        throw std::runtime_error("Baked model " + bakedPath + " ranges are not aligned for this device");
+    }
+
+    readBaked(file, bakedPath);
 
-    for (size_t meshIndex = 0; meshIndex < numSubMeshes; meshIndex++)
+    std::span<const model::MeshBufferRange> ranges =
+        file.getSection<model::MeshBufferRange>(model::BakedSection_Ranges);
+    std::span<const model::VertexDequantization> dequantizations =
+        file.getSection<model::VertexDequantization>(model::BakedSection_Dequantizations);
+    std::span<const uint8_t> vertices = file.getBytes(model::BakedSection_Vertices);
+    std::span<const uint8_t> indices = file.getBytes(model::BakedSection_Indices);
+    std::span<const uint8_t> positions = file.getBytes(model::BakedSection_Positions);
+    // Every range was checked by readBaked()
+    if (m_Meshes.empty())
     {
-        // std::cout << "Mesh " << meshIndex << ": " << m_Meshes[meshIndex].NumVertices << " verts, "
-        //           << m_Meshes[meshIndex].NumIndices << " indices" << std::endl;
+        throw std::runtime_error("Baked model " + bakedPath + " has no mesh");
+    }
 
-        // Copy vertices
-        size_t srcOffset = m_Meshes[meshIndex].BaseVertex * mVertexSize;
-        char* pSrc = pSrcVertices + srcOffset;
-        char* pDst = pAlignedVertices + mAlignedMeshes[meshIndex].VertexBufferOffset;
-        size_t copySize = mAlignedMeshes[meshIndex].VertexBufferRange;
-        memcpy(pDst, pSrc, copySize);
+    mSubmeshLods.assign(m_Meshes.size(), 0);
+    mVertexSize = header.VertexSize;
+    mPositionSize = mUsePositionStream ? header.PositionSize : 0;
+    mAlignedMeshes.assign(ranges.begin(), ranges.end());
+    mDequantizations.assign(dequantizations.begin(), dequantizations.end());
 
-        // Copy indices
-        srcOffset = m_Meshes[meshIndex].BaseIndex * sizeof(uint32_t);
-        pSrc = pSrcIndices + srcOffset;
-        pDst = pAlignedIndices + mAlignedMeshes[meshIndex].IndexBufferOffset;
-        copySize = mAlignedMeshes[meshIndex].IndexBufferRange;
-        memcpy(pDst, pSrc, copySize);
+    // Straight from the mapping to the staging buffers
+    createBuffers(vertices.data(), vertices.size(), indices.data(), indices.size(), positions.data(),
+                  positions.size());
 
-        // // Debug: Print first few indices to verify they're mesh-relative
-        // uint32_t* pIndices = (uint32_t*)(pSrcIndices + m_Meshes[meshIndex].BaseIndex * sizeof(uint32_t));
-        // std::cout << "  First 3 indices: " << pIndices[0] << ", " << pIndices[1] << ", " << pIndices[2] << std::endl;
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "Baked model " << bakedPath << " : " << m_Meshes.size() << " submeshes, "
+              << (vertices.size() + indices.size()) / 1024 << " KB of buffers loaded in "
+              << std::chrono::duration<float, std::milli>(end - start).count() << " ms" << std::endl;
+}
+
+void VulkanModel::applyDequantization(std::vector<glm::mat4>& transformations) const
+{
+    for (size_t meshIndex = 0; meshIndex < mDequantizations.size(); meshIndex++)
+    {
+        transformations[meshIndex] = transformations[meshIndex] * mDequantizations[meshIndex].toMatrix();
     }
+}
+
+glm::vec4 VulkanModel::getStreamSphere(uint32_t meshIndex, const glm::vec4& sphere) const
+{
+    return mDequantizations.empty() ? sphere : mDequantizations[meshIndex].quantizeSphere(sphere);
+}
 
-    mVertexBuffer = mVulkanCore->createVertexBuffer(pAlignedVertices, vertexBufferSize);
-    mIndexBuffer = mVulkanCore->createVertexBuffer(pAlignedIndices, indexBufferSize);
+glm::vec4 VulkanModel::getStreamPoint(uint32_t meshIndex, const glm::vec3& point) const
+{
+    return glm::vec4(mDequantizations.empty() ? point : mDequantizations[meshIndex].quantizePoint(point), 0.0f);
+}
+
+glm::vec4 VulkanModel::getDrawSphere(uint32_t meshIndex, const glm::vec4& sphere) const
+{
+    return isSkinned() ? glm::vec4(0.0f, 0.0f, 0.0f, -1.0f) : getStreamSphere(meshIndex, sphere);
+}
+
+glm::vec4 VulkanModel::getDrawCone(const glm::vec4& cone) const
+{
+    return isSkinned() ? glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) : cone;
+}
+
+void VulkanModel::createBuffers(const void* pVertices, size_t vertexBufferSize, const void* pIndices,
+                               size_t indexBufferSize, const void* pPositions, size_t positionBufferSize)
+{
+    uploadBuffer(mVertexBuffer, pVertices, vertexBufferSize);
+    uploadBuffer(mIndexBuffer, pIndices, indexBufferSize);
+    if (mPositionSize > 0)
+    {
+        uploadBuffer(mPositionBuffer, pPositions, positionBufferSize);
+    }
     mUniformBuffers = mVulkanCore->createUniformBuffers(sizeof(glm::mat4) * m_Meshes.size());
+}
+
+void VulkanModel::uploadBuffer(BufferAndMemory& target, const void* pData, VkDeviceSize size)
+{
+    if (!mDeferUploads)
+    {
+        target = mVulkanCore->createVertexBuffer(pData, size);
+        return;
+    }
 
-    free(pAlignedVertices);
-    free(pAlignedIndices);
+    void* pStaging = nullptr;
+    BufferAndMemory staging = mVulkanCore->createStagingBuffer(size, pStaging);
+    memcpy(pStaging, pData, size);
+    mPendingBuffers.push_back({&target, staging, size});
+}
+
+void VulkanModel::decodeTextures()
+{
+    // Every distinct file or embedded image is decoded once, then written to the staging buffer of its texture.
+    // The occlusion, roughness and metalness of a material are packed into a single TEX_TYPE_ORM texture instead,
+    // their own slots stay empty. The images are created by streamUploads().
+    std::vector<uint32_t> imageIndices(m_TextureLoads.size());
+    std::vector<uint32_t> decodedLoads; // first load of every image
+    // A file by its path, an embedded texture by its copy shared by all its loads. glTF metallicRoughness is listed
+    // as both metalness and roughness, it must resolve to one image for GetOrmSources().
+    std::unordered_map<std::string, uint32_t> fileImages;
+    std::unordered_map<const EmbeddedImage*, uint32_t> embeddedImages;
+    for (uint32_t loadIndex = 0; loadIndex < m_TextureLoads.size(); loadIndex++)
+    {
+        const TextureLoad& load = m_TextureLoads[loadIndex];
+        uint32_t newImage = static_cast<uint32_t>(decodedLoads.size());
+        imageIndices[loadIndex] = load.pEmbedded ? embeddedImages.emplace(load.pEmbedded.get(), newImage).first->second
+                                                 : fileImages.emplace(load.Path, newImage).first->second;
+        if (imageIndices[loadIndex] == newImage)
+        {
+            decodedLoads.push_back(loadIndex);
+        }
+    }
+
+    // Per material, the load of each ORM channel
+    std::unordered_map<int32_t, std::array<int32_t, model::kPackedChannels>> ormLoads;
+    std::vector<uint32_t> colorLoads;
+    for (uint32_t loadIndex = 0; loadIndex < m_TextureLoads.size(); loadIndex++)
+    {
+        const TextureLoad& load = m_TextureLoads[loadIndex];
+        const model::TEXTURE_TYPE* pOrmSource = std::find(std::begin(kOrmSources), std::end(kOrmSources), load.Type);
+        if (pOrmSource == std::end(kOrmSources))
+        {
+            colorLoads.push_back(loadIndex);
+            continue;
+        }
+        auto inserted = ormLoads.try_emplace(load.MaterialIndex);
+        if (inserted.second)
+        {
+            inserted.first->second.fill(-1);
+        }
+        inserted.first->second[pOrmSource - std::begin(kOrmSources)] = static_cast<int32_t>(loadIndex);
+    }
+
+    std::vector<DecodedImage> images(decodedLoads.size());
+    std::vector<PendingTextureUpload> uploads(colorLoads.size() + ormLoads.size());
+    std::vector<Texture**> targets(uploads.size());
+    auto freeImages = [&images]()
+    {
+        for (DecodedImage& image : images)
+        {
+            if (image.pDecoded)
+            {
+                stbi_image_free(image.pDecoded);
+            }
+        }
+    };
+    try
+    {
+        model::ParallelFor(
+            static_cast<uint32_t>(decodedLoads.size()),
+            [&](uint32_t imageIndex)
+            {
+                const TextureLoad& load = m_TextureLoads[decodedLoads[imageIndex]];
+                DecodedImage& image = images[imageIndex];
+                int texWidth = 0;
+                int texHeight = 0;
+                int texChannels = 4;
+                if (!load.pEmbedded)
+                {
+                    image.pDecoded = stbi_load(load.Path.c_str(), &texWidth, &texHeight, &texChannels, STBI_rgb_alpha);
+                    image.Image.pTexels = image.pDecoded;
+                }
+                else if (load.pEmbedded->Width == 0)
+                {
+                    const std::vector<uint8_t>& data = load.pEmbedded->Data;
+                    image.pDecoded = stbi_load_from_memory(data.data(), static_cast<int>(data.size()), &texWidth,
+                                                           &texHeight, &texChannels, STBI_rgb_alpha);
+                    image.Image.pTexels = image.pDecoded;
+                }
+                else
+                {
+                    image.Image.pTexels = load.pEmbedded->Data.data(); // texels already
+                    texWidth = static_cast<int>(load.pEmbedded->Width);
+                    texHeight = static_cast<int>(load.pEmbedded->Height);
+                }
+                if (!image.Image.pTexels)
+                {
+                    throw std::runtime_error("Failed to load texture image: " + load.Path);
+                }
+                image.Image.Width = static_cast<uint32_t>(texWidth);
+                image.Image.Height = static_cast<uint32_t>(texHeight);
+            });
+
+        uint32_t nextUpload = 0;
+        for (uint32_t loadIndex : colorLoads)
+        {
+            const TextureLoad& load = m_TextureLoads[loadIndex];
+            const model::TextureImage& image = images[imageIndices[loadIndex]].Image;
+            uploads[nextUpload].mWidth = image.Width;
+            uploads[nextUpload].mHeight = image.Height;
+            targets[nextUpload] = &m_Materials[load.MaterialIndex].mpTextures[load.Type];
+            nextUpload++;
+        }
+
+        std::vector<model::PackedTextureSources> ormSources;
+        for (const auto& [materialIndex, channelLoads] : ormLoads)
+        {
+            // Loads of the same image share its TextureImage
+            const model::TextureImage* pChannelImages[model::kPackedChannels] = {};
+            for (uint32_t channel = 0; channel < model::kPackedChannels; channel++)
+            {
+                if (channelLoads[channel] >= 0)
+                {
+                    pChannelImages[channel] = &images[imageIndices[channelLoads[channel]]].Image;
+                }
+            }
+            const model::PackedTextureSources& sources =
+                ormSources.emplace_back(model::GetOrmSources(pChannelImages[0], pChannelImages[1], pChannelImages[2]));
+
+            model::GetPackedTextureSize(sources, uploads[nextUpload].mWidth, uploads[nextUpload].mHeight);
+            targets[nextUpload] = &m_Materials[materialIndex].mpTextures[model::TEX_TYPE_ORM];
+            nextUpload++;
+        }
+
+        model::ParallelFor(
+            static_cast<uint32_t>(uploads.size()),
+            [&](uint32_t uploadIndex)
+            {
+                PendingTextureUpload& upload = uploads[uploadIndex];
+                VkDeviceSize imageSize = static_cast<VkDeviceSize>(upload.mWidth) * upload.mHeight * 4;
+                void* pStaging = nullptr;
+                upload.mStaging = mVulkanCore->createStagingBuffer(imageSize, pStaging);
+                if (uploadIndex < colorLoads.size())
+                {
+                    memcpy(pStaging, images[imageIndices[colorLoads[uploadIndex]]].Image.pTexels, imageSize);
+                }
+                else
+                {
+                    model::PackTextureChannels(ormSources[uploadIndex - colorLoads.size()], upload.mWidth,
+                                               upload.mHeight, static_cast<uint8_t*>(pStaging));
+                }
+            });
+    }
+    catch (...)
+    {
+        freeImages();
+        for (PendingTextureUpload& upload : uploads)
+        {
+            upload.mStaging.Destroy(mVulkanCore->getDevice());
+        }
+        throw;
+    }
+    freeImages();
+
+    for (size_t uploadIndex = 0; uploadIndex < uploads.size(); uploadIndex++)
+    {
+        *targets[uploadIndex] = new Texture(mVulkanCore);
+        uploads[uploadIndex].mpTarget = *targets[uploadIndex];
+        mPendingTextures.push_back(uploads[uploadIndex]);
+    }
+    m_TextureLoads.clear();
+}
+
+bool VulkanModel::streamUploads(UploadStream& stream, VkDeviceSize budget)
+{
+    // Model buffers first, they are needed by every draw
+    while (!mPendingBuffers.empty() && (stream.getBatchSize() == 0 || stream.getBatchSize() < budget))
+    {
+        stream.record(mPendingBuffers.back());
+        mPendingBuffers.pop_back();
+    }
+    while (!mPendingTextures.empty() && (stream.getBatchSize() == 0 || stream.getBatchSize() < budget))
+    {
+        stream.record(mPendingTextures.back());
+        mPendingTextures.pop_back();
+    }
+    return !hasPendingUploads();
 }
 
 Texture* VulkanModel::allocTexture2D()
@@ -120,20 +587,57 @@ void VulkanModel::destroyTexture(Texture* pTexture)
 
 void VulkanModel::destroy()
 {
+    // Uploads never streamed
+    for (PendingBufferUpload& upload : mPendingBuffers)
+    {
+        upload.mStaging.Destroy(mVulkanCore->getDevice());
+    }
+    mPendingBuffers.clear();
+    for (PendingTextureUpload& upload : mPendingTextures)
+    {
+        upload.mStaging.Destroy(mVulkanCore->getDevice());
+    }
+    mPendingTextures.clear();
+
     mVertexBuffer.Destroy(mVulkanCore->getDevice());
     mIndexBuffer.Destroy(mVulkanCore->getDevice());
+    if (mPositionSize > 0)
+    {
+        mPositionBuffer.Destroy(mVulkanCore->getDevice());
+    }
 
     for (auto& uniformBuffer : mUniformBuffers)
     {
         uniformBuffer.Destroy(mVulkanCore->getDevice());
     }
+    if (isSkinned())
+    {
+        // The descriptor sets are owned by the VulkanCore allocator
+        mBindPoseBuffer.Destroy(mVulkanCore->getDevice());
+        mInfluenceBuffer.Destroy(mVulkanCore->getDevice());
+        for (auto& boneBuffer : mBoneBuffers)
+        {
+            boneBuffer.Destroy(mVulkanCore->getDevice());
+        }
+    }
 
     // Destroy material textures
     destroyAllTextures();
 }
 
+void VulkanModel::enablePushConstants()
+{
+    mUsePushConstants = true;
+}
+
 void VulkanModel::createDescriptorSets(GraphicsPipelineV2* pPipeline)
 {
+    if (mUsePushConstants)
+    {
+        createMaterialDescriptorSets(pPipeline);
+        return;
+    }
+
     int32_t numSubmeshes = static_cast<int32_t>(m_Meshes.size());
     pPipeline->allocateDescriptorSets(numSubmeshes, mDescriptorSets);
     ModelDesc modelDesc;
@@ -150,9 +654,14 @@ void VulkanModel::updateModelDesc(ModelDesc& desc)
     {
         desc.mUniformBuffers[imageIndex] = mUniformBuffers[imageIndex].mBuffer;
     }
+    if (mMaxInstances > 0)
+    {
+        desc.mInstanceBuffers = desc.mUniformBuffers;
+    }
 
     desc.mRanges.resize(m_Meshes.size());
     desc.mMaterials.resize(m_Meshes.size());
+    desc.mNormalMaps.resize(m_Meshes.size());
 
     int32_t numSubmeshes = static_cast<int32_t>(m_Meshes.size());
     for (int32_t meshIndex = 0; meshIndex < numSubmeshes; meshIndex++)
@@ -163,6 +672,13 @@ void VulkanModel::updateModelDesc(ModelDesc& desc)
             Texture* pDiffuse = m_Materials[materialIndex].mpTextures[model::TEXTURE_TYPE::TEX_TYPE_BASE];
             desc.mMaterials[meshIndex].mImageView = pDiffuse->mImageView;
             desc.mMaterials[meshIndex].mSampler = pDiffuse->mSampler;
+
+            Texture* pNormal = m_Materials[materialIndex].mpTextures[model::TEXTURE_TYPE::TEX_TYPE_NORMAL];
+            if (pNormal)
+            {
+                desc.mNormalMaps[meshIndex].mImageView = pNormal->mImageView;
+                desc.mNormalMaps[meshIndex].mSampler = pNormal->mSampler;
+            }
         }
         else
         {
@@ -192,9 +708,53 @@ void VulkanModel::updateModelDesc(ModelDesc& desc)
     }
 }
 
+void VulkanModel::createMaterialDescriptorSets(GraphicsPipelineV2* pPipeline)
+{
+    if (pPipeline->hasBinding(V2_BindingUniform) || pPipeline->getPushConstantRange().size < sizeof(ModelDrawConstants))
+    {
+        throw std::runtime_error("Push constant path needs a ShaderFeature_PushConstants pipeline.");
+    }
+
+    ModelDesc submeshDesc;
+    updateModelDesc(submeshDesc);
+
+    // One set per material : whole VB and IB plus the material textures
+    size_t numMaterials = m_Materials.size();
+    ModelDesc materialDesc;
+    materialDesc.mVertexBuffer = mVertexBuffer.mBuffer;
+    materialDesc.mIndexBuffer = mIndexBuffer.mBuffer;
+    materialDesc.mUniformBuffers.resize(mVulkanCore->getSwapchainImageCount(), VK_NULL_HANDLE);
+    materialDesc.mInstanceBuffers = submeshDesc.mInstanceBuffers;
+    materialDesc.mMaterials.resize(numMaterials, {VK_NULL_HANDLE, VK_NULL_HANDLE});
+    materialDesc.mNormalMaps.resize(numMaterials, {VK_NULL_HANDLE, VK_NULL_HANDLE});
+    materialDesc.mRanges.resize(numMaterials);
+    for (SubmeshRanges& ranges : materialDesc.mRanges)
+    {
+        ranges.mVbRange = {.mOffset = 0, .mRange = VK_WHOLE_SIZE};
+        ranges.mIbRange = {.mOffset = 0, .mRange = VK_WHOLE_SIZE};
+    }
+
+    mDrawConstants.resize(m_Meshes.size());
+    for (size_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
+    {
+        // updateModelDesc has already rejected submeshes without a material
+        uint32_t materialIndex = static_cast<uint32_t>(m_Meshes[meshIndex].MaterialIndex);
+        materialDesc.mMaterials[materialIndex] = submeshDesc.mMaterials[meshIndex];
+        materialDesc.mNormalMaps[materialIndex] = submeshDesc.mNormalMaps[meshIndex];
+
+        ModelDrawConstants& draw = mDrawConstants[meshIndex];
+        draw.mWVP = glm::mat4(1.0f);
+        draw.mMaterialIndex = materialIndex;
+        draw.mVertexOffset = static_cast<uint32_t>(mAlignedMeshes[meshIndex].VertexBufferOffset / mVertexSize);
+    }
+
+    pPipeline->allocateDescriptorSets(static_cast<int32_t>(numMaterials), mDescriptorSets);
+    pPipeline->updateDescriptorSets(materialDesc, mDescriptorSets);
+}
+
 void VulkanModel::recordCommandBuffer(VkCommandBuffer commandBuffer, GraphicsPipelineV2* pPipeline, uint32_t imageIndex)
 {
-    uint32_t instanceCount{1};
+    uint32_t instanceCount = mNumInstances;
 
     uint32_t numSubmeshes = static_cast<uint32_t>(m_Meshes.size());
     for (uint32_t submeshIndex = 0; submeshIndex < numSubmeshes; submeshIndex++)
@@ -207,15 +767,564 @@ void VulkanModel::recordCommandBuffer(VkCommandBuffer commandBuffer, GraphicsPip
                                 nullptr); // pDynamicOffsets
 
         // Draw using index count with manual index buffer reading in shader
-        uint32_t indexCount = m_Meshes[submeshIndex].NumIndices;
-        uint32_t firstIndex = 0; // Always 0 since we bind with offset in descriptor
-        uint32_t firstInstance = 0;
+        const model::MeshLod& lod = getDrawLod(submeshIndex);
+        uint32_t indexCount = lod.NumIndices;
+        uint32_t firstIndex = lod.FirstIndex; // IB is bound with the submesh offset in the descriptor
+        uint32_t firstInstance = getFirstInstance();
         vkCmdDraw(commandBuffer, indexCount, instanceCount, firstIndex, firstInstance);
     }
 }
 
+void VulkanModel::recordCommandBuffer(VkCommandBuffer commandBuffer, const PipelineVariantMap& pipelines,
+                                      uint32_t imageIndex)
+{
+    if (mUsePushConstants)
+    {
+        recordCommandBufferPushConstants(commandBuffer, pipelines, imageIndex);
+        return;
+    }
+
+    uint32_t instanceCount = mNumInstances;
+
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> drawOrder = getDrawOrder(keys);
+
+    GraphicsPipelineV2* pBoundPipeline = nullptr;
+    for (uint32_t submeshIndex : drawOrder)
+    {
+        GraphicsPipelineV2* pPipeline = findPipeline(pipelines, keys[submeshIndex], submeshIndex);
+        if (pPipeline != pBoundPipeline)
+        {
+            pBoundPipeline = pPipeline;
+            pBoundPipeline->bind(commandBuffer);
+        }
+
+        vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pBoundPipeline->getPipelineLayout(),
+                                0, 1, &mDescriptorSets[imageIndex][submeshIndex], 0, nullptr);
+
+        const model::MeshLod& lod = getDrawLod(submeshIndex);
+        vkCmdDraw(commandBuffer, lod.NumIndices, instanceCount, lod.FirstIndex, getFirstInstance());
+    }
+}
+
+void VulkanModel::recordCommandBufferPushConstants(VkCommandBuffer commandBuffer, const PipelineVariantMap& pipelines,
+                                                   uint32_t imageIndex)
+{
+    if (mDrawConstants.size() != m_Meshes.size())
+    {
+        throw std::runtime_error("Model has no material descriptor sets, call createDescriptorSets first.");
+    }
+
+    // Within a permutation, submeshes sharing a material are drawn back to back
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> drawOrder = getDrawOrder(keys);
+    std::stable_sort(drawOrder.begin(), drawOrder.end(), [this, &keys](uint32_t a, uint32_t b) {
+        if (keys[a] != keys[b])
+        {
+            return keys[a] < keys[b];
+        }
+        return mDrawConstants[a].mMaterialIndex < mDrawConstants[b].mMaterialIndex;
+    });
+
+    GraphicsPipelineV2* pBoundPipeline = nullptr;
+    uint32_t boundMaterial = UINT32_MAX;
+    for (uint32_t submeshIndex : drawOrder)
+    {
+        GraphicsPipelineV2* pPipeline = findPipeline(pipelines, keys[submeshIndex], submeshIndex);
+        if (pPipeline != pBoundPipeline)
+        {
+            // Permutations share the cached set layout and push constant range, the set stays bound
+            pBoundPipeline = pPipeline;
+            pBoundPipeline->bind(commandBuffer);
+        }
+
+        const ModelDrawConstants& draw = mDrawConstants[submeshIndex];
+        if (draw.mMaterialIndex != boundMaterial)
+        {
+            boundMaterial = draw.mMaterialIndex;
+            vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                    pBoundPipeline->getPipelineLayout(), 0, 1,
+                                    &mDescriptorSets[imageIndex][boundMaterial], 0, nullptr);
+        }
+
+        vkCmdPushConstants(commandBuffer, pBoundPipeline->getPipelineLayout(),
+                           pBoundPipeline->getPushConstantRange().stageFlags, 0, sizeof(ModelDrawConstants), &draw);
+
+        // IB is bound whole : firstVertex selects the submesh LOD indices, read with gl_VertexIndex
+        const model::MeshLod& lod = getDrawLod(submeshIndex);
+        vkCmdDraw(commandBuffer, lod.NumIndices, mNumInstances, getIndexOffset(submeshIndex) + lod.FirstIndex,
+                  getFirstInstance());
+    }
+}
+
+void VulkanModel::registerBindless(BindlessRegistry* pRegistry)
+{
+    std::vector<VkBuffer> transformBuffers(mUniformBuffers.size());
+    for (size_t imageIndex = 0; imageIndex < mUniformBuffers.size(); imageIndex++)
+    {
+        transformBuffers[imageIndex] = mUniformBuffers[imageIndex].mBuffer;
+    }
+
+    uint32_t geometryIndex = pRegistry->registerGeometry(mVertexBuffer.mBuffer, mIndexBuffer.mBuffer, transformBuffers);
+
+    ModelDesc modelDesc;
+    updateModelDesc(modelDesc);
+
+    mBindlessDraws.resize(m_Meshes.size());
+    for (size_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
+    {
+        BindlessDrawConstants& draw = mBindlessDraws[meshIndex];
+        draw.mGeometryIndex = geometryIndex;
+        draw.mVertexOffset = static_cast<uint32_t>(mAlignedMeshes[meshIndex].VertexBufferOffset / sizeof(uint32_t));
+        draw.mIndexOffset = getIndexOffset(static_cast<uint32_t>(meshIndex));
+        draw.mTransformIndex = static_cast<uint32_t>(meshIndex);
+
+        const TextureInfo& baseColor = modelDesc.mMaterials[meshIndex];
+        draw.mTextureIndex = pRegistry->registerTexture(baseColor.mImageView, baseColor.mSampler);
+
+        const TextureInfo& normalMap = modelDesc.mNormalMaps[meshIndex];
+        draw.mNormalMapIndex = normalMap.mImageView != VK_NULL_HANDLE
+                                   ? pRegistry->registerTexture(normalMap.mImageView, normalMap.mSampler)
+                                   : BindlessInvalidIndex;
+    }
+
+    // The position stream is a geometry of its own sharing the index and transform buffers
+    if (mPositionSize > 0)
+    {
+        uint32_t positionGeometry =
+            pRegistry->registerGeometry(mPositionBuffer.mBuffer, mIndexBuffer.mBuffer, transformBuffers);
+        mDepthDraws = mBindlessDraws;
+        for (size_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
+        {
+            BindlessDrawConstants& draw = mDepthDraws[meshIndex];
+            draw.mGeometryIndex = positionGeometry;
+            draw.mVertexOffset =
+                static_cast<uint32_t>(mAlignedMeshes[meshIndex].PositionBufferOffset / sizeof(uint32_t));
+            draw.mTextureIndex = BindlessInvalidIndex;
+            draw.mNormalMapIndex = BindlessInvalidIndex;
+        }
+    }
+
+    std::cout << "Model registered for bindless rendering: " << m_Meshes.size() << " submeshes, "
+              << pRegistry->getNumTextures() << " textures in the registry." << std::endl;
+}
+
+void VulkanModel::recordCommandBufferBindless(VkCommandBuffer commandBuffer, const PipelineVariantMap& pipelines,
+                                              const BindlessRegistry& registry, uint32_t imageIndex)
+{
+    if (mBindlessDraws.size() != m_Meshes.size())
+    {
+        throw std::runtime_error("Model is not registered for bindless rendering.");
+    }
+
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> drawOrder = getDrawOrder(keys);
+    VkPushConstantRange pushConstantRange = BindlessRegistry::getPushConstantRange();
+
+    GraphicsPipelineV2* pBoundPipeline = nullptr;
+    for (uint32_t submeshIndex : drawOrder)
+    {
+        GraphicsPipelineV2* pPipeline = findPipeline(pipelines, keys[submeshIndex], submeshIndex);
+        if (pPipeline != pBoundPipeline)
+        {
+            // All bindless pipelines share the registry layout, the set stays bound across pipeline changes
+            if (pBoundPipeline == nullptr)
+            {
+                registry.bind(commandBuffer, pPipeline->getPipelineLayout(), imageIndex);
+            }
+            pBoundPipeline = pPipeline;
+            pBoundPipeline->bind(commandBuffer);
+        }
+
+        vkCmdPushConstants(commandBuffer, pBoundPipeline->getPipelineLayout(), pushConstantRange.stageFlags, 0,
+                           sizeof(BindlessDrawConstants), &mBindlessDraws[submeshIndex]);
+
+        // The shader adds mIndexOffset, firstVertex selects the LOD
+        const model::MeshLod& lod = getDrawLod(submeshIndex);
+        vkCmdDraw(commandBuffer, lod.NumIndices, mNumInstances, lod.FirstIndex, getFirstInstance());
+    }
+}
+
+void VulkanModel::enableGpuDriven()
+{
+    mUseGpuDriven = true;
+}
+
+void VulkanModel::recordDepthBindless(VkCommandBuffer commandBuffer, const PipelineVariantMap& pipelines,
+                                      const BindlessRegistry& registry, uint32_t imageIndex)
+{
+    if (mDepthDraws.size() != m_Meshes.size())
+    {
+        throw std::runtime_error("Model has no position stream registered for bindless rendering.");
+    }
+
+    std::vector<uint64_t> keys;
+    std::vector<uint32_t> drawOrder = getDrawOrder(keys, true /* depthOnly */);
+    VkPushConstantRange pushConstantRange = BindlessRegistry::getPushConstantRange();
+
+    GraphicsPipelineV2* pBoundPipeline = nullptr;
+    for (uint32_t submeshIndex : drawOrder)
+    {
+        GraphicsPipelineV2* pPipeline = findPipeline(pipelines, keys[submeshIndex], submeshIndex);
+        if (pPipeline != pBoundPipeline)
+        {
+            if (pBoundPipeline == nullptr)
+            {
+                registry.bind(commandBuffer, pPipeline->getPipelineLayout(), imageIndex);
+            }
+            pBoundPipeline = pPipeline;
+            pBoundPipeline->bind(commandBuffer);
+        }
+
+        vkCmdPushConstants(commandBuffer, pBoundPipeline->getPipelineLayout(), pushConstantRange.stageFlags, 0,
+                           sizeof(BindlessDrawConstants), &mDepthDraws[submeshIndex]);
+
+        const model::MeshLod& lod = getDrawLod(submeshIndex);
+        vkCmdDraw(commandBuffer, lod.NumIndices, mNumInstances, lod.FirstIndex, getFirstInstance());
+    }
+}
+
+void VulkanModel::registerIndirectDraws(IndirectDrawList* pDrawList, bool useMeshlets) const
+{
+    if (mBindlessDraws.size() != m_Meshes.size())
+    {
+        throw std::runtime_error("Model is not registered for bindless rendering.");
+    }
+
+    for (uint32_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
+    {
+        const BindlessDrawConstants& draw = mBindlessDraws[meshIndex];
+        const model::BasicMeshEntry& mesh = m_Meshes[meshIndex];
+        if (useMeshlets && mesh.NumMeshlets > 0)
+        {
+            // The triangles of a meshlet are a range of the submesh indices, see model::Meshlet
+            for (uint32_t meshletIndex = 0; meshletIndex < mesh.NumMeshlets; meshletIndex++)
+            {
+                const model::Meshlet& meshlet = m_Meshlets[mesh.FirstMeshlet + meshletIndex];
+                GpuDrawRecord record = {
+                    .mIndexCount = meshlet.TriangleCount * 3,
+                    .mBatchIndex = 0,
+                    .mGeometryIndex = draw.mGeometryIndex,
+                    .mVertexOffset = draw.mVertexOffset,
+                    .mIndexOffset = draw.mIndexOffset + meshlet.FirstIndex,
+                    .mTransformIndex = draw.mTransformIndex,
+                    .mTextureIndex = draw.mTextureIndex,
+                    .mNormalMapIndex = draw.mNormalMapIndex,
+                    .mBoundingSphere = getDrawSphere(meshIndex, meshlet.BoundingSphere),
+                    .mBoundsMin = getStreamPoint(meshIndex, meshlet.BoundsMin),
+                    .mBoundsMax = getStreamPoint(meshIndex, meshlet.BoundsMax),
+                    .mCone = getDrawCone(meshlet.Cone),
+                };
+                pDrawList->addDraw(getPermutationKey(meshIndex), record);
+            }
+            continue;
+        }
+
+        GpuDrawRecord record = {
+            .mIndexCount = mesh.NumIndices,
+            .mBatchIndex = 0,
+            .mGeometryIndex = draw.mGeometryIndex,
+            .mVertexOffset = draw.mVertexOffset,
+            .mIndexOffset = draw.mIndexOffset,
+            .mTransformIndex = draw.mTransformIndex,
+            .mTextureIndex = draw.mTextureIndex,
+            .mNormalMapIndex = draw.mNormalMapIndex,
+            .mBoundingSphere = getDrawSphere(meshIndex, mesh.BoundingSphere),
+            .mBoundsMin = getStreamPoint(meshIndex, mesh.BoundsMin),
+            .mBoundsMax = getStreamPoint(meshIndex, mesh.BoundsMax),
+            .mCone = glm::vec4(0.0f, 0.0f, 0.0f, 1.0f), // a whole submesh is never backface culled
+        };
+        pDrawList->addDraw(getPermutationKey(meshIndex), record);
+    }
+}
+
+void VulkanModel::registerMeshletDraws(MeshletDrawList* pDrawList) const
+{
+    if (mBindlessDraws.size() != m_Meshes.size())
+    {
+        throw std::runtime_error("Model is not registered for bindless rendering.");
+    }
+    if (m_Meshlets.empty())
+    {
+        throw std::runtime_error("Model has no meshlets.");
+    }
+
+    uint32_t vertexOffset = pDrawList->addVertices(m_MeshletVertices);
+    uint32_t triangleOffset = pDrawList->addTriangles(m_MeshletTriangles);
+    for (uint32_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
+    {
+        const BindlessDrawConstants& draw = mBindlessDraws[meshIndex];
+        const model::BasicMeshEntry& mesh = m_Meshes[meshIndex];
+        for (uint32_t meshletIndex = 0; meshletIndex < mesh.NumMeshlets; meshletIndex++)
+        {
+            const model::Meshlet& meshlet = m_Meshlets[mesh.FirstMeshlet + meshletIndex];
+            GpuMeshlet record = {
+                .mVertexOffset = vertexOffset + meshlet.VertexOffset,
+                .mTriangleOffset = triangleOffset + meshlet.TriangleOffset,
+                .mVertexCount = meshlet.VertexCount,
+                .mTriangleCount = meshlet.TriangleCount,
+                .mGeometryIndex = draw.mGeometryIndex,
+                .mBaseVertex = draw.mVertexOffset,
+                .mTransformIndex = draw.mTransformIndex,
+                .mTextureIndex = draw.mTextureIndex,
+                .mNormalMapIndex = draw.mNormalMapIndex,
+                .mPadding = {},
+                .mBoundingSphere = getDrawSphere(meshIndex, meshlet.BoundingSphere),
+                .mCone = getDrawCone(meshlet.Cone),
+            };
+            pDrawList->addMeshlet(getPermutationKey(meshIndex), record);
+        }
+    }
+}
+
+void VulkanModel::enableCpuCulling()
+{
+    if (mUseGpuDriven)
+    {
+        throw std::runtime_error("CPU culling is not used by the GPU-driven path.");
+    }
+    if (isSkinned())
+    {
+        // The spheres are those of the bind pose, the skinned vertices leave them
+        std::cout << "Warning! CPU culling is not supported for skinned models, every submesh is drawn." << std::endl;
+        return;
+    }
+    mUseCpuCulling = true;
+
+    // Spheres in model space : only the WVP changes per frame, the spheres of moved nodes are set again by
+    // updateTransformations()
+    mCuller.clear();
+    mVisibleSubmeshes.resize(m_Meshes.size());
+    for (uint32_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
+    {
+        mCuller.addSphere(getCullingSphere(meshIndex));
+        mVisibleSubmeshes[meshIndex] = meshIndex;
+    }
+
+    std::cout << "CPU frustum culling enabled for " << m_Meshes.size() << " submeshes, "
+              << GetCullPathName(mCuller.getPath()) << " path." << std::endl;
+}
+
+void VulkanModel::enableLods(float viewportHeight)
+{
+    if (mUseGpuDriven)
+    {
+        throw std::runtime_error("LOD selection is not supported by the GPU-driven path.");
+    }
+    mUseLods = true;
+    mLodViewportHeight = viewportHeight;
+
+    size_t numLods = 0;
+    for (const model::BasicMeshEntry& mesh : m_Meshes)
+    {
+        numLods += mesh.Lods.size();
+    }
+    std::cout << "LOD selection enabled for " << m_Meshes.size() << " submeshes, " << numLods << " LODs."
+              << std::endl;
+}
+
+float VulkanModel::getPixelsPerUnit(const glm::mat4& wvp, const glm::vec4& sphere) const
+{
+    // Row 1 of the WVP scales mesh units to clip y, row 3 to view depth (clip w of a perspective projection)
+    glm::vec4 center = wvp * glm::vec4(glm::vec3(sphere), 1.0f);
+    float unitToClipY = glm::length(glm::vec3(wvp[0][1], wvp[1][1], wvp[2][1]));
+    float unitToDepth = glm::length(glm::vec3(wvp[0][3], wvp[1][3], wvp[2][3]));
+    float depth = center.w - sphere.w * unitToDepth;
+    if (depth <= 0.0f)
+    {
+        return FLT_MAX; // camera inside the sphere : full detail
+    }
+    return unitToClipY / depth * 0.5f * mLodViewportHeight;
+}
+
+void VulkanModel::selectLod(uint32_t submeshIndex, float pixelsPerUnit)
+{
+    const std::vector<model::MeshLod>& lods = m_Meshes[submeshIndex].Lods;
+    float refineThreshold = mLodThreshold * (1.0f + kLodHysteresis);
+    float coarsenThreshold = mLodThreshold * (1.0f - kLodHysteresis);
+
+    uint32_t lod = mSubmeshLods[submeshIndex];
+    while (lod > 0 && lods[lod].Error * pixelsPerUnit > refineThreshold)
+    {
+        lod--;
+    }
+    while (lod + 1 < lods.size() && lods[lod + 1].Error * pixelsPerUnit < coarsenThreshold)
+    {
+        lod++;
+    }
+    mSubmeshLods[submeshIndex] = lod;
+}
+
+uint64_t VulkanModel::getNumDrawnTriangles(bool fullDetail) const
+{
+    std::vector<uint64_t> keys;
+    uint64_t numIndices = 0;
+    for (uint32_t submeshIndex : getDrawOrder(keys))
+    {
+        numIndices += fullDetail ? m_Meshes[submeshIndex].NumIndices : getDrawLod(submeshIndex).NumIndices;
+    }
+    return numIndices / 3 * mNumInstances;
+}
+
+std::vector<uint32_t> VulkanModel::getDrawOrder(std::vector<uint64_t>& keys, bool depthOnly) const
+{
+    uint32_t numSubmeshes = static_cast<uint32_t>(m_Meshes.size());
+    keys.resize(numSubmeshes);
+    for (uint32_t submeshIndex = 0; submeshIndex < numSubmeshes; submeshIndex++)
+    {
+        keys[submeshIndex] =
+            depthOnly ? getDepthPermutationKey(submeshIndex).hash() : getPermutationKey(submeshIndex).hash();
+    }
+
+    std::vector<uint32_t> drawOrder;
+    if (mUseCpuCulling)
+    {
+        drawOrder = mVisibleSubmeshes;
+    }
+    else
+    {
+        drawOrder.resize(numSubmeshes);
+        std::iota(drawOrder.begin(), drawOrder.end(), 0);
+    }
+    if (depthOnly)
+    {
+        std::erase_if(drawOrder, [this](uint32_t submeshIndex) { return isAlphaTested(submeshIndex); });
+    }
+    std::stable_sort(drawOrder.begin(), drawOrder.end(),
+                     [&keys](uint32_t a, uint32_t b) { return keys[a] < keys[b]; });
+    return drawOrder;
+}
+
+GraphicsPipelineV2* VulkanModel::findPipeline(const PipelineVariantMap& pipelines, uint64_t key,
+                                              uint32_t submeshIndex) const
+{
+    auto it = pipelines.find(key);
+    if (it == pipelines.end())
+    {
+        throw std::runtime_error("No pipeline for shader permutation of submesh " + std::to_string(submeshIndex));
+    }
+    return it->second;
+}
+
+ShaderPermutationKey VulkanModel::getBaseKey() const
+{
+    ShaderPermutationKey key;
+    key.mVertexLayout = mVertexLayout;
+    if (mUsePushConstants)
+    {
+        key.mFeatures |= ShaderFeature_PushConstants;
+    }
+    if (mUseGpuDriven)
+    {
+        key.mFeatures |= ShaderFeature_GpuDriven;
+    }
+    if (mMaxInstances > 0)
+    {
+        key.mFeatures |= ShaderFeature_Instanced;
+    }
+    return key;
+}
+
+ShaderPermutationKey VulkanModel::getDepthPermutationKey(uint32_t meshIndex) const
+{
+    ShaderPermutationKey key = getBaseKey();
+    key.mVertexLayout =
+        mVertexLayout == VertexLayout_Quantized ? VertexLayout_QuantizedPosition : VertexLayout_Position;
+    if (mAlignedMeshes[meshIndex].IndexSize == sizeof(uint16_t))
+    {
+        key.mFeatures |= ShaderFeature_Index16;
+    }
+    return key;
+}
+
+std::vector<ShaderPermutationKey> VulkanModel::getDepthPermutationKeys() const
+{
+    std::vector<ShaderPermutationKey> keys;
+    for (uint32_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
+    {
+        ShaderPermutationKey key = getDepthPermutationKey(meshIndex);
+        if (!isAlphaTested(meshIndex) && std::find(keys.begin(), keys.end(), key) == keys.end())
+        {
+            keys.push_back(key);
+        }
+    }
+    return keys;
+}
+
+bool VulkanModel::isAlphaTested(uint32_t meshIndex) const
+{
+    int32_t materialIndex = m_Meshes[meshIndex].MaterialIndex;
+    return materialIndex >= 0 && m_Materials[materialIndex].m_alphaTest > 0.0f;
+}
+
+ShaderPermutationKey VulkanModel::getPermutationKey(uint32_t meshIndex) const
+{
+    ShaderPermutationKey key = getBaseKey();
+    if (mAlignedMeshes[meshIndex].IndexSize == sizeof(uint16_t))
+    {
+        key.mFeatures |= ShaderFeature_Index16;
+    }
+
+    int32_t materialIndex = m_Meshes[meshIndex].MaterialIndex;
+    if (materialIndex < 0)
+    {
+        return key;
+    }
+
+    const model::CoreMaterial& material = m_Materials[materialIndex];
+    if (material.mpTextures[model::TEXTURE_TYPE::TEX_TYPE_NORMAL])
+    {
+        key.mFeatures |= ShaderFeature_NormalMap;
+    }
+    if (material.m_alphaTest > 0.0f)
+    {
+        key.mFeatures |= ShaderFeature_AlphaTest;
+    }
+
+    return key;
+}
+
+std::vector<ShaderPermutationKey> VulkanModel::getPermutationKeys() const
+{
+    std::vector<ShaderPermutationKey> keys = {getBaseKey()};
+    for (uint32_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
+    {
+        ShaderPermutationKey key = getPermutationKey(meshIndex);
+        if (std::find(keys.begin(), keys.end(), key) == keys.end())
+        {
+            keys.push_back(key);
+        }
+    }
+    return keys;
+}
+
+glm::vec4 VulkanModel::getCullingSphere(uint32_t meshIndex) const
+{
+    const model::BasicMeshEntry& mesh = m_Meshes[meshIndex];
+    const glm::mat4& transform = mesh.Transformation;
+    glm::vec3 center = glm::vec3(transform * glm::vec4(glm::vec3(mesh.BoundingSphere), 1.0f));
+    float scale = std::max({glm::length(glm::vec3(transform[0])), glm::length(glm::vec3(transform[1])),
+                            glm::length(glm::vec3(transform[2]))});
+    return glm::vec4(center, mesh.BoundingSphere.w * scale);
+}
+
+void VulkanModel::updateTransformations()
+{
+    mMovedSubmeshes.clear();
+    updateMeshTransformations(mMovedSubmeshes);
+    if (mUseCpuCulling)
+    {
+        for (uint32_t meshIndex : mMovedSubmeshes)
+        {
+            mCuller.setSphere(meshIndex, getCullingSphere(meshIndex));
+        }
+    }
+}
+
 void VulkanModel::update(int currentImage, const glm::mat4 transformation)
 {
+    updateTransformations();
+
     std::vector<glm::mat4> transformations(m_Meshes.size());
     for (size_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
     {
@@ -223,6 +1332,142 @@ void VulkanModel::update(int currentImage, const glm::mat4 transformation)
         transformations[meshIndex] = transformation * meshTransform;
     }
 
+    if (mUseCpuCulling)
+    {
+        auto cullStart = std::chrono::steady_clock::now();
+        mCuller.cull(transformation, mVisibleSubmeshes);
+        mCullTimeUs = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - cullStart).count();
+    }
+
+    if (mUseLods)
+    {
+        for (uint32_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
+        {
+            selectLod(meshIndex, getPixelsPerUnit(transformations[meshIndex], m_Meshes[meshIndex].BoundingSphere));
+        }
+    }
+    applyDequantization(transformations);
+
+    // Recorded into the command buffer as push constants, the uniform buffer is not used
+    if (mUsePushConstants && mDrawConstants.size() == m_Meshes.size())
+    {
+        for (size_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
+        {
+            mDrawConstants[meshIndex].mWVP = transformations[meshIndex];
+        }
+        return;
+    }
+
+    mUniformBuffers[currentImage].update(mVulkanCore->getDevice(), transformations.data(),
+                                         sizeof(glm::mat4) * transformations.size());
+}
+
+void VulkanModel::enableInstancing(uint32_t maxInstances)
+{
+    if (mUseGpuDriven)
+    {
+        throw std::runtime_error("Instancing is not supported by the GPU-driven path.");
+    }
+    if (maxInstances == 0)
+    {
+        throw std::runtime_error("Instancing needs at least one instance.");
+    }
+    mMaxInstances = maxInstances;
+
+    // Room for the instance transforms after the submesh ones, the buffers are not registered anywhere yet
+    for (BufferAndMemory& uniformBuffer : mUniformBuffers)
+    {
+        uniformBuffer.Destroy(mVulkanCore->getDevice());
+    }
+    mUniformBuffers = mVulkanCore->createUniformBuffers(sizeof(glm::mat4) * (m_Meshes.size() + mMaxInstances));
+}
+
+void VulkanModel::updateInstances(int currentImage, const glm::mat4& viewProj,
+                                  const std::vector<glm::mat4>& instanceTransforms)
+{
+    if (mMaxInstances == 0)
+    {
+        throw std::runtime_error("Instancing is not enabled, call enableInstancing first.");
+    }
+    if (instanceTransforms.size() > mMaxInstances)
+    {
+        throw std::runtime_error("Too many instances: " + std::to_string(instanceTransforms.size()) + ", max " +
+                                 std::to_string(mMaxInstances));
+    }
+    updateTransformations();
+
+    uint32_t numSubmeshes = static_cast<uint32_t>(m_Meshes.size());
+    std::vector<glm::mat4> transformations;
+    transformations.reserve(numSubmeshes + instanceTransforms.size());
+    for (uint32_t meshIndex = 0; meshIndex < numSubmeshes; meshIndex++)
+    {
+        transformations.push_back(m_Meshes[meshIndex].Transformation);
+    }
+
+    // A submesh is drawn when any instance of it is visible, instances with nothing visible are dropped
+    auto cullStart = std::chrono::steady_clock::now();
+    std::vector<bool> submeshVisible(numSubmeshes, !mUseCpuCulling);
+    std::vector<float> pixelsPerUnit(numSubmeshes, 0.0f); // of the nearest instance
+    std::vector<uint32_t> visible;
+    for (const glm::mat4& instanceTransform : instanceTransforms)
+    {
+        glm::mat4 instanceViewProj = viewProj * instanceTransform;
+        if (mUseCpuCulling)
+        {
+            mCuller.cull(instanceViewProj, visible);
+            if (visible.empty())
+            {
+                continue;
+            }
+            for (uint32_t submeshIndex : visible)
+            {
+                submeshVisible[submeshIndex] = true;
+            }
+        }
+        if (mUseLods)
+        {
+            for (uint32_t meshIndex = 0; meshIndex < numSubmeshes; meshIndex++)
+            {
+                const model::BasicMeshEntry& mesh = m_Meshes[meshIndex];
+                float pixels = getPixelsPerUnit(instanceViewProj * mesh.Transformation, mesh.BoundingSphere);
+                pixelsPerUnit[meshIndex] = std::max(pixelsPerUnit[meshIndex], pixels);
+            }
+        }
+        transformations.push_back(instanceViewProj);
+    }
+    mNumInstances = static_cast<uint32_t>(transformations.size()) - numSubmeshes;
+
+    if (mUseCpuCulling)
+    {
+        mVisibleSubmeshes.clear();
+        for (uint32_t submeshIndex = 0; submeshIndex < numSubmeshes && mNumInstances > 0; submeshIndex++)
+        {
+            if (submeshVisible[submeshIndex])
+            {
+                mVisibleSubmeshes.push_back(submeshIndex);
+            }
+        }
+        mCullTimeUs = std::chrono::duration<float, std::micro>(std::chrono::steady_clock::now() - cullStart).count();
+    }
+
+    if (mUseLods)
+    {
+        for (uint32_t meshIndex = 0; meshIndex < numSubmeshes; meshIndex++)
+        {
+            selectLod(meshIndex, pixelsPerUnit[meshIndex]);
+        }
+    }
+    applyDequantization(transformations);
+
+    // Push constant path : the submesh transformation is pushed, the instances are still read from the buffer
+    if (mUsePushConstants && mDrawConstants.size() == numSubmeshes)
+    {
+        for (uint32_t meshIndex = 0; meshIndex < numSubmeshes; meshIndex++)
+        {
+            mDrawConstants[meshIndex].mWVP = transformations[meshIndex];
+        }
+    }
+
     mUniformBuffers[currentImage].update(mVulkanCore->getDevice(), transformations.data(),
                                          sizeof(glm::mat4) * transformations.size());
 }
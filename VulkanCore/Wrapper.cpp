@@ -214,6 +214,22 @@ void imageMemBarrier(VkCommandBuffer CmdBuf, VkImage Image, VkFormat Format, VkI
     vkCmdPipelineBarrier(CmdBuf, sourceStage, destinationStage, 0, 0, NULL, 0, NULL, 1, &barrier);
 }
 
+void bufferMemBarrier(VkCommandBuffer CmdBuf, VkBuffer Buffer, VkAccessFlags SrcAccess, VkAccessFlags DstAccess,
+                      VkPipelineStageFlags SrcStage, VkPipelineStageFlags DstStage)
+{
+    VkBufferMemoryBarrier barrier = {.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
+                                     .pNext = NULL,
+                                     .srcAccessMask = SrcAccess,
+                                     .dstAccessMask = DstAccess,
+                                     .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                     .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+                                     .buffer = Buffer,
+                                     .offset = 0,
+                                     .size = VK_WHOLE_SIZE};
+
+    vkCmdPipelineBarrier(CmdBuf, SrcStage, DstStage, 0, 0, NULL, 1, &barrier, 0, NULL);
+}
+
 VkImageView createImageView(VkDevice Device, VkImage Image, VkFormat Format, VkImageAspectFlags AspectFlags,
                             bool isCubemap)
 {
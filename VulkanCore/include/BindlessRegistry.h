@@ -0,0 +1,103 @@
+#ifndef BINDLESS_REGISTRY_H
+#define BINDLESS_REGISTRY_H
+
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+namespace VulkanCore
+{
+
+class VulkanCore;
+struct ShaderReflection;
+
+// Bindings of the bindless descriptor set (set 0), must match VulkanDemo/shaders/bindless.*
+enum BindlessBinding
+{
+    BindlessBinding_VertexBuffers = 0, // buffer[] : one whole vertex buffer per geometry
+    BindlessBinding_IndexBuffers = 1,  // buffer[] : one whole index buffer per geometry
+    BindlessBinding_Transforms = 2,    // buffer[] : mat4 per draw, per geometry, per swapchain image
+    BindlessBinding_Textures = 3,      // sampler2D[] : variable count, partially bound
+    BindlessBinding_Count = 4
+};
+
+constexpr uint32_t BindlessInvalidIndex = UINT32_MAX;
+
+// Per-draw push constants of the bindless pipelines
+struct BindlessDrawConstants
+{
+    uint32_t mGeometryIndex;  // slot in the vertex / index / transform buffer arrays
+    uint32_t mVertexOffset;   // first vertex of the submesh, in 32-bit words
+    uint32_t mIndexOffset;    // first index of the submesh, in indices of its size (see ShaderFeature_Index16)
+    uint32_t mTransformIndex; // mat4 in the geometry transform buffer
+    uint32_t mTextureIndex;   // base color in the texture array
+    uint32_t mNormalMapIndex; // BindlessInvalidIndex when the material has no normal map
+};
+
+// One descriptor set per swapchain image holding every geometry buffer and texture of the scene.
+// Descriptor memory is O(textures + geometries) instead of O(submeshes x images), the set is bound once
+// per command buffer and each draw only pushes its BindlessDrawConstants.
+// Requires VulkanCore::isBindlessSupported().
+class BindlessRegistry
+{
+  public:
+    BindlessRegistry(VulkanCore* pVulkanCore, uint32_t maxTextures = 4096, uint32_t maxGeometries = 64);
+    ~BindlessRegistry();
+
+    void destroy();
+
+    // Returns the slot of the texture, the same image view always gets the same slot
+    uint32_t registerTexture(VkImageView imageView, VkSampler sampler);
+
+    // transformBuffers holds one buffer per swapchain image
+    uint32_t registerGeometry(VkBuffer vertexBuffer, VkBuffer indexBuffer,
+                              const std::vector<VkBuffer>& transformBuffers);
+
+    void bind(VkCommandBuffer commandBuffer, VkPipelineLayout pipelineLayout, uint32_t imageIndex,
+              VkPipelineBindPoint bindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS) const;
+
+    // Throws when a shader does not match the bindless set.
+    // With hasDrawSet, set 1 belongs to IndirectDrawList (or to a ComputePipeline) and is validated there.
+    void validateInterface(const ShaderReflection& reflection, bool hasDrawSet = false) const;
+
+    VkDescriptorSetLayout getDescriptorSetLayout() const
+    {
+        return mDescriptorSetLayout;
+    }
+    static VkPushConstantRange getPushConstantRange()
+    {
+        return {VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(BindlessDrawConstants)};
+    }
+    uint32_t getNumTextures() const
+    {
+        return mNumTextures;
+    }
+    uint32_t getNumGeometries() const
+    {
+        return mNumGeometries;
+    }
+
+  private:
+    void createDescriptorSetLayout();
+    void createDescriptorSets();
+    void writeBuffer(uint32_t imageIndex, BindlessBinding binding, uint32_t arrayElement, VkBuffer buffer);
+
+    VulkanCore* mVulkanCore;
+    VkDevice mDevice;
+    int32_t mNumImages;
+
+    uint32_t mMaxTextures;
+    uint32_t mMaxGeometries;
+    uint32_t mNumTextures;
+    uint32_t mNumGeometries;
+    std::unordered_map<VkImageView, uint32_t> mTextureSlots;
+
+    VkDescriptorSetLayout mDescriptorSetLayout;
+    VkDescriptorPool mDescriptorPool;
+    std::vector<VkDescriptorSet> mDescriptorSets; // one per swapchain image
+};
+
+} // namespace VulkanCore
+
+#endif // BINDLESS_REGISTRY_H
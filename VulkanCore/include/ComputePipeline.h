@@ -0,0 +1,80 @@
+#ifndef COMPUTE_PIPELINE_H
+#define COMPUTE_PIPELINE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+#include "ShaderReflection.h"
+
+namespace VulkanCore
+{
+
+class DescriptorSetLayoutCache;
+
+// Compute pipeline built from a GLSL compute shader.
+// The descriptor set layout (set 0) and push constant range are reflected from the SPIR-V,
+// the layout comes from the DescriptorSetLayoutCache so it is never owned by the pipeline.
+// With a shared set layout (e.g. the BindlessRegistry set) the shared set is set 0 and the reflected one set 1,
+// the shader bindings of set 0 are then validated by the owner of the shared set.
+// The workgroup size is chosen here : shaders declare layout(local_size_x_id = 0) in;
+class ComputePipeline
+{
+  public:
+    ComputePipeline(VkDevice device, const std::string& shaderPath, DescriptorSetLayoutCache* pLayoutCache,
+                    uint32_t localSizeX = 64, const std::vector<std::string>& defines = {},
+                    VkDescriptorSetLayout sharedSetLayout = VK_NULL_HANDLE);
+    ~ComputePipeline();
+
+    void destroy();
+
+    void bind(VkCommandBuffer commandBuffer) const;
+    // Binds the reflected set : set 0, or set 1 with a shared set layout
+    void bindDescriptorSet(VkCommandBuffer commandBuffer, VkDescriptorSet descriptorSet) const;
+    void pushConstants(VkCommandBuffer commandBuffer, const void* pData, uint32_t size) const;
+
+    // Enough workgroups of getLocalSizeX() invocations to cover numItems
+    uint32_t getNumGroups(uint32_t numItems) const
+    {
+        return (numItems + mLocalSizeX - 1) / mLocalSizeX;
+    }
+    uint32_t getLocalSizeX() const
+    {
+        return mLocalSizeX;
+    }
+
+    VkPipelineLayout getPipelineLayout() const
+    {
+        return mPipelineLayout;
+    }
+    VkDescriptorSetLayout getDescriptorSetLayout() const
+    {
+        return mDescriptorSetLayout;
+    }
+    // Descriptors of a single set, see DescriptorAllocator::allocate
+    const std::vector<VkDescriptorPoolSize>& getPoolSizes() const
+    {
+        return mPoolSizes;
+    }
+    const ShaderReflection& getReflection() const
+    {
+        return mReflection;
+    }
+
+  private:
+    VkDevice mDevice;
+    VkShaderModule mShaderModule;
+    VkPipelineLayout mPipelineLayout;
+    VkPipeline mPipeline;
+    VkDescriptorSetLayout mDescriptorSetLayout;
+
+    ShaderReflection mReflection;
+    std::vector<VkDescriptorPoolSize> mPoolSizes;
+    uint32_t mLocalSizeX;
+    uint32_t mSetIndex; // of the reflected set
+};
+
+} // namespace VulkanCore
+
+#endif // COMPUTE_PIPELINE_H
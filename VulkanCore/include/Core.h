@@ -20,6 +20,8 @@ namespace VulkanCore
 
 // Forward declaration
 class Texture;
+class DescriptorAllocator;
+class DescriptorSetLayoutCache;
 
 class BufferAndMemory
 {
@@ -32,6 +34,8 @@ class BufferAndMemory
 
     void Destroy(VkDevice device);
     void update(VkDevice device, const void* pData, VkDeviceSize size);
+    // Host visible buffers only, e.g. statistics written by a compute shader
+    void read(VkDevice device, void* pData, VkDeviceSize size) const;
 };
 
 class VulkanCore
@@ -40,8 +44,9 @@ class VulkanCore
     VulkanCore();
     ~VulkanCore();
 
-    // Friend class to allow Texture to access private methods
+    // Friend classes to allow Texture and UploadStream to access private methods
     friend class Texture;
+    friend class UploadStream;
 
     void initialize(std::string appName, GLFWwindow* window, bool depthEnabled);
     int32_t getSwapchainImageCount() const;
@@ -57,13 +62,55 @@ class VulkanCore
     {
         return mLogicalDevice;
     }
+    DescriptorSetLayoutCache* getDescriptorSetLayoutCache() const
+    {
+        return mDescriptorSetLayoutCache;
+    }
+    // Persistent descriptor sets, freed when VulkanCore is destroyed
+    DescriptorAllocator* getDescriptorAllocator() const
+    {
+        return mDescriptorAllocator;
+    }
+    // Transient descriptor sets of one swapchain image, reset with resetFrameDescriptors()
+    DescriptorAllocator* getFrameDescriptorAllocator(uint32_t imageIndex) const
+    {
+        return mFrameDescriptorAllocators[imageIndex];
+    }
+    // Call once the previous submission of the image has completed (after VulkanQueue::acquireNextImage)
+    void resetFrameDescriptors(uint32_t imageIndex);
+
+    // Descriptor indexing features required by BindlessRegistry are enabled
+    bool isBindlessSupported() const
+    {
+        return mBindlessSupported;
+    }
+    // Bindless plus the draw parameters / draw indirect count features required by IndirectDrawList
+    bool isGpuDrivenSupported() const
+    {
+        return mGpuDrivenSupported;
+    }
+    // GPU-driven plus the task and mesh shader stages of VK_EXT_mesh_shader required by MeshletDrawList
+    bool isMeshShaderSupported() const
+    {
+        return mMeshShaderSupported;
+    }
 
     VkRenderPass createSimpleRenderPass();
     std::vector<VkFramebuffer> createFrameBuffer(VkRenderPass renderPass);
     void destroyFramebuffers(std::vector<VkFramebuffer>& framebuffers);
 
     BufferAndMemory createVertexBuffer(const void* pVertices, size_t size);
+    // Same in two steps, for data written in place : a host visible staging buffer mapped at pData, then the
+    // vertex buffer copied from it. The staging buffer is unmapped and destroyed by the second call.
+    BufferAndMemory createStagingBuffer(VkDeviceSize size, void*& pData);
+    BufferAndMemory createVertexBuffer(BufferAndMemory& stagingBuffer, VkDeviceSize size);
+    // Device local storage buffer written by the GPU, e.g. with VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT
+    BufferAndMemory createStorageBuffer(VkDeviceSize size, VkBufferUsageFlags additionalUsage = 0);
     std::vector<BufferAndMemory> createUniformBuffers(size_t size);
+    // Device local image with mipLevels levels for compute shaders, every level is cleared to clearValue and
+    // left in VK_IMAGE_LAYOUT_GENERAL. Image views are created by the caller.
+    void createStorageImage(Texture& outTexture, uint32_t width, uint32_t height, VkFormat format, uint32_t mipLevels,
+                            const VkClearColorValue& clearValue);
 
     void createTexture(std::string filePath, Texture& outTexture);
     VkFormat getDepthFormat() const
@@ -82,6 +129,12 @@ class VulkanCore
 
     VkImageView getSwapchainImageView(uint32_t index) const;
     VkImageView getDepthImageView(uint32_t index) const;
+    // Depth images stay in VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL and can be sampled, see HiZPyramid
+    VkImage getDepthImage(uint32_t index) const;
+    VkExtent2D getSwapchainExtent() const
+    {
+        return mPhysicalDevice.getSelectedPhysicalDeviceProperties().mSurfaceCaps.currentExtent;
+    }
 
     VkInstance getVulkanInstance() const
     {
@@ -101,6 +154,11 @@ class VulkanCore
     void beginDynamicRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex, VkClearValue* clearColor,
                                VkClearValue* clearDepth);
 
+    // Depth prepass : depth attachment only, stored for the next rendering scope, which passes no clearDepth so
+    // it loads it. endDepthOnlyRendering() makes the depth writes visible to its depth test.
+    void beginDepthOnlyRendering(VkCommandBuffer commandBuffer, uint32_t imageIndex, VkClearValue* clearDepth);
+    void endDepthOnlyRendering(VkCommandBuffer commandBuffer);
+
     GLFWwindow* getWindow() const
     {
         return mWindow;
@@ -118,6 +176,7 @@ class VulkanCore
     void createLogicalDevice();
     void createSwapChain();
     void createCommandBufferPool();
+    void createDescriptorAllocators();
     BufferAndMemory createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties);
     uint32_t getMemoryTypeIndex(uint32_t typeFilter, VkMemoryPropertyFlags properties);
     void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
@@ -128,7 +187,7 @@ class VulkanCore
     void createTextureFromData(const void* pixels, uint32_t width, uint32_t height, VkFormat format, bool isCubemap,
                                Texture& outTexture);
     void createImage(Texture& outTexture, uint32_t width, uint32_t height, VkFormat format, VkImageUsageFlags usage,
-                     VkMemoryPropertyFlags memPropertiesj, bool isCubemap);
+                     VkMemoryPropertyFlags memPropertiesj, bool isCubemap, uint32_t mipLevels = 1);
     void updateTextureImage(Texture& outTexture, uint32_t width, uint32_t height, VkFormat format, int32_t layerCount,
                             const void* pixels, bool isCubemap);
 
@@ -152,6 +211,14 @@ class VulkanCore
 
     VkDevice mLogicalDevice;
 
+    // Descriptor set layouts shared by all pipelines created on mLogicalDevice
+    DescriptorSetLayoutCache* mDescriptorSetLayoutCache;
+    DescriptorAllocator* mDescriptorAllocator;
+    std::vector<DescriptorAllocator*> mFrameDescriptorAllocators; // one per swapchain image
+    bool mBindlessSupported;
+    bool mGpuDrivenSupported;
+    bool mMeshShaderSupported;
+
     // Swapchain handle which maintain the series of images for presentation,
     // format etc.,
     VkSurfaceFormatKHR mSwapchainSurfaceFormat;
@@ -0,0 +1,88 @@
+#ifndef DESCRIPTOR_ALLOCATOR_H
+#define DESCRIPTOR_ALLOCATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+namespace VulkanCore
+{
+
+// Descriptors of one type reserved per set when a pool is created
+struct DescriptorPoolRatio
+{
+    VkDescriptorType mType;
+    float mRatio;
+};
+
+struct DescriptorTypeUsage
+{
+    VkDescriptorType mType;
+    uint32_t mCapacity;
+    uint32_t mUsed;
+};
+
+struct DescriptorAllocatorStats
+{
+    uint32_t mNumPools{0};
+    uint32_t mNumFullPools{0};
+    uint32_t mSetCapacity{0};
+    uint32_t mSetsAllocated{0};
+    std::vector<DescriptorTypeUsage> mTypes;
+};
+
+// Growable descriptor set allocator.
+// Sets are allocated from a chain of pools: when the current pool runs out it is moved to the full list
+// and a bigger one is created, so callers never size pools themselves. Sets are not freed individually;
+// reset() recycles every pool at once, which makes one allocator per swapchain image a cheap transient
+// allocator for per-frame sets.
+class DescriptorAllocator
+{
+  public:
+    DescriptorAllocator(VkDevice device, std::string name, uint32_t setsPerPool,
+                        std::vector<DescriptorPoolRatio> ratios, VkDescriptorPoolCreateFlags flags = 0);
+    ~DescriptorAllocator();
+
+    void destroy();
+
+    // setSizes are the descriptors of a single set (see GetPoolSizes), used to size new pools and for the stats
+    void allocate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorPoolSize>& setSizes, uint32_t count,
+                  VkDescriptorSet* pDescriptorSets, const void* pNext = nullptr);
+
+    VkDescriptorSet allocate(VkDescriptorSetLayout layout, const std::vector<VkDescriptorPoolSize>& setSizes,
+                             const void* pNext = nullptr);
+
+    // All sets allocated so far become invalid, the GPU must be done with them
+    void reset();
+
+    DescriptorAllocatorStats getStats() const;
+    void printStats() const;
+
+  private:
+    struct Pool
+    {
+        VkDescriptorPool mPool{VK_NULL_HANDLE};
+        uint32_t mMaxSets{0};
+        uint32_t mSetsAllocated{0};
+        std::vector<VkDescriptorPoolSize> mCapacity;
+        std::vector<VkDescriptorPoolSize> mUsed;
+    };
+
+    Pool createPool(uint32_t minSets, const std::vector<VkDescriptorPoolSize>& minSizes);
+    bool tryAllocate(Pool& pool, VkDescriptorSetLayout layout, const std::vector<VkDescriptorPoolSize>& setSizes,
+                     uint32_t count, VkDescriptorSet* pDescriptorSets, const void* pNext);
+
+    VkDevice mDevice;
+    std::string mName;
+    uint32_t mSetsPerPool;
+    std::vector<DescriptorPoolRatio> mRatios;
+    VkDescriptorPoolCreateFlags mFlags;
+
+    std::vector<Pool> mReadyPools; // back() is the current pool
+    std::vector<Pool> mFullPools;
+};
+
+} // namespace VulkanCore
+
+#endif // DESCRIPTOR_ALLOCATOR_H
@@ -0,0 +1,56 @@
+#ifndef DESCRIPTOR_SET_LAYOUT_CACHE_H
+#define DESCRIPTOR_SET_LAYOUT_CACHE_H
+
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+namespace VulkanCore
+{
+
+// Deduplicates descriptor set layouts across pipelines.
+// Two requests with the same bindings (binding, type, count, stages) return the same VkDescriptorSetLayout,
+// so pipelines built from the same shader interface are layout compatible and can share descriptor sets.
+// The cache owns the layouts; pipelines must not destroy them.
+class DescriptorSetLayoutCache
+{
+  public:
+    DescriptorSetLayoutCache(VkDevice device);
+    ~DescriptorSetLayoutCache();
+
+    void destroy();
+
+    // Bindings may be in any order. bindingFlags is either empty or parallel to bindings
+    // (VkDescriptorSetLayoutBindingFlagsCreateInfo, e.g. for partially bound arrays).
+    VkDescriptorSetLayout getLayout(const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+                                    VkDescriptorSetLayoutCreateFlags flags = 0,
+                                    const std::vector<VkDescriptorBindingFlags>& bindingFlags = {});
+
+    size_t getNumLayouts() const
+    {
+        return mLayouts.size();
+    }
+
+  private:
+    struct LayoutKey
+    {
+        VkDescriptorSetLayoutCreateFlags mFlags;
+        std::vector<VkDescriptorSetLayoutBinding> mBindings; // sorted by binding
+        std::vector<VkDescriptorBindingFlags> mBindingFlags; // empty or parallel to mBindings
+
+        bool operator==(const LayoutKey& other) const;
+    };
+
+    struct LayoutKeyHash
+    {
+        size_t operator()(const LayoutKey& key) const;
+    };
+
+    VkDevice mDevice;
+    std::unordered_map<LayoutKey, VkDescriptorSetLayout, LayoutKeyHash> mLayouts;
+};
+
+} // namespace VulkanCore
+
+#endif // DESCRIPTOR_SET_LAYOUT_CACHE_H
@@ -0,0 +1,84 @@
+#ifndef FRUSTUM_CULLER_H
+#define FRUSTUM_CULLER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace VulkanCore
+{
+
+// Implementations of FrustumCuller::cull, every path gives the same result
+enum CullPath : uint32_t
+{
+    CullPath_None = 0, // culling off, everything is visible
+    CullPath_Scalar,
+    CullPath_SSE,  // 4 spheres per instruction
+    CullPath_AVX2, // 8 spheres per instruction, checked at runtime
+    CullPath_Count
+};
+
+const char* GetCullPathName(CullPath path);
+
+// Normalized clip planes of a view projection, one array per component so a plane is broadcast in one load
+struct FrustumPlanes
+{
+    float mNormalX[6];
+    float mNormalY[6];
+    float mNormalZ[6];
+    float mDistance[6];
+};
+
+// CPU frustum culling of bounding spheres, an alternative to the IndirectDrawList cull pass for CPU
+// submission. Spheres are stored as structure of arrays and tested 4 or 8 at a time against the planes of
+// Vulkan's clip volume (-w <= x, y <= w and 0 <= z <= w). The planes are in the space of the matrix input,
+// so spheres in model space are culled with the WVP without transforming them every frame.
+class FrustumCuller
+{
+  public:
+    FrustumCuller();
+
+    // Returns the index of the sphere, xyz : center, w : radius
+    uint32_t addSphere(const glm::vec4& sphere);
+    void setSphere(uint32_t index, const glm::vec4& sphere);
+    void clear();
+
+    // Fills visible with the indices of the spheres intersecting the frustum, in increasing order
+    void cull(const glm::mat4& viewProj, std::vector<uint32_t>& visible) const;
+    void cull(const glm::mat4& viewProj, CullPath path, std::vector<uint32_t>& visible) const;
+
+    static FrustumPlanes extractPlanes(const glm::mat4& viewProj);
+
+    // Fastest path of the running CPU
+    static CullPath getBestPath();
+    static bool isPathSupported(CullPath path);
+
+    void setPath(CullPath path);
+    CullPath getPath() const
+    {
+        return mPath;
+    }
+    uint32_t getNumSpheres() const
+    {
+        return mNumSpheres;
+    }
+
+  private:
+    void cullScalar(const FrustumPlanes& planes, std::vector<uint32_t>& visible) const;
+    void cullSSE(const FrustumPlanes& planes, std::vector<uint32_t>& visible) const;
+    void cullAVX2(const FrustumPlanes& planes, std::vector<uint32_t>& visible) const;
+
+    CullPath mPath;
+    uint32_t mNumSpheres;
+
+    // Padded to a multiple of 8 so the SIMD paths never read past the end
+    std::vector<float> mCenterX;
+    std::vector<float> mCenterY;
+    std::vector<float> mCenterZ;
+    std::vector<float> mRadius;
+};
+
+} // namespace VulkanCore
+
+#endif // FRUSTUM_CULLER_H
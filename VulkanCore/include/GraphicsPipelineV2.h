@@ -2,6 +2,7 @@
 #define GRAPHICS_PIPELINE_V2_H
 
 #include <GLFW/glfw3.h>
+#include <cstdint>
 #include <vector>
 
 #include <vulkan/vulkan_core.h>
@@ -11,6 +12,10 @@
 namespace VulkanCore
 {
 
+class DescriptorAllocator;
+class DescriptorSetLayoutCache;
+struct ShaderReflection;
+
 enum V2_Binding
 {
     V2_BindingVB = 0,
@@ -18,7 +23,9 @@ enum V2_Binding
     V2_BindingUniform = 2,
     V2_BindingTexture2D = 3,
     V2_BindingTextureCube = 4,
-    V2_Binding_Count = 5
+    V2_BindingNormalMap = 5,
+    V2_BindingInstances = 6, // whole transform buffer of the image, see VulkanModel::enableInstancing
+    V2_Binding_Count = 7
 };
 
 struct PipelineDesc
@@ -28,7 +35,7 @@ struct PipelineDesc
     VkShaderModule mVertexShaderModule = VK_NULL_HANDLE;
     VkShaderModule mFragmentShaderModule = VK_NULL_HANDLE;
     int32_t mNumSwapchainImages = 0;
-    VkFormat mColorFormat = VK_FORMAT_UNDEFINED;
+    VkFormat mColorFormat = VK_FORMAT_UNDEFINED; // UNDEFINED : depth only, mFragmentShaderModule may then be null
     VkFormat mDepthFormat = VK_FORMAT_UNDEFINED;
     VkCompareOp mDepthCompareOp = VK_COMPARE_OP_LESS;
     VkCullModeFlags mCullMode = VK_CULL_MODE_BACK_BIT;
@@ -37,6 +44,28 @@ struct PipelineDesc
     bool mIsUniform = false;
     bool mIsTex2D = false;
     bool mIsCubemap = false;
+    bool mIsNormalMap = false;
+    // Mesh shader pipeline, see MeshletDrawList : the mesh stage replaces the vertex stage, so there is no vertex
+    // input or input assembly state. The task stage is optional.
+    VkShaderModule mTaskShaderModule = VK_NULL_HANDLE;
+    VkShaderModule mMeshShaderModule = VK_NULL_HANDLE;
+    // Applied to every stage, see ShaderPermutationCache
+    const VkSpecializationInfo* mpSpecializationInfo = nullptr;
+    // When set, the descriptor set layout, pool sizes and push constant range are derived from the reflected
+    // shader interface and the mIsXXX flags are ignored. The interface is validated against V2_Binding.
+    // Pipelines sharing descriptor sets (e.g. shader permutations) should pass the merged interface of all of them.
+    const ShaderReflection* mpReflection = nullptr;
+    // Optional, shares the layout between pipelines with the same interface
+    DescriptorSetLayoutCache* mpLayoutCache = nullptr;
+    // Externally owned set layout (e.g. BindlessRegistry), the pipeline then creates no descriptor pool
+    // and takes its push constant range from mPushConstantRange
+    VkDescriptorSetLayout mExternalSetLayout = VK_NULL_HANDLE;
+    VkPushConstantRange mPushConstantRange = {0, 0, 0};
+    // Optional externally owned layout of set 1, e.g. IndirectDrawList::getDrawSetLayout()
+    VkDescriptorSetLayout mDrawSetLayout = VK_NULL_HANDLE;
+    // Optional, shared allocator for the descriptor sets (VulkanCore::getDescriptorAllocator).
+    // Without it the pipeline creates a private one on the first allocateDescriptorSets call.
+    DescriptorAllocator* mpDescriptorAllocator = nullptr;
 };
 
 class GraphicsPipelineV2
@@ -56,22 +85,47 @@ class GraphicsPipelineV2
     {
         return mPipelineLayout;
     }
+    VkDescriptorSetLayout getDescriptorSetLayout() const
+    {
+        return mDescriptorSetLayout;
+    }
+    const VkPushConstantRange& getPushConstantRange() const
+    {
+        return mPushConstantRange;
+    }
+    bool hasBinding(V2_Binding binding) const
+    {
+        return (mBindingMask & (1u << binding)) != 0;
+    }
 
   private:
     void initCommon(GLFWwindow* window, VkRenderPass renderPass, VkShaderModule vsModule, VkShaderModule fsModule,
                     int32_t numImages, VkFormat colorFormat, VkFormat depthFormat, VkCompareOp depthCompareOp,
-                    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT);
+                    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT,
+                    const VkSpecializationInfo* pSpecializationInfo = nullptr,
+                    VkShaderModule taskModule = VK_NULL_HANDLE, VkShaderModule meshModule = VK_NULL_HANDLE);
 
     void allocateDescriptorSetsInternal(int32_t numSubmeshes,
                                         std::vector<std::vector<VkDescriptorSet>>& descriptorSets);
-    void createDescriptorSetLayout(bool isVB, bool isIB, bool isUniform, bool isTex2D, bool isCubemap);
-    void createDescriptorPool(int32_t maxSets);
+    void createDescriptorSetLayout(bool isVB, bool isIB, bool isUniform, bool isTex2D, bool isCubemap,
+                                   bool isNormalMap);
+    void createDescriptorSetLayoutFromReflection(const ShaderReflection& reflection,
+                                                 DescriptorSetLayoutCache* pLayoutCache);
+    void validateReflection(const ShaderReflection& reflection) const;
+    void createDescriptorAllocator(int32_t maxSets);
 
     VkDevice mDevice;
     VkPipeline mGraphicsPipeline;
     VkPipelineLayout mPipelineLayout;
-    VkDescriptorPool mDescriptorPool;
+    DescriptorAllocator* mDescriptorAllocator;
+    bool mOwnsDescriptorAllocator;
     VkDescriptorSetLayout mDescriptorSetLayout;
+    bool mOwnsDescriptorSetLayout;        // false when the layout comes from a DescriptorSetLayoutCache
+    VkDescriptorSetLayout mDrawSetLayout; // set 1, never owned
+
+    std::vector<VkDescriptorPoolSize> mPoolSizes; // for a single set
+    VkPushConstantRange mPushConstantRange;
+    uint32_t mBindingMask; // bit per V2_Binding present in the layout
 
     int32_t mNumImages;
 };
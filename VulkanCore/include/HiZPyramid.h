@@ -0,0 +1,72 @@
+#ifndef HIZ_PYRAMID_H
+#define HIZ_PYRAMID_H
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+#include "Core.h"
+#include "Texture.h"
+
+namespace VulkanCore
+{
+
+class ComputePipeline;
+
+// Hierarchical-Z pyramid of the scene depth, for GPU occlusion culling.
+// Level 0 is a copy of the depth buffer, every next level keeps the farthest depth of its 2x2 footprint in the
+// previous one (3x3 on the last row / column of odd sized levels), so a single texel bounds the depth of
+// everything already drawn behind a screen area.
+// Built at the end of a frame and read by the IndirectDrawList cull pass of the next one. The image is shared by
+// all swapchain images and always in VK_IMAGE_LAYOUT_GENERAL, it starts at the far plane so nothing is
+// occluded before the first build.
+class HiZPyramid
+{
+  public:
+    HiZPyramid(VulkanCore* pVulkanCore);
+    ~HiZPyramid();
+
+    void destroy();
+
+    // After vkCmdEndRendering : reads the depth image of imageIndex and rebuilds every level
+    void recordBuild(VkCommandBuffer commandBuffer, uint32_t imageIndex) const;
+
+    // All levels, sampled with texelFetch and an explicit level
+    VkDescriptorImageInfo getDescriptorImageInfo() const
+    {
+        return {mImage.mSampler, mImage.mImageView, VK_IMAGE_LAYOUT_GENERAL};
+    }
+    uint32_t getWidth() const
+    {
+        return mImage.mWidth;
+    }
+    uint32_t getHeight() const
+    {
+        return mImage.mHeight;
+    }
+    uint32_t getNumLevels() const
+    {
+        return mNumLevels;
+    }
+
+  private:
+    void createImageViews();
+    void createDescriptorSets();
+
+    VulkanCore* mVulkanCore;
+    VkDevice mDevice;
+    int32_t mNumImages;
+
+    Texture mImage; // R32_SFLOAT, mImageView covers every level
+    uint32_t mNumLevels;
+    std::vector<VkImageView> mLevelViews;
+
+    ComputePipeline* mBuildPipeline;
+    VkSampler mDepthSampler;
+    std::vector<VkDescriptorSet> mDepthSets; // per swapchain image : depth image -> level 0
+    std::vector<VkDescriptorSet> mLevelSets; // mLevelSets[i] : level i -> level i + 1
+};
+
+} // namespace VulkanCore
+
+#endif // HIZ_PYRAMID_H
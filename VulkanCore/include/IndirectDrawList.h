@@ -0,0 +1,154 @@
+#ifndef INDIRECT_DRAW_LIST_H
+#define INDIRECT_DRAW_LIST_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+#include "Core.h"
+#include "ShaderPermutation.h"
+
+namespace VulkanCore
+{
+
+class BindlessRegistry;
+class ComputePipeline;
+class HiZPyramid;
+
+// Per-draw record read by the build compute shader and the GPU-driven vertex shader.
+// std430 layout, must match DrawRecord in VulkanCore/shaders/indirect_build.comp and VulkanDemo/shaders/bindless.*
+struct GpuDrawRecord
+{
+    uint32_t mIndexCount;
+    uint32_t mBatchIndex;      // pipeline the draw belongs to, assigned by IndirectDrawList::upload
+    uint32_t mGeometryIndex;   // see BindlessDrawConstants
+    uint32_t mVertexOffset;    // first vertex of the submesh, in 32-bit words
+    uint32_t mIndexOffset;     // first index of the submesh, in indices of its size (see ShaderFeature_Index16)
+    uint32_t mTransformIndex;  // mat4 in the geometry transform buffer
+    uint32_t mTextureIndex;    // base color in the bindless texture array
+    uint32_t mNormalMapIndex;  // BindlessInvalidIndex when the material has no normal map
+    glm::vec4 mBoundingSphere; // xyz : center, w : radius, in the space of the draw transform. w < 0 : never culled
+    glm::vec4 mBoundsMin;      // AABB, w unused
+    glm::vec4 mBoundsMax;
+    glm::vec4 mCone;           // normal cone of a meshlet, see model::Meshlet::Cone. w = 1 : never backface culled
+};
+
+// VkDrawIndirectCommand followed by the record it draws, read back in the vertex shader through gl_DrawID
+struct GpuDrawCommand
+{
+    VkDrawIndirectCommand mCommand;
+    uint32_t mDrawIndex;
+};
+
+enum CullFlags
+{
+    CullFlag_Frustum = 1 << 0,
+    CullFlag_Occlusion = 1 << 1, // needs a HiZPyramid
+    CullFlag_Backface = 1 << 2,  // normal cone of the draw, meshlet draws only
+};
+
+// Host visible, one per swapchain image : flags read by the cull pass, counters written by it.
+// Must match CullData in VulkanCore/shaders/indirect_build.comp
+struct GpuCullData
+{
+    uint32_t mFlags; // CullFlags
+    uint32_t mNumVisible;
+    uint32_t mNumFrustumCulled;
+    uint32_t mNumOcclusionCulled;
+    uint32_t mNumBackfaceCulled;
+};
+
+// Bindings of set 1 of the GPU-driven graphics pipelines
+enum IndirectDrawBinding
+{
+    IndirectDrawBinding_Records = 0,  // GpuDrawRecord[]
+    IndirectDrawBinding_Commands = 1, // GpuDrawCommand[]
+    IndirectDrawBinding_Count = 2
+};
+
+// GPU-driven draw submission.
+// Draw records live in an SSBO; each frame a compute pass culls them and writes one GpuDrawCommand per
+// surviving record into the range of its batch (one batch per shader permutation) and counts them, then every
+// batch is rendered with a single vkCmdDrawIndirectCount. CPU work per frame is O(batches), independent of the
+// number of draws.
+// Culling : bounding sphere against the frustum planes of the draw WVP, then the normal cone of the draw against
+// the camera position (meshlet draws, see VulkanModel::registerIndirectDraws), then the projected AABB against the
+// HiZPyramid of the previous frame, so a draw hidden by last frame's depth may show up one frame late.
+// Works on top of the BindlessRegistry set, requires VulkanCore::isGpuDrivenSupported().
+class IndirectDrawList
+{
+  public:
+    // Without a HiZ pyramid only frustum culling is available
+    IndirectDrawList(VulkanCore* pVulkanCore, const BindlessRegistry* pRegistry, const HiZPyramid* pHiZ = nullptr);
+    ~IndirectDrawList();
+
+    void destroy();
+
+    // Draws may be added until upload(), key selects the pipeline of the draw in recordDraws()
+    void addDraw(const ShaderPermutationKey& key, const GpuDrawRecord& record);
+
+    // Groups the draws by batch, creates the buffers and descriptor sets
+    void upload();
+
+    // Outside of a render pass : resets the counts, culls and builds the indirect commands of the image
+    void recordBuild(VkCommandBuffer commandBuffer, uint32_t imageIndex) const;
+
+    // Inside the render pass : one vkCmdDrawIndirectCount per batch
+    void recordDraws(VkCommandBuffer commandBuffer, const PipelineVariantMap& pipelines, uint32_t imageIndex) const;
+
+    // Call once the previous submission of the image has completed (after VulkanQueue::acquireNextImage) :
+    // returns the counters of that submission and sets the CullFlags of the next one
+    GpuCullData updateCullData(uint32_t imageIndex, uint32_t cullFlags);
+
+    // Throws when a shader does not match set 1
+    void validateInterface(const ShaderReflection& reflection) const;
+
+    VkDescriptorSetLayout getDrawSetLayout() const
+    {
+        return mDrawSetLayout;
+    }
+    uint32_t getNumDraws() const
+    {
+        return static_cast<uint32_t>(mRecords.size());
+    }
+    uint32_t getNumBatches() const
+    {
+        return static_cast<uint32_t>(mBatches.size());
+    }
+
+  private:
+    struct Batch
+    {
+        uint64_t mKey;
+        uint32_t mFirstCommand;
+        uint32_t mMaxDraws;
+    };
+
+    void createDescriptorSets();
+
+    VulkanCore* mVulkanCore;
+    const BindlessRegistry* mRegistry;
+    const HiZPyramid* mHiZ;
+    VkDevice mDevice;
+    int32_t mNumImages;
+
+    std::vector<uint64_t> mPendingKeys; // parallel to mRecords until upload()
+    std::vector<GpuDrawRecord> mRecords;
+    std::vector<Batch> mBatches;
+
+    ComputePipeline* mBuildPipeline;
+    VkDescriptorSetLayout mDrawSetLayout; // owned by the DescriptorSetLayoutCache
+
+    BufferAndMemory mRecordBuffer;
+    BufferAndMemory mBatchBuffer;                 // first command of every batch
+    std::vector<BufferAndMemory> mCommandBuffers; // per swapchain image
+    std::vector<BufferAndMemory> mCountBuffers;   // per swapchain image, one count per batch
+    std::vector<BufferAndMemory> mCullBuffers;    // per swapchain image, GpuCullData
+    std::vector<VkDescriptorSet> mBuildSets;      // per swapchain image, compute set 1 (set 0 : bindless)
+    std::vector<VkDescriptorSet> mDrawSets;       // per swapchain image, graphics set 1
+};
+
+} // namespace VulkanCore
+
+#endif // INDIRECT_DRAW_LIST_H
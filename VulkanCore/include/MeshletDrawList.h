@@ -0,0 +1,147 @@
+#ifndef MESHLET_DRAW_LIST_H
+#define MESHLET_DRAW_LIST_H
+
+#include <cstdint>
+#include <glm/glm.hpp>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+#include "Core.h"
+#include "IndirectDrawList.h"
+#include "ShaderPermutation.h"
+
+namespace VulkanCore
+{
+
+class BindlessRegistry;
+
+// Per-meshlet record read by the task and mesh shaders.
+// std430 layout, must match MeshletRecord in VulkanCore/shaders/meshlet_cull.task and VulkanDemo/shaders/meshlet.mesh
+struct GpuMeshlet
+{
+    uint32_t mVertexOffset;    // in the meshlet vertex buffer of the list, see addVertices
+    uint32_t mTriangleOffset;  // in the meshlet triangle buffer of the list, see addTriangles
+    uint32_t mVertexCount;
+    uint32_t mTriangleCount;
+    uint32_t mGeometryIndex;   // see BindlessDrawConstants
+    uint32_t mBaseVertex;      // first vertex of the submesh, in 32-bit words
+    uint32_t mTransformIndex;  // mat4 in the geometry transform buffer
+    uint32_t mTextureIndex;    // base color in the bindless texture array
+    uint32_t mNormalMapIndex;  // BindlessInvalidIndex when the material has no normal map
+    uint32_t mPadding[3];
+    glm::vec4 mBoundingSphere; // xyz : center, w : radius, in the space of the draw transform. w < 0 : never culled
+    glm::vec4 mCone;           // see model::Meshlet::Cone
+};
+
+// Push constants of the mesh shader pipelines, one vkCmdDrawMeshTasksEXT per batch
+struct MeshletBatchConstants
+{
+    uint32_t mFirstMeshlet;
+    uint32_t mNumMeshlets;
+};
+
+// Bindings of set 1 of the mesh shader pipelines
+enum MeshletDrawBinding
+{
+    MeshletDrawBinding_Meshlets = 0,  // GpuMeshlet[]
+    MeshletDrawBinding_Vertices = 1,  // uint[] : vertex index relative to the submesh
+    MeshletDrawBinding_Triangles = 2, // uint[] : three 8-bit indices into the meshlet vertices
+    MeshletDrawBinding_CullData = 3,  // GpuCullData, per swapchain image
+    MeshletDrawBinding_Count = 4
+};
+
+constexpr uint32_t kMeshletTaskGroupSize = 32; // meshlets per task workgroup, local size of the meshlet shaders
+
+// Mesh shader (VK_EXT_mesh_shader) submission of meshlets.
+// The meshlets of a batch (one per shader permutation) are contiguous and drawn with a single
+// vkCmdDrawMeshTasksEXT : every task workgroup culls kMeshletTaskGroupSize meshlets against the frustum and their
+// normal cone, then launches one mesh workgroup per visible meshlet. No compute pre-pass and no indirect buffer,
+// CPU work per frame is O(batches).
+// The list owns the task shader, the mesh and fragment stages come from the pipelines given to recordDraws().
+// Works on top of the BindlessRegistry set, requires VulkanCore::isMeshShaderSupported().
+class MeshletDrawList
+{
+  public:
+    MeshletDrawList(VulkanCore* pVulkanCore, const BindlessRegistry* pRegistry);
+    ~MeshletDrawList();
+
+    void destroy();
+
+    // Meshlet vertices and triangles of a model, return the offset of the first one for GpuMeshlet
+    uint32_t addVertices(const std::vector<uint32_t>& vertices);
+    uint32_t addTriangles(const std::vector<uint32_t>& triangles);
+
+    // Meshlets may be added until upload(), key selects the pipeline of the meshlet in recordDraws()
+    void addMeshlet(const ShaderPermutationKey& key, const GpuMeshlet& meshlet);
+
+    // Groups the meshlets by batch, creates the buffers and descriptor sets
+    void upload();
+
+    // Inside the render pass : one vkCmdDrawMeshTasksEXT per batch
+    void recordDraws(VkCommandBuffer commandBuffer, const PipelineVariantMap& pipelines, uint32_t imageIndex) const;
+
+    // After the render pass : makes the counters of the task shader visible to updateCullData()
+    void recordCullDataBarrier(VkCommandBuffer commandBuffer, uint32_t imageIndex) const;
+
+    // See IndirectDrawList::updateCullData, CullFlag_Occlusion is ignored
+    GpuCullData updateCullData(uint32_t imageIndex, uint32_t cullFlags);
+
+    // Throws when a shader does not match set 1
+    void validateInterface(const ShaderReflection& reflection) const;
+
+    VkShaderModule getTaskShaderModule() const
+    {
+        return mTaskShaderModule;
+    }
+    VkDescriptorSetLayout getDrawSetLayout() const
+    {
+        return mDrawSetLayout;
+    }
+    static VkPushConstantRange getPushConstantRange()
+    {
+        return {VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT, 0, sizeof(MeshletBatchConstants)};
+    }
+    uint32_t getNumMeshlets() const
+    {
+        return static_cast<uint32_t>(mMeshlets.size());
+    }
+    uint32_t getNumBatches() const
+    {
+        return static_cast<uint32_t>(mBatches.size());
+    }
+
+  private:
+    struct Batch
+    {
+        uint64_t mKey;
+        uint32_t mFirstMeshlet;
+        uint32_t mNumMeshlets;
+    };
+
+    void createDescriptorSets();
+
+    VulkanCore* mVulkanCore;
+    const BindlessRegistry* mRegistry;
+    VkDevice mDevice;
+    int32_t mNumImages;
+
+    std::vector<uint64_t> mPendingKeys; // parallel to mMeshlets until upload()
+    std::vector<GpuMeshlet> mMeshlets;
+    std::vector<uint32_t> mVertices;
+    std::vector<uint32_t> mTriangles;
+    std::vector<Batch> mBatches;
+
+    VkShaderModule mTaskShaderModule;
+    VkDescriptorSetLayout mDrawSetLayout; // owned by the DescriptorSetLayoutCache
+    PFN_vkCmdDrawMeshTasksEXT mCmdDrawMeshTasks;
+
+    BufferAndMemory mMeshletBuffer;
+    BufferAndMemory mVertexBuffer;
+    BufferAndMemory mTriangleBuffer;
+    std::vector<BufferAndMemory> mCullBuffers; // per swapchain image, GpuCullData
+    std::vector<VkDescriptorSet> mDrawSets;    // per swapchain image
+};
+
+} // namespace VulkanCore
+
+#endif // MESHLET_DRAW_LIST_H
@@ -29,7 +29,9 @@ struct ModelDesc
     VkBuffer mVertexBuffer;
     VkBuffer mIndexBuffer;
     std::vector<VkBuffer> mUniformBuffers;
+    std::vector<VkBuffer> mInstanceBuffers; // per swapchain image, bound whole, empty without instancing
     std::vector<TextureInfo> mMaterials;
+    std::vector<TextureInfo> mNormalMaps; // per submesh, null handles when the material has no normal map
     std::vector<SubmeshRanges> mRanges;
 };
 } // namespace VulkanCore
@@ -0,0 +1,135 @@
+#ifndef MODEL_LOADER_H
+#define MODEL_LOADER_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Core.h"
+#include "ShaderPermutation.h"
+#include "UploadStream.h"
+
+namespace VulkanCore
+{
+
+class VulkanModel;
+
+// Default bytes of uploads submitted per frame by ModelLoader::update()
+constexpr VkDeviceSize kDefaultUploadBudget = 32ull * 1024 * 1024;
+
+enum ModelLoadStage : uint32_t
+{
+    ModelLoadStage_Queued = 0,
+    ModelLoadStage_Import,   // assimp, the model cache or the baked file, the buffers are written to staging buffers
+    ModelLoadStage_Decode,   // texture files decoded to staging buffers
+    ModelLoadStage_Upload,   // copies streamed by the render thread, waiting for the other models included
+    ModelLoadStage_Resident, // the model can be drawn
+    ModelLoadStage_Failed,
+    ModelLoadStage_Count
+};
+
+const char* GetModelLoadStageName(ModelLoadStage stage);
+
+// One model requested from ModelLoader, polled by the render thread
+class ModelLoad
+{
+  public:
+    ModelLoadStage getStage() const
+    {
+        return mStage.load(std::memory_order_acquire);
+    }
+    bool isResident() const
+    {
+        return getStage() == ModelLoadStage_Resident;
+    }
+    bool isFailed() const
+    {
+        return getStage() == ModelLoadStage_Failed;
+    }
+    const std::string& getPath() const
+    {
+        return mPath;
+    }
+    // Once failed
+    const std::string& getError() const
+    {
+        return mError;
+    }
+    // Milliseconds spent in a stage the load went through, 0 for the current and the later ones
+    float getStageTime(ModelLoadStage stage) const
+    {
+        return stage < getStage() ? mStageTimes[stage] : 0.0f;
+    }
+    // Since load() was called
+    float getElapsedTime() const;
+
+    // Once resident, the caller owns the model : destroy() and delete it
+    VulkanModel* releaseModel();
+
+  private:
+    friend class ModelLoader;
+
+    // Ends the current stage, called by the thread running it
+    void setStage(ModelLoadStage stage);
+
+    std::string mPath;
+    VertexLayout mVertexLayout{VertexLayout_Full};
+    bool mPositionStream{false};
+    VulkanModel* mpModel{nullptr};
+    std::string mError;
+    VkDeviceSize mUploadSize{0};
+    std::atomic<ModelLoadStage> mStage{ModelLoadStage_Queued};
+    float mStageTimes[ModelLoadStage_Count] = {};
+    std::chrono::steady_clock::time_point mStart;
+    std::chrono::steady_clock::time_point mStageStart;
+};
+
+// Models loaded in the background : a worker thread imports them and decodes their textures, then update() streams
+// their uploads through an UploadStream, a batch of at most the upload budget per frame, so the render thread never
+// waits on a model. Models are loaded one at a time, in request order.
+class ModelLoader
+{
+  public:
+    ModelLoader(VulkanCore* pVulkanCore, VkDeviceSize uploadBudget = kDefaultUploadBudget);
+    ~ModelLoader();
+
+    // Waits for the model being imported, the models not released are destroyed
+    void destroy();
+
+    // Returns at once, same arguments as the VulkanModel constructor. The load is owned by the loader.
+    ModelLoad* load(const std::string& modelPath, VertexLayout vertexLayout = VertexLayout_Full,
+                    bool positionStream = false);
+
+    // Render thread, once per frame : submits the next upload batch once the previous one has completed
+    void update();
+
+  private:
+    void runWorker();
+    void importModel(ModelLoad& load);
+    void finishUploads(ModelLoad& load);
+    void failLoad(ModelLoad& load, const std::string& error);
+
+    VulkanCore* mVulkanCore;
+    VkDeviceSize mUploadBudget;
+    UploadStream mUploadStream;
+    std::vector<std::unique_ptr<ModelLoad>> mLoads;
+    ModelLoad* mpStreamingLoad{nullptr}; // uploads in the stream
+
+    // Worker thread
+    std::mutex mMutex;
+    std::condition_variable mCondition;
+    std::deque<ModelLoad*> mQueue; // not imported yet
+    bool mStopping{false};
+    std::thread mWorker;
+};
+
+} // namespace VulkanCore
+
+#endif // MODEL_LOADER_H
@@ -18,6 +18,10 @@ struct PhysicalDeviceProperties
     VkSurfaceCapabilitiesKHR mSurfaceCaps;
     VkPhysicalDeviceMemoryProperties mMemoryProperties;
     VkPhysicalDeviceFeatures mFeatures;
+    VkPhysicalDeviceVulkan11Features mFeatures11; // pNext is reset to nullptr after the query
+    VkPhysicalDeviceVulkan12Features mFeatures12; // pNext is reset to nullptr after the query
+    VkPhysicalDeviceMeshShaderFeaturesEXT mMeshShaderFeatures; // all false without VK_EXT_mesh_shader
+    VkPhysicalDeviceDescriptorIndexingProperties mDescriptorIndexingProperties;
     VkFormat mDepthFormat;
     struct
     {
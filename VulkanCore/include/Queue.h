@@ -18,6 +18,8 @@ class VulkanQueue
 
     uint32_t acquireNextImage();
     void submitSync(VkCommandBuffer commandBuffer);
+    // Returns right away, fence is signaled once the command buffer has executed, see UploadStream
+    void submit(VkCommandBuffer commandBuffer, VkFence fence);
     void submitAsync(VkCommandBuffer commandBuffer);
     void submitAsync(VkCommandBuffer* commandBuffer, uint32_t numOfCommandBuffers);
     void presentImage(uint32_t imageIndex);
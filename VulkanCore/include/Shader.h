@@ -1,5 +1,7 @@
 #pragma once
+#include <cstdint>
 #include <string>
+#include <vector>
 #include <vulkan/vulkan.h>
 
 namespace VulkanCore
@@ -9,4 +11,9 @@ VkShaderModule CreateShaderModuleFromText(const VkDevice& device, const std::str
 
 VkShaderModule CreateShaderModuleFromBinary(const VkDevice& device, const std::string& shaderCode);
 
+// Compile a GLSL file to SPIR-V. Each define is either "NAME" or "NAME=VALUE".
+std::vector<uint32_t> CompileShaderToSpirv(const std::string& shaderFile, const std::vector<std::string>& defines);
+
+VkShaderModule CreateShaderModuleFromSpirv(const VkDevice& device, const std::vector<uint32_t>& spirvCode);
+
 }; // namespace VulkanCore
@@ -0,0 +1,144 @@
+#ifndef SHADER_PERMUTATION_H
+#define SHADER_PERMUTATION_H
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+#include "ShaderReflection.h"
+
+namespace VulkanCore
+{
+
+class GraphicsPipelineV2;
+
+// Optional shader features a material can request.
+// Interface features change the shader's resource interface (bindings, varyings) and are therefore
+// compiled in with a preprocessor define. All other features only toggle code paths and are passed
+// as specialization constants, so they share one SPIR-V module and the driver strips the unused branches.
+enum ShaderFeature : uint32_t
+{
+    ShaderFeature_None = 0,
+    ShaderFeature_NormalMap = 1 << 0,     // interface feature : HAS_NORMAL_MAP
+    ShaderFeature_AlphaTest = 1 << 1,     // specialization constant only
+    ShaderFeature_PushConstants = 1 << 2, // interface feature : USE_PUSH_CONSTANTS, see ModelDrawConstants
+    ShaderFeature_GpuDriven = 1 << 3,     // interface feature : GPU_DRIVEN, draws read through gl_DrawID
+    ShaderFeature_Instanced = 1 << 4,     // interface feature : INSTANCED, transform per gl_InstanceIndex
+    ShaderFeature_Index16 = 1 << 5,       // specialization constant only : 16-bit indices, two per word
+};
+
+constexpr uint32_t ShaderFeature_InterfaceMask =
+    ShaderFeature_NormalMap | ShaderFeature_PushConstants | ShaderFeature_GpuDriven | ShaderFeature_Instanced;
+
+// Layout of the pulled vertex stream, read by the vertex shader through kVertexLayout
+enum VertexLayout : uint32_t
+{
+    VertexLayout_Full = 0,      // Model::Vertex : pos, uv, normal, tangent, bitangent (56 bytes)
+    VertexLayout_Quantized = 1, // model::QuantizedVertex (20 bytes), dequantized by the draw transform
+    // Position streams for depth only passes, see VulkanModel : the other attributes read as zero
+    VertexLayout_Position = 2,          // vec3 of VertexLayout_Full (12 bytes)
+    VertexLayout_QuantizedPosition = 3, // unorm16 x3 of VertexLayout_Quantized + padding (8 bytes)
+};
+
+// constant_id values shared by all model shaders
+enum SpecConstantId : uint32_t
+{
+    SpecConstant_FeatureMask = 0,
+    SpecConstant_VertexLayout = 1,
+    SpecConstant_AlphaCutoff = 2,
+    SpecConstant_Count = 3
+};
+
+struct ShaderPermutationKey
+{
+    uint32_t mFeatures = ShaderFeature_None;
+    uint32_t mVertexLayout = VertexLayout_Full;
+
+    uint64_t hash() const
+    {
+        return (static_cast<uint64_t>(mVertexLayout) << 32) | mFeatures;
+    }
+
+    bool operator==(const ShaderPermutationKey& other) const
+    {
+        return mFeatures == other.mFeatures && mVertexLayout == other.mVertexLayout;
+    }
+};
+
+// Pipelines for every shader permutation used by a model, keyed by ShaderPermutationKey::hash()
+using PipelineVariantMap = std::unordered_map<uint64_t, GraphicsPipelineV2*>;
+
+// Values of the model shader specialization constants, laid out as VkSpecializationInfo::pData
+struct SpecializationData
+{
+    uint32_t mFeatureMask;
+    uint32_t mVertexLayout;
+    float mAlphaCutoff;
+};
+
+struct ShaderVariant
+{
+    ShaderPermutationKey mKey;
+    VkShaderModule mVertexModule = VK_NULL_HANDLE; // or mesh shader, see ShaderPermutationCache
+    VkShaderModule mFragmentModule = VK_NULL_HANDLE;
+
+    // Resource interface of both stages, see PipelineDesc::mpReflection
+    ShaderReflection mReflection;
+
+    // Specialization data, referenced by mSpecializationInfo.
+    // Variants are heap allocated by the cache so these pointers stay valid.
+    SpecializationData mSpecData;
+    std::array<VkSpecializationMapEntry, SpecConstant_Count> mSpecEntries;
+    VkSpecializationInfo mSpecializationInfo;
+};
+
+// Compiles shader variants on demand and deduplicates them by key.
+// Modules are shared between variants that only differ in specialization constants.
+// The vertex shader path may name a mesh shader (.mesh) instead, for the pipelines of MeshletDrawList.
+class ShaderPermutationCache
+{
+  public:
+    ShaderPermutationCache(VkDevice device, std::string vertexShaderPath, std::string fragmentShaderPath);
+    ~ShaderPermutationCache();
+
+    void destroy();
+
+    const ShaderVariant& getVariant(const ShaderPermutationKey& key);
+
+    size_t getNumVariants() const
+    {
+        return mVariants.size();
+    }
+    size_t getNumModules() const
+    {
+        return mVertexModules.size() + mFragmentModules.size();
+    }
+
+  private:
+    struct CompiledModule
+    {
+        VkShaderModule mModule = VK_NULL_HANDLE;
+        ShaderReflection mReflection;
+    };
+
+    const CompiledModule& getModule(std::unordered_map<uint32_t, CompiledModule>& modules,
+                                    const std::string& shaderPath, uint32_t interfaceFeatures);
+
+    static std::vector<std::string> getDefines(uint32_t interfaceFeatures);
+
+    VkDevice mDevice;
+    std::string mVertexShaderPath;
+    std::string mFragmentShaderPath;
+
+    std::unordered_map<uint64_t, std::unique_ptr<ShaderVariant>> mVariants;
+    std::unordered_map<uint32_t, CompiledModule> mVertexModules;   // keyed by interface feature mask
+    std::unordered_map<uint32_t, CompiledModule> mFragmentModules; // keyed by interface feature mask
+};
+
+} // namespace VulkanCore
+
+#endif // SHADER_PERMUTATION_H
@@ -0,0 +1,48 @@
+#ifndef SHADER_REFLECTION_H
+#define SHADER_REFLECTION_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+namespace VulkanCore
+{
+
+struct ReflectedBinding
+{
+    uint32_t mSet{0};
+    uint32_t mBinding{0};
+    VkDescriptorType mType{VK_DESCRIPTOR_TYPE_MAX_ENUM};
+    uint32_t mCount{1}; // 0 for runtime sized arrays
+    VkShaderStageFlags mStages{0};
+    std::string mName;
+};
+
+struct ShaderReflection
+{
+    VkShaderStageFlags mStages{0};
+    std::vector<ReflectedBinding> mBindings; // sorted by set, then binding
+    VkPushConstantRange mPushConstants{0, 0, 0}; // size 0 when the shader has no push constants
+};
+
+// Extract the resource interface of a SPIR-V module.
+// Only the subset needed to build descriptor set layouts is parsed.
+ShaderReflection ReflectSpirv(const std::vector<uint32_t>& spirvCode);
+
+// Combine the interfaces of the stages of one pipeline.
+// Throws when two stages disagree on the type or array size of a binding.
+ShaderReflection MergeReflection(const ShaderReflection& a, const ShaderReflection& b);
+
+// Bindings of one descriptor set, ready for VkDescriptorSetLayoutCreateInfo
+std::vector<VkDescriptorSetLayoutBinding> GetSetLayoutBindings(const ShaderReflection& reflection, uint32_t set);
+
+// Pool sizes needed to allocate numSets sets of the given layout
+std::vector<VkDescriptorPoolSize> GetPoolSizes(const std::vector<VkDescriptorSetLayoutBinding>& bindings,
+                                               uint32_t numSets);
+
+const char* GetDescriptorTypeName(VkDescriptorType type);
+
+} // namespace VulkanCore
+
+#endif // SHADER_REFLECTION_H
@@ -0,0 +1,64 @@
+#ifndef SKINNING_PASS_H
+#define SKINNING_PASS_H
+
+#include <cstdint>
+#include <span>
+#include <vulkan/vulkan_core.h>
+
+#include "Animation.h"
+#include "Core.h"
+
+namespace VulkanCore
+{
+
+class ComputePipeline;
+
+// Per vertex bone influences, matches Influence in skinning.comp
+struct GpuBoneInfluence
+{
+    uint32_t mBoneIds[model::kMaxBoneInfluences];
+    float mWeights[model::kMaxBoneInfluences];
+};
+
+// firstPositionWord of a model without position stream
+constexpr uint32_t kSkinningNoPositionStream = UINT32_MAX;
+
+// One dispatch per submesh, matches SkinningConstants in skinning.comp
+struct GpuSkinningConstants
+{
+    uint32_t mNumVertices;
+    uint32_t mFirstInfluence;    // of the submesh in the influence buffer
+    uint32_t mFirstVertexWord;   // of the submesh in the bind pose and skinned vertex buffers
+    uint32_t mFirstPositionWord; // of the submesh in the position stream, or kSkinningNoPositionStream
+};
+
+// Linear blend skinning on the GPU : every vertex of the bind pose is moved by its bone matrices and written to the
+// vertex buffer (and position stream) the draws read, so every render path draws the animated geometry unchanged.
+// The pipeline is shared by the skinned models, each one owns its buffers and descriptor sets, see
+// VulkanModel::enableSkinning().
+class SkinningPass
+{
+  public:
+    SkinningPass(VulkanCore* pVulkanCore);
+    ~SkinningPass();
+
+    void destroy();
+
+    // Set of one model and swapchain image. Without position stream, positions is the skinned vertex buffer and is
+    // not written.
+    VkDescriptorSet createDescriptorSet(const BufferAndMemory& bindPose, const BufferAndMemory& influences,
+                                        const BufferAndMemory& bones, const BufferAndMemory& vertices,
+                                        const BufferAndMemory& positions) const;
+
+    // Binds the pipeline and the set, then dispatches every submesh. Barriers are left to the caller.
+    void recordDispatches(VkCommandBuffer commandBuffer, VkDescriptorSet descriptorSet,
+                          std::span<const GpuSkinningConstants> dispatches) const;
+
+  private:
+    VulkanCore* mVulkanCore;
+    ComputePipeline* mPipeline;
+};
+
+} // namespace VulkanCore
+
+#endif // SKINNING_PASS_H
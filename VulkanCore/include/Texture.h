@@ -28,7 +28,10 @@ class Texture
 
     void destroy(VkDevice device);
     void LoadFromFile(const std::string& filePath);
-    void Load(uint32_t bufferSize, void* pImageData);
+    // Image file in memory (png, jpg...), e.g. a texture embedded in a model
+    void Load(uint32_t bufferSize, const void* pImageData);
+    // width x height RGBA texels
+    void LoadPixels(const void* pPixels, uint32_t width, uint32_t height);
     void loadEctCubemap(const std::string& fileName);
 
     VkImage mImage{VK_NULL_HANDLE};
@@ -0,0 +1,75 @@
+#ifndef UPLOAD_STREAM_H
+#define UPLOAD_STREAM_H
+
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan_core.h>
+
+#include "Core.h"
+
+namespace VulkanCore
+{
+
+class Texture;
+
+// Device local storage buffer waiting for its copy : mStaging is written (and still mapped) by the producer,
+// e.g. a worker thread, mpTarget receives the buffer when the copy is recorded.
+struct PendingBufferUpload
+{
+    BufferAndMemory* mpTarget{nullptr};
+    BufferAndMemory mStaging;
+    VkDeviceSize mSize{0};
+};
+
+// Sampled 2D image waiting for its copy, mStaging holds mWidth * mHeight RGBA texels
+struct PendingTextureUpload
+{
+    Texture* mpTarget{nullptr};
+    BufferAndMemory mStaging;
+    uint32_t mWidth{0};
+    uint32_t mHeight{0};
+    VkFormat mFormat{VK_FORMAT_R8G8B8A8_UNORM};
+};
+
+// Uploads recorded into one command buffer and submitted with a fence, unlike VulkanCore::copyBuffer() the caller
+// does not wait : isComplete() is polled once per frame and the staging buffers are freed when the batch is done.
+// A single batch is in flight at a time. Render thread only, as every other queue submission.
+class UploadStream
+{
+  public:
+    UploadStream(VulkanCore* pVulkanCore);
+    ~UploadStream();
+
+    void destroy();
+
+    // Create the target and record its copy into the open batch. Returns the bytes copied.
+    VkDeviceSize record(PendingBufferUpload& upload);
+    VkDeviceSize record(PendingTextureUpload& upload);
+
+    // Submit the open batch, the targets can be used once isComplete() returns true
+    void submit();
+    bool isComplete();
+    void wait();
+
+    // Bytes recorded into the open batch
+    VkDeviceSize getBatchSize() const
+    {
+        return mBatchSize;
+    }
+
+  private:
+    void begin();
+    void releaseStaging();
+
+    VulkanCore* mVulkanCore;
+    VkCommandBuffer mCommandBuffer;
+    VkFence mFence;
+    bool mRecording;
+    bool mInFlight;
+    VkDeviceSize mBatchSize;
+    std::vector<BufferAndMemory> mStagingBuffers; // of the batch, destroyed once it completes
+};
+
+} // namespace VulkanCore
+
+#endif // UPLOAD_STREAM_H
@@ -1,10 +1,17 @@
 #ifndef VULKANCORE_MODEL_H
 #define VULKANCORE_MODEL_H
 
+#include "BindlessRegistry.h"
 #include "Core.h"
+#include "FrustumCuller.h"
 #include "GraphicsPipelineV2.h"
+#include "IndirectDrawList.h"
+#include "MeshletDrawList.h"
 #include "Model.h"
+#include "ShaderPermutation.h"
+#include "SkinningPass.h"
 #include "Texture.h"
+#include "UploadStream.h"
 
 #include <glm/glm.hpp>
 #include <vector>
@@ -12,17 +19,176 @@
 
 namespace VulkanCore
 {
+
+// Per-draw push constants of the ShaderFeature_PushConstants permutations, matches DrawConstants in triangle.vert
+struct ModelDrawConstants
+{
+    glm::mat4 mWVP;
+    uint32_t mMaterialIndex; // selects the material descriptor set, available to the shaders
+    uint32_t mVertexOffset;  // first vertex of the submesh in the model vertex buffer
+};
+
+// Share of the LOD threshold the projected error must cross before the LOD changes, see enableLods
+constexpr float kLodHysteresis = 0.25f;
+
 class VulkanModel : public model::Model
 {
   public:
-    VulkanModel(std::string modelPath, VulkanCore* pVulkanCore);
+    // VertexLayout_Quantized uploads model::QuantizedVertex instead of Model::Vertex. The dequantization of a
+    // submesh is folded into its uploaded transformation, so every render path and the GPU culling work unchanged.
+    // With positionStream a second vertex buffer holds only the positions, see recordDepthBindless().
+    // A modelPath ending in kBakedModelExtension is mapped and uploaded as is, it must have been baked with the same
+    // vertex layout and with a position stream if one is requested, see BakedModel.h.
+    // With deferUploads nothing is submitted to a queue, so the model can be built on a worker thread : the device
+    // local buffers are left in their staging buffers and the textures are only listed, decodeTextures() and
+    // streamUploads() finish the job, see ModelLoader.
+    VulkanModel(std::string modelPath, VulkanCore* pVulkanCore, VertexLayout vertexLayout = VertexLayout_Full,
+                bool positionStream = false, bool deferUploads = false);
     ~VulkanModel() = default;
 
     void destroy();
+
+    // Deferred uploads only. Decodes every listed texture into a staging buffer, in parallel, any thread.
+    void decodeTextures();
+    // Render thread : records pending uploads into the open batch of stream until it holds budget bytes (at least
+    // one upload), the caller submits it. Returns true once nothing is left, the model can be drawn when the
+    // stream completes.
+    bool streamUploads(UploadStream& stream, VkDeviceSize budget);
+    bool hasPendingUploads() const
+    {
+        return !mPendingBuffers.empty() || !mPendingTextures.empty();
+    }
+
+    // Push constant path : the per-draw WVP and material index are pushed instead of written to the uniform
+    // buffer, and descriptor sets are per material (whole VB/IB + textures) so consecutive submeshes of a
+    // material draw without rebinding. Call before getPermutationKeys(), the command buffer of an image
+    // must then be re-recorded after every update().
+    void enablePushConstants();
+    bool isPushConstantsEnabled() const
+    {
+        return mUsePushConstants;
+    }
+
     void createDescriptorSets(GraphicsPipelineV2* pPipeline);
     void recordCommandBuffer(VkCommandBuffer commandBuffer, GraphicsPipelineV2* pPipeline, uint32_t imageIndex);
+
+    // Draws every submesh with the pipeline of its material permutation,
+    // submeshes sharing a permutation are drawn back to back
+    void recordCommandBuffer(VkCommandBuffer commandBuffer, const PipelineVariantMap& pipelines, uint32_t imageIndex);
+
+    // Bindless path : register the buffers and textures once, then every draw is a push constant update
+    // on top of the single registry set, see BindlessRegistry
+    void registerBindless(BindlessRegistry* pRegistry);
+    void recordCommandBufferBindless(VkCommandBuffer commandBuffer, const PipelineVariantMap& pipelines,
+                                     const BindlessRegistry& registry, uint32_t imageIndex);
+
+    // Depth only draws of the bindless path reading the position stream, for a depth prepass or a shadow map.
+    // Pipelines are keyed by getDepthPermutationKeys(), they need no fragment shader. Alpha tested submeshes are
+    // skipped : their depth depends on the texture, they are only drawn by the main pass.
+    bool hasPositionStream() const
+    {
+        return mPositionSize > 0;
+    }
+    std::vector<ShaderPermutationKey> getDepthPermutationKeys() const;
+    void recordDepthBindless(VkCommandBuffer commandBuffer, const PipelineVariantMap& pipelines,
+                             const BindlessRegistry& registry, uint32_t imageIndex);
+
+    // GPU-driven path on top of the bindless one : every submesh becomes a draw record of the list, which
+    // builds and submits the draws itself, see IndirectDrawList. Call enableGpuDriven() before
+    // getPermutationKeys() and registerIndirectDraws() after registerBindless().
+    // With useMeshlets every meshlet of LOD 0 is a draw record instead, so the list culls clusters (backfacing
+    // ones included) rather than whole submeshes.
+    void enableGpuDriven();
+    void registerIndirectDraws(IndirectDrawList* pDrawList, bool useMeshlets = false) const;
+
+    // Mesh shader path on top of the bindless one : the meshlets are culled by a task shader, see
+    // MeshletDrawList. Same requirements as registerIndirectDraws().
+    void registerMeshletDraws(MeshletDrawList* pDrawList) const;
+    uint32_t getNumMeshlets() const
+    {
+        return static_cast<uint32_t>(m_Meshlets.size());
+    }
+
+    // CPU frustum culling for the CPU submission paths : update() culls the submesh spheres against its WVP and
+    // only the visible submeshes are recorded, so the command buffer of an image must then be re-recorded after
+    // every update(). The GPU-driven path culls on the GPU instead.
+    void enableCpuCulling();
+    bool isCpuCullingEnabled() const
+    {
+        return mUseCpuCulling;
+    }
+    FrustumCuller& getCuller()
+    {
+        return mCuller;
+    }
+    uint32_t getNumVisibleSubmeshes() const
+    {
+        return static_cast<uint32_t>(mUseCpuCulling ? mVisibleSubmeshes.size() : m_Meshes.size());
+    }
+    float getCullTimeUs() const
+    {
+        return mCullTimeUs;
+    }
+
+    // Instancing : every submesh is drawn once for all the instances. The transform buffer of an image holds the
+    // submesh transformations followed by the view projection of every instance, the draws start at
+    // firstInstance = number of submeshes so gl_InstanceIndex indexes it directly. Call before
+    // getPermutationKeys(), updateInstances() then replaces update() and the command buffer of an image must be
+    // re-recorded after every call. Not supported by the GPU-driven path.
+    void enableInstancing(uint32_t maxInstances);
+    bool isInstancingEnabled() const
+    {
+        return mMaxInstances > 0;
+    }
+    // With CPU culling the instances outside the frustum are not uploaded
+    void updateInstances(int currentImage, const glm::mat4& viewProj,
+                         const std::vector<glm::mat4>& instanceTransforms);
+    uint32_t getNumInstances() const
+    {
+        return mNumInstances;
+    }
+    // LOD selection for the CPU submission paths : update() and updateInstances() draw every submesh with its
+    // coarsest LOD whose simplification error projects under the threshold, in pixels of a viewport of the given
+    // height. A LOD changes only once its error crosses the threshold by kLodHysteresis, so the camera resting at
+    // a LOD distance does not make it pop. The command buffer of an image must then be re-recorded after every
+    // update(). Instanced submeshes use the LOD of their nearest instance, the GPU-driven path draws LOD 0.
+    void enableLods(float viewportHeight);
+    bool isLodEnabled() const
+    {
+        return mUseLods;
+    }
+    void setLodThreshold(float pixels)
+    {
+        mLodThreshold = pixels;
+    }
+    float getLodThreshold() const
+    {
+        return mLodThreshold;
+    }
+    uint32_t getLod(uint32_t submeshIndex) const
+    {
+        return mSubmeshLods[submeshIndex];
+    }
+    // Triangles of the recorded draws, at the current LODs or at LOD 0
+    uint64_t getNumDrawnTriangles(bool fullDetail = false) const;
+
+    // Nodes moved with setNodeTransformation() since the last call are applied first, by update() and
+    // updateInstances() alike
     void update(int currentImage, const glm::mat4 transformation);
 
+    // Skinned models (isSkinned()) are uploaded with VertexLayout_Full : the bind pose stays in a buffer of its own
+    // and the vertex buffer (and position stream) is rewritten by the pass every frame, before the draws, see
+    // SkinningPass. Culling and LODs use the bounds of the bind pose. Call once after construction.
+    void enableSkinning(SkinningPass* pSkinningPass);
+    bool isSkinningEnabled() const
+    {
+        return mSkinningPass != nullptr;
+    }
+    // Bone matrices of the image, pose sampled from getSkeleton()
+    void updatePose(int currentImage, const model::AnimationPose& pose);
+    // Before any draw of the image, outside of a rendering
+    void recordSkinning(VkCommandBuffer commandBuffer, uint32_t imageIndex) const;
+
     const BufferAndMemory& getVertexBuffer() const
     {
         return mVertexBuffer;
@@ -35,37 +201,126 @@ class VulkanModel : public model::Model
     {
         return mVertexSize;
     }
+    VertexLayout getVertexLayout() const
+    {
+        return mVertexLayout;
+    }
+
+    // Shader permutation required by the material of the given submesh
+    ShaderPermutationKey getPermutationKey(uint32_t meshIndex) const;
+
+    // Unique permutations used by this model, the base permutation (no material feature) is always first
+    std::vector<ShaderPermutationKey> getPermutationKeys() const;
 
   protected:
     Texture* allocTexture2D() override;
     void destroyTexture(Texture* pTexture) override;
     void populateBuffer(std::vector<Vertex>& vertices) override;
-    void populateBufferSkinned(std::vector<Vertex>& vertices) override
-    {
-        throw std::runtime_error("Skinned meshes not supported yet.");
-    };
+    void populateBufferSkinned(std::vector<SkinnedVertex>& vertices) override;
 
   private:
+    // Permutation of the model render path before any material feature
+    ShaderPermutationKey getBaseKey() const;
+    ShaderPermutationKey getDepthPermutationKey(uint32_t meshIndex) const;
+    bool isAlphaTested(uint32_t meshIndex) const;
+
     void updateModelDesc(ModelDesc& desc);
-    void updateAlignedMeshesArray();
-    void createBuffers(std::vector<Vertex>& vertices);
+    void createMaterialDescriptorSets(GraphicsPipelineV2* pPipeline);
+    void recordCommandBufferPushConstants(VkCommandBuffer commandBuffer, const PipelineVariantMap& pipelines,
+                                          uint32_t imageIndex);
+    void loadBaked(const std::string& bakedPath);
+    // Device local copy of pData into target, now or queued into mPendingBuffers with deferred uploads
+    void uploadBuffer(BufferAndMemory& target, const void* pData, VkDeviceSize size);
+    // Uploads GPU-ready buffers from host memory, mAlignedMeshes gives their layout. pPositions is ignored without
+    // position stream.
+    void createBuffers(const void* pVertices, size_t vertexBufferSize, const void* pIndices, size_t indexBufferSize,
+                       const void* pPositions, size_t positionBufferSize);
+
+    // Uploaded transformations of the submeshes include the dequantization of their vertices, and so must the
+    // culling volumes read by the GPU with them
+    void applyDequantization(std::vector<glm::mat4>& transformations) const;
+    glm::vec4 getStreamSphere(uint32_t meshIndex, const glm::vec4& sphere) const;
+    glm::vec4 getStreamPoint(uint32_t meshIndex, const glm::vec3& point) const;
+    // Culling volumes of the GPU draw records. Skinned vertices leave the bind pose the spheres and normal cones were
+    // computed from, so the draws of a skinned model are never culled.
+    glm::vec4 getDrawSphere(uint32_t meshIndex, const glm::vec4& sphere) const;
+    glm::vec4 getDrawCone(const glm::vec4& cone) const;
+
+    // Mesh transformations of the moved nodes, the culling spheres of their submeshes follow
+    void updateTransformations();
+    glm::vec4 getCullingSphere(uint32_t meshIndex) const;
+
+    // gl_InstanceIndex of the first instance, see enableInstancing
+    uint32_t getFirstInstance() const
+    {
+        return mMaxInstances > 0 ? static_cast<uint32_t>(m_Meshes.size()) : 0;
+    }
+
+    // Pixels covered by a unit of mesh space at the point of the sphere nearest to the camera
+    float getPixelsPerUnit(const glm::mat4& wvp, const glm::vec4& sphere) const;
+    void selectLod(uint32_t submeshIndex, float pixelsPerUnit);
+    const model::MeshLod& getDrawLod(uint32_t submeshIndex) const
+    {
+        return m_Meshes[submeshIndex].Lods[mSubmeshLods[submeshIndex]];
+    }
+
+    // Submesh indices sorted by permutation so every pipeline is bound only once, culled ones are skipped.
+    // depthOnly sorts by depth permutation and skips the alpha tested submeshes.
+    std::vector<uint32_t> getDrawOrder(std::vector<uint64_t>& keys, bool depthOnly = false) const;
+    GraphicsPipelineV2* findPipeline(const PipelineVariantMap& pipelines, uint64_t key, uint32_t submeshIndex) const;
 
     VulkanCore* mVulkanCore;
 
     BufferAndMemory mVertexBuffer;
     BufferAndMemory mIndexBuffer;
+    BufferAndMemory mPositionBuffer; // optional position stream, ranges in mAlignedMeshes
+    uint32_t mPositionSize{0};       // bytes per position, 0 without position stream
     std::vector<BufferAndMemory> mUniformBuffers;
     std::vector<std::vector<VkDescriptorSet>> mDescriptorSets;
-    uint32_t mVertexSize{0}; // sizeof(Vertex) or sizeof(SkinnedVertex)
+    VertexLayout mVertexLayout;
+    bool mUsePositionStream;
+    uint32_t mVertexSize{0}; // sizeof(Vertex), sizeof(QuantizedVertex) or sizeof(SkinnedVertex)
+    std::vector<model::VertexDequantization> mDequantizations; // per submesh, empty for VertexLayout_Full
+    std::vector<BindlessDrawConstants> mBindlessDraws; // per submesh, filled by registerBindless
+    std::vector<BindlessDrawConstants> mDepthDraws;    // per submesh, on the position stream geometry
+
+    bool mUsePushConstants{false};
+    bool mUseGpuDriven{false};
+    std::vector<ModelDrawConstants> mDrawConstants; // per submesh, WVP written by update()
+
+    bool mUseCpuCulling{false};
+    FrustumCuller mCuller;                   // one sphere per submesh, after Transformation
+    std::vector<uint32_t> mVisibleSubmeshes; // written by update()
+    std::vector<uint32_t> mMovedSubmeshes;   // by updateTransformations(), kept for its capacity
+    float mCullTimeUs{0.0f};
+
+    uint32_t mMaxInstances{0}; // 0 : instancing disabled
+    uint32_t mNumInstances{1}; // drawn by every submesh draw
 
-    struct VulkanMeshEntry
+    bool mUseLods{false};
+    float mLodViewportHeight{0.0f};
+    float mLodThreshold{1.0f};          // max projected error, in pixels
+    std::vector<uint32_t> mSubmeshLods; // index in Lods of every submesh, written by update()
+
+    // Index offset of the submesh in the model index buffer, in indices of its own size
+    uint32_t getIndexOffset(uint32_t meshIndex) const
     {
-        size_t VertexBufferOffset{0};
-        size_t IndexBufferOffset{0};
-        size_t VertexBufferRange{0};
-        size_t IndexBufferRange{0};
-    };
-    std::vector<VulkanMeshEntry> mAlignedMeshes;
+        return static_cast<uint32_t>(mAlignedMeshes[meshIndex].IndexBufferOffset / mAlignedMeshes[meshIndex].IndexSize);
+    }
+    std::vector<model::MeshBufferRange> mAlignedMeshes;
+
+    // Deferred uploads, see streamUploads
+    bool mDeferUploads{false};
+    std::vector<PendingBufferUpload> mPendingBuffers;
+    std::vector<PendingTextureUpload> mPendingTextures;
+
+    // Skinning, see enableSkinning
+    SkinningPass* mSkinningPass{nullptr};
+    BufferAndMemory mBindPoseBuffer;                       // vertices of the bind pose, laid out as mVertexBuffer
+    BufferAndMemory mInfluenceBuffer;                      // GpuBoneInfluence per vertex, in model vertex order
+    std::vector<BufferAndMemory> mBoneBuffers;             // per swapchain image, one matrix per bone
+    std::vector<VkDescriptorSet> mSkinningSets;            // per swapchain image
+    std::vector<GpuSkinningConstants> mSkinningDispatches; // per submesh
 };
 
 } // namespace VulkanCore
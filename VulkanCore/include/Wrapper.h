@@ -11,6 +11,10 @@ VkSemaphore CreateSemaphore(VkDevice Device);
 void imageMemBarrier(VkCommandBuffer CmdBuf, VkImage Image, VkFormat Format, VkImageLayout OldLayout,
                      VkImageLayout NewLayout, int32_t layerCount);
 
+// Whole buffer barrier, e.g. compute writes -> indirect command reads
+void bufferMemBarrier(VkCommandBuffer CmdBuf, VkBuffer Buffer, VkAccessFlags SrcAccess, VkAccessFlags DstAccess,
+                      VkPipelineStageFlags SrcStage, VkPipelineStageFlags DstStage);
+
 VkImageView createImageView(VkDevice Device, VkImage Image, VkFormat Format, VkImageAspectFlags AspectFlags,
                             bool isCubemap);
 
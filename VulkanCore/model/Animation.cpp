@@ -0,0 +1,129 @@
+#include "Animation.h"
+#include "AnimationSampler.h"
+#include "ParallelFor.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace VulkanCore::model
+{
+
+namespace
+{
+
+glm::vec3 interpolate(const glm::vec3& a, const glm::vec3& b, float t)
+{
+    return glm::mix(a, b, t);
+}
+
+glm::quat interpolate(const glm::quat& a, const glm::quat& b, float t)
+{
+    return glm::slerp(a, b, t);
+}
+
+// Value of the track at time, clamped to its first and last keys
+template <typename T> T sampleTrack(const std::vector<AnimationKey<T>>& keys, float time, const T& defaultValue)
+{
+    if (keys.empty())
+    {
+        return defaultValue;
+    }
+    if (keys.size() == 1 || time <= keys.front().Time)
+    {
+        return keys.front().Value;
+    }
+
+    // First key after time
+    auto next = std::upper_bound(keys.begin(), keys.end(), time,
+                                 [](float t, const AnimationKey<T>& key) { return t < key.Time; });
+    if (next == keys.end())
+    {
+        return keys.back().Value;
+    }
+    auto previous = next - 1;
+    float span = next->Time - previous->Time;
+    float t = span > 0.0f ? (time - previous->Time) / span : 0.0f;
+    return interpolate(previous->Value, next->Value, t);
+}
+
+} // namespace
+
+glm::vec3 SampleTrack(const std::vector<AnimationKey<glm::vec3>>& keys, float time, const glm::vec3& defaultValue)
+{
+    return sampleTrack(keys, time, defaultValue);
+}
+
+glm::quat SampleTrack(const std::vector<AnimationKey<glm::quat>>& keys, float time, const glm::quat& defaultValue)
+{
+    return sampleTrack(keys, time, defaultValue);
+}
+
+void SampleAnimation(const Skeleton& skeleton, const AnimationClip* pClip, float time, AnimationPose& pose)
+{
+    size_t numNodes = skeleton.Nodes.size();
+    pose.NodeTransforms.resize(numNodes);
+    pose.BoneMatrices.resize(skeleton.BoneNodes.size());
+
+    // Local transformations : bind pose, replaced by the channels of the clip
+    for (size_t node = 0; node < numNodes; node++)
+    {
+        pose.NodeTransforms[node] = skeleton.Nodes[node].Transformation;
+    }
+    if (pClip && !pClip->Channels.empty())
+    {
+        if (pClip->Duration > 0.0f)
+        {
+            time = std::fmod(time, pClip->Duration);
+            time = time < 0.0f ? time + pClip->Duration : time;
+        }
+        for (const AnimationChannel& channel : pClip->Channels)
+        {
+            glm::vec3 position = sampleTrack(channel.Positions, time, glm::vec3(0.0f));
+            glm::quat rotation = sampleTrack(channel.Rotations, time, glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+            glm::vec3 scale = sampleTrack(channel.Scales, time, glm::vec3(1.0f));
+
+            // translation * rotation * scale
+            glm::mat4& local = pose.NodeTransforms[channel.Node];
+            local = glm::mat4_cast(glm::normalize(rotation));
+            local[0] *= scale.x;
+            local[1] *= scale.y;
+            local[2] *= scale.z;
+            local[3] = glm::vec4(position, 1.0f);
+        }
+    }
+
+    // Model space, parents come first
+    for (size_t node = 0; node < numNodes; node++)
+    {
+        int32_t parent = skeleton.Nodes[node].Parent;
+        if (parent >= 0)
+        {
+            pose.NodeTransforms[node] = pose.NodeTransforms[parent] * pose.NodeTransforms[node];
+        }
+    }
+
+    for (size_t bone = 0; bone < skeleton.BoneNodes.size(); bone++)
+    {
+        pose.BoneMatrices[bone] = pose.NodeTransforms[skeleton.BoneNodes[bone]] * skeleton.BoneOffsets[bone];
+    }
+}
+
+void SampleAnimations(std::span<const AnimationJob> jobs, WorkerPool& pool)
+{
+    pool.parallelFor(
+        static_cast<uint32_t>(jobs.size()),
+        [&](uint32_t jobIndex)
+        {
+            const AnimationJob& job = jobs[jobIndex];
+            if (job.pSoaClip)
+            {
+                SampleAnimationSoa(*job.pSkeleton, job.pSoaClip, job.Time, *job.pPose);
+            }
+            else
+            {
+                SampleAnimation(*job.pSkeleton, job.pClip, job.Time, *job.pPose);
+            }
+        });
+}
+
+} // namespace VulkanCore::model
@@ -0,0 +1,394 @@
+#include "AnimationSampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define ANIMATION_SAMPLER_X86
+#include <immintrin.h>
+#endif
+
+namespace VulkanCore::model
+{
+
+namespace
+{
+
+// Interpolation factor of the normalized lerp closest to a slerp of the same factor, from
+// https://zeux.io/2015/07/23/approximating-slerp/. d is the cosine of the angle between the rotations, positive.
+float slerpFactor(float d, float t)
+{
+    float a = 1.0904f + d * (-3.2452f + d * (3.55645f - d * 1.43519f));
+    float b = 0.848013f + d * (-1.06021f + d * 0.215638f);
+    float k = a * (t - 0.5f) * (t - 0.5f) + b;
+    return t + t * (t - 0.5f) * (t - 1.0f) * k;
+}
+
+// Lanes of the group between frames a and b to the local transformations of its animated nodes
+void sampleGroupScalar(const SoaTransform& a, const SoaTransform& b, float alpha, uint32_t laneMask,
+                       glm::mat4* pLocals)
+{
+    for (uint32_t lane = 0; lane < kAnimationLanes; lane++)
+    {
+        if ((laneMask & (1u << lane)) == 0)
+        {
+            continue;
+        }
+        float tx = a.TranslationX[lane] + (b.TranslationX[lane] - a.TranslationX[lane]) * alpha;
+        float ty = a.TranslationY[lane] + (b.TranslationY[lane] - a.TranslationY[lane]) * alpha;
+        float tz = a.TranslationZ[lane] + (b.TranslationZ[lane] - a.TranslationZ[lane]) * alpha;
+        float sx = a.ScaleX[lane] + (b.ScaleX[lane] - a.ScaleX[lane]) * alpha;
+        float sy = a.ScaleY[lane] + (b.ScaleY[lane] - a.ScaleY[lane]) * alpha;
+        float sz = a.ScaleZ[lane] + (b.ScaleZ[lane] - a.ScaleZ[lane]) * alpha;
+
+        float d = a.RotationX[lane] * b.RotationX[lane] + a.RotationY[lane] * b.RotationY[lane] +
+                  a.RotationZ[lane] * b.RotationZ[lane] + a.RotationW[lane] * b.RotationW[lane];
+        float t = slerpFactor(d, alpha);
+        float x = a.RotationX[lane] + (b.RotationX[lane] - a.RotationX[lane]) * t;
+        float y = a.RotationY[lane] + (b.RotationY[lane] - a.RotationY[lane]) * t;
+        float z = a.RotationZ[lane] + (b.RotationZ[lane] - a.RotationZ[lane]) * t;
+        float w = a.RotationW[lane] + (b.RotationW[lane] - a.RotationW[lane]) * t;
+        float invLength = 1.0f / std::sqrt(x * x + y * y + z * z + w * w);
+        x *= invLength;
+        y *= invLength;
+        z *= invLength;
+        w *= invLength;
+
+        // mat4_cast(rotation) * scale, as in SampleAnimation()
+        float xx = x * x, yy = y * y, zz = z * z;
+        float xy = x * y, xz = x * z, yz = y * z;
+        float wx = w * x, wy = w * y, wz = w * z;
+        glm::mat4& local = pLocals[lane];
+        local[0] = glm::vec4((1.0f - 2.0f * (yy + zz)) * sx, 2.0f * (xy + wz) * sx, 2.0f * (xz - wy) * sx, 0.0f);
+        local[1] = glm::vec4(2.0f * (xy - wz) * sy, (1.0f - 2.0f * (xx + zz)) * sy, 2.0f * (yz + wx) * sy, 0.0f);
+        local[2] = glm::vec4(2.0f * (xz + wy) * sz, 2.0f * (yz - wx) * sz, (1.0f - 2.0f * (xx + yy)) * sz, 0.0f);
+        local[3] = glm::vec4(tx, ty, tz, 1.0f);
+    }
+}
+
+#ifdef ANIMATION_SAMPLER_X86
+
+__attribute__((target("sse2"))) inline __m128 lerpSSE(__m128 a, __m128 b, __m128 t)
+{
+    return _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), t));
+}
+
+// sampleGroupScalar() on the 4 lanes at once, the matrices are transposed to one register per column to be stored
+__attribute__((target("sse2"))) void sampleGroupSSE(const SoaTransform& a, const SoaTransform& b, float alpha,
+                                                    uint32_t laneMask, glm::mat4* pLocals)
+{
+    __m128 t = _mm_set1_ps(alpha);
+    __m128 tx = lerpSSE(_mm_load_ps(a.TranslationX), _mm_load_ps(b.TranslationX), t);
+    __m128 ty = lerpSSE(_mm_load_ps(a.TranslationY), _mm_load_ps(b.TranslationY), t);
+    __m128 tz = lerpSSE(_mm_load_ps(a.TranslationZ), _mm_load_ps(b.TranslationZ), t);
+    __m128 sx = lerpSSE(_mm_load_ps(a.ScaleX), _mm_load_ps(b.ScaleX), t);
+    __m128 sy = lerpSSE(_mm_load_ps(a.ScaleY), _mm_load_ps(b.ScaleY), t);
+    __m128 sz = lerpSSE(_mm_load_ps(a.ScaleZ), _mm_load_ps(b.ScaleZ), t);
+
+    __m128 x0 = _mm_load_ps(a.RotationX), y0 = _mm_load_ps(a.RotationY);
+    __m128 z0 = _mm_load_ps(a.RotationZ), w0 = _mm_load_ps(a.RotationW);
+    __m128 x1 = _mm_load_ps(b.RotationX), y1 = _mm_load_ps(b.RotationY);
+    __m128 z1 = _mm_load_ps(b.RotationZ), w1 = _mm_load_ps(b.RotationW);
+    __m128 d = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x0, x1), _mm_mul_ps(y0, y1)), _mm_mul_ps(z0, z1)),
+                          _mm_mul_ps(w0, w1));
+
+    // slerpFactor()
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 one = _mm_set1_ps(1.0f);
+    __m128 k0 = _mm_sub_ps(_mm_set1_ps(3.55645f), _mm_mul_ps(d, _mm_set1_ps(1.43519f)));
+    k0 = _mm_add_ps(_mm_set1_ps(-3.2452f), _mm_mul_ps(d, k0));
+    k0 = _mm_add_ps(_mm_set1_ps(1.0904f), _mm_mul_ps(d, k0));
+    __m128 k1 = _mm_add_ps(_mm_set1_ps(-1.06021f), _mm_mul_ps(d, _mm_set1_ps(0.215638f)));
+    k1 = _mm_add_ps(_mm_set1_ps(0.848013f), _mm_mul_ps(d, k1));
+    __m128 centered = _mm_sub_ps(t, half);
+    __m128 k = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(k0, centered), centered), k1);
+    t = _mm_add_ps(t, _mm_mul_ps(_mm_mul_ps(_mm_mul_ps(t, centered), _mm_sub_ps(t, one)), k));
+
+    __m128 x = lerpSSE(x0, x1, t);
+    __m128 y = lerpSSE(y0, y1, t);
+    __m128 z = lerpSSE(z0, z1, t);
+    __m128 w = lerpSSE(w0, w1, t);
+    __m128 length2 =
+        _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)), _mm_mul_ps(w, w));
+    __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(length2));
+    x = _mm_mul_ps(x, invLength);
+    y = _mm_mul_ps(y, invLength);
+    z = _mm_mul_ps(z, invLength);
+    w = _mm_mul_ps(w, invLength);
+
+    const __m128 two = _mm_set1_ps(2.0f);
+    __m128 xx = _mm_mul_ps(x, x), yy = _mm_mul_ps(y, y), zz = _mm_mul_ps(z, z);
+    __m128 xy = _mm_mul_ps(x, y), xz = _mm_mul_ps(x, z), yz = _mm_mul_ps(y, z);
+    __m128 wx = _mm_mul_ps(w, x), wy = _mm_mul_ps(w, y), wz = _mm_mul_ps(w, z);
+
+    __m128 column0[4] = {_mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(yy, zz))), sx),
+                         _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xy, wz)), sx),
+                         _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xz, wy)), sx), _mm_setzero_ps()};
+    __m128 column1[4] = {_mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(xy, wz)), sy),
+                         _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, zz))), sy),
+                         _mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(yz, wx)), sy), _mm_setzero_ps()};
+    __m128 column2[4] = {_mm_mul_ps(_mm_mul_ps(two, _mm_add_ps(xz, wy)), sz),
+                         _mm_mul_ps(_mm_mul_ps(two, _mm_sub_ps(yz, wx)), sz),
+                         _mm_mul_ps(_mm_sub_ps(one, _mm_mul_ps(two, _mm_add_ps(xx, yy))), sz), _mm_setzero_ps()};
+    __m128 column3[4] = {tx, ty, tz, one};
+    _MM_TRANSPOSE4_PS(column0[0], column0[1], column0[2], column0[3]);
+    _MM_TRANSPOSE4_PS(column1[0], column1[1], column1[2], column1[3]);
+    _MM_TRANSPOSE4_PS(column2[0], column2[1], column2[2], column2[3]);
+    _MM_TRANSPOSE4_PS(column3[0], column3[1], column3[2], column3[3]);
+
+    for (uint32_t lane = 0; lane < kAnimationLanes; lane++)
+    {
+        if (laneMask & (1u << lane))
+        {
+            float* pLocal = &pLocals[lane][0][0];
+            _mm_storeu_ps(pLocal, column0[lane]);
+            _mm_storeu_ps(pLocal + 4, column1[lane]);
+            _mm_storeu_ps(pLocal + 8, column2[lane]);
+            _mm_storeu_ps(pLocal + 12, column3[lane]);
+        }
+    }
+}
+
+// result = a * b, summed in the order of glm
+__attribute__((target("sse2"))) void multiplySSE(const glm::mat4& a, const glm::mat4& b, glm::mat4& result)
+{
+    const float* pA = &a[0][0];
+    const float* pB = &b[0][0];
+    __m128 a0 = _mm_loadu_ps(pA), a1 = _mm_loadu_ps(pA + 4), a2 = _mm_loadu_ps(pA + 8), a3 = _mm_loadu_ps(pA + 12);
+    float* pResult = &result[0][0];
+    for (uint32_t column = 0; column < 4; column++)
+    {
+        const float* pColumn = pB + column * 4;
+        __m128 sum = _mm_add_ps(_mm_mul_ps(a0, _mm_set1_ps(pColumn[0])), _mm_mul_ps(a1, _mm_set1_ps(pColumn[1])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a2, _mm_set1_ps(pColumn[2])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(a3, _mm_set1_ps(pColumn[3])));
+        _mm_storeu_ps(pResult + column * 4, sum);
+    }
+}
+
+#endif
+
+void multiply(const glm::mat4& a, const glm::mat4& b, glm::mat4& result, AnimationPath path)
+{
+#ifdef ANIMATION_SAMPLER_X86
+    if (path == AnimationPath_SSE)
+    {
+        multiplySSE(a, b, result);
+        return;
+    }
+#endif
+    result = a * b;
+}
+
+} // namespace
+
+const char* GetAnimationPathName(AnimationPath path)
+{
+    switch (path)
+    {
+    case AnimationPath_Scalar:
+        return "Scalar";
+    case AnimationPath_SSE:
+        return "SSE";
+    default:
+        return "Unknown";
+    }
+}
+
+bool IsAnimationPathSupported(AnimationPath path)
+{
+    switch (path)
+    {
+    case AnimationPath_Scalar:
+        return true;
+#ifdef ANIMATION_SAMPLER_X86
+    case AnimationPath_SSE:
+        return __builtin_cpu_supports("sse2");
+#endif
+    default:
+        return false;
+    }
+}
+
+AnimationPath GetBestAnimationPath()
+{
+    static const AnimationPath bestPath =
+        IsAnimationPathSupported(AnimationPath_SSE) ? AnimationPath_SSE : AnimationPath_Scalar;
+    return bestPath;
+}
+
+SoaAnimationClip BuildSoaAnimationClip(const AnimationClip& clip, uint32_t numNodes)
+{
+    SoaAnimationClip soaClip;
+    soaClip.Name = clip.Name;
+    soaClip.Duration = clip.Duration;
+    soaClip.NumNodes = numNodes;
+
+    // Channel of every node, the last one wins like in SampleAnimation(), and the closest keys of the clip
+    std::vector<const AnimationChannel*> nodeChannels(numNodes, nullptr);
+    float keySpacing = 0.0f;
+    auto updateKeySpacing = [&](const auto& keys)
+    {
+        for (size_t key = 1; key < keys.size(); key++)
+        {
+            float spacing = keys[key].Time - keys[key - 1].Time;
+            keySpacing = spacing > 0.0f && (keySpacing == 0.0f || spacing < keySpacing) ? spacing : keySpacing;
+        }
+    };
+    for (const AnimationChannel& channel : clip.Channels)
+    {
+        if (channel.Node >= numNodes)
+        {
+            throw std::runtime_error("Animation " + clip.Name + " has a channel of a node out of the skeleton");
+        }
+        nodeChannels[channel.Node] = &channel;
+        updateKeySpacing(channel.Positions);
+        updateKeySpacing(channel.Rotations);
+        updateKeySpacing(channel.Scales);
+    }
+
+    for (uint32_t firstNode = 0; firstNode < numNodes; firstNode += kAnimationLanes)
+    {
+        SoaNodeGroup group = {firstNode, 0};
+        for (uint32_t lane = 0; lane < kAnimationLanes && firstNode + lane < numNodes; lane++)
+        {
+            group.LaneMask |= nodeChannels[firstNode + lane] ? 1u << lane : 0u;
+        }
+        if (group.LaneMask != 0)
+        {
+            soaClip.Groups.push_back(group);
+        }
+    }
+
+    // Frames evenly spaced from 0 to the duration, rounded to a whole number of intervals
+    soaClip.NumFrames = 1;
+    if (clip.Duration > 0.0f && keySpacing > 0.0f)
+    {
+        float sampleRate = std::min(1.0f / keySpacing, kMaxAnimationSampleRate);
+        soaClip.NumFrames = static_cast<uint32_t>(std::ceil(clip.Duration * sampleRate - 1e-3f)) + 1;
+        soaClip.SampleRate = static_cast<float>(soaClip.NumFrames - 1) / clip.Duration;
+    }
+
+    size_t numGroups = soaClip.Groups.size();
+    soaClip.Frames.resize(soaClip.NumFrames * numGroups);
+    for (uint32_t frame = 0; frame < soaClip.NumFrames; frame++)
+    {
+        float time = soaClip.SampleRate > 0.0f ? frame / soaClip.SampleRate : 0.0f;
+        for (size_t groupIndex = 0; groupIndex < numGroups; groupIndex++)
+        {
+            const SoaNodeGroup& group = soaClip.Groups[groupIndex];
+            SoaTransform& transform = soaClip.Frames[frame * numGroups + groupIndex];
+            for (uint32_t lane = 0; lane < kAnimationLanes; lane++)
+            {
+                // Lanes without channel are never stored, they keep the defaults
+                const AnimationChannel* pChannel =
+                    (group.LaneMask & (1u << lane)) ? nodeChannels[group.FirstNode + lane] : nullptr;
+                glm::vec3 position(0.0f);
+                glm::quat rotation(1.0f, 0.0f, 0.0f, 0.0f);
+                glm::vec3 scale(1.0f);
+                if (pChannel)
+                {
+                    position = SampleTrack(pChannel->Positions, time, position);
+                    rotation = glm::normalize(SampleTrack(pChannel->Rotations, time, rotation));
+                    scale = SampleTrack(pChannel->Scales, time, scale);
+                }
+
+                // q and -q are the same rotation, the one closest to the previous frame interpolates the short way
+                if (frame > 0)
+                {
+                    const SoaTransform& previous = soaClip.Frames[(frame - 1) * numGroups + groupIndex];
+                    float dot = previous.RotationX[lane] * rotation.x + previous.RotationY[lane] * rotation.y +
+                                previous.RotationZ[lane] * rotation.z + previous.RotationW[lane] * rotation.w;
+                    if (dot < 0.0f)
+                    {
+                        rotation = glm::quat(-rotation.w, -rotation.x, -rotation.y, -rotation.z);
+                    }
+                }
+
+                transform.TranslationX[lane] = position.x;
+                transform.TranslationY[lane] = position.y;
+                transform.TranslationZ[lane] = position.z;
+                transform.RotationX[lane] = rotation.x;
+                transform.RotationY[lane] = rotation.y;
+                transform.RotationZ[lane] = rotation.z;
+                transform.RotationW[lane] = rotation.w;
+                transform.ScaleX[lane] = scale.x;
+                transform.ScaleY[lane] = scale.y;
+                transform.ScaleZ[lane] = scale.z;
+            }
+        }
+    }
+    return soaClip;
+}
+
+void SampleAnimationSoa(const Skeleton& skeleton, const SoaAnimationClip* pClip, float time, AnimationPose& pose,
+                        AnimationPath path)
+{
+    if (!IsAnimationPathSupported(path))
+    {
+        throw std::runtime_error(std::string("Animation path not supported by this CPU: ") +
+                                 GetAnimationPathName(path));
+    }
+    size_t numNodes = skeleton.Nodes.size();
+    if (pClip && pClip->NumNodes != numNodes)
+    {
+        throw std::runtime_error("Animation " + pClip->Name + " was built for another skeleton");
+    }
+    pose.NodeTransforms.resize(numNodes);
+    pose.BoneMatrices.resize(skeleton.BoneNodes.size());
+
+    for (size_t node = 0; node < numNodes; node++)
+    {
+        pose.NodeTransforms[node] = skeleton.Nodes[node].Transformation;
+    }
+    if (pClip && !pClip->Groups.empty())
+    {
+        if (pClip->Duration > 0.0f)
+        {
+            time = std::fmod(time, pClip->Duration);
+            time = time < 0.0f ? time + pClip->Duration : time;
+        }
+
+        // The same two frames for every node
+        float position = std::max(time * pClip->SampleRate, 0.0f);
+        uint32_t frame0 = std::min(static_cast<uint32_t>(position), pClip->NumFrames - 1);
+        uint32_t frame1 = std::min(frame0 + 1, pClip->NumFrames - 1);
+        float alpha = std::clamp(position - static_cast<float>(frame0), 0.0f, 1.0f);
+
+        size_t numGroups = pClip->Groups.size();
+        const SoaTransform* pFrame0 = pClip->Frames.data() + frame0 * numGroups;
+        const SoaTransform* pFrame1 = pClip->Frames.data() + frame1 * numGroups;
+        for (size_t groupIndex = 0; groupIndex < numGroups; groupIndex++)
+        {
+            const SoaNodeGroup& group = pClip->Groups[groupIndex];
+            glm::mat4* pLocals = pose.NodeTransforms.data() + group.FirstNode;
+#ifdef ANIMATION_SAMPLER_X86
+            if (path == AnimationPath_SSE)
+            {
+                sampleGroupSSE(pFrame0[groupIndex], pFrame1[groupIndex], alpha, group.LaneMask, pLocals);
+                continue;
+            }
+#endif
+            sampleGroupScalar(pFrame0[groupIndex], pFrame1[groupIndex], alpha, group.LaneMask, pLocals);
+        }
+    }
+
+    // Model space in a single forward pass, parents come first
+    for (size_t node = 0; node < numNodes; node++)
+    {
+        int32_t parent = skeleton.Nodes[node].Parent;
+        if (parent >= 0)
+        {
+            multiply(pose.NodeTransforms[parent], pose.NodeTransforms[node], pose.NodeTransforms[node], path);
+        }
+    }
+
+    for (size_t bone = 0; bone < skeleton.BoneNodes.size(); bone++)
+    {
+        multiply(pose.NodeTransforms[skeleton.BoneNodes[bone]], skeleton.BoneOffsets[bone], pose.BoneMatrices[bone],
+                 path);
+    }
+}
+
+} // namespace VulkanCore::model
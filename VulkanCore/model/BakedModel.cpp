@@ -0,0 +1,448 @@
+#include "BakedModel.h"
+#include "MeshBuffers.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "Model.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace VulkanCore::model
+{
+
+static_assert(sizeof(BakedMaterial::TexturePaths) / sizeof(uint32_t) == TEX_TYPE_ORM,
+              "BakedMaterial must reference every texture type loaded from a file");
+
+namespace
+{
+
+uint64_t alignSection(uint64_t offset)
+{
+    return (offset + kBakedSectionAlignment - 1) & ~(kBakedSectionAlignment - 1);
+}
+
+std::string getDirectory(const std::string& path)
+{
+    size_t slashIndex = path.find_last_of("/\\");
+    return slashIndex != std::string::npos ? path.substr(0, slashIndex) : ".";
+}
+
+// [first, first + count) within [0, size), without overflow
+bool isRangeValid(uint64_t first, uint64_t count, uint64_t size)
+{
+    return first <= size && count <= size - first;
+}
+
+} // namespace
+
+std::string GetBakedModelPath(const std::string& modelPath)
+{
+    size_t dotIndex = modelPath.find_last_of('.');
+    size_t slashIndex = modelPath.find_last_of("/\\");
+    if (dotIndex == std::string::npos || (slashIndex != std::string::npos && dotIndex < slashIndex))
+    {
+        return modelPath + kBakedModelExtension;
+    }
+    return modelPath.substr(0, dotIndex) + kBakedModelExtension;
+}
+
+bool IsBakedModelPath(const std::string& path)
+{
+    std::string extension = kBakedModelExtension;
+    return path.size() > extension.size() &&
+           path.compare(path.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+void BakedModelWriter::addSection(BakedSection section, const void* pData, size_t size)
+{
+    mSections[section] = {pData, size};
+}
+
+uint32_t BakedModelWriter::addString(const std::string& string)
+{
+    uint32_t offset = static_cast<uint32_t>(mStrings.size());
+    mStrings.append(string);
+    mStrings.push_back('\0');
+    return offset;
+}
+
+void BakedModelWriter::write(const std::string& path, BakedModelHeader header) const
+{
+    Section sections[BakedSection_Count];
+    std::copy(std::begin(mSections), std::end(mSections), sections);
+    sections[BakedSection_Strings] = {mStrings.data(), mStrings.size()};
+
+    uint64_t offset = alignSection(sizeof(BakedModelHeader));
+    for (uint32_t section = 0; section < BakedSection_Count; section++)
+    {
+        header.Sections[section] = {offset, sections[section].mSize};
+        offset = alignSection(offset + sections[section].mSize);
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        throw std::runtime_error("Failed to open " + path + " for writing");
+    }
+
+    static const char kPadding[kBakedSectionAlignment] = {};
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    uint64_t position = sizeof(header);
+    for (uint32_t section = 0; section < BakedSection_Count; section++)
+    {
+        file.write(kPadding, static_cast<std::streamsize>(header.Sections[section].Offset - position));
+        file.write(static_cast<const char*>(sections[section].mpData),
+                   static_cast<std::streamsize>(sections[section].mSize));
+        position = header.Sections[section].Offset + sections[section].mSize;
+    }
+
+    if (!file)
+    {
+        throw std::runtime_error("Failed to write " + path);
+    }
+}
+
+BakedModelFile::BakedModelFile(const std::string& path) : mPath(path)
+{
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Failed to open baked model " + path);
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0 || static_cast<size_t>(fileStat.st_size) < sizeof(BakedModelHeader))
+    {
+        close(fd);
+        throw std::runtime_error("Baked model " + path + " is truncated");
+    }
+
+    mSize = static_cast<size_t>(fileStat.st_size);
+    void* pData = mmap(nullptr, mSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // the mapping keeps the file alive
+    if (pData == MAP_FAILED)
+    {
+        throw std::runtime_error("Failed to map baked model " + path);
+    }
+    mpData = static_cast<const uint8_t*>(pData);
+    // Read once front to back by the upload, start the reads now
+    madvise(pData, mSize, MADV_WILLNEED);
+
+    const BakedModelHeader& header = getHeader();
+    std::string error;
+    if (header.Magic != kBakedModelMagic)
+    {
+        error = "is not a baked model";
+    }
+    else if (header.Version != kBakedModelVersion)
+    {
+        error = "has version " + std::to_string(header.Version) + ", expected " + std::to_string(kBakedModelVersion) +
+                " : bake it again";
+    }
+    for (uint32_t section = 0; section < BakedSection_Count && error.empty(); section++)
+    {
+        const BakedSectionEntry& entry = header.Sections[section];
+        if (entry.Offset % kBakedSectionAlignment != 0 || entry.Offset > mSize || entry.Size > mSize - entry.Offset)
+        {
+            error = "has an invalid section " + std::to_string(section);
+        }
+    }
+    if (!error.empty())
+    {
+        munmap(pData, mSize);
+        mpData = nullptr;
+        throw std::runtime_error("Baked model " + path + " " + error);
+    }
+}
+
+BakedModelFile::~BakedModelFile()
+{
+    if (mpData)
+    {
+        munmap(const_cast<uint8_t*>(mpData), mSize);
+    }
+}
+
+std::string BakedModelFile::getString(uint32_t offset) const
+{
+    if (offset == kBakedNoString)
+    {
+        return {};
+    }
+    std::span<const uint8_t> strings = getBytes(BakedSection_Strings);
+    const char* pBegin = reinterpret_cast<const char*>(strings.data()) + offset;
+    const char* pEnd =
+        offset < strings.size() ? static_cast<const char*>(memchr(pBegin, '\0', strings.size() - offset)) : nullptr;
+    if (!pEnd)
+    {
+        throw std::runtime_error("Baked model " + mPath + " has an invalid string offset");
+    }
+    return std::string(pBegin, pEnd);
+}
+
+void ValidateBakedModel(const BakedModelFile& file, uint32_t sourceVertexSize)
+{
+    const BakedModelHeader& header = file.getHeader();
+    std::span<const BakedMesh> meshes = file.getSection<BakedMesh>(BakedSection_Meshes);
+    std::span<const MeshLod> lods = file.getSection<MeshLod>(BakedSection_Lods);
+    std::span<const Meshlet> meshlets = file.getSection<Meshlet>(BakedSection_Meshlets);
+    std::span<const uint32_t> meshletVertices = file.getSection<uint32_t>(BakedSection_MeshletVertices);
+    std::span<const uint32_t> meshletTriangles = file.getSection<uint32_t>(BakedSection_MeshletTriangles);
+    size_t numMaterials = file.getSection<BakedMaterial>(BakedSection_Materials).size();
+    size_t numNodes = file.getSection<BakedNode>(BakedSection_Nodes).size();
+
+    bool hasSource = (header.Flags & BakedModelFlag_SourceGeometry) != 0;
+    uint64_t numSourceVertices = 0;
+    uint64_t numSourceIndices = 0;
+    if (hasSource)
+    {
+        if (sourceVertexSize == 0 || file.getBytes(BakedSection_SourceVertices).size() % sourceVertexSize != 0)
+        {
+            throw std::runtime_error("Baked model " + file.getPath() + " has source vertices of another size");
+        }
+        numSourceVertices = file.getBytes(BakedSection_SourceVertices).size() / sourceVertexSize;
+        numSourceIndices = file.getSection<uint32_t>(BakedSection_SourceIndices).size();
+    }
+
+    bool hasBuffers = (header.Flags & BakedModelFlag_GpuBuffers) != 0;
+    bool hasPositions = (header.Flags & BakedModelFlag_PositionStream) != 0;
+    std::span<const MeshBufferRange> ranges = file.getSection<MeshBufferRange>(BakedSection_Ranges);
+    if (hasBuffers &&
+        (ranges.size() != meshes.size() ||
+         ((header.Flags & BakedModelFlag_Quantized) != 0 &&
+          file.getSection<VertexDequantization>(BakedSection_Dequantizations).size() != meshes.size())))
+    {
+        throw std::runtime_error("Baked model " + file.getPath() + " has inconsistent buffers");
+    }
+    uint64_t vertexBytes = file.getBytes(BakedSection_Vertices).size();
+    uint64_t indexBytes = file.getBytes(BakedSection_Indices).size();
+    uint64_t positionBytes = file.getBytes(BakedSection_Positions).size();
+
+    for (size_t meshIndex = 0; meshIndex < meshes.size(); meshIndex++)
+    {
+        const BakedMesh& mesh = meshes[meshIndex];
+        bool valid = mesh.NumLods > 0 && isRangeValid(mesh.FirstLod, mesh.NumLods, lods.size()) &&
+                     mesh.NumIndices <= mesh.NumLodIndices &&
+                     isRangeValid(mesh.FirstMeshlet, mesh.NumMeshlets, meshlets.size()) &&
+                     mesh.MaterialIndex >= -1 && mesh.MaterialIndex < static_cast<int64_t>(numMaterials) &&
+                     mesh.Node >= -1 && mesh.Node < static_cast<int64_t>(numNodes);
+        for (uint32_t lod = 0; valid && lod < mesh.NumLods; lod++)
+        {
+            const MeshLod& meshLod = lods[mesh.FirstLod + lod];
+            valid = isRangeValid(meshLod.FirstIndex, meshLod.NumIndices, mesh.NumLodIndices);
+        }
+        for (uint32_t meshlet = 0; valid && meshlet < mesh.NumMeshlets; meshlet++)
+        {
+            const Meshlet& cluster = meshlets[mesh.FirstMeshlet + meshlet];
+            uint64_t numClusterIndices = static_cast<uint64_t>(cluster.TriangleCount) * 3;
+            valid = isRangeValid(cluster.FirstIndex, numClusterIndices, mesh.NumIndices) &&
+                    isRangeValid(cluster.VertexOffset, cluster.VertexCount, meshletVertices.size()) &&
+                    isRangeValid(cluster.TriangleOffset, cluster.TriangleCount, meshletTriangles.size());
+        }
+        if (valid && hasSource)
+        {
+            valid = isRangeValid(mesh.BaseVertex, mesh.NumVertices, numSourceVertices) &&
+                    isRangeValid(mesh.BaseIndex, mesh.NumLodIndices, numSourceIndices);
+        }
+        if (valid && hasBuffers)
+        {
+            const MeshBufferRange& range = ranges[meshIndex];
+            valid = (range.IndexSize == sizeof(uint16_t) || range.IndexSize == sizeof(uint32_t)) &&
+                    (range.IndexSize == sizeof(uint32_t) || mesh.NumVertices <= kMaxIndex16Vertices) &&
+                    isRangeValid(range.VertexBufferOffset, range.VertexBufferRange, vertexBytes) &&
+                    static_cast<uint64_t>(mesh.NumVertices) * header.VertexSize <= range.VertexBufferRange &&
+                    isRangeValid(range.IndexBufferOffset, range.IndexBufferRange, indexBytes) &&
+                    static_cast<uint64_t>(mesh.NumLodIndices) * range.IndexSize <= range.IndexBufferRange;
+            if (valid && hasPositions)
+            {
+                valid = isRangeValid(range.PositionBufferOffset, range.PositionBufferRange, positionBytes) &&
+                        static_cast<uint64_t>(mesh.NumVertices) * header.PositionSize <= range.PositionBufferRange;
+            }
+        }
+        if (!valid)
+        {
+            throw std::runtime_error("Baked model " + file.getPath() + " has an invalid mesh " +
+                                     std::to_string(meshIndex));
+        }
+    }
+}
+
+void Model::writeBaked(const std::string& bakedPath, const MeshBuffers* pBuffers,
+                       const std::vector<Vertex>* pVertices) const
+{
+    BakedModelWriter writer;
+
+    std::vector<BakedMesh> meshes(m_Meshes.size());
+    std::vector<MeshLod> lods;
+    for (size_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
+    {
+        const BasicMeshEntry& entry = m_Meshes[meshIndex];
+        BakedMesh& mesh = meshes[meshIndex];
+        mesh.BaseVertex = entry.BaseVertex;
+        mesh.BaseIndex = entry.BaseIndex;
+        mesh.NumVertices = entry.NumVertices;
+        mesh.NumIndices = entry.NumIndices;
+        mesh.ValidFaces = entry.ValidFaces;
+        mesh.MaterialIndex = entry.MaterialIndex;
+        mesh.NumLodIndices = entry.NumLodIndices;
+        mesh.FirstLod = static_cast<uint32_t>(lods.size());
+        mesh.NumLods = static_cast<uint32_t>(entry.Lods.size());
+        mesh.FirstMeshlet = entry.FirstMeshlet;
+        mesh.NumMeshlets = entry.NumMeshlets;
+        mesh.Node = entry.Node;
+        mesh.Transformation = entry.Transformation;
+        mesh.BoundsMin = glm::vec4(entry.BoundsMin, 0.0f);
+        mesh.BoundsMax = glm::vec4(entry.BoundsMax, 0.0f);
+        mesh.BoundingSphere = entry.BoundingSphere;
+        lods.insert(lods.end(), entry.Lods.begin(), entry.Lods.end());
+    }
+
+    std::vector<BakedNode> nodes(m_SceneGraph.getNumNodes());
+    for (uint32_t node = 0; node < nodes.size(); node++)
+    {
+        nodes[node].Parent = m_SceneGraph.getParent(node);
+        nodes[node].Name = writer.addString(m_SceneGraph.getName(node));
+        nodes[node].Transformation = m_SceneGraph.getLocalTransform(node);
+    }
+
+    std::vector<BakedMaterial> materials(m_Materials.size());
+    for (size_t materialIndex = 0; materialIndex < m_Materials.size(); materialIndex++)
+    {
+        const CoreMaterial& source = m_Materials[materialIndex];
+        BakedMaterial& material = materials[materialIndex];
+        material.Name = writer.addString(source.m_name);
+        material.MaterialType = static_cast<uint32_t>(source.m_materialType);
+        material.IsPBR = source.m_isPBR ? 1 : 0;
+        material.TransparencyFactor = source.m_transparencyFactor;
+        material.AlphaTest = source.m_alphaTest;
+        material.Ior = source.m_ior;
+        material.AmbientColor = source.mAmbientColor;
+        material.DiffuseColor = source.mDiffuseColor;
+        material.SpecularColor = source.mSpecularColor;
+        material.EmissiveColor = source.mEmissiveColor;
+        material.ReflectiveColor = source.mReflectiveColor;
+        for (uint32_t texType = 0; texType < TEX_TYPE_ORM; texType++)
+        {
+            const std::string& texturePath = source.mTexturePaths[texType];
+            material.TexturePaths[texType] = texturePath.empty() ? kBakedNoString : writer.addString(texturePath);
+        }
+    }
+
+    writer.addSection(BakedSection_Meshes, meshes);
+    writer.addSection(BakedSection_Lods, lods);
+    writer.addSection(BakedSection_Nodes, nodes);
+    writer.addSection(BakedSection_Materials, materials);
+    writer.addSection(BakedSection_Meshlets, m_Meshlets);
+    writer.addSection(BakedSection_MeshletVertices, m_MeshletVertices);
+    writer.addSection(BakedSection_MeshletTriangles, m_MeshletTriangles);
+
+    BakedModelHeader header;
+    header.NumIndices = static_cast<uint32_t>(m_Indices.size());
+    if (pBuffers)
+    {
+        writer.addSection(BakedSection_Ranges, pBuffers->Ranges);
+        writer.addSection(BakedSection_Dequantizations, pBuffers->Dequantizations);
+        writer.addSection(BakedSection_Vertices, pBuffers->Vertices);
+        writer.addSection(BakedSection_Indices, pBuffers->Indices);
+        writer.addSection(BakedSection_Positions, pBuffers->Positions);
+        header.Flags |= BakedModelFlag_GpuBuffers;
+        header.Flags |= pBuffers->Dequantizations.empty() ? 0 : BakedModelFlag_Quantized;
+        header.Flags |= pBuffers->PositionSize > 0 ? BakedModelFlag_PositionStream : 0;
+        header.VertexSize = pBuffers->VertexSize;
+        header.PositionSize = pBuffers->PositionSize;
+    }
+    if (pVertices)
+    {
+        writer.addSection(BakedSection_SourceVertices, *pVertices);
+        writer.addSection(BakedSection_SourceIndices, m_Indices);
+        header.Flags |= BakedModelFlag_SourceGeometry;
+    }
+    writer.write(bakedPath, header);
+}
+
+void Model::readBaked(const BakedModelFile& file, const std::string& modelPath)
+{
+    ValidateBakedModel(file, sizeof(Vertex));
+
+    std::span<const BakedMesh> meshes = file.getSection<BakedMesh>(BakedSection_Meshes);
+    std::span<const MeshLod> lods = file.getSection<MeshLod>(BakedSection_Lods);
+    std::span<const Meshlet> meshlets = file.getSection<Meshlet>(BakedSection_Meshlets);
+    std::span<const BakedMaterial> materials = file.getSection<BakedMaterial>(BakedSection_Materials);
+    std::span<const BakedNode> nodes = file.getSection<BakedNode>(BakedSection_Nodes);
+
+    m_SceneGraph.clear();
+    for (uint32_t node = 0; node < nodes.size(); node++)
+    {
+        if (nodes[node].Parent < -1 || nodes[node].Parent >= static_cast<int32_t>(node))
+        {
+            throw std::runtime_error("Baked model " + file.getPath() + " has an invalid node " + std::to_string(node));
+        }
+        m_SceneGraph.addNode(nodes[node].Parent, nodes[node].Transformation, file.getString(nodes[node].Name));
+    }
+
+    m_Meshes.resize(meshes.size());
+    for (size_t meshIndex = 0; meshIndex < meshes.size(); meshIndex++)
+    {
+        const BakedMesh& mesh = meshes[meshIndex];
+        BasicMeshEntry& entry = m_Meshes[meshIndex];
+        entry.BaseVertex = mesh.BaseVertex;
+        entry.BaseIndex = mesh.BaseIndex;
+        entry.NumVertices = mesh.NumVertices;
+        entry.NumIndices = mesh.NumIndices;
+        entry.ValidFaces = mesh.ValidFaces;
+        entry.MaterialIndex = mesh.MaterialIndex;
+        entry.Node = mesh.Node;
+        entry.Transformation = mesh.Transformation;
+        entry.BoundsMin = glm::vec3(mesh.BoundsMin);
+        entry.BoundsMax = glm::vec3(mesh.BoundsMax);
+        entry.BoundingSphere = mesh.BoundingSphere;
+        entry.NumLodIndices = mesh.NumLodIndices;
+        entry.Lods.assign(lods.begin() + mesh.FirstLod, lods.begin() + mesh.FirstLod + mesh.NumLods);
+        entry.FirstMeshlet = mesh.FirstMeshlet;
+        entry.NumMeshlets = mesh.NumMeshlets;
+    }
+
+    std::span<const uint32_t> meshletVertices = file.getSection<uint32_t>(BakedSection_MeshletVertices);
+    std::span<const uint32_t> meshletTriangles = file.getSection<uint32_t>(BakedSection_MeshletTriangles);
+    m_Meshlets.assign(meshlets.begin(), meshlets.end());
+    m_MeshletVertices.assign(meshletVertices.begin(), meshletVertices.end());
+    m_MeshletTriangles.assign(meshletTriangles.begin(), meshletTriangles.end());
+
+    // Textures are referenced relative to the model
+    std::string dir = getDirectory(modelPath);
+    m_Materials.resize(materials.size());
+    for (size_t materialIndex = 0; materialIndex < materials.size(); materialIndex++)
+    {
+        const BakedMaterial& source = materials[materialIndex];
+        CoreMaterial& material = m_Materials[materialIndex];
+        material.m_name = file.getString(source.Name);
+        material.m_materialType = static_cast<int>(source.MaterialType);
+        material.m_isPBR = source.IsPBR != 0;
+        material.m_transparencyFactor = source.TransparencyFactor;
+        material.m_alphaTest = source.AlphaTest;
+        material.m_ior = source.Ior;
+        material.mAmbientColor = source.AmbientColor;
+        material.mDiffuseColor = source.DiffuseColor;
+        material.mSpecularColor = source.SpecularColor;
+        material.mEmissiveColor = source.EmissiveColor;
+        material.mReflectiveColor = source.ReflectiveColor;
+        for (uint32_t texType = 0; texType < TEX_TYPE_ORM; texType++)
+        {
+            material.mTexturePaths[texType] = file.getString(source.TexturePaths[texType]);
+            if (!material.mTexturePaths[texType].empty())
+            {
+                loadTextureFromFile(dir, material.mTexturePaths[texType], static_cast<int32_t>(materialIndex),
+                                    static_cast<TEXTURE_TYPE>(texType), false);
+            }
+        }
+    }
+}
+
+} // namespace VulkanCore::model
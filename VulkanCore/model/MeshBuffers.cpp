@@ -0,0 +1,175 @@
+#include "MeshBuffers.h"
+#include "Model.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <numeric>
+
+namespace VulkanCore::model
+{
+
+namespace
+{
+
+uint64_t alignUp(uint64_t offset, uint64_t alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Zero initialized heap buffers, so the bytes between the ranges are deterministic in a baked model
+class HostMeshBufferWriter : public MeshBufferWriter
+{
+  public:
+    MeshBufferTargets map(uint64_t vertexBufferSize, uint64_t indexBufferSize, uint64_t positionBufferSize) override
+    {
+        mVertices.resize(vertexBufferSize);
+        mIndices.resize(indexBufferSize);
+        mPositions.resize(positionBufferSize);
+        return {mVertices.data(), mIndices.data(), mPositions.data()};
+    }
+
+    std::vector<uint8_t> mVertices;
+    std::vector<uint8_t> mIndices;
+    std::vector<uint8_t> mPositions;
+};
+
+} // namespace
+
+MeshBuffers Model::buildMeshBuffers(const std::vector<Vertex>& vertices, bool quantize, bool positionStream,
+                                    uint64_t alignment) const
+{
+    HostMeshBufferWriter writer;
+    MeshBuffers buffers = writeMeshBuffers(vertices, quantize, positionStream, alignment, writer);
+    buffers.Vertices = std::move(writer.mVertices);
+    buffers.Indices = std::move(writer.mIndices);
+    buffers.Positions = std::move(writer.mPositions);
+    return buffers;
+}
+
+MeshBuffers Model::writeMeshBuffers(const std::vector<Vertex>& vertices, bool quantize, bool positionStream,
+                                    uint64_t alignment, MeshBufferWriter& writer) const
+{
+    MeshBuffers buffers;
+    buffers.VertexSize = quantize ? sizeof(QuantizedVertex) : sizeof(Vertex);
+    if (positionStream)
+    {
+        buffers.PositionSize = quantize ? 4 * sizeof(uint16_t) : sizeof(glm::vec3);
+    }
+
+    // Ranges. VB ranges also start on a whole vertex, so the push constant path can address them by vertex offset,
+    // same for the position stream.
+    uint64_t vertexAlignment = std::lcm(alignment, static_cast<uint64_t>(buffers.VertexSize));
+    uint64_t positionAlignment =
+        buffers.PositionSize > 0 ? std::lcm(alignment, static_cast<uint64_t>(buffers.PositionSize)) : alignment;
+
+    buffers.Ranges.resize(m_Meshes.size());
+    uint64_t baseVertexOffset = 0;
+    uint64_t baseIndexOffset = 0;
+    uint64_t basePositionOffset = 0;
+    for (size_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
+    {
+        const BasicMeshEntry& mesh = m_Meshes[meshIndex];
+        MeshBufferRange& range = buffers.Ranges[meshIndex];
+
+        range.VertexBufferOffset = baseVertexOffset;
+        range.VertexBufferRange = static_cast<uint64_t>(mesh.NumVertices) * buffers.VertexSize;
+        baseVertexOffset = alignUp(baseVertexOffset + range.VertexBufferRange, vertexAlignment);
+
+        // The IB range covers every LOD. 16-bit indices are read two per word, the range is rounded up to whole
+        // words.
+        range.IndexSize = mesh.NumVertices <= kMaxIndex16Vertices ? sizeof(uint16_t) : sizeof(uint32_t);
+        range.IndexBufferOffset = baseIndexOffset;
+        range.IndexBufferRange = alignUp(static_cast<uint64_t>(mesh.NumLodIndices) * range.IndexSize, sizeof(uint32_t));
+        baseIndexOffset = alignUp(baseIndexOffset + range.IndexBufferRange, alignment);
+
+        range.PositionBufferOffset = basePositionOffset;
+        range.PositionBufferRange = static_cast<uint64_t>(mesh.NumVertices) * buffers.PositionSize;
+        basePositionOffset = alignUp(basePositionOffset + range.PositionBufferRange, positionAlignment);
+    }
+
+    // Last buffer = offset + range
+    const MeshBufferRange& last = buffers.Ranges.back();
+    uint64_t vertexBufferSize = last.VertexBufferOffset + last.VertexBufferRange;
+    uint64_t indexBufferSize = last.IndexBufferOffset + last.IndexBufferRange;
+    uint64_t positionBufferSize = last.PositionBufferOffset + last.PositionBufferRange;
+    MeshBufferTargets targets = writer.map(vertexBufferSize, indexBufferSize, positionBufferSize);
+
+    if (quantize)
+    {
+        buffers.Dequantizations.resize(m_Meshes.size());
+    }
+
+    size_t index16Count = 0;
+    for (size_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
+    {
+        const BasicMeshEntry& mesh = m_Meshes[meshIndex];
+        const MeshBufferRange& range = buffers.Ranges[meshIndex];
+
+        // Vertices and positions
+        uint8_t* pDstVertex = targets.pVertices + range.VertexBufferOffset;
+        uint8_t* pDstPosition = targets.pPositions + range.PositionBufferOffset;
+        if (quantize)
+        {
+            VertexDequantization& dequantization = buffers.Dequantizations[meshIndex];
+            dequantization = ComputeVertexDequantization(mesh.BoundsMin, mesh.BoundsMax);
+            for (uint32_t i = mesh.BaseVertex; i < mesh.BaseVertex + mesh.NumVertices; i++)
+            {
+                const Vertex& vertex = vertices[i];
+                QuantizedVertex quantized = QuantizeVertex(dequantization, vertex.pos, vertex.texCoord, vertex.normal,
+                                                           vertex.tangent, vertex.bitangent);
+                memcpy(pDstVertex, &quantized, sizeof(quantized));
+                pDstVertex += sizeof(quantized);
+                if (positionStream)
+                {
+                    memcpy(pDstPosition, quantized.Position, sizeof(quantized.Position));
+                    pDstPosition += buffers.PositionSize;
+                }
+            }
+        }
+        else
+        {
+            memcpy(pDstVertex, vertices.data() + mesh.BaseVertex, range.VertexBufferRange);
+            for (uint32_t i = mesh.BaseVertex; positionStream && i < mesh.BaseVertex + mesh.NumVertices; i++)
+            {
+                memcpy(pDstPosition, &vertices[i].pos, sizeof(glm::vec3));
+                pDstPosition += buffers.PositionSize;
+            }
+        }
+
+        // Indices, narrowed to 16 bits when the submesh allows it
+        const uint32_t* pSrcIndex = m_Indices.data() + mesh.BaseIndex;
+        uint8_t* pDstIndex = targets.pIndices + range.IndexBufferOffset;
+        if (range.IndexSize == sizeof(uint16_t))
+        {
+            uint16_t* pDstIndex16 = std::copy(pSrcIndex, pSrcIndex + mesh.NumLodIndices,
+                                              reinterpret_cast<uint16_t*>(pDstIndex));
+            if (mesh.NumLodIndices % 2 != 0)
+            {
+                *pDstIndex16 = 0; // the padding of the last word
+            }
+            index16Count += mesh.NumLodIndices;
+        }
+        else
+        {
+            memcpy(pDstIndex, pSrcIndex, mesh.NumLodIndices * sizeof(uint32_t));
+        }
+    }
+
+    if (quantize)
+    {
+        std::cout << "Quantized " << vertices.size() << " vertices : " << sizeof(QuantizedVertex)
+                  << " bytes instead of " << sizeof(Vertex) << ", "
+                  << vertices.size() * (sizeof(Vertex) - sizeof(QuantizedVertex)) / 1024 << " KB saved" << std::endl;
+    }
+    std::cout << "Index buffer : " << indexBufferSize / 1024 << " KB, " << index16Count << " of "
+              << m_Indices.size() << " indices in 16 bits" << std::endl;
+    if (positionStream)
+    {
+        std::cout << "Position stream : " << buffers.PositionSize << " bytes per vertex, "
+                  << positionBufferSize / 1024 << " KB" << std::endl;
+    }
+    return buffers;
+}
+
+} // namespace VulkanCore::model
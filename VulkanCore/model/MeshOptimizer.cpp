@@ -0,0 +1,531 @@
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <glm/glm.hpp>
+
+namespace VulkanCore::model
+{
+
+namespace
+{
+
+constexpr uint32_t kInvalidIndex = UINT32_MAX;
+constexpr uint32_t kFetchLineSize = 64;
+
+// Forsyth, "Linear-Speed Vertex Cache Optimisation" : LRU cache model and score weights
+constexpr uint32_t kForsythCacheSize = 32;
+constexpr float kCacheDecayPower = 1.5f;
+constexpr float kLastTriangleScore = 0.75f;
+constexpr float kValenceBoostScale = 2.0f;
+constexpr float kValenceBoostPower = 0.5f;
+
+// Misses of a FIFO cache of cacheSize entries
+class FifoCache
+{
+  public:
+    explicit FifoCache(uint32_t cacheSize) : mEntries(cacheSize, kInvalidIndex), mNext{0}
+    {
+    }
+
+    // Returns true on a miss, the entry is then inserted
+    bool access(uint32_t entry)
+    {
+        if (std::find(mEntries.begin(), mEntries.end(), entry) != mEntries.end())
+        {
+            return false;
+        }
+        mEntries[mNext] = entry;
+        mNext = (mNext + 1) % mEntries.size();
+        return true;
+    }
+
+  private:
+    std::vector<uint32_t> mEntries;
+    size_t mNext;
+};
+
+float getVertexScore(int32_t cachePosition, uint32_t liveTriangles)
+{
+    if (liveTriangles == 0)
+    {
+        return -1.0f; // no triangle left to emit
+    }
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            // Used by the last triangle : fixed score so the strip does not turn back on itself
+            score = kLastTriangleScore;
+        }
+        else
+        {
+            float scale = 1.0f / (kForsythCacheSize - 3);
+            score = std::pow(1.0f - (cachePosition - 3) * scale, kCacheDecayPower);
+        }
+    }
+
+    // Vertices with few triangles left are finished first so they leave the cache for good
+    return score + kValenceBoostScale * std::pow(static_cast<float>(liveTriangles), -kValenceBoostPower);
+}
+
+struct VertexHash
+{
+    const uint8_t* mVertices;
+    uint32_t mVertexSize;
+
+    size_t operator()(uint32_t vertex) const
+    {
+        // FNV-1a over the vertex bytes
+        const uint8_t* pBytes = mVertices + static_cast<size_t>(vertex) * mVertexSize;
+        uint64_t hash = 14695981039346656037ull;
+        for (uint32_t i = 0; i < mVertexSize; i++)
+        {
+            hash = (hash ^ pBytes[i]) * 1099511628211ull;
+        }
+        return static_cast<size_t>(hash);
+    }
+};
+
+struct VertexEqual
+{
+    const uint8_t* mVertices;
+    uint32_t mVertexSize;
+
+    bool operator()(uint32_t a, uint32_t b) const
+    {
+        return std::memcmp(mVertices + static_cast<size_t>(a) * mVertexSize,
+                           mVertices + static_cast<size_t>(b) * mVertexSize, mVertexSize) == 0;
+    }
+};
+
+// Moves the vertices to their new slot and rewrites the indices, remap[vertex] is kInvalidIndex for
+// dropped vertices
+void applyVertexRemap(std::vector<uint32_t>& indices, uint8_t* vertices, uint32_t numVertices, uint32_t vertexSize,
+                      const std::vector<uint32_t>& remap, uint32_t newNumVertices)
+{
+    std::vector<uint8_t> remapped(static_cast<size_t>(newNumVertices) * vertexSize);
+    for (uint32_t vertex = 0; vertex < numVertices; vertex++)
+    {
+        if (remap[vertex] != kInvalidIndex)
+        {
+            std::memcpy(remapped.data() + static_cast<size_t>(remap[vertex]) * vertexSize,
+                        vertices + static_cast<size_t>(vertex) * vertexSize, vertexSize);
+        }
+    }
+    std::memcpy(vertices, remapped.data(), remapped.size());
+
+    for (uint32_t& index : indices)
+    {
+        index = remap[index];
+    }
+}
+
+glm::vec3 getPosition(const uint8_t* vertices, uint32_t vertexSize, uint32_t positionOffset, uint32_t vertex)
+{
+    float position[3];
+    std::memcpy(position, vertices + static_cast<size_t>(vertex) * vertexSize + positionOffset, sizeof(position));
+    return glm::vec3(position[0], position[1], position[2]);
+}
+
+float getACMR(const std::vector<uint32_t>& indices)
+{
+    FifoCache cache(kVertexCacheSize);
+    uint32_t misses = 0;
+    for (uint32_t index : indices)
+    {
+        misses += cache.access(index) ? 1 : 0;
+    }
+    return indices.empty() ? 0.0f : static_cast<float>(misses) / (indices.size() / 3);
+}
+
+} // namespace
+
+const char* GetMeshOptimizerStageName(MeshOptimizerStage stage)
+{
+    switch (stage)
+    {
+    case MeshOptimizerStage_Input:
+        return "Input";
+    case MeshOptimizerStage_Deduplicate:
+        return "Deduplicate";
+    case MeshOptimizerStage_VertexCache:
+        return "Vertex cache";
+    case MeshOptimizerStage_Overdraw:
+        return "Overdraw";
+    case MeshOptimizerStage_VertexFetch:
+        return "Vertex fetch";
+    default:
+        return "Unknown";
+    }
+}
+
+float MeshOptimizerStats::getACMR() const
+{
+    return mNumIndices ? static_cast<float>(mTransformedVertices) / (mNumIndices / 3) : 0.0f;
+}
+
+float MeshOptimizerStats::getATVR() const
+{
+    return mNumVertices ? static_cast<float>(mTransformedVertices) / mNumVertices : 0.0f;
+}
+
+float MeshOptimizerStats::getOverfetch() const
+{
+    uint64_t vertexBytes = static_cast<uint64_t>(mNumVertices) * mVertexSize;
+    return vertexBytes ? static_cast<float>(mBytesFetched) / vertexBytes : 0.0f;
+}
+
+MeshOptimizerStats& MeshOptimizerStats::operator+=(const MeshOptimizerStats& other)
+{
+    mNumIndices += other.mNumIndices;
+    mNumVertices += other.mNumVertices;
+    mTransformedVertices += other.mTransformedVertices;
+    mBytesFetched += other.mBytesFetched;
+    mVertexSize = other.mVertexSize;
+    return *this;
+}
+
+MeshOptimizerStats AnalyzeMesh(const std::vector<uint32_t>& indices, uint32_t numVertices, uint32_t vertexSize)
+{
+    MeshOptimizerStats stats;
+    stats.mNumIndices = static_cast<uint32_t>(indices.size());
+    stats.mNumVertices = numVertices;
+    stats.mVertexSize = vertexSize;
+
+    FifoCache vertexCache(kVertexCacheSize);
+    FifoCache fetchCache(kFetchCacheLines);
+    for (uint32_t index : indices)
+    {
+        if (!vertexCache.access(index))
+        {
+            continue;
+        }
+        stats.mTransformedVertices++;
+
+        // Every line the transformed vertex touches
+        uint64_t firstByte = static_cast<uint64_t>(index) * vertexSize;
+        uint64_t lastByte = firstByte + vertexSize - 1;
+        for (uint64_t line = firstByte / kFetchLineSize; line <= lastByte / kFetchLineSize; line++)
+        {
+            stats.mBytesFetched += fetchCache.access(static_cast<uint32_t>(line)) ? kFetchLineSize : 0;
+        }
+    }
+    return stats;
+}
+
+uint32_t OptimizeMesh(std::vector<uint32_t>& indices, uint8_t* vertices, uint32_t numVertices, uint32_t vertexSize,
+                      uint32_t positionOffset, MeshOptimizerReport* pReport)
+{
+    if (indices.size() % 3 != 0)
+    {
+        throw std::runtime_error("Mesh optimizer needs a triangle list, got " + std::to_string(indices.size()) +
+                                 " indices.");
+    }
+
+    auto report = [&](MeshOptimizerStage stage) {
+        if (pReport)
+        {
+            (*pReport)[stage] = AnalyzeMesh(indices, numVertices, vertexSize);
+        }
+    };
+
+    report(MeshOptimizerStage_Input);
+    numVertices = DeduplicateVertices(indices, vertices, numVertices, vertexSize);
+    report(MeshOptimizerStage_Deduplicate);
+    OptimizeVertexCache(indices, numVertices);
+    report(MeshOptimizerStage_VertexCache);
+    OptimizeOverdraw(indices, vertices, vertexSize, positionOffset);
+    report(MeshOptimizerStage_Overdraw);
+    numVertices = OptimizeVertexFetch(indices, vertices, numVertices, vertexSize);
+    report(MeshOptimizerStage_VertexFetch);
+
+    return numVertices;
+}
+
+uint32_t DeduplicateVertices(std::vector<uint32_t>& indices, uint8_t* vertices, uint32_t numVertices,
+                             uint32_t vertexSize)
+{
+    // First referenced copy of every unique vertex, in index order
+    std::unordered_map<uint32_t, uint32_t, VertexHash, VertexEqual> uniqueVertices(
+        numVertices, VertexHash{vertices, vertexSize}, VertexEqual{vertices, vertexSize});
+    std::vector<uint32_t> remap(numVertices, kInvalidIndex);
+    uint32_t numUnique = 0;
+    for (uint32_t index : indices)
+    {
+        if (remap[index] != kInvalidIndex)
+        {
+            continue;
+        }
+        auto [it, inserted] = uniqueVertices.emplace(index, numUnique);
+        remap[index] = it->second;
+        numUnique += inserted ? 1 : 0;
+    }
+
+    applyVertexRemap(indices, vertices, numVertices, vertexSize, remap, numUnique);
+    return numUnique;
+}
+
+void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t numVertices)
+{
+    uint32_t numTriangles = static_cast<uint32_t>(indices.size() / 3);
+    if (numTriangles == 0)
+    {
+        return;
+    }
+
+    // Triangles of every vertex, emitted ones are swapped past liveTriangles
+    std::vector<uint32_t> liveTriangles(numVertices, 0);
+    for (uint32_t index : indices)
+    {
+        liveTriangles[index]++;
+    }
+    std::vector<uint32_t> adjacencyOffsets(numVertices + 1, 0);
+    std::partial_sum(liveTriangles.begin(), liveTriangles.end(), adjacencyOffsets.begin() + 1);
+    std::vector<uint32_t> adjacency(indices.size());
+    std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+    for (uint32_t triangle = 0; triangle < numTriangles; triangle++)
+    {
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            adjacency[fill[indices[triangle * 3 + corner]]++] = triangle;
+        }
+    }
+
+    std::vector<int32_t> cachePositions(numVertices, -1);
+    std::vector<float> vertexScores(numVertices);
+    for (uint32_t vertex = 0; vertex < numVertices; vertex++)
+    {
+        vertexScores[vertex] = getVertexScore(-1, liveTriangles[vertex]);
+    }
+    // Triangle scores are summed from the current vertex scores when needed, never stored, so none goes stale
+    auto scoreLiveTriangles = [&](uint32_t vertex, uint32_t& bestTriangle, float& bestScore)
+    {
+        uint32_t* pBegin = &adjacency[adjacencyOffsets[vertex]];
+        for (uint32_t* pTri = pBegin; pTri != pBegin + liveTriangles[vertex]; pTri++)
+        {
+            const uint32_t* pCorners = &indices[*pTri * 3];
+            float score = vertexScores[pCorners[0]] + vertexScores[pCorners[1]] + vertexScores[pCorners[2]];
+            if (score > bestScore)
+            {
+                bestScore = score;
+                bestTriangle = *pTri;
+            }
+        }
+    };
+
+    std::vector<bool> emitted(numTriangles, false);
+    std::vector<uint32_t> cache;
+    std::vector<uint32_t> newCache;
+    cache.reserve(kForsythCacheSize + 3);
+    newCache.reserve(kForsythCacheSize + 3);
+    // Vertices of the emitted triangles, most recent last : a dead end restarts next to them
+    std::vector<uint32_t> deadEndStack;
+    deadEndStack.reserve(indices.size());
+
+    std::vector<uint32_t> optimized;
+    optimized.reserve(indices.size());
+    uint32_t bestTriangle = kInvalidIndex;
+    uint32_t scanCursor = 0;
+    for (uint32_t numEmitted = 0; numEmitted < numTriangles; numEmitted++)
+    {
+        if (bestTriangle == kInvalidIndex)
+        {
+            // Nothing left around the cache : the most recent vertex with triangles left, then the first triangle
+            // left in input order. Both only move forward, so dead ends stay linear overall.
+            float bestScore = -1.0f;
+            while (bestTriangle == kInvalidIndex && !deadEndStack.empty())
+            {
+                uint32_t vertex = deadEndStack.back();
+                deadEndStack.pop_back();
+                scoreLiveTriangles(vertex, bestTriangle, bestScore);
+            }
+            while (bestTriangle == kInvalidIndex)
+            {
+                if (!emitted[scanCursor])
+                {
+                    bestTriangle = scanCursor;
+                }
+                scanCursor++;
+            }
+        }
+
+        const uint32_t* pTriangle = &indices[bestTriangle * 3];
+        optimized.insert(optimized.end(), pTriangle, pTriangle + 3);
+        deadEndStack.insert(deadEndStack.end(), pTriangle, pTriangle + 3);
+        emitted[bestTriangle] = true;
+
+        // Remove the triangle from the adjacency of its vertices
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            uint32_t vertex = pTriangle[corner];
+            uint32_t* pBegin = &adjacency[adjacencyOffsets[vertex]];
+            uint32_t* pEnd = pBegin + liveTriangles[vertex];
+            std::iter_swap(std::find(pBegin, pEnd, bestTriangle), pEnd - 1);
+            liveTriangles[vertex]--;
+        }
+
+        // The triangle vertices move to the front of the LRU cache, the ones pushed past its end are evicted and
+        // rescored as out of the cache
+        newCache.assign(pTriangle, pTriangle + 3);
+        for (uint32_t vertex : cache)
+        {
+            if (vertex != pTriangle[0] && vertex != pTriangle[1] && vertex != pTriangle[2])
+            {
+                newCache.push_back(vertex);
+            }
+        }
+        for (size_t position = 0; position < newCache.size(); position++)
+        {
+            uint32_t vertex = newCache[position];
+            cachePositions[vertex] = position < kForsythCacheSize ? static_cast<int32_t>(position) : -1;
+            vertexScores[vertex] = getVertexScore(cachePositions[vertex], liveTriangles[vertex]);
+        }
+        if (newCache.size() > kForsythCacheSize)
+        {
+            newCache.resize(kForsythCacheSize);
+        }
+        std::swap(cache, newCache);
+
+        // The next triangle is the best one around the cache
+        bestTriangle = kInvalidIndex;
+        float bestScore = -1.0f;
+        for (uint32_t vertex : cache)
+        {
+            scoreLiveTriangles(vertex, bestTriangle, bestScore);
+        }
+    }
+
+    indices = std::move(optimized);
+}
+
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const uint8_t* vertices, uint32_t vertexSize,
+                      uint32_t positionOffset, float threshold)
+{
+    uint32_t numTriangles = static_cast<uint32_t>(indices.size() / 3);
+    if (numTriangles < 2)
+    {
+        return;
+    }
+
+    // Clusters start on the triangles missing the cache on all three vertices, reordering whole clusters keeps
+    // most of the vertex cache order (Sander et al., "Fast Triangle Reordering for Vertex Locality and Reduced
+    // Overdraw")
+    std::vector<uint32_t> clusterStarts;
+    FifoCache cache(kVertexCacheSize);
+    for (uint32_t triangle = 0; triangle < numTriangles; triangle++)
+    {
+        uint32_t misses = 0;
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            misses += cache.access(indices[triangle * 3 + corner]) ? 1 : 0;
+        }
+        if (triangle == 0 || misses == 3)
+        {
+            clusterStarts.push_back(triangle);
+        }
+    }
+    uint32_t numClusters = static_cast<uint32_t>(clusterStarts.size());
+    clusterStarts.push_back(numTriangles);
+    if (numClusters < 2)
+    {
+        return;
+    }
+
+    // Area weighted centroid and normal of every cluster
+    std::vector<glm::vec3> clusterCentroids(numClusters, glm::vec3(0.0f));
+    std::vector<glm::vec3> clusterNormals(numClusters, glm::vec3(0.0f));
+    glm::vec3 meshCentroid(0.0f);
+    float meshArea = 0.0f;
+    for (uint32_t cluster = 0; cluster < numClusters; cluster++)
+    {
+        float clusterArea = 0.0f;
+        for (uint32_t triangle = clusterStarts[cluster]; triangle < clusterStarts[cluster + 1]; triangle++)
+        {
+            glm::vec3 p0 = getPosition(vertices, vertexSize, positionOffset, indices[triangle * 3]);
+            glm::vec3 p1 = getPosition(vertices, vertexSize, positionOffset, indices[triangle * 3 + 1]);
+            glm::vec3 p2 = getPosition(vertices, vertexSize, positionOffset, indices[triangle * 3 + 2]);
+            glm::vec3 normal = glm::cross(p1 - p0, p2 - p0); // length : twice the area
+            float area = glm::length(normal);
+
+            clusterCentroids[cluster] += (p0 + p1 + p2) * (area / 3.0f);
+            clusterNormals[cluster] += normal;
+            clusterArea += area;
+        }
+        meshCentroid += clusterCentroids[cluster];
+        meshArea += clusterArea;
+        clusterCentroids[cluster] = clusterArea > 0.0f ? clusterCentroids[cluster] / clusterArea : glm::vec3(0.0f);
+        float normalLength = glm::length(clusterNormals[cluster]);
+        clusterNormals[cluster] = normalLength > 0.0f ? clusterNormals[cluster] / normalLength : glm::vec3(0.0f);
+    }
+    meshCentroid = meshArea > 0.0f ? meshCentroid / meshArea : glm::vec3(0.0f);
+
+    // Clusters facing away from the center are likely in front of the others from most view points
+    std::vector<float> sortKeys(numClusters);
+    for (uint32_t cluster = 0; cluster < numClusters; cluster++)
+    {
+        sortKeys[cluster] = glm::dot(clusterCentroids[cluster] - meshCentroid, clusterNormals[cluster]);
+    }
+    std::vector<uint32_t> clusterOrder(numClusters);
+    std::iota(clusterOrder.begin(), clusterOrder.end(), 0);
+    std::stable_sort(clusterOrder.begin(), clusterOrder.end(),
+                     [&sortKeys](uint32_t a, uint32_t b) { return sortKeys[a] > sortKeys[b]; });
+
+    std::vector<uint32_t> reordered;
+    reordered.reserve(indices.size());
+    for (uint32_t cluster : clusterOrder)
+    {
+        reordered.insert(reordered.end(), indices.begin() + clusterStarts[cluster] * 3,
+                         indices.begin() + clusterStarts[cluster + 1] * 3);
+    }
+
+    // Cluster boundaries can cost vertex cache hits, the order is kept only within the threshold
+    if (getACMR(reordered) <= getACMR(indices) * threshold)
+    {
+        indices = std::move(reordered);
+    }
+}
+
+uint32_t OptimizeVertexFetch(std::vector<uint32_t>& indices, uint8_t* vertices, uint32_t numVertices,
+                             uint32_t vertexSize)
+{
+    // Vertices in the order the indices first use them, so a draw streams through the vertex buffer
+    std::vector<uint32_t> remap(numVertices, kInvalidIndex);
+    uint32_t numUsed = 0;
+    for (uint32_t index : indices)
+    {
+        if (remap[index] == kInvalidIndex)
+        {
+            remap[index] = numUsed++;
+        }
+    }
+
+    applyVertexRemap(indices, vertices, numVertices, vertexSize, remap, numUsed);
+    return numUsed;
+}
+
+std::string FormatMeshOptimizerReport(const MeshOptimizerReport& report)
+{
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(3);
+    for (uint32_t stage = 0; stage < MeshOptimizerStage_Count; stage++)
+    {
+        const MeshOptimizerStats& stats = report[stage];
+        const char* pName = GetMeshOptimizerStageName(static_cast<MeshOptimizerStage>(stage));
+        stream << "  " << std::left << std::setw(14) << pName << std::right << " vertices: " << std::setw(8)
+               << stats.mNumVertices << "  ACMR: " << stats.getACMR() << "  ATVR: " << stats.getATVR()
+               << "  overfetch: " << stats.getOverfetch() << "\n";
+    }
+    return stream.str();
+}
+
+} // namespace VulkanCore::model
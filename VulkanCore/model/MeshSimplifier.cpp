@@ -0,0 +1,460 @@
+#include "MeshSimplifier.h"
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+#include <glm/glm.hpp>
+
+namespace VulkanCore::model
+{
+
+namespace
+{
+
+constexpr uint32_t kInvalidIndex = UINT32_MAX;
+constexpr float kBorderWeight = 10.0f;     // border planes against the surface ones, keeps open borders in place
+constexpr float kPassCollapseRatio = 0.25f; // max share of the candidates collapsed by a pass
+constexpr double kPassCostBound = 1.5;      // max cost of a pass relative to the cost at its collapse quota
+
+// Position of a vertex regarding collapses
+enum VertexKind : uint8_t
+{
+    VertexKind_Manifold = 0, // collapses to any neighbor
+    VertexKind_Border,       // open border, collapses along it
+    VertexKind_Seam,         // several vertices share the position, stays in place
+    VertexKind_Locked        // non-manifold or seam on a border, stays in place
+};
+
+// Sum of squared distances to planes : error(p) = p^T A p + 2 b.p + c, A symmetric. Divided by the summed
+// weight the error is a squared distance in mesh space.
+struct Quadric
+{
+    double mA00{0.0}, mA11{0.0}, mA22{0.0}, mA01{0.0}, mA02{0.0}, mA12{0.0};
+    double mB0{0.0}, mB1{0.0}, mB2{0.0};
+    double mC{0.0};
+    double mWeight{0.0};
+
+    // Plane dot(normal, p) + distance = 0, normal of unit length
+    void addPlane(const glm::vec3& normal, float distance, float weight)
+    {
+        double x = normal.x;
+        double y = normal.y;
+        double z = normal.z;
+        double d = distance;
+        mA00 += x * x * weight;
+        mA11 += y * y * weight;
+        mA22 += z * z * weight;
+        mA01 += x * y * weight;
+        mA02 += x * z * weight;
+        mA12 += y * z * weight;
+        mB0 += x * d * weight;
+        mB1 += y * d * weight;
+        mB2 += z * d * weight;
+        mC += d * d * weight;
+        mWeight += weight;
+    }
+
+    void add(const Quadric& other)
+    {
+        mA00 += other.mA00;
+        mA11 += other.mA11;
+        mA22 += other.mA22;
+        mA01 += other.mA01;
+        mA02 += other.mA02;
+        mA12 += other.mA12;
+        mB0 += other.mB0;
+        mB1 += other.mB1;
+        mB2 += other.mB2;
+        mC += other.mC;
+        mWeight += other.mWeight;
+    }
+
+    double evaluate(const glm::vec3& position) const
+    {
+        double x = position.x;
+        double y = position.y;
+        double z = position.z;
+        double error = mA00 * x * x + mA11 * y * y + mA22 * z * z;
+        error += 2.0 * (mA01 * x * y + mA02 * x * z + mA12 * y * z);
+        error += 2.0 * (mB0 * x + mB1 * y + mB2 * z) + mC;
+        return mWeight > 0.0 ? std::max(error, 0.0) / mWeight : 0.0;
+    }
+};
+
+struct Collapse
+{
+    uint32_t mFrom{kInvalidIndex}; // vertex removed, every index of it becomes mTo
+    uint32_t mTo{kInvalidIndex};
+    double mCost{DBL_MAX};
+};
+
+struct PositionHash
+{
+    const std::vector<glm::vec3>* mpPositions;
+
+    size_t operator()(uint32_t vertex) const
+    {
+        uint32_t bits[3];
+        std::memcpy(bits, &(*mpPositions)[vertex], sizeof(bits));
+        return (bits[0] * 73856093u) ^ (bits[1] * 19349663u) ^ (bits[2] * 83492791u);
+    }
+};
+
+struct PositionEqual
+{
+    const std::vector<glm::vec3>* mpPositions;
+
+    bool operator()(uint32_t a, uint32_t b) const
+    {
+        return std::memcmp(&(*mpPositions)[a], &(*mpPositions)[b], sizeof(glm::vec3)) == 0;
+    }
+};
+
+uint64_t getEdgeKey(uint32_t a, uint32_t b)
+{
+    return a < b ? (static_cast<uint64_t>(a) << 32) | b : (static_cast<uint64_t>(b) << 32) | a;
+}
+
+glm::vec3 getTriangleNormal(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2)
+{
+    return glm::cross(p1 - p0, p2 - p0); // length : twice the area
+}
+
+} // namespace
+
+std::vector<uint32_t> SimplifyMesh(const std::vector<uint32_t>& indices, const uint8_t* vertices, uint32_t numVertices,
+                                   uint32_t vertexSize, uint32_t positionOffset, uint32_t targetIndexCount,
+                                   float targetError, float* pResultError)
+{
+    if (indices.size() % 3 != 0)
+    {
+        throw std::runtime_error("Mesh simplifier needs a triangle list, got " + std::to_string(indices.size()) +
+                                 " indices.");
+    }
+    if (pResultError)
+    {
+        *pResultError = 0.0f;
+    }
+
+    std::vector<uint32_t> result = indices;
+    if (result.size() <= targetIndexCount)
+    {
+        return result;
+    }
+
+    std::vector<glm::vec3> positions(numVertices);
+    for (uint32_t vertex = 0; vertex < numVertices; vertex++)
+    {
+        std::memcpy(&positions[vertex], vertices + static_cast<size_t>(vertex) * vertexSize + positionOffset,
+                    sizeof(glm::vec3));
+    }
+
+    // Vertices sharing a position collapse together : positionIds maps every vertex to the first one at its
+    // position, wedgeCounts counts the vertices at a position
+    std::vector<uint32_t> positionIds(numVertices, kInvalidIndex);
+    std::vector<uint32_t> wedgeCounts(numVertices, 0);
+    std::unordered_map<uint32_t, uint32_t, PositionHash, PositionEqual> positionMap(
+        numVertices, PositionHash{&positions}, PositionEqual{&positions});
+    glm::vec3 boundsMin(FLT_MAX);
+    glm::vec3 boundsMax(-FLT_MAX);
+    for (uint32_t index : result)
+    {
+        if (positionIds[index] == kInvalidIndex)
+        {
+            auto [it, inserted] = positionMap.emplace(index, index);
+            positionIds[index] = it->second;
+            wedgeCounts[it->second]++;
+            boundsMin = glm::min(boundsMin, positions[index]);
+            boundsMax = glm::max(boundsMax, positions[index]);
+        }
+    }
+    glm::vec3 extent = boundsMax - boundsMin;
+    double errorLimit = static_cast<double>(targetError) * std::max({extent.x, extent.y, extent.z});
+    double maxCost = errorLimit * errorLimit;
+
+    // Surface planes weighted by area, plus planes perpendicular to the open borders
+    std::unordered_map<uint64_t, uint32_t> edgeTriangles;
+    std::vector<Quadric> quadrics(numVertices);
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            edgeTriangles[getEdgeKey(positionIds[result[i + corner]], positionIds[result[i + (corner + 1) % 3]])]++;
+        }
+    }
+    for (size_t i = 0; i < result.size(); i += 3)
+    {
+        const glm::vec3& p0 = positions[result[i]];
+        glm::vec3 normal = getTriangleNormal(p0, positions[result[i + 1]], positions[result[i + 2]]);
+        float length = glm::length(normal);
+        if (length == 0.0f)
+        {
+            continue;
+        }
+        normal /= length;
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            quadrics[positionIds[result[i + corner]]].addPlane(normal, -glm::dot(normal, p0), 0.5f * length);
+        }
+
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            uint32_t a = positionIds[result[i + corner]];
+            uint32_t b = positionIds[result[i + (corner + 1) % 3]];
+            if (edgeTriangles[getEdgeKey(a, b)] != 1)
+            {
+                continue;
+            }
+            glm::vec3 edge = positions[b] - positions[a];
+            glm::vec3 borderNormal = glm::cross(edge, normal);
+            float borderLength = glm::length(borderNormal);
+            if (borderLength > 0.0f)
+            {
+                borderNormal /= borderLength;
+                float weight = kBorderWeight * glm::dot(edge, edge);
+                float distance = -glm::dot(borderNormal, positions[a]);
+                quadrics[a].addPlane(borderNormal, distance, weight);
+                quadrics[b].addPlane(borderNormal, distance, weight);
+            }
+        }
+    }
+
+    std::vector<uint8_t> kinds(numVertices);
+    std::vector<Collapse> bestCollapses(numVertices);
+    std::vector<Collapse> candidates;
+    std::vector<uint32_t> adjacencyOffsets(numVertices + 1);
+    std::vector<uint32_t> adjacency;
+    std::vector<uint8_t> locked(numVertices);
+    std::vector<uint32_t> remap(numVertices);
+    double resultCost = 0.0;
+
+    uint32_t targetTriangles = targetIndexCount / 3;
+    while (result.size() > targetIndexCount)
+    {
+        uint32_t numTriangles = static_cast<uint32_t>(result.size() / 3);
+
+        // Edges and vertex kinds of the current mesh, collapses can close or lock borders
+        edgeTriangles.clear();
+        for (uint32_t i = 0; i < result.size(); i += 3)
+        {
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                edgeTriangles[getEdgeKey(positionIds[result[i + corner]], positionIds[result[i + (corner + 1) % 3]])]++;
+            }
+        }
+        for (uint32_t vertex = 0; vertex < numVertices; vertex++)
+        {
+            kinds[vertex] = wedgeCounts[vertex] > 1 ? VertexKind_Seam : VertexKind_Manifold;
+        }
+        for (const auto& [key, count] : edgeTriangles)
+        {
+            for (uint32_t position : {static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key)})
+            {
+                if (count > 2)
+                {
+                    kinds[position] = VertexKind_Locked;
+                }
+                else if (count == 1)
+                {
+                    bool border = kinds[position] == VertexKind_Manifold || kinds[position] == VertexKind_Border;
+                    kinds[position] = border ? VertexKind_Border : VertexKind_Locked;
+                }
+            }
+        }
+
+        // Cheapest collapse of every vertex
+        std::fill(bestCollapses.begin(), bestCollapses.end(), Collapse{});
+        for (uint32_t i = 0; i < result.size(); i += 3)
+        {
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                uint32_t a = result[i + corner];
+                uint32_t b = result[i + (corner + 1) % 3];
+                for (auto [from, to] : {std::pair(a, b), std::pair(b, a)})
+                {
+                    uint32_t fromPosition = positionIds[from];
+                    uint32_t toPosition = positionIds[to];
+                    if (fromPosition == toPosition || kinds[fromPosition] == VertexKind_Seam ||
+                        kinds[fromPosition] == VertexKind_Locked)
+                    {
+                        continue;
+                    }
+                    if (kinds[fromPosition] == VertexKind_Border &&
+                        edgeTriangles[getEdgeKey(fromPosition, toPosition)] != 1)
+                    {
+                        continue;
+                    }
+
+                    double cost = quadrics[fromPosition].evaluate(positions[to]);
+                    if (cost < bestCollapses[from].mCost)
+                    {
+                        bestCollapses[from] = {from, to, cost};
+                    }
+                }
+            }
+        }
+
+        candidates.clear();
+        for (const Collapse& collapse : bestCollapses)
+        {
+            if (collapse.mFrom != kInvalidIndex && collapse.mCost <= maxCost)
+            {
+                candidates.push_back(collapse);
+            }
+        }
+        if (candidates.empty())
+        {
+            break;
+        }
+        std::sort(candidates.begin(), candidates.end(),
+                  [](const Collapse& a, const Collapse& b) { return a.mCost < b.mCost; });
+
+        // Triangles around every position
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t index : result)
+        {
+            adjacencyOffsets[positionIds[index] + 1]++;
+        }
+        std::partial_sum(adjacencyOffsets.begin(), adjacencyOffsets.end(), adjacencyOffsets.begin());
+        adjacency.resize(result.size());
+        std::vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (uint32_t triangle = 0; triangle < numTriangles; triangle++)
+        {
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                adjacency[fill[positionIds[result[triangle * 3 + corner]]]++] = triangle;
+            }
+        }
+
+        // A collapse locks the triangles around it for the rest of the pass, so the flip test of the next
+        // ones sees up to date triangles
+        uint32_t maxCollapses = std::max(1u, (numTriangles - std::min(numTriangles, targetTriangles)) / 2);
+        uint32_t maxPassCollapses = static_cast<uint32_t>(candidates.size() * kPassCollapseRatio);
+        maxCollapses = std::min(maxCollapses, std::max(1u, maxPassCollapses));
+        // Collapses locked out of the pass leave room for costlier ones, they wait for the next pass instead
+        double passMaxCost = candidates[std::min<size_t>(maxCollapses, candidates.size()) - 1].mCost * kPassCostBound;
+        std::fill(locked.begin(), locked.end(), 0);
+        std::iota(remap.begin(), remap.end(), 0);
+        uint32_t numCollapses = 0;
+        for (const Collapse& collapse : candidates)
+        {
+            if (numCollapses >= maxCollapses || collapse.mCost > passMaxCost)
+            {
+                break;
+            }
+            uint32_t fromPosition = positionIds[collapse.mFrom];
+            uint32_t toPosition = positionIds[collapse.mTo];
+            if (locked[fromPosition] || locked[toPosition])
+            {
+                continue;
+            }
+
+            // The triangles kept around the vertex must not flip
+            bool flips = false;
+            const uint32_t* pBegin = &adjacency[adjacencyOffsets[fromPosition]];
+            const uint32_t* pEnd = &adjacency[0] + adjacencyOffsets[fromPosition + 1];
+            for (const uint32_t* pTriangle = pBegin; pTriangle != pEnd && !flips; pTriangle++)
+            {
+                const uint32_t* pCorners = &result[*pTriangle * 3];
+                glm::vec3 before[3];
+                glm::vec3 after[3];
+                bool collapsed = false;
+                for (uint32_t corner = 0; corner < 3; corner++)
+                {
+                    uint32_t position = positionIds[pCorners[corner]];
+                    collapsed = collapsed || position == toPosition;
+                    before[corner] = positions[pCorners[corner]];
+                    after[corner] = position == fromPosition ? positions[collapse.mTo] : before[corner];
+                }
+                if (!collapsed)
+                {
+                    glm::vec3 normalBefore = getTriangleNormal(before[0], before[1], before[2]);
+                    glm::vec3 normalAfter = getTriangleNormal(after[0], after[1], after[2]);
+                    flips = glm::dot(normalBefore, normalAfter) <= 0.0f;
+                }
+            }
+            if (flips)
+            {
+                continue;
+            }
+
+            remap[collapse.mFrom] = collapse.mTo;
+            quadrics[toPosition].add(quadrics[fromPosition]);
+            resultCost = std::max(resultCost, collapse.mCost);
+            for (const uint32_t* pTriangle = pBegin; pTriangle != pEnd; pTriangle++)
+            {
+                for (uint32_t corner = 0; corner < 3; corner++)
+                {
+                    locked[positionIds[result[*pTriangle * 3 + corner]]] = 1;
+                }
+            }
+            numCollapses++;
+        }
+        if (numCollapses == 0)
+        {
+            break;
+        }
+
+        // Collapsed triangles have two corners at the same position
+        size_t numIndices = 0;
+        for (size_t i = 0; i < result.size(); i += 3)
+        {
+            uint32_t a = remap[result[i]];
+            uint32_t b = remap[result[i + 1]];
+            uint32_t c = remap[result[i + 2]];
+            if (positionIds[a] != positionIds[b] && positionIds[b] != positionIds[c] &&
+                positionIds[a] != positionIds[c])
+            {
+                result[numIndices++] = a;
+                result[numIndices++] = b;
+                result[numIndices++] = c;
+            }
+        }
+        result.resize(numIndices);
+    }
+
+    if (pResultError)
+    {
+        *pResultError = static_cast<float>(std::sqrt(resultCost));
+    }
+    return result;
+}
+
+std::vector<MeshLod> GenerateLodChain(std::vector<uint32_t>& indices, const uint8_t* vertices, uint32_t numVertices,
+                                      uint32_t vertexSize, uint32_t positionOffset)
+{
+    std::vector<MeshLod> lods = {{0, static_cast<uint32_t>(indices.size()), 0.0f}};
+    std::vector<uint32_t> fullMesh = indices;
+
+    // Every LOD starts from the full mesh so its error is measured against it
+    for (uint32_t level = 1; level < kMaxMeshLods; level++)
+    {
+        uint32_t previousIndices = lods.back().NumIndices;
+        float previousError = lods.back().Error;
+        uint32_t targetIndexCount = static_cast<uint32_t>(fullMesh.size() * std::pow(kLodReduction, level)) / 3 * 3;
+
+        float error = 0.0f;
+        std::vector<uint32_t> lodIndices = SimplifyMesh(fullMesh, vertices, numVertices, vertexSize, positionOffset,
+                                                        targetIndexCount, kLodMaxError, &error);
+        if (lodIndices.empty() || lodIndices.size() > previousIndices * kLodMinReduction)
+        {
+            break;
+        }
+        OptimizeVertexCache(lodIndices, numVertices);
+
+        lods.push_back({static_cast<uint32_t>(indices.size()), static_cast<uint32_t>(lodIndices.size()),
+                        std::max(error, previousError)});
+        indices.insert(indices.end(), lodIndices.begin(), lodIndices.end());
+    }
+    return lods;
+}
+
+} // namespace VulkanCore::model
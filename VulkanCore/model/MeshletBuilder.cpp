@@ -0,0 +1,277 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace VulkanCore::model
+{
+
+namespace
+{
+
+constexpr uint32_t kInvalidIndex = UINT32_MAX;
+constexpr float kSeedDistance = 2.0f; // a triangle not sharing a vertex joins a meshlet within this many radii
+
+glm::vec3 getPosition(const uint8_t* vertices, uint32_t vertexSize, uint32_t positionOffset, uint32_t vertex)
+{
+    float position[3];
+    std::memcpy(position, vertices + static_cast<size_t>(vertex) * vertexSize + positionOffset, sizeof(position));
+    return glm::vec3(position[0], position[1], position[2]);
+}
+
+// Triangles of every vertex. The first mCounts[vertex] entries of a vertex are the triangles not yet in a meshlet.
+struct TriangleAdjacency
+{
+    std::vector<uint32_t> mOffsets;
+    std::vector<uint32_t> mCounts;
+    std::vector<uint32_t> mTriangles;
+
+    TriangleAdjacency(const std::vector<uint32_t>& indices, uint32_t numVertices)
+        : mOffsets(numVertices + 1, 0), mCounts(numVertices, 0), mTriangles(indices.size())
+    {
+        for (uint32_t index : indices)
+        {
+            mCounts[index]++;
+        }
+        for (uint32_t vertex = 0; vertex < numVertices; vertex++)
+        {
+            mOffsets[vertex + 1] = mOffsets[vertex] + mCounts[vertex];
+            mCounts[vertex] = 0;
+        }
+        for (uint32_t i = 0; i < indices.size(); i++)
+        {
+            uint32_t vertex = indices[i];
+            mTriangles[mOffsets[vertex] + mCounts[vertex]++] = i / 3;
+        }
+    }
+
+    void remove(uint32_t vertex, uint32_t triangle)
+    {
+        uint32_t* pFirst = &mTriangles[mOffsets[vertex]];
+        uint32_t* pLast = pFirst + mCounts[vertex];
+        uint32_t* pFound = std::find(pFirst, pLast, triangle);
+        if (pFound != pLast)
+        {
+            *pFound = *(pLast - 1);
+            *(pLast - 1) = triangle;
+            mCounts[vertex]--;
+        }
+    }
+};
+
+// Cone of the triangle normals, see Meshlet::Cone. Degenerate triangles are ignored.
+glm::vec4 computeNormalCone(const std::vector<glm::vec3>& normals)
+{
+    glm::vec3 axis(0.0f);
+    for (const glm::vec3& normal : normals)
+    {
+        axis += normal;
+    }
+    float axisLength = glm::length(axis);
+    if (normals.empty() || axisLength < FLT_EPSILON)
+    {
+        return glm::vec4(0.0f, 0.0f, 0.0f, 1.0f);
+    }
+    axis /= axisLength;
+
+    float minDot = 1.0f;
+    for (const glm::vec3& normal : normals)
+    {
+        minDot = std::min(minDot, glm::dot(normal, axis));
+    }
+    if (minDot <= kMeshletMinConeDot)
+    {
+        return glm::vec4(axis, 1.0f);
+    }
+    return glm::vec4(axis, std::sqrt(1.0f - minDot * minDot));
+}
+
+} // namespace
+
+std::vector<Meshlet> BuildMeshlets(std::vector<uint32_t>& indices, const uint8_t* vertices, uint32_t numVertices,
+                                   uint32_t vertexSize, uint32_t positionOffset, std::vector<uint32_t>& meshletVertices,
+                                   std::vector<uint32_t>& meshletTriangles, uint32_t maxVertices, uint32_t maxTriangles)
+{
+    if (maxVertices < 3 || maxVertices > 256 || maxTriangles == 0)
+    {
+        throw std::runtime_error("BuildMeshlets: a meshlet holds 3 to 256 vertices and at least one triangle.");
+    }
+
+    uint32_t numTriangles = static_cast<uint32_t>(indices.size() / 3);
+    std::vector<glm::vec3> positions(numVertices);
+    for (uint32_t vertex = 0; vertex < numVertices; vertex++)
+    {
+        positions[vertex] = getPosition(vertices, vertexSize, positionOffset, vertex);
+    }
+    std::vector<glm::vec3> centroids(numTriangles);
+    for (uint32_t triangle = 0; triangle < numTriangles; triangle++)
+    {
+        const uint32_t* pTriangle = &indices[triangle * 3];
+        centroids[triangle] = (positions[pTriangle[0]] + positions[pTriangle[1]] + positions[pTriangle[2]]) / 3.0f;
+    }
+
+    TriangleAdjacency adjacency(indices, numVertices);
+    std::vector<bool> emitted(numTriangles, false);
+    std::vector<uint32_t> localIndex(numVertices, kInvalidIndex); // in the current meshlet
+    std::vector<uint32_t> reordered;
+    reordered.reserve(indices.size());
+
+    std::vector<Meshlet> meshlets;
+    std::vector<uint32_t> currentVertices;
+    std::vector<uint32_t> currentTriangles;
+    glm::vec3 positionSum(0.0f);
+    float radius = 0.0f; // from the average vertex position, grows as vertices join
+
+    auto getCenter = [&]() { return positionSum / static_cast<float>(std::max<size_t>(currentVertices.size(), 1)); };
+
+    // Vertices a triangle would add to the current meshlet
+    auto countNewVertices = [&](uint32_t triangle)
+    {
+        uint32_t a = indices[triangle * 3], b = indices[triangle * 3 + 1], c = indices[triangle * 3 + 2];
+        return (localIndex[a] == kInvalidIndex ? 1u : 0u) + (b != a && localIndex[b] == kInvalidIndex ? 1u : 0u) +
+               (c != a && c != b && localIndex[c] == kInvalidIndex ? 1u : 0u);
+    };
+
+    auto addTriangle = [&](uint32_t triangle)
+    {
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            uint32_t vertex = indices[triangle * 3 + corner];
+            adjacency.remove(vertex, triangle);
+            if (localIndex[vertex] == kInvalidIndex)
+            {
+                localIndex[vertex] = static_cast<uint32_t>(currentVertices.size());
+                currentVertices.push_back(vertex);
+                positionSum += positions[vertex];
+                radius = std::max(radius, glm::length(positions[vertex] - getCenter()));
+            }
+        }
+        emitted[triangle] = true;
+        currentTriangles.push_back(triangle);
+    };
+
+    auto finishMeshlet = [&]()
+    {
+        Meshlet meshlet;
+        meshlet.FirstIndex = static_cast<uint32_t>(reordered.size());
+        meshlet.VertexOffset = static_cast<uint32_t>(meshletVertices.size());
+        meshlet.TriangleOffset = static_cast<uint32_t>(meshletTriangles.size());
+        meshlet.VertexCount = static_cast<uint32_t>(currentVertices.size());
+        meshlet.TriangleCount = static_cast<uint32_t>(currentTriangles.size());
+
+        std::vector<glm::vec3> normals;
+        normals.reserve(currentTriangles.size());
+        for (uint32_t triangle : currentTriangles)
+        {
+            const uint32_t* pTriangle = &indices[triangle * 3];
+            reordered.insert(reordered.end(), pTriangle, pTriangle + 3);
+            meshletTriangles.push_back(localIndex[pTriangle[0]] | (localIndex[pTriangle[1]] << 8) |
+                                       (localIndex[pTriangle[2]] << 16));
+
+            glm::vec3 normal = glm::cross(positions[pTriangle[1]] - positions[pTriangle[0]],
+                                          positions[pTriangle[2]] - positions[pTriangle[0]]);
+            float area = glm::length(normal);
+            if (area > FLT_EPSILON)
+            {
+                normals.push_back(normal / area);
+            }
+        }
+
+        meshlet.BoundsMin = glm::vec3(FLT_MAX);
+        meshlet.BoundsMax = glm::vec3(-FLT_MAX);
+        for (uint32_t vertex : currentVertices)
+        {
+            meshletVertices.push_back(vertex);
+            meshlet.BoundsMin = glm::min(meshlet.BoundsMin, positions[vertex]);
+            meshlet.BoundsMax = glm::max(meshlet.BoundsMax, positions[vertex]);
+            localIndex[vertex] = kInvalidIndex;
+        }
+        glm::vec3 center = (meshlet.BoundsMin + meshlet.BoundsMax) * 0.5f;
+        float sphereRadius = 0.0f;
+        for (uint32_t vertex : currentVertices)
+        {
+            sphereRadius = std::max(sphereRadius, glm::length(positions[vertex] - center));
+        }
+        meshlet.BoundingSphere = glm::vec4(center, sphereRadius);
+        meshlet.Cone = computeNormalCone(normals);
+        meshlets.push_back(meshlet);
+
+        currentVertices.clear();
+        currentTriangles.clear();
+        positionSum = glm::vec3(0.0f);
+        radius = 0.0f;
+    };
+
+    uint32_t nextSeed = 0; // triangles before it are all emitted
+    while (reordered.size() + currentTriangles.size() * 3 < numTriangles * 3)
+    {
+        // Best triangle sharing a vertex with the meshlet : fewest new vertices, then fewest triangles left on its
+        // vertices, then closest to the meshlet center
+        uint32_t best = kInvalidIndex;
+        uint32_t bestNewVertices = UINT32_MAX;
+        uint32_t bestLiveTriangles = UINT32_MAX;
+        float bestDistance = FLT_MAX;
+        glm::vec3 center = getCenter();
+        for (uint32_t vertex : currentVertices)
+        {
+            const uint32_t* pTriangles = &adjacency.mTriangles[adjacency.mOffsets[vertex]];
+            for (uint32_t i = 0; i < adjacency.mCounts[vertex]; i++)
+            {
+                uint32_t triangle = pTriangles[i];
+                uint32_t newVertices = countNewVertices(triangle);
+                if (currentVertices.size() + newVertices > maxVertices || newVertices > bestNewVertices)
+                {
+                    continue;
+                }
+                // Triangles left alone once the meshlet is done would end up in tiny meshlets, take them first
+                uint32_t a = indices[triangle * 3], b = indices[triangle * 3 + 1], c = indices[triangle * 3 + 2];
+                uint32_t liveTriangles = adjacency.mCounts[a] + adjacency.mCounts[b] + adjacency.mCounts[c];
+                float distance = glm::length(centroids[triangle] - center);
+                if (newVertices < bestNewVertices || liveTriangles < bestLiveTriangles ||
+                    (liveTriangles == bestLiveTriangles && distance < bestDistance))
+                {
+                    best = triangle;
+                    bestNewVertices = newVertices;
+                    bestLiveTriangles = liveTriangles;
+                    bestDistance = distance;
+                }
+            }
+        }
+
+        // Otherwise the next triangle of the input order, cache optimized so usually close by
+        if (best == kInvalidIndex)
+        {
+            while (emitted[nextSeed])
+            {
+                nextSeed++;
+            }
+            if (!currentTriangles.empty() &&
+                (currentVertices.size() + countNewVertices(nextSeed) > maxVertices ||
+                 glm::length(centroids[nextSeed] - center) > kSeedDistance * std::max(radius, FLT_EPSILON)))
+            {
+                finishMeshlet();
+                continue;
+            }
+            best = nextSeed;
+        }
+
+        addTriangle(best);
+        if (currentTriangles.size() == maxTriangles)
+        {
+            finishMeshlet();
+        }
+    }
+    if (!currentTriangles.empty())
+    {
+        finishMeshlet();
+    }
+
+    indices = std::move(reordered);
+    return meshlets;
+}
+
+} // namespace VulkanCore::model
@@ -1,10 +1,15 @@
 #include "Model.h"
+#include "ModelCache.h"
+#include "ParallelFor.h"
 #include "include/Material.h"
+#include <algorithm>
 #include <assimp/material.h>
 #include <cassert>
+#include <chrono>
 #include <cstdint>
 #include <glm/ext/matrix_float4x4.hpp>
 #include <iostream>
+#include <span>
 #include <vector>
 
 namespace VulkanCore::model
@@ -13,6 +18,15 @@ namespace VulkanCore::model
 namespace
 {
 
+// Texture paths of the materials are relative to this directory next to the model
+constexpr const char* kTextureDirectory = "textures";
+
+constexpr uint32_t kImportFlags = aiProcess_JoinIdenticalVertices | aiProcess_Triangulate | aiProcess_GenSmoothNormals |
+                                  aiProcess_LimitBoneWeights | aiProcess_SplitLargeMeshes |
+                                  aiProcess_ImproveCacheLocality | aiProcess_RemoveRedundantMaterials |
+                                  aiProcess_FindDegenerates | aiProcess_FindInvalidData | aiProcess_GenUVCoords |
+                                  aiProcess_CalcTangentSpace;
+
 aiTextureType getAssimpTextureType(TEXTURE_TYPE texType)
 {
     switch (texType)
@@ -23,11 +37,41 @@ aiTextureType getAssimpTextureType(TEXTURE_TYPE texType)
             return aiTextureType_SPECULAR;
         case TEX_TYPE_NORMAL:
             return aiTextureType_NORMALS;
+        case TEX_TYPE_METALNESS:
+            return aiTextureType_METALNESS;
+        case TEX_TYPE_EMISSIVE:
+            return aiTextureType_EMISSIVE;
+        case TEX_TYPE_NORMAL_CAMERA:
+            return aiTextureType_NORMAL_CAMERA;
+        case TEX_TYPE_EMISSION_COLOR:
+            return aiTextureType_EMISSION_COLOR;
+        case TEX_TYPE_ROUGHNESS:
+            return aiTextureType_DIFFUSE_ROUGHNESS;
+        case TEX_TYPE_AMBIENT_OCCLUSION:
+            return aiTextureType_AMBIENT_OCCLUSION;
+        case TEX_TYPE_CLEARCOAT:
+        case TEX_TYPE_CLEARCOAT_ROUGHNESS:
+        case TEX_TYPE_CLEARCOAT_NORMAL:
+            return aiTextureType_CLEARCOAT;
         default:
             return aiTextureType_UNKNOWN;
     }
 }
 
+// The clear coat layer keeps its three textures under aiTextureType_CLEARCOAT
+uint32_t getAssimpTextureIndex(TEXTURE_TYPE texType)
+{
+    switch (texType)
+    {
+        case TEX_TYPE_CLEARCOAT_ROUGHNESS:
+            return 1;
+        case TEX_TYPE_CLEARCOAT_NORMAL:
+            return 2;
+        default:
+            return 0;
+    }
+}
+
 glm::mat4 convertGLMmatrix4(const aiMatrix4x4& aiMat)
 {
     glm::mat4 mat;
@@ -109,6 +153,36 @@ int32_t countValidFaces(const aiMesh* mesh)
     return validFaces;
 }
 
+// AABB and bounding sphere of the mesh vertices, the sphere is centered on the AABB
+void computeMeshBounds(const aiMesh* mesh, BasicMeshEntry& entry)
+{
+    if (mesh->mNumVertices == 0)
+    {
+        return;
+    }
+
+    glm::vec3 boundsMin(mesh->mVertices[0].x, mesh->mVertices[0].y, mesh->mVertices[0].z);
+    glm::vec3 boundsMax = boundsMin;
+    for (uint32_t i = 1; i < mesh->mNumVertices; i++)
+    {
+        glm::vec3 pos(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
+        boundsMin = glm::min(boundsMin, pos);
+        boundsMax = glm::max(boundsMax, pos);
+    }
+
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float radiusSq = 0.0f;
+    for (uint32_t i = 0; i < mesh->mNumVertices; i++)
+    {
+        glm::vec3 offset = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z) - center;
+        radiusSq = glm::max(radiusSq, glm::dot(offset, offset));
+    }
+
+    entry.BoundsMin = boundsMin;
+    entry.BoundsMax = boundsMax;
+    entry.BoundingSphere = glm::vec4(center, glm::sqrt(radiusSq));
+}
+
 // int32_t getTextureCount(const aiMaterial* pMaterial)
 // {
 //     int32_t textureCount{0};
@@ -120,30 +194,40 @@ int32_t countValidFaces(const aiMesh* mesh)
 //     return textureCount;
 // }
 
-bool getFullTransformation(const aiNode* pRootNode, const char* pName, glm::mat4& Transformation)
+bool hasBones(const aiScene* pScene)
 {
-    Transformation = glm::mat4(1.0f);
-
-    const aiNode* pNode = pRootNode->FindNode(pName);
-    if (!pNode)
+    for (uint32_t i = 0; i < pScene->mNumMeshes; i++)
     {
-        printf("Warning! Cannot find a node for '%s'\n", pName);
-        return false;
+        if (pScene->mMeshes[i]->HasBones())
+        {
+            return true;
+        }
     }
+    return false;
+}
+
+// Zero vectors (missing attributes) stay zero
+glm::vec3 transformDirection(const glm::mat3& matrix, const glm::vec3& direction)
+{
+    glm::vec3 transformed = matrix * direction;
+    float length = glm::length(transformed);
+    return length > 0.0f ? transformed / length : transformed;
+}
 
-    while (pNode)
+// Keeps the kMaxBoneInfluences largest weights
+void addBoneInfluence(uint32_t* pBoneIds, float* pWeights, uint32_t boneId, float weight)
+{
+    float* pSmallest = std::min_element(pWeights, pWeights + kMaxBoneInfluences);
+    if (weight > *pSmallest)
     {
-        glm::mat4 CurTransformation = convertGLMmatrix4(pNode->mTransformation);
-        Transformation = Transformation * CurTransformation;
-        pNode = pNode->mParent;
+        pBoneIds[pSmallest - pWeights] = boneId;
+        *pSmallest = weight;
     }
-
-    return true;
 }
 
 } // namespace
 
-bool Model::initGeometry(const aiScene* pScene, const std::string& Filename)
+bool Model::initGeometry(const aiScene* pScene, const std::string& Filename, uint64_t cacheKey)
 {
     m_Meshes.resize(pScene->mNumMeshes);
     m_Materials.resize(pScene->mNumMaterials);
@@ -153,29 +237,298 @@ bool Model::initGeometry(const aiScene* pScene, const std::string& Filename)
 
     countVerticesAndIndices(pScene, NumVertices, NumIndices);
 
-    // initialize buffers
-    if (pScene->mNumAnimations > 0)
+    if (pScene->mNumAnimations > 0 || hasBones(pScene))
     {
-        // ToDo : Handle skinned meshes
-        throw std::runtime_error("Skinned meshes not supported yet.");
+        // The mesh transformations come first, they are folded into the vertices and the bones
+        initSceneGraph(pScene);
+        initSkeleton(pScene);
+        initAnimations(pScene);
+
+        std::vector<SkinnedVertex> SkinnedVertices;
+        initGeometryInternal<SkinnedVertex>(SkinnedVertices, NumVertices, NumIndices, pScene);
+        if (!initMaterials(pScene, Filename))
+        {
+            return false;
+        }
+
+        // Not cached, the entries hold Vertex
+        populateBufferSkinned(SkinnedVertices);
+        return true;
     }
-    else
+
+    std::vector<Vertex> Vertices;
+    initGeometryInternal<Vertex>(Vertices, NumVertices, NumIndices, pScene);
+
+    if (!initMaterials(pScene, Filename))
     {
-        std::vector<Vertex> Vertices;
-        initGeometryInternal<Vertex>(Vertices, NumVertices, NumIndices, pScene);
-        populateBuffer(Vertices);
+        return false;
     }
 
-    if (!initMaterials(pScene, Filename))
+    initSceneGraph(pScene);
+
+    // Cached once the scene is complete, the buffers are then populated the same way as on a cache hit
+    if (cacheKey != 0 && !m_HasEmbeddedTextures)
+    {
+        ModelCache::getDefault().insert(cacheKey,
+                                        [&](const std::string& path) { writeBaked(path, nullptr, &Vertices); });
+    }
+    populateBuffer(Vertices);
+
+    return true;
+}
+
+uint64_t Model::getCacheKey(const std::string& modelPath) const
+{
+    uint64_t key = 0;
+    try
+    {
+        key = HashFile(modelPath);
+    }
+    catch (const std::runtime_error&)
+    {
+        return 0;
+    }
+
+    uint32_t options[] = {kImportFlags,
+                          kBakedModelVersion,
+                          static_cast<uint32_t>(sizeof(Vertex)),
+                          m_UseMeshOptimizer,
+                          m_GenerateLods,
+                          m_BuildMeshlets,
+                          kMaxMeshLods,
+                          kMeshletMaxVertices,
+                          kMeshletMaxTriangles};
+    key = HashBytes(options, sizeof(options), key);
+    return key != 0 ? key : 1;
+}
+
+bool Model::loadFromCache(uint64_t cacheKey, const std::string& modelPath)
+{
+    ModelCache& cache = ModelCache::getDefault();
+    std::string cachedPath = cache.find(cacheKey);
+    if (cachedPath.empty())
+    {
+        return false;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<Vertex> vertices;
+    try
+    {
+        BakedModelFile file(cachedPath);
+        if ((file.getHeader().Flags & BakedModelFlag_SourceGeometry) == 0)
+        {
+            throw std::runtime_error("no processed geometry");
+        }
+        std::span<const Vertex> sourceVertices = file.getSection<Vertex>(BakedSection_SourceVertices);
+        std::span<const uint32_t> sourceIndices = file.getSection<uint32_t>(BakedSection_SourceIndices);
+        readBaked(file, modelPath);
+        vertices.assign(sourceVertices.begin(), sourceVertices.end());
+        m_Indices.assign(sourceIndices.begin(), sourceIndices.end());
+    }
+    catch (const std::runtime_error& e)
     {
+        std::cout << "Warning! Discarding the model cache entry " << cachedPath << " : " << e.what() << std::endl;
+        cache.remove(cacheKey);
+        destroyAllTextures();
+        m_Meshes.clear();
+        m_Materials.clear();
+        m_TextureLoads.clear();
         return false;
     }
 
-    calculateMeshTransformations(pScene);
+    auto end = std::chrono::high_resolution_clock::now();
+    std::cout << "Model cache hit for " << modelPath << " : " << m_Meshes.size() << " meshes, " << vertices.size()
+              << " vertices read in " << std::chrono::duration<float, std::milli>(end - start).count() << " ms"
+              << std::endl;
 
+    populateBuffer(vertices);
     return true;
 }
 
+void Model::initSkeleton(const aiScene* pScene)
+{
+    // Nodes of the scene graph, already parents first
+    m_Skeleton = {};
+    for (uint32_t node = 0; node < m_SceneGraph.getNumNodes(); node++)
+    {
+        m_Skeleton.Nodes.push_back({m_SceneGraph.getParent(node), m_SceneGraph.getLocalTransform(node)});
+        m_Skeleton.NodeNames.push_back(m_SceneGraph.getName(node));
+    }
+
+    // Vertices are moved to model space by their mesh transformation, see prepareSkinnedMeshes(), the offsets
+    // start from there
+    for (uint32_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
+    {
+        const aiMesh* pMesh = pScene->mMeshes[meshIndex];
+        glm::mat4 modelToMesh = glm::inverse(m_Meshes[meshIndex].Transformation);
+        if (pMesh->mNumBones == 0)
+        {
+            m_Skeleton.BoneNodes.push_back(static_cast<uint32_t>(std::max(m_Meshes[meshIndex].Node, 0)));
+            m_Skeleton.BoneOffsets.push_back(modelToMesh);
+            continue;
+        }
+
+        for (uint32_t i = 0; i < pMesh->mNumBones; i++)
+        {
+            const aiBone* pBone = pMesh->mBones[i];
+            int32_t node = m_SceneGraph.findNode(pBone->mName.C_Str());
+            if (node < 0)
+            {
+                throw std::runtime_error(std::string("No node for the bone ") + pBone->mName.C_Str());
+            }
+            m_Skeleton.BoneNodes.push_back(static_cast<uint32_t>(node));
+            m_Skeleton.BoneOffsets.push_back(convertGLMmatrix4(pBone->mOffsetMatrix) * modelToMesh);
+        }
+    }
+
+    std::cout << "Skeleton : " << m_Skeleton.Nodes.size() << " nodes, " << m_Skeleton.BoneNodes.size() << " bones"
+              << std::endl;
+}
+
+void Model::initAnimations(const aiScene* pScene)
+{
+    m_Animations.clear();
+    m_SoaAnimations.clear();
+    for (uint32_t i = 0; i < pScene->mNumAnimations; i++)
+    {
+        const aiAnimation* pAnimation = pScene->mAnimations[i];
+        double ticksPerSecond = pAnimation->mTicksPerSecond > 0.0 ? pAnimation->mTicksPerSecond : 25.0;
+
+        AnimationClip clip;
+        clip.Name = pAnimation->mName.C_Str();
+        clip.Duration = static_cast<float>(pAnimation->mDuration / ticksPerSecond);
+        for (uint32_t c = 0; c < pAnimation->mNumChannels; c++)
+        {
+            const aiNodeAnim* pNodeAnim = pAnimation->mChannels[c];
+            int32_t node = m_SceneGraph.findNode(pNodeAnim->mNodeName.C_Str());
+            if (node < 0)
+            {
+                std::cout << "Warning! Animation " << clip.Name << " : no node for the channel "
+                          << pNodeAnim->mNodeName.C_Str() << std::endl;
+                continue;
+            }
+
+            AnimationChannel channel;
+            channel.Node = static_cast<uint32_t>(node);
+            for (uint32_t k = 0; k < pNodeAnim->mNumPositionKeys; k++)
+            {
+                const aiVectorKey& key = pNodeAnim->mPositionKeys[k];
+                channel.Positions.push_back({static_cast<float>(key.mTime / ticksPerSecond),
+                                             glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z)});
+            }
+            for (uint32_t k = 0; k < pNodeAnim->mNumRotationKeys; k++)
+            {
+                const aiQuatKey& key = pNodeAnim->mRotationKeys[k];
+                channel.Rotations.push_back({static_cast<float>(key.mTime / ticksPerSecond),
+                                             glm::quat(key.mValue.w, key.mValue.x, key.mValue.y, key.mValue.z)});
+            }
+            for (uint32_t k = 0; k < pNodeAnim->mNumScalingKeys; k++)
+            {
+                const aiVectorKey& key = pNodeAnim->mScalingKeys[k];
+                channel.Scales.push_back({static_cast<float>(key.mTime / ticksPerSecond),
+                                          glm::vec3(key.mValue.x, key.mValue.y, key.mValue.z)});
+            }
+            clip.Channels.push_back(std::move(channel));
+        }
+
+        std::cout << "Animation " << clip.Name << " : " << clip.Duration << " s, " << clip.Channels.size()
+                  << " channels" << std::endl;
+        m_SoaAnimations.push_back(BuildSoaAnimationClip(clip, static_cast<uint32_t>(m_Skeleton.Nodes.size())));
+        m_Animations.push_back(std::move(clip));
+    }
+}
+
+void Model::prepareSkinnedMeshes(std::vector<SkinnedVertex>& vertices, const aiScene* pScene)
+{
+    // Bones of a mesh are contiguous, in the order of initSkeleton()
+    std::vector<uint32_t> firstBones(m_Meshes.size());
+    uint32_t numBones = 0;
+    for (uint32_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
+    {
+        firstBones[meshIndex] = numBones;
+        numBones += std::max(pScene->mMeshes[meshIndex]->mNumBones, 1u);
+    }
+
+    ParallelFor(static_cast<uint32_t>(m_Meshes.size()),
+                [&](uint32_t meshIndex)
+                {
+                    prepareSkinnedMesh(m_Meshes[meshIndex], pScene->mMeshes[meshIndex],
+                                       vertices.data() + m_Meshes[meshIndex].BaseVertex, firstBones[meshIndex]);
+                });
+}
+
+void Model::prepareSkinnedMesh(BasicMeshEntry& mesh, const aiMesh* pMesh, SkinnedVertex* pVertices,
+                               uint32_t firstBone) const
+{
+    if (mesh.NumVertices == 0)
+    {
+        return;
+    }
+
+    glm::mat3 tangentMatrix(mesh.Transformation);
+    glm::mat3 normalMatrix = glm::transpose(glm::inverse(tangentMatrix));
+    for (uint32_t i = 0; i < mesh.NumVertices; i++)
+    {
+        SkinnedVertex& vertex = pVertices[i];
+        vertex.pos = glm::vec3(mesh.Transformation * glm::vec4(vertex.pos, 1.0f));
+        vertex.normal = transformDirection(normalMatrix, vertex.normal);
+        vertex.tangent = transformDirection(tangentMatrix, vertex.tangent);
+        vertex.bitangent = transformDirection(tangentMatrix, vertex.bitangent);
+    }
+    mesh.Transformation = glm::mat4(1.0f);
+
+    // Influences, a mesh without bones follows the bone of its node
+    if (pMesh->mNumBones == 0)
+    {
+        for (uint32_t i = 0; i < mesh.NumVertices; i++)
+        {
+            pVertices[i].boneIds[0] = firstBone;
+            pVertices[i].weights[0] = 1.0f;
+        }
+    }
+    for (uint32_t b = 0; b < pMesh->mNumBones; b++)
+    {
+        const aiBone* pBone = pMesh->mBones[b];
+        for (uint32_t w = 0; w < pBone->mNumWeights; w++)
+        {
+            SkinnedVertex& vertex = pVertices[pBone->mWeights[w].mVertexId];
+            addBoneInfluence(vertex.boneIds, vertex.weights, firstBone + b, pBone->mWeights[w].mWeight);
+        }
+    }
+    for (uint32_t i = 0; i < mesh.NumVertices; i++)
+    {
+        float* pWeights = pVertices[i].weights;
+        float sum = 0.0f;
+        for (uint32_t k = 0; k < kMaxBoneInfluences; k++)
+        {
+            sum += pWeights[k];
+        }
+        for (uint32_t k = 0; sum > 0.0f && k < kMaxBoneInfluences; k++)
+        {
+            pWeights[k] /= sum;
+        }
+    }
+
+    // Bounds of the bind pose, now in model space
+    glm::vec3 boundsMin = pVertices[0].pos;
+    glm::vec3 boundsMax = boundsMin;
+    for (uint32_t i = 1; i < mesh.NumVertices; i++)
+    {
+        boundsMin = glm::min(boundsMin, pVertices[i].pos);
+        boundsMax = glm::max(boundsMax, pVertices[i].pos);
+    }
+    glm::vec3 center = (boundsMin + boundsMax) * 0.5f;
+    float radius = 0.0f;
+    for (uint32_t i = 0; i < mesh.NumVertices; i++)
+    {
+        radius = glm::max(radius, glm::length(pVertices[i].pos - center));
+    }
+    mesh.BoundsMin = boundsMin;
+    mesh.BoundsMax = boundsMax;
+    mesh.BoundingSphere = glm::vec4(center, radius);
+}
+
 void Model::countVerticesAndIndices(const aiScene* pScene, uint32_t& NumVertices, uint32_t& NumIndices)
 {
     for (uint32_t i = 0; i < m_Meshes.size(); i++)
@@ -186,6 +539,9 @@ void Model::countVerticesAndIndices(const aiScene* pScene, uint32_t& NumVertices
         m_Meshes[i].NumIndices = pScene->mMeshes[i]->mNumFaces * 3; // assuming all faces are triangles
         m_Meshes[i].BaseVertex = NumVertices;
         m_Meshes[i].BaseIndex = NumIndices;
+        m_Meshes[i].NumLodIndices = m_Meshes[i].NumIndices;
+        m_Meshes[i].Lods = {{0, m_Meshes[i].NumIndices, 0.0f}};
+        computeMeshBounds(pScene->mMeshes[i], m_Meshes[i]);
 
         NumVertices += m_Meshes[i].NumVertices;
         NumIndices += m_Meshes[i].NumIndices;
@@ -201,7 +557,7 @@ bool Model::initMaterials(const aiScene* pScene, const std::string& Filename)
         dir = Filename.substr(0, slashIndex);
     }
     // All material data are in "textures" folder
-    dir += "/textures";
+    dir += std::string("/") + kTextureDirectory;
 
     for (uint32_t i = 0; i < m_Materials.size(); i++)
     {
@@ -210,6 +566,7 @@ bool Model::initMaterials(const aiScene* pScene, const std::string& Filename)
         loadTexturesFromMaterial(pMaterial, dir, i);
         loadColorFromMaterial(pMaterial, i);
     }
+    m_EmbeddedImages.clear(); // the loads keep their copies
 
     return true;
 }
@@ -218,32 +575,27 @@ void Model::loadTexturesFromMaterial(const aiMaterial* pMaterial, const std::str
 {
     // int32_t textureCount = getTextureCount(pMaterial);
     // std::cout << "Material index " << materialIndex << " has " << textureCount << " textures." << std::endl;
-    loadDiffuseTexture(dir, pMaterial, materialIndex);
-    loadSpecularTexture(dir, pMaterial, materialIndex);
-    loadNormalTexture(dir, pMaterial, materialIndex);
-
-    /* ToDo: implement other texture types
-    LoadMetalnessTexture(dir, pMaterial, materialIndex);
-    LoadEmissiveTexture(dir, pMaterial, materialIndex);
-    LoadEmissionColorTexture(dir, pMaterial, materialIndex);
-    LoadNormalCameraTexture(dir, pMaterial, materialIndex);
-    LoadRoughnessTexture(dir, pMaterial, materialIndex);
-    LoadAmbientOcclusionTexture(dir, pMaterial, materialIndex);
-    LoadClearCoatTexture(dir, pMaterial, materialIndex);
-    LoadClearCoatRoughnessTexture(dir, pMaterial, materialIndex);
-    LoadClearCoatNormalTexture(dir, pMaterial, materialIndex);
-    */
+    // Every type with a source, TEX_TYPE_ORM is packed from the occlusion, roughness and metalness ones
+    for (uint32_t texType = 0; texType < TEX_TYPE_ORM; texType++)
+    {
+        loadTexture(dir, pMaterial, materialIndex, static_cast<TEXTURE_TYPE>(texType));
+    }
 }
 
 void Model::loadTexture(const std::string& dir, const aiMaterial* pMaterial, int32_t materialIndex,
                         TEXTURE_TYPE texType)
 {
     aiTextureType aiTexType = getAssimpTextureType(texType);
+    uint32_t aiTexIndex = getAssimpTextureIndex(texType);
+    if (texType == TEX_TYPE_AMBIENT_OCCLUSION && pMaterial->GetTextureCount(aiTexType) == 0)
+    {
+        aiTexType = aiTextureType_LIGHTMAP; // glTF occlusion
+    }
     m_Materials[materialIndex].mpTextures[texType] = nullptr;
-    if (pMaterial->GetTextureCount(aiTexType) > 0)
+    if (aiTexIndex < pMaterial->GetTextureCount(aiTexType))
     {
         aiString texturePath;
-        if (pMaterial->GetTexture(aiTexType, 0, &texturePath, NULL, NULL, NULL, NULL, NULL) == AI_SUCCESS)
+        if (pMaterial->GetTexture(aiTexType, aiTexIndex, &texturePath, NULL, NULL, NULL, NULL, NULL) == AI_SUCCESS)
         {
             const aiTexture* paiTexture = m_pScene->GetEmbeddedTexture(texturePath.C_Str());
             bool isSRGB = false; //(texType == TEXTURE_TYPE::TEX_TYPE_BASE); //
@@ -261,11 +613,11 @@ void Model::loadTexture(const std::string& dir, const aiMaterial* pMaterial, int
 
             if (paiTexture)
             {
-                // ToDo : implement embedded texture loading
-                // loadTextureEmbedded();
+                loadTextureEmbedded(paiTexture, materialIndex, texType, isSRGB);
             }
             else
             {
+                m_Materials[materialIndex].mTexturePaths[texType] = std::string(kTextureDirectory) + "/" + cleanPath;
                 loadTextureFromFile(dir, cleanPath, materialIndex, texType, isSRGB);
             }
         }
@@ -276,24 +628,71 @@ void Model::loadTextureFromFile(const std::string& Dir, const std::string& Path,
                                 TEXTURE_TYPE MyType, bool IsSRGB)
 {
     std::string fullPath = Dir + "/" + Path;
+    if (m_DeferTextureLoads)
+    {
+        m_TextureLoads.push_back({fullPath, MaterialIndex, MyType, IsSRGB});
+        return;
+    }
+
     m_Materials[MaterialIndex].mpTextures[MyType] = allocTexture2D();
-    m_Materials[MaterialIndex].mpTextures[MyType]->LoadFromFile(fullPath);
+    if (m_Materials[MaterialIndex].mpTextures[MyType])
+    {
+        m_Materials[MaterialIndex].mpTextures[MyType]->LoadFromFile(fullPath);
+    }
     // std::cout << "Loaded texture: " << fullPath << std::endl;
 }
 
-void Model::loadDiffuseTexture(const std::string& dir, const aiMaterial* pMaterial, int32_t materialIndex)
+void Model::loadTextureEmbedded(const aiTexture* pTexture, int32_t MaterialIndex, TEXTURE_TYPE MyType, bool IsSRGB)
 {
-    loadTexture(dir, pMaterial, materialIndex, TEXTURE_TYPE::TEX_TYPE_BASE);
-}
+    m_HasEmbeddedTextures = true;
 
-void Model::loadSpecularTexture(const std::string& dir, const aiMaterial* pMaterial, int32_t materialIndex)
-{
-    loadTexture(dir, pMaterial, materialIndex, TEXTURE_TYPE::TEX_TYPE_SPECULAR);
-}
+    // Copied out of the scene on its first reference, decoded later or below without any temporary file
+    std::shared_ptr<const EmbeddedImage>& pImage = m_EmbeddedImages[pTexture];
+    if (!pImage)
+    {
+        auto pCopy = std::make_shared<EmbeddedImage>();
+        if (pTexture->mHeight == 0)
+        {
+            // Compressed, mWidth is the size of the file in memory
+            const uint8_t* pData = reinterpret_cast<const uint8_t*>(pTexture->pcData);
+            pCopy->Data.assign(pData, pData + pTexture->mWidth);
+        }
+        else
+        {
+            // aiTexel is BGRA
+            uint32_t numTexels = pTexture->mWidth * pTexture->mHeight;
+            pCopy->Data.resize(static_cast<size_t>(numTexels) * 4);
+            for (uint32_t i = 0; i < numTexels; i++)
+            {
+                const aiTexel& texel = pTexture->pcData[i];
+                uint8_t* pTexel = &pCopy->Data[static_cast<size_t>(i) * 4];
+                pTexel[0] = texel.r;
+                pTexel[1] = texel.g;
+                pTexel[2] = texel.b;
+                pTexel[3] = texel.a;
+            }
+            pCopy->Width = pTexture->mWidth;
+            pCopy->Height = pTexture->mHeight;
+        }
+        pImage = std::move(pCopy);
+    }
 
-void Model::loadNormalTexture(const std::string& dir, const aiMaterial* pMaterial, int32_t materialIndex)
-{
-    loadTexture(dir, pMaterial, materialIndex, TEXTURE_TYPE::TEX_TYPE_NORMAL);
+    if (m_DeferTextureLoads)
+    {
+        m_TextureLoads.push_back({pTexture->mFilename.C_Str(), MaterialIndex, MyType, IsSRGB, pImage});
+        return;
+    }
+
+    Texture* pLoaded = allocTexture2D();
+    m_Materials[MaterialIndex].mpTextures[MyType] = pLoaded;
+    if (pLoaded && pImage->Width == 0)
+    {
+        pLoaded->Load(static_cast<uint32_t>(pImage->Data.size()), pImage->Data.data());
+    }
+    else if (pLoaded)
+    {
+        pLoaded->LoadPixels(pImage->Data.data(), pImage->Width, pImage->Height);
+    }
 }
 
 void Model::loadColorFromMaterial(const aiMaterial* pMaterial, int32_t materialIndex)
@@ -306,6 +705,19 @@ void Model::loadColorFromMaterial(const aiMaterial* pMaterial, int32_t materialI
     loadColor(pMaterial, material.mAmbientColor, AI_MATKEY_COLOR_AMBIENT);
     loadColor(pMaterial, material.mEmissiveColor, AI_MATKEY_COLOR_EMISSIVE);
     loadColor(pMaterial, material.mReflectiveColor, AI_MATKEY_COLOR_REFLECTIVE);
+
+    float opacity = 1.0f;
+    if (pMaterial->Get(AI_MATKEY_OPACITY, opacity) == AI_SUCCESS)
+    {
+        material.m_transparencyFactor = opacity;
+    }
+
+    // glTF alpha mask cutoff ("$mat.gltf.alphaCutoff"), only present for MASK materials
+    float alphaCutoff = 0.0f;
+    if (pMaterial->Get("$mat.gltf.alphaCutoff", 0, 0, alphaCutoff) == AI_SUCCESS)
+    {
+        material.m_alphaTest = alphaCutoff;
+    }
 }
 
 void Model::loadColor(const aiMaterial* pMaterial, glm::vec4& color, const char* pAiMatKey, int32_t aiMatType,
@@ -322,27 +734,55 @@ void Model::loadColor(const aiMaterial* pMaterial, glm::vec4& color, const char*
     }
 }
 
-void Model::calculateMeshTransformations(const aiScene* pScene)
+void Model::initSceneGraph(const aiScene* pScene)
 {
-    aiNode* rootNode = pScene->mRootNode;
-    glm::mat4 identity = glm::mat4(1.0f);
-    traverseNodeHierarchy(identity, rootNode);
+    m_SceneGraph.clear();
+    for (BasicMeshEntry& mesh : m_Meshes)
+    {
+        mesh.Node = -1;
+    }
+
+    // Depth first, children in order, a node is added after its parent. A mesh referenced by several nodes keeps
+    // the last one.
+    std::vector<std::pair<const aiNode*, int32_t>> stack = {{pScene->mRootNode, -1}};
+    while (!stack.empty())
+    {
+        auto [pNode, parent] = stack.back();
+        stack.pop_back();
+
+        uint32_t node = m_SceneGraph.addNode(parent, convertGLMmatrix4(pNode->mTransformation), pNode->mName.C_Str());
+        for (uint32_t i = 0; i < pNode->mNumMeshes; i++)
+        {
+            m_Meshes[pNode->mMeshes[i]].Node = static_cast<int32_t>(node);
+        }
+        for (uint32_t i = pNode->mNumChildren; i > 0; i--)
+        {
+            stack.push_back({pNode->mChildren[i - 1], static_cast<int32_t>(node)});
+        }
+    }
+
+    for (BasicMeshEntry& mesh : m_Meshes)
+    {
+        mesh.Transformation = mesh.Node >= 0 ? m_SceneGraph.getWorldTransform(mesh.Node) : glm::mat4(1.0f);
+    }
 }
 
-void Model::traverseNodeHierarchy(const glm::mat4& ParentTransformation, aiNode* pNode)
+void Model::updateMeshTransformations(std::vector<uint32_t>& changedMeshes)
 {
-    glm::mat4 nodeTransformation = convertGLMmatrix4(pNode->mTransformation);
-    glm::mat4 combinedTransformation = ParentTransformation * nodeTransformation;
-
-    for (uint32_t i = 0; i < pNode->mNumMeshes; i++)
+    // The transformations of skinned meshes are part of their bones
+    if (m_SceneGraph.update() == 0 || isSkinned())
     {
-        uint32_t meshIndex = pNode->mMeshes[i];
-        m_Meshes[meshIndex].Transformation = combinedTransformation;
+        return;
     }
 
-    for (uint32_t i = 0; i < pNode->mNumChildren; i++)
+    for (uint32_t meshIndex = 0; meshIndex < m_Meshes.size(); meshIndex++)
     {
-        traverseNodeHierarchy(combinedTransformation, pNode->mChildren[i]);
+        BasicMeshEntry& mesh = m_Meshes[meshIndex];
+        if (mesh.Node >= 0 && m_SceneGraph.isChanged(mesh.Node))
+        {
+            mesh.Transformation = m_SceneGraph.getWorldTransform(mesh.Node);
+            changedMeshes.push_back(meshIndex);
+        }
     }
 }
 
@@ -357,13 +797,16 @@ Model::~Model()
 
 void Model::initScene(std::string modelPath)
 {
+    // Processed output of an earlier load of the same source, assimp is skipped entirely on a hit
+    uint64_t cacheKey = m_UseCache ? getCacheKey(modelPath) : 0;
+    if (cacheKey != 0 && loadFromCache(cacheKey, modelPath))
+    {
+        return;
+    }
+
     // Load model from the specified path
     Assimp::Importer importer;
-    m_pScene = importer.ReadFile(
-        modelPath, aiProcess_JoinIdenticalVertices | aiProcess_Triangulate | aiProcess_GenSmoothNormals |
-                       aiProcess_LimitBoneWeights | aiProcess_SplitLargeMeshes | aiProcess_ImproveCacheLocality |
-                       aiProcess_RemoveRedundantMaterials | aiProcess_FindDegenerates | aiProcess_FindInvalidData |
-                       aiProcess_GenUVCoords | aiProcess_CalcTangentSpace);
+    m_pScene = importer.ReadFile(modelPath, kImportFlags);
 
     if (!m_pScene || m_pScene->mFlags & AI_SCENE_FLAGS_INCOMPLETE || !m_pScene->mRootNode)
     {
@@ -371,14 +814,11 @@ void Model::initScene(std::string modelPath)
     }
     else
     {
-        if (!initGeometry(m_pScene, modelPath))
+        if (!initGeometry(m_pScene, modelPath, cacheKey))
         {
             throw std::runtime_error("Failed to initialize geometry for model: " + modelPath);
         }
 
-        glm::mat4 transformation;
-        getFullTransformation(m_pScene->mRootNode, m_pScene->mRootNode->mName.C_Str(), transformation);
-
         // ToDo: lighting calc
     }
 }
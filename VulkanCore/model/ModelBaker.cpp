@@ -0,0 +1,26 @@
+#include "ModelBaker.h"
+
+namespace VulkanCore::model
+{
+
+ModelBaker::ModelBaker(const std::string& modelPath, bool quantize) : Model(), mQuantize(quantize)
+{
+    initScene(modelPath);
+}
+
+void ModelBaker::populateBuffer(std::vector<Vertex>& vertices)
+{
+    mBuffers = buildMeshBuffers(vertices, mQuantize, true, kBakedModelAlignment);
+}
+
+void ModelBaker::write(const std::string& bakedPath) const
+{
+    if (m_HasEmbeddedTextures)
+    {
+        std::cout << "Warning! Embedded textures are not baked, " << bakedPath << " references texture files only"
+                  << std::endl;
+    }
+    writeBaked(bakedPath, &mBuffers);
+}
+
+} // namespace VulkanCore::model
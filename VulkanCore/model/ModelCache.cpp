@@ -0,0 +1,170 @@
+#include "ModelCache.h"
+#include "BakedModel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+namespace VulkanCore::model
+{
+
+namespace
+{
+
+constexpr uint64_t kFnvPrime = 0x100000001B3ull;
+
+// Inserts in flight in this process, part of the temporary names
+std::atomic<uint64_t> gNextInsert{0};
+
+} // namespace
+
+uint64_t HashBytes(const void* pData, size_t size, uint64_t seed)
+{
+    const uint8_t* pBytes = static_cast<const uint8_t*>(pData);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash = (hash ^ pBytes[i]) * kFnvPrime;
+    }
+    return hash;
+}
+
+uint64_t HashFile(const std::string& path, uint64_t seed)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+    {
+        throw std::runtime_error("Failed to open " + path);
+    }
+
+    std::vector<char> buffer(1 << 20);
+    uint64_t hash = seed;
+    while (file)
+    {
+        file.read(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+        hash = HashBytes(buffer.data(), static_cast<size_t>(file.gcount()), hash);
+    }
+    return hash;
+}
+
+ModelCache::ModelCache(std::filesystem::path directory, uint64_t maxBytes)
+    : mDirectory(std::move(directory)), mMaxBytes(maxBytes)
+{
+}
+
+ModelCache& ModelCache::getDefault()
+{
+    static ModelCache cache = []()
+    {
+        std::filesystem::path directory;
+        if (const char* pCacheHome = std::getenv("XDG_CACHE_HOME"))
+        {
+            directory = pCacheHome;
+        }
+        else if (const char* pHome = std::getenv("HOME"))
+        {
+            directory = std::filesystem::path(pHome) / ".cache";
+        }
+        else
+        {
+            directory = ".cache";
+        }
+        return ModelCache(directory / "VulkanEngine" / "models", kDefaultModelCacheBytes);
+    }();
+    return cache;
+}
+
+std::filesystem::path ModelCache::getEntryPath(uint64_t key) const
+{
+    char name[17];
+    snprintf(name, sizeof(name), "%016llx", static_cast<unsigned long long>(key));
+    return mDirectory / (std::string(name) + kBakedModelExtension);
+}
+
+std::string ModelCache::find(uint64_t key) const
+{
+    std::filesystem::path path = getEntryPath(key);
+    std::error_code error;
+    if (!std::filesystem::is_regular_file(path, error))
+    {
+        return {};
+    }
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now(), error);
+    return path.string();
+}
+
+bool ModelCache::insert(uint64_t key, const std::function<void(const std::string& path)>& write) const
+{
+    std::filesystem::path path = getEntryPath(key);
+    // Unique to this insert : writers of the same key in other threads or processes never share a temporary file, the
+    // last rename wins with a complete entry
+    std::filesystem::path tempPath = path;
+    tempPath += "." + std::to_string(getpid()) + "." + std::to_string(gNextInsert.fetch_add(1)) + ".tmp";
+    try
+    {
+        std::filesystem::create_directories(mDirectory);
+        write(tempPath.string());
+        std::filesystem::rename(tempPath, path);
+    }
+    catch (const std::exception& e)
+    {
+        std::cout << "Warning! Cannot write the model cache entry " << path << " : " << e.what() << std::endl;
+        std::error_code error;
+        std::filesystem::remove(tempPath, error);
+        return false;
+    }
+
+    trim();
+    return true;
+}
+
+void ModelCache::remove(uint64_t key) const
+{
+    std::error_code error;
+    std::filesystem::remove(getEntryPath(key), error);
+}
+
+void ModelCache::trim() const
+{
+    struct Entry
+    {
+        std::filesystem::path mPath;
+        std::filesystem::file_time_type mLastUse;
+        uint64_t mSize;
+    };
+    std::vector<Entry> entries;
+    uint64_t totalSize = 0;
+
+    std::error_code error;
+    for (const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(mDirectory, error))
+    {
+        if (file.is_regular_file(error) && file.path().extension() == kBakedModelExtension)
+        {
+            Entry entry{file.path(), file.last_write_time(error), file.file_size(error)};
+            totalSize += entry.mSize;
+            entries.push_back(std::move(entry));
+        }
+    }
+
+    // Oldest first. The most recent entry is kept even when it alone exceeds the cap, it is the one just used.
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry& a, const Entry& b) { return a.mLastUse < b.mLastUse; });
+    for (size_t i = 0; i + 1 < entries.size() && totalSize > mMaxBytes; i++)
+    {
+        if (std::filesystem::remove(entries[i].mPath, error))
+        {
+            totalSize -= entries[i].mSize;
+            std::cout << "Model cache : evicted " << entries[i].mPath.filename() << std::endl;
+        }
+    }
+}
+
+} // namespace VulkanCore::model
@@ -0,0 +1,171 @@
+#include "ParallelFor.h"
+
+#include <algorithm>
+
+namespace VulkanCore::model
+{
+
+void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func, uint32_t numThreads)
+{
+    if (numThreads == 0)
+    {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    numThreads = std::min(numThreads, count);
+    if (numThreads <= 1)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            func(i);
+        }
+        return;
+    }
+
+    std::atomic<uint32_t> nextItem{0};
+    std::exception_ptr firstException;
+    std::mutex exceptionMutex;
+    auto worker = [&]()
+    {
+        for (uint32_t i = nextItem.fetch_add(1); i < count; i = nextItem.fetch_add(1))
+        {
+            try
+            {
+                func(i);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(exceptionMutex);
+                if (!firstException)
+                {
+                    firstException = std::current_exception();
+                }
+                nextItem = count; // the remaining items are skipped
+            }
+        }
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(numThreads - 1);
+    for (uint32_t i = 1; i < numThreads; i++)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+
+    if (firstException)
+    {
+        std::rethrow_exception(firstException);
+    }
+}
+
+WorkerPool::WorkerPool(uint32_t numThreads)
+{
+    if (numThreads == 0)
+    {
+        numThreads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+    mWorkers.reserve(numThreads - 1);
+    for (uint32_t i = 1; i < numThreads; i++)
+    {
+        mWorkers.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStop = true;
+    }
+    mWake.notify_all();
+    for (std::thread& worker : mWorkers)
+    {
+        worker.join();
+    }
+}
+
+void WorkerPool::parallelFor(uint32_t count, const std::function<void(uint32_t)>& func)
+{
+    if (mWorkers.empty() || count <= 1)
+    {
+        for (uint32_t i = 0; i < count; i++)
+        {
+            func(i);
+        }
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mMutex);
+        mpFunc = &func;
+        mCount = count;
+        mNextItem = 0;
+        mFirstException = nullptr;
+        mBusyWorkers = static_cast<uint32_t>(mWorkers.size());
+        mGeneration++;
+    }
+    mWake.notify_all();
+    runItems();
+
+    std::exception_ptr exception;
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mDone.wait(lock, [this]() { return mBusyWorkers == 0; });
+        mpFunc = nullptr;
+        exception = mFirstException;
+        mFirstException = nullptr;
+    }
+    if (exception)
+    {
+        std::rethrow_exception(exception);
+    }
+}
+
+void WorkerPool::workerLoop()
+{
+    uint64_t generation = 0;
+    std::unique_lock<std::mutex> lock(mMutex);
+    for (;;)
+    {
+        mWake.wait(lock, [&]() { return mStop || mGeneration != generation; });
+        if (mStop)
+        {
+            return;
+        }
+        generation = mGeneration;
+
+        lock.unlock();
+        runItems();
+        lock.lock();
+        if (--mBusyWorkers == 0)
+        {
+            mDone.notify_one();
+        }
+    }
+}
+
+void WorkerPool::runItems()
+{
+    for (uint32_t i = mNextItem.fetch_add(1); i < mCount; i = mNextItem.fetch_add(1))
+    {
+        try
+        {
+            (*mpFunc)(i);
+        }
+        catch (...)
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (!mFirstException)
+            {
+                mFirstException = std::current_exception();
+            }
+            mNextItem = mCount; // the remaining items are skipped
+        }
+    }
+}
+
+} // namespace VulkanCore::model
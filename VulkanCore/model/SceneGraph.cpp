@@ -0,0 +1,73 @@
+#include "SceneGraph.h"
+
+#include <algorithm>
+
+namespace VulkanCore::model
+{
+
+void SceneGraph::clear()
+{
+    mParents.clear();
+    mLocalTransforms.clear();
+    mWorldTransforms.clear();
+    mDirty.clear();
+    mUpdates.clear();
+    mNames.clear();
+    mNodeIndices.clear();
+    mFirstDirty = 0;
+}
+
+uint32_t SceneGraph::addNode(int32_t parent, const glm::mat4& localTransform, const std::string& name)
+{
+    uint32_t node = getNumNodes();
+    mParents.push_back(parent);
+    mLocalTransforms.push_back(localTransform);
+    mWorldTransforms.push_back(parent < 0 ? localTransform : mWorldTransforms[parent] * localTransform);
+    mDirty.push_back(0);
+    mUpdates.push_back(mNumUpdates);
+    mNames.push_back(name);
+    mNodeIndices.emplace(name, node);
+    if (mFirstDirty == node)
+    {
+        mFirstDirty = node + 1; // up to date, unless a parent is flagged
+    }
+    return node;
+}
+
+int32_t SceneGraph::findNode(const std::string& name) const
+{
+    auto node = mNodeIndices.find(name);
+    return node != mNodeIndices.end() ? static_cast<int32_t>(node->second) : -1;
+}
+
+void SceneGraph::setLocalTransform(uint32_t node, const glm::mat4& localTransform)
+{
+    mLocalTransforms[node] = localTransform;
+    mDirty[node] = 1;
+    mFirstDirty = std::min(mFirstDirty, node);
+}
+
+uint32_t SceneGraph::update()
+{
+    mNumUpdates++;
+    uint32_t numChanged = 0;
+    uint32_t numNodes = getNumNodes();
+    for (uint32_t node = mFirstDirty; node < numNodes; node++)
+    {
+        // The parent is done already, a node changes with it
+        int32_t parent = mParents[node];
+        if (!mDirty[node] && (parent < 0 || mUpdates[parent] != mNumUpdates))
+        {
+            continue;
+        }
+        mWorldTransforms[node] =
+            parent < 0 ? mLocalTransforms[node] : mWorldTransforms[parent] * mLocalTransforms[node];
+        mDirty[node] = 0;
+        mUpdates[node] = mNumUpdates;
+        numChanged++;
+    }
+    mFirstDirty = numNodes;
+    return numChanged;
+}
+
+} // namespace VulkanCore::model
@@ -0,0 +1,88 @@
+#include "TexturePacking.h"
+
+#include <algorithm>
+#include <vector>
+
+namespace VulkanCore::model
+{
+
+namespace
+{
+
+TextureChannelSource getChannelSource(const TextureImage* pImage, uint32_t channel, uint8_t defaultValue)
+{
+    TextureChannelSource source;
+    source.DefaultValue = defaultValue;
+    if (pImage)
+    {
+        source.pTexels = pImage->pTexels;
+        source.Width = pImage->Width;
+        source.Height = pImage->Height;
+        source.Channel = channel;
+    }
+    return source;
+}
+
+} // namespace
+
+PackedTextureSources GetOrmSources(const TextureImage* pOcclusion, const TextureImage* pRoughness,
+                                   const TextureImage* pMetalness)
+{
+    bool metallicRoughness = pRoughness && pRoughness == pMetalness;
+    return {getChannelSource(pOcclusion, 0, 255), getChannelSource(pRoughness, metallicRoughness ? 1 : 0, 255),
+            getChannelSource(pMetalness, metallicRoughness ? 2 : 0, 0)};
+}
+
+void GetPackedTextureSize(const PackedTextureSources& sources, uint32_t& width, uint32_t& height)
+{
+    width = 0;
+    height = 0;
+    for (const TextureChannelSource& source : sources)
+    {
+        if (source.pTexels)
+        {
+            width = std::max(width, source.Width);
+            height = std::max(height, source.Height);
+        }
+    }
+}
+
+void PackTextureChannels(const PackedTextureSources& sources, uint32_t width, uint32_t height, uint8_t* pTexels)
+{
+    std::vector<uint32_t> sourceColumns(width);
+    for (uint32_t channel = 0; channel < kPackedChannels; channel++)
+    {
+        const TextureChannelSource& source = sources[channel];
+        if (!source.pTexels)
+        {
+            for (uint64_t texel = 0; texel < static_cast<uint64_t>(width) * height; texel++)
+            {
+                pTexels[texel * 4 + channel] = source.DefaultValue;
+            }
+            continue;
+        }
+
+        // Nearest texel, same texel centers in both images
+        for (uint32_t x = 0; x < width; x++)
+        {
+            sourceColumns[x] = static_cast<uint32_t>((static_cast<uint64_t>(x) * source.Width) / width);
+        }
+        for (uint32_t y = 0; y < height; y++)
+        {
+            uint32_t sourceY = static_cast<uint32_t>((static_cast<uint64_t>(y) * source.Height) / height);
+            const uint8_t* pSourceRow = source.pTexels + static_cast<uint64_t>(sourceY) * source.Width * 4;
+            uint8_t* pRow = pTexels + static_cast<uint64_t>(y) * width * 4;
+            for (uint32_t x = 0; x < width; x++)
+            {
+                pRow[x * 4 + channel] = pSourceRow[sourceColumns[x] * 4 + source.Channel];
+            }
+        }
+    }
+
+    for (uint64_t texel = 0; texel < static_cast<uint64_t>(width) * height; texel++)
+    {
+        pTexels[texel * 4 + 3] = 255;
+    }
+}
+
+} // namespace VulkanCore::model
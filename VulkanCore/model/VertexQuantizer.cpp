@@ -0,0 +1,92 @@
+#include "VertexQuantizer.h"
+
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+#include <glm/packing.hpp>
+
+namespace VulkanCore::model
+{
+
+namespace
+{
+
+constexpr float kPositionSteps = 65535.0f; // unorm16
+
+glm::vec2 signNotZero(const glm::vec2& v)
+{
+    return glm::vec2(v.x >= 0.0f ? 1.0f : -1.0f, v.y >= 0.0f ? 1.0f : -1.0f);
+}
+
+uint16_t quantizeUnorm16(float value)
+{
+    return static_cast<uint16_t>(std::clamp(value, 0.0f, kPositionSteps) + 0.5f);
+}
+
+} // namespace
+
+glm::mat4 VertexDequantization::toMatrix() const
+{
+    glm::mat4 matrix(Scale);
+    matrix[3] = glm::vec4(Offset, 1.0f);
+    return matrix;
+}
+
+VertexDequantization ComputeVertexDequantization(const glm::vec3& boundsMin, const glm::vec3& boundsMax)
+{
+    glm::vec3 extent = boundsMax - boundsMin;
+    float maxExtent = std::max({extent.x, extent.y, extent.z});
+
+    VertexDequantization dequantization;
+    dequantization.Offset = boundsMin;
+    dequantization.Scale = maxExtent > FLT_EPSILON ? maxExtent / kPositionSteps : 1.0f;
+    return dequantization;
+}
+
+uint32_t EncodeOctahedral(const glm::vec3& direction)
+{
+    float l1 = std::abs(direction.x) + std::abs(direction.y) + std::abs(direction.z);
+    if (l1 < FLT_EPSILON)
+    {
+        return glm::packSnorm2x16(glm::vec2(0.0f));
+    }
+
+    glm::vec3 n = direction / l1;
+    glm::vec2 encoded(n.x, n.y);
+    if (n.z < 0.0f)
+    {
+        // Lower hemisphere folded over the diagonals
+        encoded = (1.0f - glm::abs(glm::vec2(encoded.y, encoded.x))) * signNotZero(encoded);
+    }
+    return glm::packSnorm2x16(encoded);
+}
+
+glm::vec3 DecodeOctahedral(uint32_t encoded)
+{
+    glm::vec2 e = glm::unpackSnorm2x16(encoded);
+    glm::vec3 n(e.x, e.y, 1.0f - std::abs(e.x) - std::abs(e.y));
+    float t = std::max(-n.z, 0.0f);
+    n.x += n.x >= 0.0f ? -t : t;
+    n.y += n.y >= 0.0f ? -t : t;
+    return glm::normalize(n);
+}
+
+QuantizedVertex QuantizeVertex(const VertexDequantization& dequantization, const glm::vec3& position,
+                               const glm::vec2& texCoord, const glm::vec3& normal, const glm::vec3& tangent,
+                               const glm::vec3& bitangent)
+{
+    glm::vec3 quantized = dequantization.quantizePoint(position);
+
+    QuantizedVertex vertex;
+    vertex.Position[0] = quantizeUnorm16(quantized.x);
+    vertex.Position[1] = quantizeUnorm16(quantized.y);
+    vertex.Position[2] = quantizeUnorm16(quantized.z);
+    vertex.BitangentSign = glm::dot(glm::cross(normal, tangent), bitangent) < 0.0f ? 1 : 0;
+    vertex.TexCoord = glm::packHalf2x16(texCoord);
+    vertex.Normal = EncodeOctahedral(normal);
+    vertex.Tangent = EncodeOctahedral(tangent);
+    return vertex;
+}
+
+} // namespace VulkanCore::model
@@ -0,0 +1,94 @@
+#ifndef MODEL_ANIMATION_H
+#define MODEL_ANIMATION_H
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+namespace VulkanCore::model
+{
+
+// Bone influences per vertex, aiProcess_LimitBoneWeights keeps the 4 largest
+constexpr uint32_t kMaxBoneInfluences = 4;
+
+// Node of the hierarchy driving the bones
+struct SkeletonNode
+{
+    int32_t Parent{-1};             // index in Skeleton::Nodes, -1 for the root
+    glm::mat4 Transformation{1.0f}; // relative to the parent, bind pose
+};
+
+// Nodes are stored parents first, so a single pass over them computes every model space transformation.
+// A bone skins the vertices from model space : its offset maps a vertex of the bind pose to the space of its node.
+// Meshes without bones of an animated model get a bone of their own node, so node animation moves them too.
+struct Skeleton
+{
+    std::vector<SkeletonNode> Nodes;
+    std::vector<std::string> NodeNames;
+    std::vector<uint32_t> BoneNodes;    // node of every bone
+    std::vector<glm::mat4> BoneOffsets; // per bone
+};
+
+template <typename T> struct AnimationKey
+{
+    float Time{0.0f}; // in seconds
+    T Value;
+};
+
+// Keys of one node, they replace its bind pose transformation while the clip plays
+struct AnimationChannel
+{
+    uint32_t Node{0};
+    std::vector<AnimationKey<glm::vec3>> Positions;
+    std::vector<AnimationKey<glm::quat>> Rotations;
+    std::vector<AnimationKey<glm::vec3>> Scales;
+};
+
+struct AnimationClip
+{
+    std::string Name;
+    float Duration{0.0f}; // in seconds
+    std::vector<AnimationChannel> Channels;
+};
+
+// Sampled skeleton. Kept from one sample to the next, so sampling allocates nothing once the sizes are reached.
+struct AnimationPose
+{
+    std::vector<glm::mat4> NodeTransforms; // model space
+    std::vector<glm::mat4> BoneMatrices;   // node transformation * bone offset, the skinning matrices
+};
+
+// Value of a track at time, clamped to its first and last keys. Keys are interpolated linearly, rotations with a
+// slerp. defaultValue without keys.
+glm::vec3 SampleTrack(const std::vector<AnimationKey<glm::vec3>>& keys, float time, const glm::vec3& defaultValue);
+glm::quat SampleTrack(const std::vector<AnimationKey<glm::quat>>& keys, float time, const glm::quat& defaultValue);
+
+// Samples the clip at time, wrapped to its duration. Keys are interpolated linearly, rotations with a slerp.
+// Nodes without channel keep their bind pose, so does every node without clip (pClip nullptr).
+void SampleAnimation(const Skeleton& skeleton, const AnimationClip* pClip, float time, AnimationPose& pose);
+
+struct SoaAnimationClip;
+class WorkerPool;
+
+// pSoaClip, when set, is sampled with SampleAnimationSoa() instead of pClip with SampleAnimation()
+struct AnimationJob
+{
+    const Skeleton* pSkeleton{nullptr};
+    const AnimationClip* pClip{nullptr};
+    float Time{0.0f};
+    AnimationPose* pPose{nullptr};
+    const SoaAnimationClip* pSoaClip{nullptr};
+};
+
+// Samples every job on the threads of pool, which is meant to live as long as the animated scene since it runs
+// every frame. The poses must differ, a character is sampled by a single thread so its hierarchy stays in the cache
+// of one core.
+void SampleAnimations(std::span<const AnimationJob> jobs, WorkerPool& pool);
+
+} // namespace VulkanCore::model
+
+#endif // MODEL_ANIMATION_H
@@ -0,0 +1,80 @@
+#ifndef MODEL_ANIMATION_SAMPLER_H
+#define MODEL_ANIMATION_SAMPLER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Animation.h"
+
+namespace VulkanCore::model
+{
+
+// Nodes sampled together, one per SIMD lane
+constexpr uint32_t kAnimationLanes = 4;
+
+// Upper bound of the frame rate of a SoaAnimationClip, finer keys are resampled at this rate
+constexpr float kMaxAnimationSampleRate = 120.0f;
+
+// Implementations of SampleAnimationSoa(), every path gives the same pose up to rounding
+enum AnimationPath : uint32_t
+{
+    AnimationPath_Scalar = 0,
+    AnimationPath_SSE, // 4 nodes per instruction
+    AnimationPath_Count
+};
+
+const char* GetAnimationPathName(AnimationPath path);
+bool IsAnimationPathSupported(AnimationPath path);
+// Fastest path of the running CPU
+AnimationPath GetBestAnimationPath();
+
+// kAnimationLanes consecutive nodes starting at FirstNode, LaneMask has a bit per node with a channel
+struct SoaNodeGroup
+{
+    uint32_t FirstNode{0};
+    uint32_t LaneMask{0};
+};
+
+// Local transformation of the nodes of a group at one frame, one array per component so a component of the 4
+// nodes is a single load. Rotations are on the same hemisphere as the previous frame.
+struct alignas(16) SoaTransform
+{
+    float TranslationX[kAnimationLanes];
+    float TranslationY[kAnimationLanes];
+    float TranslationZ[kAnimationLanes];
+    float RotationX[kAnimationLanes];
+    float RotationY[kAnimationLanes];
+    float RotationZ[kAnimationLanes];
+    float RotationW[kAnimationLanes];
+    float ScaleX[kAnimationLanes];
+    float ScaleY[kAnimationLanes];
+    float ScaleZ[kAnimationLanes];
+};
+
+// AnimationClip resampled for SampleAnimationSoa() : every channel is sampled at the same frames, evenly spaced
+// over the clip at the rate of its closest keys (up to kMaxAnimationSampleRate), so the key search is a single
+// division shared by all nodes. Clips baked at a fixed rate, the usual case, keep their exact keys. Only the
+// groups with a channel are kept, a frame holds all of them, one after the other.
+struct SoaAnimationClip
+{
+    std::string Name;
+    float Duration{0.0f};   // in seconds
+    float SampleRate{0.0f}; // frames per second, 0 with a single frame
+    uint32_t NumFrames{0};
+    uint32_t NumNodes{0};
+    std::vector<SoaNodeGroup> Groups;
+    std::vector<SoaTransform> Frames; // NumFrames * Groups.size()
+};
+
+SoaAnimationClip BuildSoaAnimationClip(const AnimationClip& clip, uint32_t numNodes);
+
+// Same pose as SampleAnimation(), 4 nodes at a time : the two frames around time are interpolated and turned into
+// matrices for the 4 nodes of a group together. Rotations use an approximation of the slerp, under 0.001 radians
+// away, so no trigonometry is evaluated.
+void SampleAnimationSoa(const Skeleton& skeleton, const SoaAnimationClip* pClip, float time, AnimationPose& pose,
+                        AnimationPath path = GetBestAnimationPath());
+
+} // namespace VulkanCore::model
+
+#endif // MODEL_ANIMATION_SAMPLER_H
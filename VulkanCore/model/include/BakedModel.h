@@ -0,0 +1,210 @@
+#ifndef MODEL_BAKED_MODEL_H
+#define MODEL_BAKED_MODEL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace VulkanCore::model
+{
+
+// Baked model : everything Model::initScene() produces (submesh table with LODs and meshlets, node hierarchy,
+// material references) and the GPU-ready vertex, index and position buffers, in one file that is memory mapped and
+// copied straight into staging memory. Written by ModelBaker, see VulkanTools/ModelBake.cpp. The entries of the
+// ModelCache hold the processed Model::Vertex and indices instead of the GPU buffers. The layout is the one of the
+// host, a file of any other version is rejected : bump kBakedModelVersion on every change of the structures below,
+// of MeshBufferRange, Meshlet, MeshLod, VertexDequantization or Model::Vertex.
+constexpr uint32_t kBakedModelMagic = 0x4D424B56; // "VKBM"
+constexpr uint32_t kBakedModelVersion = 3;
+constexpr const char* kBakedModelExtension = ".vkbake";
+
+// Buffer ranges of a baked model start on this alignment. It is the largest minStorageBufferOffsetAlignment the
+// Vulkan spec allows, so the ranges are valid on every device.
+constexpr uint64_t kBakedModelAlignment = 256;
+
+// Sections start on this alignment in the file, the mapping itself is page aligned
+constexpr uint64_t kBakedSectionAlignment = 64;
+
+enum BakedSection
+{
+    BakedSection_Meshes,           // BakedMesh per submesh
+    BakedSection_Lods,             // MeshLod, ranges given by BakedMesh
+    BakedSection_Ranges,           // MeshBufferRange per submesh
+    BakedSection_Dequantizations,  // VertexDequantization per submesh, empty unless quantized
+    BakedSection_Materials,        // BakedMaterial
+    BakedSection_Strings,          // NUL terminated, referenced by offset
+    BakedSection_Meshlets,         // Meshlet
+    BakedSection_MeshletVertices,  // uint32_t
+    BakedSection_MeshletTriangles, // uint32_t
+    BakedSection_Vertices,         // GPU buffers, uploaded as is
+    BakedSection_Indices,
+    BakedSection_Positions,
+    BakedSection_SourceVertices,   // Model::Vertex, see BakedModelFlag_SourceGeometry
+    BakedSection_SourceIndices,    // uint32_t, every LOD
+    BakedSection_Nodes,            // BakedNode, parents first
+    BakedSection_Count
+};
+
+enum BakedModelFlags
+{
+    BakedModelFlag_Quantized = 1 << 0,      // QuantizedVertex instead of Model::Vertex
+    BakedModelFlag_PositionStream = 1 << 1, // BakedSection_Positions is present
+    BakedModelFlag_GpuBuffers = 1 << 2,     // BakedSection_Vertices and Indices are present
+    BakedModelFlag_SourceGeometry = 1 << 3, // BakedSection_SourceVertices and SourceIndices are present
+};
+
+struct BakedSectionEntry
+{
+    uint64_t Offset{0}; // from the start of the file
+    uint64_t Size{0};   // in bytes
+};
+
+struct BakedModelHeader
+{
+    uint32_t Magic{kBakedModelMagic};
+    uint32_t Version{kBakedModelVersion};
+    uint32_t Flags{0};
+    uint32_t VertexSize{0};
+    uint32_t PositionSize{0};
+    uint32_t NumIndices{0}; // of every LOD, for the stats only
+    uint64_t Alignment{kBakedModelAlignment};
+    BakedSectionEntry Sections[BakedSection_Count];
+};
+
+constexpr uint32_t kBakedNoString = UINT32_MAX;
+
+// BasicMeshEntry without its LOD vector
+struct BakedMesh
+{
+    uint32_t BaseVertex{0};
+    uint32_t BaseIndex{0};
+    uint32_t NumVertices{0};
+    uint32_t NumIndices{0};
+    uint32_t ValidFaces{0};
+    int32_t MaterialIndex{-1};
+    uint32_t NumLodIndices{0};
+    uint32_t FirstLod{0};
+    uint32_t NumLods{0};
+    uint32_t FirstMeshlet{0};
+    uint32_t NumMeshlets{0};
+    int32_t Node{-1};
+    glm::mat4 Transformation{1.0f};
+    glm::vec4 BoundsMin{0.0f}; // w unused
+    glm::vec4 BoundsMax{0.0f};
+    glm::vec4 BoundingSphere{0.0f};
+};
+
+// SceneGraph node
+struct BakedNode
+{
+    int32_t Parent{-1};
+    uint32_t Name{kBakedNoString};
+    uint32_t Padding[2]{};
+    glm::mat4 Transformation{1.0f}; // relative to the parent
+};
+
+// CoreMaterial with texture paths instead of textures
+struct BakedMaterial
+{
+    uint32_t Name{kBakedNoString};
+    uint32_t MaterialType{0};
+    uint32_t IsPBR{0};
+    float TransparencyFactor{1.0f};
+    float AlphaTest{0.0f};
+    float Ior{1.5f};
+    uint32_t Padding[2]{};
+    glm::vec4 AmbientColor{0.0f};
+    glm::vec4 DiffuseColor{0.0f};
+    glm::vec4 SpecularColor{0.0f};
+    glm::vec4 EmissiveColor{0.0f};
+    glm::vec4 ReflectiveColor{0.0f};
+    uint32_t TexturePaths[12]; // TEX_TYPE_ORM, relative to the directory of the model, kBakedNoString if none
+};
+
+// Model.obj -> Model.vkbake
+std::string GetBakedModelPath(const std::string& modelPath);
+bool IsBakedModelPath(const std::string& path);
+
+// Sections are referenced, not copied : they must stay alive until write()
+class BakedModelWriter
+{
+  public:
+    void addSection(BakedSection section, const void* pData, size_t size);
+    template <typename T> void addSection(BakedSection section, const std::vector<T>& data)
+    {
+        addSection(section, data.data(), data.size() * sizeof(T));
+    }
+    uint32_t addString(const std::string& string);
+
+    // Writes the header, then every section. Throws on I/O errors.
+    void write(const std::string& path, BakedModelHeader header) const;
+
+  private:
+    struct Section
+    {
+        const void* mpData{nullptr};
+        size_t mSize{0};
+    };
+    Section mSections[BakedSection_Count];
+    std::string mStrings;
+};
+
+// Read-only mapping of a baked model, the header and section bounds are validated on open. Throws on errors.
+class BakedModelFile
+{
+  public:
+    explicit BakedModelFile(const std::string& path);
+    ~BakedModelFile();
+
+    BakedModelFile(const BakedModelFile&) = delete;
+    BakedModelFile& operator=(const BakedModelFile&) = delete;
+
+    const BakedModelHeader& getHeader() const
+    {
+        return *reinterpret_cast<const BakedModelHeader*>(mpData);
+    }
+
+    std::span<const uint8_t> getBytes(BakedSection section) const
+    {
+        const BakedSectionEntry& entry = getHeader().Sections[section];
+        return {mpData + entry.Offset, static_cast<size_t>(entry.Size)};
+    }
+
+    template <typename T> std::span<const T> getSection(BakedSection section) const
+    {
+        std::span<const uint8_t> bytes = getBytes(section);
+        if (bytes.size() % sizeof(T) != 0)
+        {
+            throw std::runtime_error("Baked model " + mPath + " : section " + std::to_string(section) +
+                                     " is not a whole number of elements");
+        }
+        return {reinterpret_cast<const T*>(bytes.data()), bytes.size() / sizeof(T)};
+    }
+
+    // Empty for kBakedNoString
+    std::string getString(uint32_t offset) const;
+
+    const std::string& getPath() const
+    {
+        return mPath;
+    }
+
+  private:
+    std::string mPath;
+    const uint8_t* mpData{nullptr};
+    size_t mSize{0};
+};
+
+// Checks every range the loaders follow : LODs, meshlets and their vertex and triangle lists, materials and nodes of
+// each mesh, its vertices and indices in the source geometry (Model::Vertex of sourceVertexSize bytes) and in the GPU
+// buffers, when the file has them. Everything is computed in 64 bits. Throws on the first invalid range.
+void ValidateBakedModel(const BakedModelFile& file, uint32_t sourceVertexSize);
+
+} // namespace VulkanCore::model
+
+#endif // MODEL_BAKED_MODEL_H
@@ -24,7 +24,8 @@ enum TEXTURE_TYPE
     TEX_TYPE_CLEARCOAT = 9,
     TEX_TYPE_CLEARCOAT_ROUGHNESS = 10,
     TEX_TYPE_CLEARCOAT_NORMAL = 11,
-    TEX_TYPE_NUM = 12
+    TEX_TYPE_ORM = 12, // occlusion R, roughness G, metalness B : packed by VulkanModel from the three above, no file
+    TEX_TYPE_NUM = 13
 };
 
 enum MaterialType
@@ -55,6 +56,7 @@ class CoreMaterial
     glm::vec4 mReflectiveColor = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
 
     Texture* mpTextures[TEX_TYPE_NUM] = {0};
+    std::string mTexturePaths[TEX_TYPE_NUM]; // relative to the directory of the model, kept for baking
 
     float m_transparencyFactor = 1.0f;
     float m_alphaTest = 0.0f;
@@ -0,0 +1,62 @@
+#ifndef MODEL_MESH_BUFFERS_H
+#define MODEL_MESH_BUFFERS_H
+
+#include <cstdint>
+#include <vector>
+
+#include "VertexQuantizer.h"
+
+namespace VulkanCore::model
+{
+
+// Submeshes with at most this many vertices get 16-bit indices, see ShaderFeature_Index16
+constexpr uint32_t kMaxIndex16Vertices = UINT16_MAX + 1;
+
+// Byte ranges of a submesh in the model buffers. Every range starts on the storage buffer alignment, vertex and
+// position ranges also on a whole vertex.
+struct MeshBufferRange
+{
+    uint64_t VertexBufferOffset{0};
+    uint64_t IndexBufferOffset{0};
+    uint64_t VertexBufferRange{0};
+    uint64_t IndexBufferRange{0}; // every LOD, rounded up to whole words
+    uint64_t PositionBufferOffset{0};
+    uint64_t PositionBufferRange{0};
+    uint32_t IndexSize{sizeof(uint32_t)}; // sizeof(uint16_t) when the submesh has few enough vertices
+    uint32_t Padding{0};
+};
+
+// GPU-ready geometry of a model : the exact bytes of its vertex, index and position buffers, built by
+// Model::buildMeshBuffers() or mapped from a baked model. Model::writeMeshBuffers() leaves the byte vectors empty.
+struct MeshBuffers
+{
+    uint32_t VertexSize{0};                            // sizeof(Model::Vertex) or sizeof(QuantizedVertex)
+    uint32_t PositionSize{0};                          // 0 without position stream
+    std::vector<MeshBufferRange> Ranges;               // per submesh
+    std::vector<VertexDequantization> Dequantizations; // per submesh, empty unless quantized
+    std::vector<uint8_t> Vertices;
+    std::vector<uint8_t> Indices;
+    std::vector<uint8_t> Positions;
+};
+
+struct MeshBufferTargets
+{
+    uint8_t* pVertices{nullptr};
+    uint8_t* pIndices{nullptr};
+    uint8_t* pPositions{nullptr}; // unused without position stream
+};
+
+// Destination of Model::writeMeshBuffers(), e.g. mapped staging memory, so the buffers are written once at their
+// final offsets instead of being built on the heap and copied. map() is called once the layout is known, with the
+// size of every buffer (0 for the position one without position stream), and returns where to write them. The
+// bytes between the ranges are not written.
+class MeshBufferWriter
+{
+  public:
+    virtual ~MeshBufferWriter() = default;
+    virtual MeshBufferTargets map(uint64_t vertexBufferSize, uint64_t indexBufferSize, uint64_t positionBufferSize) = 0;
+};
+
+} // namespace VulkanCore::model
+
+#endif // MODEL_MESH_BUFFERS_H
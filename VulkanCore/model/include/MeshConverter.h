@@ -0,0 +1,157 @@
+#ifndef MODEL_MESH_CONVERTER_H
+#define MODEL_MESH_CONVERTER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "assimp/mesh.h"
+
+#include "ParallelFor.h"
+
+namespace VulkanCore::model
+{
+
+// Vertices converted per task, a large mesh is split so it does not end up on a single core
+constexpr uint32_t kMeshConversionChunk = 64 * 1024;
+
+// Destination of an aiMesh in the model vertex and index arrays, see Model::countVerticesAndIndices()
+struct MeshConversionRange
+{
+    const aiMesh* pMesh{nullptr};
+    uint32_t BaseVertex{0};
+    uint32_t BaseIndex{0};
+};
+
+// One loop per combination of attributes, the presence checks are resolved once per mesh instead of per vertex.
+// Missing attributes are zeroed.
+template <typename VertexType, bool HasNormals, bool HasTexCoords, bool HasTangents>
+void ConvertVertexRange(const aiMesh* pMesh, uint32_t first, uint32_t count, VertexType* pDst)
+{
+    for (uint32_t i = first; i < first + count; i++)
+    {
+        VertexType& vertex = *pDst++;
+        vertex.pos = glm::vec3(pMesh->mVertices[i].x, pMesh->mVertices[i].y, pMesh->mVertices[i].z);
+        if constexpr (HasNormals)
+        {
+            vertex.normal = glm::vec3(pMesh->mNormals[i].x, pMesh->mNormals[i].y, pMesh->mNormals[i].z);
+        }
+        else
+        {
+            vertex.normal = glm::vec3(0.0f);
+        }
+        if constexpr (HasTexCoords)
+        {
+            vertex.texCoord = glm::vec2(pMesh->mTextureCoords[0][i].x, pMesh->mTextureCoords[0][i].y);
+        }
+        else
+        {
+            vertex.texCoord = glm::vec2(0.0f);
+        }
+        if constexpr (HasTangents)
+        {
+            vertex.tangent = glm::vec3(pMesh->mTangents[i].x, pMesh->mTangents[i].y, pMesh->mTangents[i].z);
+            vertex.bitangent = glm::vec3(pMesh->mBitangents[i].x, pMesh->mBitangents[i].y, pMesh->mBitangents[i].z);
+        }
+        else
+        {
+            vertex.tangent = glm::vec3(0.0f);
+            vertex.bitangent = glm::vec3(0.0f);
+        }
+    }
+}
+
+// Vertices [first, first + count) of pMesh to pDst
+template <typename VertexType>
+void ConvertMeshVertices(const aiMesh* pMesh, uint32_t first, uint32_t count, VertexType* pDst)
+{
+    uint32_t attributes = (pMesh->HasNormals() ? 1 : 0) | (pMesh->HasTextureCoords(0) ? 2 : 0) |
+                          (pMesh->HasTangentsAndBitangents() ? 4 : 0);
+    switch (attributes)
+    {
+    case 0:
+        ConvertVertexRange<VertexType, false, false, false>(pMesh, first, count, pDst);
+        break;
+    case 1:
+        ConvertVertexRange<VertexType, true, false, false>(pMesh, first, count, pDst);
+        break;
+    case 2:
+        ConvertVertexRange<VertexType, false, true, false>(pMesh, first, count, pDst);
+        break;
+    case 3:
+        ConvertVertexRange<VertexType, true, true, false>(pMesh, first, count, pDst);
+        break;
+    case 4:
+        ConvertVertexRange<VertexType, false, false, true>(pMesh, first, count, pDst);
+        break;
+    case 5:
+        ConvertVertexRange<VertexType, true, false, true>(pMesh, first, count, pDst);
+        break;
+    case 6:
+        ConvertVertexRange<VertexType, false, true, true>(pMesh, first, count, pDst);
+        break;
+    default:
+        ConvertVertexRange<VertexType, true, true, true>(pMesh, first, count, pDst);
+        break;
+    }
+}
+
+// Indices of every face of pMesh, in order, to pDst
+inline void ConvertMeshIndices(const aiMesh* pMesh, uint32_t* pDst)
+{
+    for (uint32_t i = 0; i < pMesh->mNumFaces; i++)
+    {
+        const aiFace& face = pMesh->mFaces[i];
+        pDst = std::copy(face.mIndices, face.mIndices + face.mNumIndices, pDst);
+    }
+}
+
+// Converts every mesh to its range of vertices and indices. The ranges are disjoint, so the meshes, and the chunks
+// of kMeshConversionChunk vertices of the large ones, are converted in parallel on up to numThreads threads,
+// 0 for the hardware concurrency.
+template <typename VertexType>
+void ConvertMeshes(std::span<const MeshConversionRange> meshes, VertexType* pVertices, uint32_t* pIndices,
+                   uint32_t numThreads = 0)
+{
+    struct Task
+    {
+        uint32_t Mesh;
+        uint32_t FirstVertex;
+        uint32_t NumVertices; // 0 : the indices of the mesh
+    };
+    std::vector<Task> tasks;
+    for (uint32_t meshIndex = 0; meshIndex < meshes.size(); meshIndex++)
+    {
+        const aiMesh* pMesh = meshes[meshIndex].pMesh;
+        for (uint32_t first = 0; first < pMesh->mNumVertices; first += kMeshConversionChunk)
+        {
+            tasks.push_back({meshIndex, first, std::min(kMeshConversionChunk, pMesh->mNumVertices - first)});
+        }
+        tasks.push_back({meshIndex, 0, 0});
+    }
+
+    ParallelFor(
+        static_cast<uint32_t>(tasks.size()),
+        [&](uint32_t taskIndex)
+        {
+            const Task& task = tasks[taskIndex];
+            const MeshConversionRange& mesh = meshes[task.Mesh];
+            if (task.NumVertices > 0)
+            {
+                ConvertMeshVertices<VertexType>(mesh.pMesh, task.FirstVertex, task.NumVertices,
+                                                pVertices + mesh.BaseVertex + task.FirstVertex);
+            }
+            else
+            {
+                ConvertMeshIndices(mesh.pMesh, pIndices + mesh.BaseIndex);
+            }
+        },
+        numThreads);
+}
+
+} // namespace VulkanCore::model
+
+#endif // MODEL_MESH_CONVERTER_H
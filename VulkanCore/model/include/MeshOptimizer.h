@@ -0,0 +1,75 @@
+#ifndef MODEL_MESH_OPTIMIZER_H
+#define MODEL_MESH_OPTIMIZER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace VulkanCore::model
+{
+
+// Load time optimization of an indexed triangle list, in the spirit of meshoptimizer. Vertices are raw bytes of
+// vertexSize, compared bitwise, with three floats of position at positionOffset. Indices are relative to the mesh.
+
+// Stages of OptimizeMesh, in order
+enum MeshOptimizerStage
+{
+    MeshOptimizerStage_Input = 0,
+    MeshOptimizerStage_Deduplicate, // bitwise identical vertices are merged, unreferenced ones are dropped
+    MeshOptimizerStage_VertexCache, // triangles reordered for the post-transform cache (Forsyth)
+    MeshOptimizerStage_Overdraw,    // clusters of the cache order sorted front-facing first
+    MeshOptimizerStage_VertexFetch, // vertices reordered by first use
+    MeshOptimizerStage_Count
+};
+
+const char* GetMeshOptimizerStageName(MeshOptimizerStage stage);
+
+// Counters of one mesh after a stage. They add up across meshes, the ratios are then model wide.
+struct MeshOptimizerStats
+{
+    uint32_t mNumIndices{0};
+    uint32_t mNumVertices{0};
+    uint32_t mTransformedVertices{0}; // post-transform cache misses, see kVertexCacheSize
+    uint64_t mBytesFetched{0};        // vertex memory read through kFetchCacheLines lines of 64 bytes
+    uint32_t mVertexSize{0};
+
+    // Average cache miss ratio : transformed vertices per triangle, 0.5 is the best case for a regular grid
+    float getACMR() const;
+    // Average transformed vertex ratio : transformed vertices per vertex, 1.0 is optimal
+    float getATVR() const;
+    // Bytes fetched per byte of vertex data, 1.0 is optimal
+    float getOverfetch() const;
+
+    MeshOptimizerStats& operator+=(const MeshOptimizerStats& other);
+};
+
+using MeshOptimizerReport = std::array<MeshOptimizerStats, MeshOptimizerStage_Count>;
+
+constexpr uint32_t kVertexCacheSize = 16;   // FIFO of the ACMR / ATVR simulation
+constexpr uint32_t kFetchCacheLines = 64;   // FIFO of 64 byte lines of the overfetch simulation
+constexpr float kOverdrawThreshold = 1.05f; // max ACMR increase accepted by the overdraw stage
+
+MeshOptimizerStats AnalyzeMesh(const std::vector<uint32_t>& indices, uint32_t numVertices, uint32_t vertexSize);
+
+// Runs every stage in place. vertices holds numVertices * vertexSize bytes, it is compacted to the returned
+// number of vertices. The stats after each stage are written to pReport when given.
+uint32_t OptimizeMesh(std::vector<uint32_t>& indices, uint8_t* vertices, uint32_t numVertices, uint32_t vertexSize,
+                      uint32_t positionOffset, MeshOptimizerReport* pReport = nullptr);
+
+// Individual stages
+uint32_t DeduplicateVertices(std::vector<uint32_t>& indices, uint8_t* vertices, uint32_t numVertices,
+                             uint32_t vertexSize);
+void OptimizeVertexCache(std::vector<uint32_t>& indices, uint32_t numVertices);
+void OptimizeOverdraw(std::vector<uint32_t>& indices, const uint8_t* vertices, uint32_t vertexSize,
+                      uint32_t positionOffset, float threshold = kOverdrawThreshold);
+uint32_t OptimizeVertexFetch(std::vector<uint32_t>& indices, uint8_t* vertices, uint32_t numVertices,
+                             uint32_t vertexSize);
+
+// One line per stage : vertices, ACMR, ATVR and overfetch
+std::string FormatMeshOptimizerReport(const MeshOptimizerReport& report);
+
+} // namespace VulkanCore::model
+
+#endif // MODEL_MESH_OPTIMIZER_H
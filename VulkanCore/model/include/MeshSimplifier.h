@@ -0,0 +1,38 @@
+#ifndef MODEL_MESH_SIMPLIFIER_H
+#define MODEL_MESH_SIMPLIFIER_H
+
+#include <cstdint>
+#include <vector>
+
+namespace VulkanCore::model
+{
+
+// Level of detail of a mesh : a range of its index list drawn over the same vertices
+struct MeshLod
+{
+    uint32_t FirstIndex{0}; // relative to the mesh BaseIndex
+    uint32_t NumIndices{0};
+    float Error{0.0f}; // max distance to the full mesh surface, in mesh space
+};
+
+constexpr uint32_t kMaxMeshLods = 5;     // LOD 0, the full mesh, included
+constexpr float kLodReduction = 0.5f;    // triangles of a LOD relative to the previous one
+constexpr float kLodMinReduction = 0.8f; // the chain stops once a LOD keeps more of the previous one
+constexpr float kLodMaxError = 0.05f;    // relative to the mesh extent
+
+// Quadric error edge collapse (Garland and Heckbert) of an indexed triangle list, vertices are kept and only
+// the indices change. Vertices with the same position but other attributes form a seam, seams and open borders
+// stay in place so textures do not slide. Stops at targetIndexCount or once a collapse would move the surface
+// by more than targetError, relative to the mesh extent. pResultError gets the error reached, in mesh space.
+std::vector<uint32_t> SimplifyMesh(const std::vector<uint32_t>& indices, const uint8_t* vertices, uint32_t numVertices,
+                                   uint32_t vertexSize, uint32_t positionOffset, uint32_t targetIndexCount,
+                                   float targetError, float* pResultError = nullptr);
+
+// Appends LOD 1 and up to indices, which holds LOD 0 on input. Each LOD halves the triangles of LOD 0 once more
+// and is vertex cache optimized. Returns the LODs, LOD 0 first.
+std::vector<MeshLod> GenerateLodChain(std::vector<uint32_t>& indices, const uint8_t* vertices, uint32_t numVertices,
+                                      uint32_t vertexSize, uint32_t positionOffset);
+
+} // namespace VulkanCore::model
+
+#endif // MODEL_MESH_SIMPLIFIER_H
@@ -0,0 +1,46 @@
+#ifndef MODEL_MESHLET_BUILDER_H
+#define MODEL_MESHLET_BUILDER_H
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace VulkanCore::model
+{
+
+// Cluster of a mesh small enough for one mesh shader workgroup. The triangles of a meshlet are also a contiguous
+// range of the mesh LOD 0 indices, so the same cluster can be drawn as a plain index range.
+struct Meshlet
+{
+    uint32_t FirstIndex{0};     // relative to the mesh BaseIndex
+    uint32_t VertexOffset{0};   // in the meshlet vertex list of the model
+    uint32_t TriangleOffset{0}; // in the meshlet triangle list of the model
+    uint32_t VertexCount{0};
+    uint32_t TriangleCount{0};
+    glm::vec3 BoundsMin{0.0f};      // AABB in mesh space
+    glm::vec3 BoundsMax{0.0f};
+    glm::vec4 BoundingSphere{0.0f}; // xyz : center, w : radius, mesh space
+    // xyz : average triangle normal, w : sine of the normal cone half angle, 1 when the meshlet cannot be backface
+    // culled. Every triangle faces away from a camera at p when dot(center - p, axis) >= w * |center - p| + radius.
+    glm::vec4 Cone{0.0f, 0.0f, 0.0f, 1.0f};
+};
+
+constexpr uint32_t kMeshletMaxVertices = 64;   // mesh shader output limits, see meshlet.mesh
+constexpr uint32_t kMeshletMaxTriangles = 124; // 126 is the practical limit of most hardware, kept a multiple of 4
+constexpr float kMeshletMinConeDot = 0.1f;     // wider normal cones are never culled, the test would almost never pass
+
+// Greedy clustering of an indexed triangle list : a meshlet starts at the first triangle left in the input order
+// and grows through the triangles sharing its vertices, the ones adding the fewest vertices and closest to its
+// center first. indices is reordered so each meshlet is a contiguous range. Appends the mesh relative vertex
+// indices of every meshlet to meshletVertices and one triangle per uint to meshletTriangles (three 8-bit indices
+// into the meshlet vertices).
+std::vector<Meshlet> BuildMeshlets(std::vector<uint32_t>& indices, const uint8_t* vertices, uint32_t numVertices,
+                                   uint32_t vertexSize, uint32_t positionOffset, std::vector<uint32_t>& meshletVertices,
+                                   std::vector<uint32_t>& meshletTriangles,
+                                   uint32_t maxVertices = kMeshletMaxVertices,
+                                   uint32_t maxTriangles = kMeshletMaxTriangles);
+
+} // namespace VulkanCore::model
+
+#endif // MODEL_MESHLET_BUILDER_H
@@ -2,8 +2,14 @@
 #define MODEL_H
 
 #include <assimp/material.h>
+#include <algorithm>
+#include <cstddef>
 #include <cstdint>
 #include <iostream>
+#include <memory>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
 #include <vector>
 
 #include <glm/glm.hpp>
@@ -12,7 +18,17 @@
 #include "assimp/postprocess.h"
 #include "assimp/scene.h"
 
+#include "Animation.h"
+#include "AnimationSampler.h"
+#include "BakedModel.h"
 #include "Material.h"
+#include "MeshBuffers.h"
+#include "MeshConverter.h"
+#include "MeshOptimizer.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "SceneGraph.h"
+#include "VertexQuantizer.h"
 
 namespace VulkanCore::model
 {
@@ -24,7 +40,15 @@ struct BasicMeshEntry
     uint32_t NumIndices{0};
     uint32_t ValidFaces{0};
     int32_t MaterialIndex{-1};
-    glm::mat4 Transformation;
+    glm::mat4 Transformation;       // world transformation of Node
+    int32_t Node{-1};               // in the model SceneGraph, -1 when no node references the mesh
+    glm::vec3 BoundsMin{0.0f};      // AABB in mesh space, before Transformation
+    glm::vec3 BoundsMax{0.0f};
+    glm::vec4 BoundingSphere{0.0f}; // xyz : center, w : radius, mesh space
+    uint32_t NumLodIndices{0};      // indices of every LOD from BaseIndex, LOD 0 (NumIndices) first
+    std::vector<MeshLod> Lods;      // Lods[0] is the full mesh
+    uint32_t FirstMeshlet{0};       // meshlets of LOD 0 in the model meshlet list
+    uint32_t NumMeshlets{0};
 };
 
 class Model
@@ -35,7 +59,51 @@ class Model
 
     void initScene(std::string modelPath);
 
+    // Stats of all meshes after each stage, empty when the optimizer is off
+    const MeshOptimizerReport& getMeshOptimizerReport() const
+    {
+        return m_MeshOptimizerReport;
+    }
+
+    // Models with bones or animations are skinned, every vertex is then moved by the bones of an AnimationPose.
+    // Their meshes are stored in model space : Transformation is the identity, the node transformations are part
+    // of the bones.
+    bool isSkinned() const
+    {
+        return !m_Skeleton.BoneNodes.empty();
+    }
+    const Skeleton& getSkeleton() const
+    {
+        return m_Skeleton;
+    }
+    const std::vector<AnimationClip>& getAnimations() const
+    {
+        return m_Animations;
+    }
+    // Same clips laid out for SampleAnimationSoa()
+    const std::vector<SoaAnimationClip>& getSoaAnimations() const
+    {
+        return m_SoaAnimations;
+    }
+
+    // Node hierarchy of the scene. Nodes moved with setNodeTransformation() move their meshes, and the meshes of
+    // their descendants, on the next updateMeshTransformations(). Skinned models move their nodes with an
+    // AnimationPose instead.
+    const SceneGraph& getSceneGraph() const
+    {
+        return m_SceneGraph;
+    }
+    int32_t findNode(const std::string& name) const
+    {
+        return m_SceneGraph.findNode(name);
+    }
+    void setNodeTransformation(uint32_t node, const glm::mat4& localTransformation)
+    {
+        m_SceneGraph.setLocalTransform(node, localTransformation);
+    }
+
   protected:
+    // May return nullptr when only the texture paths are needed, see ModelBaker
     virtual Texture* allocTexture2D() = 0;
     virtual void destroyTexture(Texture* pTexture) = 0;
 
@@ -65,14 +133,72 @@ class Model
         // Removed color field to match shader VertexData structure (56 bytes)
     };
 
+    // Vertex followed by its bone influences, unused influences have a weight of 0
     struct SkinnedVertex
     {
-        // ToDo: implement skinned vertex
+        glm::vec3 pos;
+        glm::vec2 texCoord;
+        glm::vec3 normal;
+        glm::vec3 tangent;
+        glm::vec3 bitangent;
+        uint32_t boneIds[kMaxBoneInfluences];
+        float weights[kMaxBoneInfluences];
+    };
+
+    // GPU-ready copy of the geometry, every submesh range starting on alignment. Quantized : QuantizedVertex
+    // instead of Vertex, see VertexQuantizer.h. positionStream adds a buffer of the positions alone.
+    MeshBuffers buildMeshBuffers(const std::vector<Vertex>& vertices, bool quantize, bool positionStream,
+                                 uint64_t alignment) const;
+    // Same buffers written through writer, the returned MeshBuffers holds their layout only
+    MeshBuffers writeMeshBuffers(const std::vector<Vertex>& vertices, bool quantize, bool positionStream,
+                                 uint64_t alignment, MeshBufferWriter& writer) const;
+
+    // Baked model of the loaded scene with its GPU-ready buffers and/or its processed vertices and indices, see
+    // BakedModel.h
+    void writeBaked(const std::string& bakedPath, const MeshBuffers* pBuffers,
+                    const std::vector<Vertex>* pVertices = nullptr) const;
+    // Everything initScene() loads except the geometry, the caller uploads its buffers straight from the file.
+    // Texture paths are resolved next to modelPath.
+    void readBaked(const BakedModelFile& file, const std::string& modelPath);
+
+    // Transformation of the meshes whose node moved since the last call, their indices are appended to
+    // changedMeshes
+    void updateMeshTransformations(std::vector<uint32_t>& changedMeshes);
+
+    // Copy of an embedded texture, the scene is gone when it is decoded : a compressed image (png, jpg...) when
+    // Width is 0, RGBA texels otherwise
+    struct EmbeddedImage
+    {
+        std::vector<uint8_t> Data;
+        uint32_t Width{0};
+        uint32_t Height{0};
     };
 
+    // Texture found while loading, loaded later by the derived class when m_DeferTextureLoads is set. The loads of
+    // an embedded texture share one copy of it.
+    struct TextureLoad
+    {
+        std::string Path; // full path, or the name of an embedded texture
+        int32_t MaterialIndex{-1};
+        TEXTURE_TYPE Type{TEX_TYPE_BASE};
+        bool IsSRGB{false};
+        std::shared_ptr<const EmbeddedImage> pEmbedded; // nullptr for a file
+    };
+
+    // loadTextureFromFile() and loadTextureEmbedded() queue into m_TextureLoads, mpTextures stay nullptr
+    bool m_DeferTextureLoads{false};
+    std::vector<TextureLoad> m_TextureLoads;
+    // Embedded textures live in the source only : such models are not cached and their baked files lack them
+    bool m_HasEmbeddedTextures{false};
+    // Copied once per aiTexture, whatever the number of materials and slots referencing it. Cleared with the scene.
+    std::unordered_map<const aiTexture*, std::shared_ptr<const EmbeddedImage>> m_EmbeddedImages;
+
     std::vector<BasicMeshEntry> m_Meshes;
     std::vector<CoreMaterial> m_Materials;
     std::vector<uint32_t> m_Indices;
+    std::vector<Meshlet> m_Meshlets;
+    std::vector<uint32_t> m_MeshletVertices;  // relative to the mesh BaseVertex
+    std::vector<uint32_t> m_MeshletTriangles; // three 8-bit indices into the meshlet vertices per uint
 
   private:
     template <typename VertexType>
@@ -92,94 +218,141 @@ class Model
 
     template <typename VertexType> void initAllMeshes(std::vector<VertexType>& vertices, const aiScene* pScene)
     {
-        const bool useMeshOptimizer{false}; // ToDo: implement mesh optimizer
+        std::vector<MeshConversionRange> ranges(m_Meshes.size());
         for (uint32_t i = 0; i < m_Meshes.size(); i++)
         {
-            const aiMesh* mesh = pScene->mMeshes[i];
-            if (useMeshOptimizer)
-            {
-                // ToDo : implement mesh optimizer library
-                // remove duplicate vertices and reindex
-                // cache locality optimization
-                // reduce overdraw
-                // vertex fetch optimization
-                // create simplified version of mesh for LOD
-            }
-            else
-            {
-                initSingleMesh<VertexType>(vertices, mesh, i);
-            }
+            ranges[i] = {pScene->mMeshes[i], m_Meshes[i].BaseVertex, m_Meshes[i].BaseIndex};
+        }
+        ConvertMeshes<VertexType>(ranges, vertices.data(), m_Indices.data());
+        if constexpr (std::is_same_v<VertexType, SkinnedVertex>)
+        {
+            prepareSkinnedMeshes(vertices, pScene);
+        }
+
+        if (m_UseMeshOptimizer)
+        {
+            optimizeMeshes<VertexType>(vertices);
+        }
+        if (m_GenerateLods)
+        {
+            generateLods<VertexType>(vertices);
+        }
+        if (m_BuildMeshlets)
+        {
+            buildMeshlets<VertexType>(vertices);
         }
     }
 
-    template <typename VertexType>
-    void initSingleMesh(std::vector<VertexType>& vertices, const aiMesh* mesh, uint32_t meshIndex)
+    // Runs the mesh optimizer on every mesh, then packs the vertex ranges it shrank
+    template <typename VertexType> void optimizeMeshes(std::vector<VertexType>& vertices)
     {
-        // std::cout << "Initializing mesh index " << meshIndex << " with " << mesh->mNumVertices << " vertices and "
-        //           << mesh->mNumFaces << " faces "
-        //           << " name " << mesh->mName.C_Str() << std::endl;
-        VertexType vertex;
-        uint32_t vertexBase = m_Meshes[meshIndex].BaseVertex;
-        uint32_t indexBase = m_Meshes[meshIndex].BaseIndex;
-
-        // Process vertices
-        for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+        m_MeshOptimizerReport = {};
+        uint32_t baseVertex = 0;
+        std::vector<uint32_t> indices;
+        for (BasicMeshEntry& mesh : m_Meshes)
         {
-
-            // Process vertex positions
-            vertex.pos = glm::vec3(mesh->mVertices[i].x, mesh->mVertices[i].y, mesh->mVertices[i].z);
-
-            // Process normals
-            if (mesh->HasNormals())
-            {
-                vertex.normal = glm::vec3(mesh->mNormals[i].x, mesh->mNormals[i].y, mesh->mNormals[i].z);
-            }
-            else
+            auto firstIndex = m_Indices.begin() + mesh.BaseIndex;
+            indices.assign(firstIndex, firstIndex + mesh.NumIndices);
+
+            MeshOptimizerReport report;
+            uint32_t numVertices = OptimizeMesh(indices, reinterpret_cast<uint8_t*>(vertices.data() + mesh.BaseVertex),
+                                                mesh.NumVertices, sizeof(VertexType), offsetof(VertexType, pos),
+                                                &report);
+            for (uint32_t stage = 0; stage < MeshOptimizerStage_Count; stage++)
             {
-                vertex.normal = glm::vec3(0.0f, 0.0f, 0.0f);
+                m_MeshOptimizerReport[stage] += report[stage];
             }
 
-            // Process texture coordinates
-            if (mesh->HasTextureCoords(0))
-            {
-                vertex.texCoord = glm::vec2(mesh->mTextureCoords[0][i].x, mesh->mTextureCoords[0][i].y);
-            }
-            else
-            {
-                vertex.texCoord = glm::vec2(0.0f, 0.0f);
-            }
+            std::copy(indices.begin(), indices.end(), firstIndex);
+            std::copy(vertices.begin() + mesh.BaseVertex, vertices.begin() + mesh.BaseVertex + numVertices,
+                      vertices.begin() + baseVertex);
+            mesh.BaseVertex = baseVertex;
+            mesh.NumVertices = numVertices;
+            baseVertex += numVertices;
+        }
+        vertices.resize(baseVertex);
 
-            // Process tangents and bitangents
-            if (mesh->HasTangentsAndBitangents())
-            {
-                vertex.tangent = glm::vec3(mesh->mTangents[i].x, mesh->mTangents[i].y, mesh->mTangents[i].z);
-                vertex.bitangent = glm::vec3(mesh->mBitangents[i].x, mesh->mBitangents[i].y, mesh->mBitangents[i].z);
-            }
-            else
+        std::cout << "Mesh optimizer, " << m_Meshes.size() << " meshes :\n"
+                  << FormatMeshOptimizerReport(m_MeshOptimizerReport);
+    }
+
+    // Simplified LODs of every mesh, stored after its LOD 0 indices so a mesh keeps one contiguous index range
+    template <typename VertexType> void generateLods(const std::vector<VertexType>& vertices)
+    {
+        std::vector<uint32_t> lodIndices;
+        lodIndices.reserve(m_Indices.size() * 2);
+        std::vector<uint32_t> indices;
+        uint32_t lodTriangles[kMaxMeshLods] = {};
+        for (BasicMeshEntry& mesh : m_Meshes)
+        {
+            auto firstIndex = m_Indices.begin() + mesh.BaseIndex;
+            indices.assign(firstIndex, firstIndex + mesh.NumIndices);
+            mesh.Lods = GenerateLodChain(indices, reinterpret_cast<const uint8_t*>(vertices.data() + mesh.BaseVertex),
+                                         mesh.NumVertices, sizeof(VertexType), offsetof(VertexType, pos));
+            for (size_t lod = 0; lod < mesh.Lods.size(); lod++)
             {
-                vertex.tangent = glm::vec3(0.0f, 0.0f, 0.0f);
-                vertex.bitangent = glm::vec3(0.0f, 0.0f, 0.0f);
+                lodTriangles[lod] += mesh.Lods[lod].NumIndices / 3;
             }
 
-            vertices[vertexBase + i] = vertex;
+            mesh.BaseIndex = static_cast<uint32_t>(lodIndices.size());
+            mesh.NumLodIndices = static_cast<uint32_t>(indices.size());
+            lodIndices.insert(lodIndices.end(), indices.begin(), indices.end());
         }
+        m_Indices = std::move(lodIndices);
 
-        // Process indices - write to correct offset, don't use push_back
-        uint32_t indexOffset = 0;
-        for (uint32_t i = 0; i < mesh->mNumFaces; i++)
+        std::cout << "LOD triangles :";
+        for (uint32_t lod = 0; lod < kMaxMeshLods; lod++)
         {
-            const aiFace& face = mesh->mFaces[i];
-            for (uint32_t j = 0; j < face.mNumIndices; j++)
-            {
-                m_Indices[indexBase + indexOffset] = face.mIndices[j];
-                indexOffset++;
-            }
+            std::cout << " " << lodTriangles[lod];
+        }
+        std::cout << std::endl;
+    }
+
+    // Meshlets of LOD 0 of every mesh, its indices are reordered so each meshlet is a contiguous range
+    template <typename VertexType> void buildMeshlets(const std::vector<VertexType>& vertices)
+    {
+        m_Meshlets.clear();
+        m_MeshletVertices.clear();
+        m_MeshletTriangles.clear();
+        std::vector<uint32_t> indices;
+        for (BasicMeshEntry& mesh : m_Meshes)
+        {
+            auto firstIndex = m_Indices.begin() + mesh.BaseIndex;
+            indices.assign(firstIndex, firstIndex + mesh.NumIndices);
+            std::vector<Meshlet> meshlets =
+                BuildMeshlets(indices, reinterpret_cast<const uint8_t*>(vertices.data() + mesh.BaseVertex),
+                              mesh.NumVertices, sizeof(VertexType), offsetof(VertexType, pos), m_MeshletVertices,
+                              m_MeshletTriangles);
+            std::copy(indices.begin(), indices.end(), firstIndex);
+
+            mesh.FirstMeshlet = static_cast<uint32_t>(m_Meshlets.size());
+            mesh.NumMeshlets = static_cast<uint32_t>(meshlets.size());
+            m_Meshlets.insert(m_Meshlets.end(), meshlets.begin(), meshlets.end());
         }
 
-        // ToDo : handle bones for skinned meshes
+        if (!m_Meshlets.empty())
+        {
+            std::cout << "Meshlets : " << m_Meshlets.size() << ", " << m_MeshletVertices.size() / m_Meshlets.size()
+                      << " vertices and " << m_MeshletTriangles.size() / m_Meshlets.size() << " triangles on average"
+                      << std::endl;
+        }
     }
 
-    bool initGeometry(const aiScene* pScene, const std::string& Filename);
+    bool initGeometry(const aiScene* pScene, const std::string& Filename, uint64_t cacheKey);
+
+    // Skinned models : the node hierarchy, one bone per aiBone of every mesh (and per mesh without bones) and the
+    // clips. Needs the scene graph.
+    void initSkeleton(const aiScene* pScene);
+    void initAnimations(const aiScene* pScene);
+    // Moves the converted vertices to model space and fills their bone influences, the bounds follow
+    void prepareSkinnedMeshes(std::vector<SkinnedVertex>& vertices, const aiScene* pScene);
+    void prepareSkinnedMesh(BasicMeshEntry& mesh, const aiMesh* pMesh, SkinnedVertex* pVertices,
+                            uint32_t firstBone) const;
+
+    // Key of the processed model in ModelCache : contents of the source, import flags and processing options.
+    // 0 when the source cannot be read.
+    uint64_t getCacheKey(const std::string& modelPath) const;
+    bool loadFromCache(uint64_t cacheKey, const std::string& modelPath);
     bool initMaterials(const aiScene* pScene, const std::string& Filename);
 
     void countVerticesAndIndices(const aiScene* pScene, uint32_t& NumVertices, uint32_t& NumIndices);
@@ -188,22 +361,28 @@ class Model
     void loadTexturesFromMaterial(const aiMaterial* pMaterial, const std::string& Filename, int32_t materialIndex);
     void loadTextureFromFile(const std::string& Dir, const std::string& Path, int32_t MaterialIndex,
                              TEXTURE_TYPE MyType, bool IsSRGB);
-
-    void loadDiffuseTexture(const std::string& dir, const aiMaterial* pMaterial, int32_t materialIndex);
-    void loadSpecularTexture(const std::string& dir, const aiMaterial* pMaterial, int32_t materialIndex);
-    void loadNormalTexture(const std::string& dir, const aiMaterial* pMaterial, int32_t materialIndex);
+    void loadTextureEmbedded(const aiTexture* pTexture, int32_t MaterialIndex, TEXTURE_TYPE MyType, bool IsSRGB);
 
     void loadColorFromMaterial(const aiMaterial* pMaterial, int32_t materialIndex);
     void loadColor(const aiMaterial* pMaterial, glm::vec4& color, const char* pAiMatKey, int32_t aiMatType,
                    int32_t AiMatIdx);
 
-    void calculateMeshTransformations(const aiScene* pScene);
-    void traverseNodeHierarchy(const glm::mat4& ParentTransformation, aiNode* pNode);
+    // Flattens the aiNode tree into m_SceneGraph, then sets the node and the transformation of every mesh
+    void initSceneGraph(const aiScene* pScene);
 
-    virtual void populateBufferSkinned(std::vector<Vertex>& vertices) = 0;
+    virtual void populateBufferSkinned(std::vector<SkinnedVertex>& vertices) = 0;
     virtual void populateBuffer(std::vector<Vertex>& vertices) = 0;
 
     const aiScene* m_pScene;
+    bool m_UseMeshOptimizer{true}; // load time dedup, vertex cache, overdraw and fetch optimization
+    bool m_GenerateLods{true};     // simplified index ranges per mesh, see MeshSimplifier.h
+    bool m_BuildMeshlets{true};    // clusters of LOD 0 for cluster culling, see MeshletBuilder.h
+    bool m_UseCache{true};         // processed models kept in ModelCache::getDefault(), assimp skipped on a hit
+    MeshOptimizerReport m_MeshOptimizerReport{};
+    SceneGraph m_SceneGraph;
+    Skeleton m_Skeleton;
+    std::vector<AnimationClip> m_Animations;
+    std::vector<SoaAnimationClip> m_SoaAnimations;
 };
 } // namespace VulkanCore::model
 
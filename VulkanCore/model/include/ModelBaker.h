@@ -0,0 +1,45 @@
+#ifndef MODEL_MODEL_BAKER_H
+#define MODEL_MODEL_BAKER_H
+
+#include <string>
+
+#include "Model.h"
+
+namespace VulkanCore::model
+{
+
+// Offline side of the baked models : imports a model with the processing of VulkanModel and writes it with its
+// GPU-ready buffers, without any device. Ranges are aligned on kBakedModelAlignment, textures are referenced by
+// path only. The position stream is always baked, so the file serves VulkanModel with or without one.
+class ModelBaker : public Model
+{
+  public:
+    ModelBaker(const std::string& modelPath, bool quantize);
+
+    void write(const std::string& bakedPath) const;
+
+    const MeshBuffers& getBuffers() const
+    {
+        return mBuffers;
+    }
+
+  protected:
+    Texture* allocTexture2D() override
+    {
+        return nullptr;
+    }
+    void destroyTexture(Texture* pTexture) override {}
+    void populateBuffer(std::vector<Vertex>& vertices) override;
+    void populateBufferSkinned(std::vector<SkinnedVertex>& vertices) override
+    {
+        throw std::runtime_error("Skinned models cannot be baked.");
+    }
+
+  private:
+    bool mQuantize;
+    MeshBuffers mBuffers;
+};
+
+} // namespace VulkanCore::model
+
+#endif // MODEL_MODEL_BAKER_H
@@ -0,0 +1,56 @@
+#ifndef MODEL_MODEL_CACHE_H
+#define MODEL_MODEL_CACHE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <functional>
+#include <string>
+
+namespace VulkanCore::model
+{
+
+constexpr uint64_t kDefaultModelCacheBytes = 512ull * 1024 * 1024;
+
+// 64-bit FNV-1a, chained through seed
+constexpr uint64_t kHashSeed = 0xCBF29CE484222325ull;
+uint64_t HashBytes(const void* pData, size_t size, uint64_t seed = kHashSeed);
+
+// Hash of the contents of a file, throws when it cannot be read
+uint64_t HashFile(const std::string& path, uint64_t seed = kHashSeed);
+
+// On-disk cache of processed models, see Model::initScene(). An entry is a baked model named by its key. Once the
+// entries exceed the size cap the least recently used ones are evicted. Recency is the modification time of an
+// entry, touched on every hit, so the cache needs no index and survives being shared by several processes.
+class ModelCache
+{
+  public:
+    ModelCache(std::filesystem::path directory, uint64_t maxBytes);
+
+    // $XDG_CACHE_HOME/VulkanEngine/models, or ~/.cache/VulkanEngine/models, capped to kDefaultModelCacheBytes
+    static ModelCache& getDefault();
+
+    // Path of the entry touched as the most recently used, empty on a miss
+    std::string find(uint64_t key) const;
+
+    // write() gets a temporary path unique to the insert (process id and a counter), renamed to the entry once it
+    // returns so a failed or concurrent write never leaves a partial entry. The cache is then trimmed. Returns false,
+    // with a warning, when the entry could not be written : the cache is an optimization, a failure must not fail the
+    // load.
+    bool insert(uint64_t key, const std::function<void(const std::string& path)>& write) const;
+
+    void remove(uint64_t key) const;
+
+    // Evicts the least recently used entries until they fit in the size cap
+    void trim() const;
+
+  private:
+    std::filesystem::path getEntryPath(uint64_t key) const;
+
+    std::filesystem::path mDirectory;
+    uint64_t mMaxBytes;
+};
+
+} // namespace VulkanCore::model
+
+#endif // MODEL_MODEL_CACHE_H
@@ -0,0 +1,63 @@
+#ifndef MODEL_PARALLEL_FOR_H
+#define MODEL_PARALLEL_FOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace VulkanCore::model
+{
+
+// Runs func(i) for every i in [0, count) on up to numThreads threads, the calling one included, 0 for the hardware
+// concurrency. Items are handed out one at a time so uneven items balance, func must be safe to run concurrently on
+// different items. Returns once every item is done, the first exception thrown by func is rethrown.
+// The threads are created and joined by every call, which suits load time work. Work repeated every frame goes
+// through a WorkerPool instead.
+void ParallelFor(uint32_t count, const std::function<void(uint32_t)>& func, uint32_t numThreads = 0);
+
+// Threads created once and woken by every parallelFor(), for work repeated every frame. The pool owns
+// numThreads - 1 workers, the calling thread being the last one, 0 for the hardware concurrency.
+class WorkerPool
+{
+  public:
+    explicit WorkerPool(uint32_t numThreads = 0);
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    uint32_t getNumThreads() const
+    {
+        return static_cast<uint32_t>(mWorkers.size()) + 1;
+    }
+
+    // Same contract as ParallelFor() on the threads of the pool. Calls must not overlap.
+    void parallelFor(uint32_t count, const std::function<void(uint32_t)>& func);
+
+  private:
+    void workerLoop();
+    void runItems();
+
+    std::vector<std::thread> mWorkers;
+    std::mutex mMutex;
+    std::condition_variable mWake;
+    std::condition_variable mDone;
+    uint64_t mGeneration{0}; // incremented by every call, wakes the workers
+    uint32_t mBusyWorkers{0};
+    bool mStop{false};
+
+    // The current call
+    const std::function<void(uint32_t)>* mpFunc{nullptr};
+    uint32_t mCount{0};
+    std::atomic<uint32_t> mNextItem{0};
+    std::exception_ptr mFirstException;
+};
+
+} // namespace VulkanCore::model
+
+#endif // MODEL_PARALLEL_FOR_H
@@ -0,0 +1,75 @@
+#ifndef MODEL_SCENE_GRAPH_H
+#define MODEL_SCENE_GRAPH_H
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+namespace VulkanCore::model
+{
+
+// Node hierarchy of a model flattened parents first : a node is always stored after its parent, so a single pass in
+// order computes every world transformation, no recursion and no parent lookup. Local transformations can be set at
+// any time, they flag their node and update() then recomputes the flagged nodes and their descendants only, starting
+// from the first flagged one.
+class SceneGraph
+{
+  public:
+    void clear();
+
+    // parent is an index returned earlier, -1 for a root. Names need not be unique, see findNode().
+    uint32_t addNode(int32_t parent, const glm::mat4& localTransform, const std::string& name);
+
+    uint32_t getNumNodes() const
+    {
+        return static_cast<uint32_t>(mParents.size());
+    }
+    int32_t getParent(uint32_t node) const
+    {
+        return mParents[node];
+    }
+    const std::string& getName(uint32_t node) const
+    {
+        return mNames[node];
+    }
+    const glm::mat4& getLocalTransform(uint32_t node) const
+    {
+        return mLocalTransforms[node];
+    }
+    // Relative to the root, as of the last update()
+    const glm::mat4& getWorldTransform(uint32_t node) const
+    {
+        return mWorldTransforms[node];
+    }
+
+    // First node added with this name, -1 if none
+    int32_t findNode(const std::string& name) const;
+
+    void setLocalTransform(uint32_t node, const glm::mat4& localTransform);
+
+    // World transformations of the nodes set since the last update and of their descendants. Returns how many
+    // nodes changed, isChanged() tells which ones until the next update.
+    uint32_t update();
+    bool isChanged(uint32_t node) const
+    {
+        return mUpdates[node] == mNumUpdates;
+    }
+
+  private:
+    std::vector<int32_t> mParents;
+    std::vector<glm::mat4> mLocalTransforms;
+    std::vector<glm::mat4> mWorldTransforms;
+    std::vector<uint8_t> mDirty;    // local transformation set since the last update
+    std::vector<uint32_t> mUpdates; // last update that changed the world transformation
+    std::vector<std::string> mNames;
+    std::unordered_map<std::string, uint32_t> mNodeIndices;
+    uint32_t mFirstDirty{0}; // nodes before it are up to date
+    uint32_t mNumUpdates{0};
+};
+
+} // namespace VulkanCore::model
+
+#endif // MODEL_SCENE_GRAPH_H
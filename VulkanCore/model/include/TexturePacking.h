@@ -0,0 +1,49 @@
+#ifndef MODEL_TEXTURE_PACKING_H
+#define MODEL_TEXTURE_PACKING_H
+
+#include <array>
+#include <cstdint>
+
+namespace VulkanCore::model
+{
+
+// Channels of a packed RGB texture, alpha is always 255
+constexpr uint32_t kPackedChannels = 3;
+
+// Decoded image, Width x Height RGBA texels
+struct TextureImage
+{
+    const uint8_t* pTexels{nullptr};
+    uint32_t Width{0};
+    uint32_t Height{0};
+};
+
+// One channel of a packed texture, read from a channel of a decoded RGBA image
+struct TextureChannelSource
+{
+    const uint8_t* pTexels{nullptr}; // Width x Height RGBA texels, nullptr : DefaultValue everywhere
+    uint32_t Width{0};
+    uint32_t Height{0};
+    uint32_t Channel{0}; // 0 : R, 1 : G, 2 : B, 3 : A
+    uint8_t DefaultValue{0};
+};
+
+// Source of every channel of a packed texture
+using PackedTextureSources = std::array<TextureChannelSource, kPackedChannels>;
+
+// Occlusion (R), roughness (G) and metalness (B) of a material, any map may be nullptr. Roughness and metalness
+// given as the same image are a glTF metallicRoughness texture, read from its G and B channels, separate maps are
+// grayscale and read from R. Without a map : no occlusion, fully rough, dielectric.
+PackedTextureSources GetOrmSources(const TextureImage* pOcclusion, const TextureImage* pRoughness,
+                                   const TextureImage* pMetalness);
+
+// Size of the packed texture : the largest source, 0 x 0 without any
+void GetPackedTextureSize(const PackedTextureSources& sources, uint32_t& width, uint32_t& height);
+
+// Writes width x height RGBA texels, the channel c from sources[c]. Smaller sources are sampled at the nearest
+// texel, so maps authored at different resolutions still pack.
+void PackTextureChannels(const PackedTextureSources& sources, uint32_t width, uint32_t height, uint8_t* pTexels);
+
+} // namespace VulkanCore::model
+
+#endif // MODEL_TEXTURE_PACKING_H
@@ -0,0 +1,56 @@
+#ifndef MODEL_VERTEX_QUANTIZER_H
+#define MODEL_VERTEX_QUANTIZER_H
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+namespace VulkanCore::model
+{
+
+// Compact vertex of VertexLayout_Quantized (20 bytes instead of 56), every field is read as whole 32-bit words by
+// the vertex pulling shaders
+struct QuantizedVertex
+{
+    uint16_t Position[3];   // unorm16 in the mesh AABB, see VertexDequantization
+    uint16_t BitangentSign; // 1 when the bitangent is -cross(normal, tangent)
+    uint32_t TexCoord;      // two half floats, GLSL unpackHalf2x16
+    uint32_t Normal;        // octahedral, two snorm16, GLSL unpackSnorm2x16
+    uint32_t Tangent;       // octahedral, two snorm16
+};
+static_assert(sizeof(QuantizedVertex) == 20, "QuantizedVertex must match the shader decode");
+
+// position = Offset + quantized * Scale, quantized in [0, 65535]. The scale is the same on every axis so the
+// dequantization is a uniform scale and a translation : spheres and normal cones keep their shape in the
+// quantized space and the dequantization folds into the mesh transformation.
+struct VertexDequantization
+{
+    glm::vec3 Offset{0.0f};
+    float Scale{1.0f};
+
+    glm::mat4 toMatrix() const;
+
+    // Mesh space to quantized space
+    glm::vec3 quantizePoint(const glm::vec3& point) const
+    {
+        return (point - Offset) / Scale;
+    }
+    glm::vec4 quantizeSphere(const glm::vec4& sphere) const
+    {
+        return glm::vec4(quantizePoint(glm::vec3(sphere)), sphere.w / Scale);
+    }
+};
+
+VertexDequantization ComputeVertexDequantization(const glm::vec3& boundsMin, const glm::vec3& boundsMax);
+
+// Unit vector to the octahedron folded onto the unit square, two snorm16. Zero vectors encode +Z.
+uint32_t EncodeOctahedral(const glm::vec3& direction);
+glm::vec3 DecodeOctahedral(uint32_t encoded);
+
+QuantizedVertex QuantizeVertex(const VertexDequantization& dequantization, const glm::vec3& position,
+                               const glm::vec2& texCoord, const glm::vec3& normal, const glm::vec3& tangent,
+                               const glm::vec3& bitangent);
+
+} // namespace VulkanCore::model
+
+#endif // MODEL_VERTEX_QUANTIZER_H
@@ -0,0 +1,291 @@
+#include "Animation.h"
+#include "AnimationSampler.h"
+#include "ParallelFor.h"
+#include "TestUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+// SampleAnimationSoa() against SampleAnimation() : the SSE and scalar paths agree, the slerp approximation stays
+// within its bound, SampleAnimations() on a worker pool matches the single thread sampling
+
+namespace
+{
+
+using namespace VulkanCore::model;
+
+glm::quat rotationAbout(const glm::vec3& axis, float angle)
+{
+    glm::vec3 unitAxis = glm::normalize(axis);
+    float s = std::sin(angle * 0.5f);
+    return glm::quat(std::cos(angle * 0.5f), unitAxis.x * s, unitAxis.y * s, unitAxis.z * s);
+}
+
+float getMaxDifference(const glm::mat4& a, const glm::mat4& b)
+{
+    float difference = 0.0f;
+    for (int column = 0; column < 4; column++)
+    {
+        for (int row = 0; row < 4; row++)
+        {
+            difference = std::max(difference, std::abs(a[column][row] - b[column][row]));
+        }
+    }
+    return difference;
+}
+
+float getMaxDifference(const std::vector<glm::mat4>& a, const std::vector<glm::mat4>& b)
+{
+    float difference = a.size() == b.size() ? 0.0f : INFINITY;
+    for (size_t i = 0; i < std::min(a.size(), b.size()); i++)
+    {
+        difference = std::max(difference, getMaxDifference(a[i], b[i]));
+    }
+    return difference;
+}
+
+// Angle between the rotations of two matrices without scale, from their first two axes
+float getRotationError(const glm::mat4& a, const glm::mat4& b)
+{
+    float error = 0.0f;
+    for (int column = 0; column < 2; column++)
+    {
+        glm::vec3 axisA = glm::normalize(glm::vec3(a[column]));
+        glm::vec3 axisB = glm::normalize(glm::vec3(b[column]));
+        error = std::max(error, std::atan2(glm::length(glm::cross(axisA, axisB)), glm::dot(axisA, axisB)));
+    }
+    return error;
+}
+
+// Chain of numNodes nodes, nodes below numAnimated get a channel of 30 keys per second over a second, with up to
+// 60 degrees between rotation keys, flipped to the other hemisphere every other key
+void createAnimation(uint32_t numNodes, uint32_t numAnimated, Skeleton& skeleton, AnimationClip& clip)
+{
+    for (uint32_t node = 0; node < numNodes; node++)
+    {
+        SkeletonNode skeletonNode;
+        skeletonNode.Parent = static_cast<int32_t>(node) - 1;
+        skeletonNode.Transformation[3] = glm::vec4(0.0f, 1.0f, 0.0f, 1.0f);
+        skeleton.Nodes.push_back(skeletonNode);
+        skeleton.NodeNames.push_back("Node" + std::to_string(node));
+        skeleton.BoneNodes.push_back(node);
+        glm::mat4 offset(1.0f);
+        offset[3] = glm::vec4(0.0f, -static_cast<float>(node), 0.0f, 1.0f);
+        skeleton.BoneOffsets.push_back(offset);
+    }
+
+    clip.Name = "Test";
+    clip.Duration = 1.0f;
+    for (uint32_t node = 0; node < numAnimated; node++)
+    {
+        AnimationChannel channel;
+        channel.Node = node;
+        glm::vec3 axis(1.0f, static_cast<float>(node), 0.5f);
+        for (uint32_t key = 0; key <= 30; key++)
+        {
+            float time = key / 30.0f;
+            float angle = std::sin(time * 7.0f + static_cast<float>(node)) * 3.0f;
+            glm::quat rotation = rotationAbout(axis, angle);
+            if (key % 2 == 1)
+            {
+                rotation = glm::quat(-rotation.w, -rotation.x, -rotation.y, -rotation.z);
+            }
+            channel.Rotations.push_back({time, rotation});
+            channel.Positions.push_back({time, glm::vec3(time, 1.0f, static_cast<float>(node) * 0.1f)});
+            channel.Scales.push_back({time, glm::vec3(1.0f + time * 0.5f)});
+        }
+        clip.Channels.push_back(channel);
+    }
+}
+
+void testPathsAgree()
+{
+    // 6 nodes : a full group and a partial one, the last node without channel
+    Skeleton skeleton;
+    AnimationClip clip;
+    createAnimation(6, 5, skeleton, clip);
+    SoaAnimationClip soaClip = BuildSoaAnimationClip(clip, 6);
+    CHECK(soaClip.NumFrames == 31);
+    CHECK(soaClip.Groups.size() == 2 && soaClip.Groups[1].FirstNode == 4 && soaClip.Groups[1].LaneMask == 1);
+
+    AnimationPose reference;
+    AnimationPose scalar;
+    AnimationPose sse;
+    for (float time : {0.0f, 0.01f, 0.25f, 0.5f, 0.77f, 0.999f, 1.4f, -0.3f})
+    {
+        SampleAnimation(skeleton, &clip, time, reference);
+        SampleAnimationSoa(skeleton, &soaClip, time, scalar, AnimationPath_Scalar);
+        // The slerp approximation, under 0.001 radians per node, accumulated down the chain
+        CHECK(getMaxDifference(scalar.NodeTransforms, reference.NodeTransforms) < 0.005f);
+        CHECK(getMaxDifference(scalar.BoneMatrices, reference.BoneMatrices) < 0.005f);
+        if (IsAnimationPathSupported(AnimationPath_SSE))
+        {
+            // Rounding only : same frames, same approximation
+            SampleAnimationSoa(skeleton, &soaClip, time, sse, AnimationPath_SSE);
+            CHECK(getMaxDifference(sse.NodeTransforms, scalar.NodeTransforms) < 1e-4f);
+            CHECK(getMaxDifference(sse.BoneMatrices, scalar.BoneMatrices) < 1e-4f);
+        }
+    }
+
+    // Without clip every node keeps its bind pose
+    SampleAnimationSoa(skeleton, nullptr, 0.5f, scalar, AnimationPath_Scalar);
+    SampleAnimation(skeleton, nullptr, 0.5f, reference);
+    CHECK(getMaxDifference(scalar.NodeTransforms, reference.NodeTransforms) < 1e-5f);
+}
+
+void testSlerpApproximation()
+{
+    // A single node between two keys far apart : the approximation of the slerp within 0.001 radians
+    Skeleton skeleton;
+    skeleton.Nodes.resize(1);
+    AnimationClip clip;
+    clip.Duration = 1.0f;
+    AnimationChannel channel;
+    glm::quat start = rotationAbout(glm::vec3(0.3f, 1.0f, -0.2f), 0.2f);
+    glm::quat end = rotationAbout(glm::vec3(-1.0f, 0.4f, 0.6f), 2.5f);
+    channel.Rotations = {{0.0f, start}, {1.0f, end}};
+    clip.Channels.push_back(channel);
+    SoaAnimationClip soaClip = BuildSoaAnimationClip(clip, 1);
+    CHECK(soaClip.NumFrames == 2);
+
+    std::vector<AnimationPath> paths = {AnimationPath_Scalar};
+    if (IsAnimationPathSupported(AnimationPath_SSE))
+    {
+        paths.push_back(AnimationPath_SSE);
+    }
+    AnimationPose pose;
+    for (AnimationPath path : paths)
+    {
+        float maxError = 0.0f;
+        for (uint32_t step = 0; step < 64; step++) // the time wraps at the duration
+        {
+            float time = step / 64.0f;
+            SampleAnimationSoa(skeleton, &soaClip, time, pose, path);
+            glm::quat exact = glm::slerp(start, end, time);
+            maxError = std::max(maxError, getRotationError(pose.NodeTransforms[0], glm::mat4_cast(exact)));
+        }
+        CHECK(maxError < 0.001f);
+    }
+}
+
+void testErrors()
+{
+    Skeleton skeleton;
+    AnimationClip clip;
+    createAnimation(3, 3, skeleton, clip);
+    SoaAnimationClip soaClip = BuildSoaAnimationClip(clip, 3);
+    AnimationPose pose;
+
+    bool thrown = false;
+    try
+    {
+        SampleAnimationSoa(skeleton, &soaClip, 0.0f, pose, AnimationPath_Count);
+    }
+    catch (const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    skeleton.Nodes.pop_back();
+    thrown = false;
+    try
+    {
+        SampleAnimationSoa(skeleton, &soaClip, 0.0f, pose, AnimationPath_Scalar);
+    }
+    catch (const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    thrown = false;
+    try
+    {
+        BuildSoaAnimationClip(clip, 2);
+    }
+    catch (const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+    CHECK(IsAnimationPathSupported(AnimationPath_Scalar));
+    CHECK(IsAnimationPathSupported(GetBestAnimationPath()));
+}
+
+void testWorkerPool()
+{
+    Skeleton skeleton;
+    AnimationClip clip;
+    createAnimation(9, 7, skeleton, clip);
+    SoaAnimationClip soaClip = BuildSoaAnimationClip(clip, 9);
+
+    // The same pool for every frame, more characters than threads
+    WorkerPool pool(4);
+    CHECK(pool.getNumThreads() == 4);
+    const uint32_t numCharacters = 37;
+    std::vector<AnimationPose> poses(numCharacters);
+    std::vector<AnimationJob> jobs(numCharacters);
+    for (uint32_t frame = 0; frame < 20; frame++)
+    {
+        for (uint32_t character = 0; character < numCharacters; character++)
+        {
+            float time = frame / 60.0f + character * 0.1f;
+            jobs[character] = {&skeleton, character % 2 ? &clip : nullptr, time, &poses[character],
+                               character % 2 ? nullptr : &soaClip};
+        }
+        SampleAnimations(jobs, pool);
+
+        bool allMatch = true;
+        AnimationPose reference;
+        for (uint32_t character = 0; character < numCharacters; character++)
+        {
+            const AnimationJob& job = jobs[character];
+            if (job.pSoaClip)
+            {
+                SampleAnimationSoa(skeleton, &soaClip, job.Time, reference);
+            }
+            else
+            {
+                SampleAnimation(skeleton, &clip, job.Time, reference);
+            }
+            allMatch = allMatch && getMaxDifference(poses[character].BoneMatrices, reference.BoneMatrices) == 0.0f;
+        }
+        CHECK(allMatch);
+    }
+
+    // A failing job, the SoA clip does not match the skeleton, is rethrown by the call and leaves the pool usable
+    Skeleton broken = skeleton;
+    broken.Nodes.pop_back();
+    jobs[4].pSkeleton = &broken;
+    bool thrown = false;
+    try
+    {
+        SampleAnimations(jobs, pool);
+    }
+    catch (const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+    jobs[4].pSkeleton = &skeleton;
+    SampleAnimations(jobs, pool);
+    SampleAnimations({}, pool);
+}
+
+} // namespace
+
+int main()
+{
+    testPathsAgree();
+    testSlerpApproximation();
+    testErrors();
+    testWorkerPool();
+    return VulkanCore::model::test::TestResult();
+}
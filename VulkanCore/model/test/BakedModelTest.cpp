@@ -0,0 +1,308 @@
+#include "BakedModel.h"
+#include "MeshBuffers.h"
+#include "MeshSimplifier.h"
+#include "MeshletBuilder.h"
+#include "TestUtils.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+// Baked model files : written by BakedModelWriter, mapped back by BakedModelFile, ranges checked by
+// ValidateBakedModel()
+
+namespace
+{
+
+using namespace VulkanCore::model;
+
+constexpr uint32_t kSourceVertexSize = 16; // stands for Model::Vertex, the geometry is opaque to the file
+constexpr uint32_t kGpuVertexSize = 20;
+constexpr uint32_t kPositionSize = 8;
+
+// A quad with two LODs and one meshlet per LOD 0, source geometry and 16-bit GPU buffers
+struct TestModel
+{
+    std::vector<BakedMesh> Meshes{1};
+    std::vector<MeshLod> Lods{{0, 6, 0.0f}, {6, 3, 0.5f}};
+    std::vector<Meshlet> Meshlets{1};
+    std::vector<uint32_t> MeshletVertices{0, 1, 2, 3};
+    std::vector<uint32_t> MeshletTriangles{0x00020100, 0x00020301};
+    std::vector<BakedMaterial> Materials{1};
+    std::vector<BakedNode> Nodes{2};
+    std::vector<uint8_t> SourceVertices = std::vector<uint8_t>(4 * kSourceVertexSize, 0xAB);
+    std::vector<uint32_t> SourceIndices{0, 1, 2, 1, 3, 2, 0, 3, 2};
+    std::vector<MeshBufferRange> Ranges{1};
+    std::vector<uint8_t> Vertices = std::vector<uint8_t>(4 * kGpuVertexSize, 0xCD);
+    std::vector<uint8_t> Indices = std::vector<uint8_t>(20, 0x01);
+    std::vector<uint8_t> Positions = std::vector<uint8_t>(4 * kPositionSize, 0xEF);
+
+    TestModel()
+    {
+        BakedMesh& mesh = Meshes[0];
+        mesh.NumVertices = 4;
+        mesh.NumIndices = 6;
+        mesh.NumLodIndices = 9;
+        mesh.NumLods = 2;
+        mesh.NumMeshlets = 1;
+        mesh.MaterialIndex = 0;
+        mesh.Node = 1;
+        Meshlets[0].VertexCount = 4;
+        Meshlets[0].TriangleCount = 2;
+        Nodes[1].Parent = 0;
+
+        MeshBufferRange& range = Ranges[0];
+        range.VertexBufferRange = Vertices.size();
+        range.IndexBufferRange = Indices.size();
+        range.PositionBufferRange = Positions.size();
+        range.IndexSize = sizeof(uint16_t);
+    }
+};
+
+// Baked model in the temporary directory, removed with the object
+class TempBakedModel
+{
+  public:
+    TempBakedModel()
+        : mPath((std::filesystem::temp_directory_path() / ("BakedModelTest." + std::to_string(getpid()) +
+                                                             kBakedModelExtension))
+                    .string())
+    {
+    }
+    ~TempBakedModel()
+    {
+        std::remove(mPath.c_str());
+    }
+
+    const std::string& getPath() const
+    {
+        return mPath;
+    }
+
+    void write(const TestModel& model)
+    {
+        BakedModelWriter writer;
+        std::vector<BakedMaterial> materials = model.Materials;
+        materials[0].Name = writer.addString("Material");
+        std::vector<BakedNode> nodes = model.Nodes;
+        nodes[1].Name = writer.addString("Node");
+
+        writer.addSection(BakedSection_Meshes, model.Meshes);
+        writer.addSection(BakedSection_Lods, model.Lods);
+        writer.addSection(BakedSection_Meshlets, model.Meshlets);
+        writer.addSection(BakedSection_MeshletVertices, model.MeshletVertices);
+        writer.addSection(BakedSection_MeshletTriangles, model.MeshletTriangles);
+        writer.addSection(BakedSection_Materials, materials);
+        writer.addSection(BakedSection_Nodes, nodes);
+        writer.addSection(BakedSection_SourceVertices, model.SourceVertices);
+        writer.addSection(BakedSection_SourceIndices, model.SourceIndices);
+        writer.addSection(BakedSection_Ranges, model.Ranges);
+        writer.addSection(BakedSection_Vertices, model.Vertices);
+        writer.addSection(BakedSection_Indices, model.Indices);
+        writer.addSection(BakedSection_Positions, model.Positions);
+
+        BakedModelHeader header;
+        header.Flags = BakedModelFlag_GpuBuffers | BakedModelFlag_PositionStream | BakedModelFlag_SourceGeometry;
+        header.VertexSize = kGpuVertexSize;
+        header.PositionSize = kPositionSize;
+        header.NumIndices = static_cast<uint32_t>(model.SourceIndices.size());
+        writer.write(mPath, header);
+    }
+
+  private:
+    std::string mPath;
+};
+
+bool throws(const std::function<void()>& function)
+{
+    try
+    {
+        function();
+    }
+    catch (const std::runtime_error&)
+    {
+        return true;
+    }
+    return false;
+}
+
+template <typename T> bool isEqual(std::span<const T> section, const std::vector<T>& data)
+{
+    return section.size() == data.size() && std::memcmp(section.data(), data.data(), data.size() * sizeof(T)) == 0;
+}
+
+// Writes the model with one change and checks the validation rejects it
+bool isRejected(const std::function<void(TestModel&)>& corrupt)
+{
+    TestModel model;
+    corrupt(model);
+    TempBakedModel test;
+    test.write(model);
+    BakedModelFile file(test.getPath());
+    return throws([&]() { ValidateBakedModel(file, kSourceVertexSize); });
+}
+
+void testRoundTrip()
+{
+    TestModel model;
+    TempBakedModel test;
+    test.write(model);
+    BakedModelFile file(test.getPath());
+
+    const BakedModelHeader& header = file.getHeader();
+    CHECK(header.Magic == kBakedModelMagic && header.Version == kBakedModelVersion);
+    CHECK(header.VertexSize == kGpuVertexSize && header.PositionSize == kPositionSize);
+    CHECK(header.NumIndices == 9);
+    for (uint32_t section = 0; section < BakedSection_Count; section++)
+    {
+        const uint8_t* pSection = file.getBytes(static_cast<BakedSection>(section)).data();
+        CHECK(header.Sections[section].Offset % kBakedSectionAlignment == 0);
+        CHECK(reinterpret_cast<uintptr_t>(pSection) % kBakedSectionAlignment == 0);
+    }
+
+    CHECK(isEqual(file.getSection<MeshLod>(BakedSection_Lods), model.Lods));
+    CHECK(isEqual(file.getSection<uint32_t>(BakedSection_MeshletVertices), model.MeshletVertices));
+    CHECK(isEqual(file.getSection<uint32_t>(BakedSection_MeshletTriangles), model.MeshletTriangles));
+    CHECK(isEqual(file.getSection<uint32_t>(BakedSection_SourceIndices), model.SourceIndices));
+    CHECK(isEqual(file.getSection<uint8_t>(BakedSection_SourceVertices), model.SourceVertices));
+    CHECK(isEqual(file.getSection<uint8_t>(BakedSection_Vertices), model.Vertices));
+    CHECK(isEqual(file.getSection<uint8_t>(BakedSection_Indices), model.Indices));
+    CHECK(isEqual(file.getSection<uint8_t>(BakedSection_Positions), model.Positions));
+    CHECK(file.getSection<BakedMesh>(BakedSection_Meshes)[0].NumLodIndices == 9);
+    CHECK(file.getBytes(BakedSection_Dequantizations).empty());
+
+    std::span<const BakedMaterial> materials = file.getSection<BakedMaterial>(BakedSection_Materials);
+    std::span<const BakedNode> nodes = file.getSection<BakedNode>(BakedSection_Nodes);
+    CHECK(file.getString(materials[0].Name) == "Material");
+    CHECK(file.getString(nodes[1].Name) == "Node");
+    CHECK(file.getString(kBakedNoString).empty());
+    CHECK(throws([&]() { file.getString(1000); }));
+    CHECK(throws([&]() { file.getSection<MeshBufferRange>(BakedSection_Vertices); }));
+
+    CHECK(!throws([&]() { ValidateBakedModel(file, kSourceVertexSize); }));
+    CHECK(throws([&]() { ValidateBakedModel(file, 24); }));
+}
+
+void testInvalidFiles()
+{
+    TempBakedModel test;
+    CHECK(throws([&]() { BakedModelFile file(test.getPath()); }));
+
+    test.write(TestModel());
+    std::vector<char> bytes;
+    {
+        std::ifstream input(test.getPath(), std::ios::binary);
+        bytes.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    }
+    auto rewrite = [&](const std::vector<char>& content)
+    {
+        std::ofstream output(test.getPath(), std::ios::binary | std::ios::trunc);
+        output.write(content.data(), static_cast<std::streamsize>(content.size()));
+    };
+
+    std::vector<char> corrupt = bytes;
+    corrupt[0] ^= 1;
+    rewrite(corrupt);
+    CHECK(throws([&]() { BakedModelFile file(test.getPath()); }));
+
+    corrupt = bytes;
+    reinterpret_cast<BakedModelHeader*>(corrupt.data())->Version++;
+    rewrite(corrupt);
+    CHECK(throws([&]() { BakedModelFile file(test.getPath()); }));
+
+    // A section past the end of a truncated file
+    rewrite(std::vector<char>(bytes.begin(), bytes.end() - 1));
+    CHECK(throws([&]() { BakedModelFile file(test.getPath()); }));
+
+    rewrite(std::vector<char>(bytes.begin(), bytes.begin() + sizeof(BakedModelHeader) - 1));
+    CHECK(throws([&]() { BakedModelFile file(test.getPath()); }));
+
+    rewrite(bytes);
+    CHECK(!throws([&]() { BakedModelFile file(test.getPath()); }));
+}
+
+void testInvalidRanges()
+{
+    CHECK(!isRejected([](TestModel&) {}));
+
+    CHECK(isRejected([](TestModel& model) { model.Meshes[0].NumLods = 0; }));
+    CHECK(isRejected([](TestModel& model) { model.Meshes[0].FirstLod = 1; }));
+    CHECK(isRejected([](TestModel& model) { model.Lods[1].NumIndices = 4; }));
+    CHECK(isRejected([](TestModel& model) { model.Lods[1].FirstIndex = UINT32_MAX; }));
+    CHECK(isRejected([](TestModel& model) { model.Meshes[0].NumIndices = 10; }));
+
+    // 32-bit wrap arounds must not pass
+    CHECK(isRejected(
+        [](TestModel& model)
+        {
+            model.Meshlets[0].VertexOffset = UINT32_MAX;
+            model.Meshlets[0].VertexCount = 2;
+        }));
+    CHECK(isRejected([](TestModel& model) { model.Meshlets[0].TriangleCount = 0x55555556; }));
+    CHECK(isRejected([](TestModel& model) { model.Meshlets[0].TriangleOffset = 1; }));
+    CHECK(isRejected([](TestModel& model) { model.Meshes[0].FirstMeshlet = 1; }));
+
+    CHECK(isRejected([](TestModel& model) { model.Meshes[0].MaterialIndex = 1; }));
+    CHECK(isRejected([](TestModel& model) { model.Meshes[0].MaterialIndex = -2; }));
+    CHECK(!isRejected([](TestModel& model) { model.Meshes[0].MaterialIndex = -1; }));
+    CHECK(isRejected([](TestModel& model) { model.Meshes[0].Node = 2; }));
+
+    CHECK(isRejected([](TestModel& model) { model.Meshes[0].BaseVertex = 1; }));
+    CHECK(isRejected([](TestModel& model) { model.SourceIndices.pop_back(); }));
+
+    CHECK(isRejected([](TestModel& model) { model.Ranges[0].IndexSize = 3; }));
+    CHECK(isRejected([](TestModel& model) { model.Ranges[0].IndexSize = sizeof(uint32_t); }));
+    CHECK(isRejected([](TestModel& model) { model.Ranges[0].VertexBufferOffset = 4; }));
+    CHECK(isRejected([](TestModel& model) { model.Ranges[0].VertexBufferRange = 3 * kGpuVertexSize; }));
+    CHECK(isRejected([](TestModel& model) { model.Ranges[0].IndexBufferOffset = UINT64_MAX; }));
+    CHECK(isRejected([](TestModel& model) { model.Ranges[0].PositionBufferRange = 100; }));
+    CHECK(isRejected([](TestModel& model) { model.Ranges.emplace_back(); }));
+
+    // 16-bit indices cannot address the vertices of a larger mesh, the sizes are consistent otherwise
+    auto growMesh = [](TestModel& model, uint32_t indexSize)
+    {
+        const uint32_t numVertices = kMaxIndex16Vertices + 1;
+        model.Meshes[0].NumVertices = numVertices;
+        model.SourceVertices.resize(static_cast<size_t>(numVertices) * kSourceVertexSize);
+        model.Vertices.resize(static_cast<size_t>(numVertices) * kGpuVertexSize);
+        model.Positions.resize(static_cast<size_t>(numVertices) * kPositionSize);
+        model.Indices.resize(static_cast<size_t>(model.Meshes[0].NumLodIndices) * sizeof(uint32_t));
+
+        MeshBufferRange& range = model.Ranges[0];
+        range.VertexBufferRange = model.Vertices.size();
+        range.IndexBufferRange = model.Indices.size();
+        range.PositionBufferRange = model.Positions.size();
+        range.IndexSize = indexSize;
+    };
+    CHECK(isRejected([&](TestModel& model) { growMesh(model, sizeof(uint16_t)); }));
+    CHECK(!isRejected([&](TestModel& model) { growMesh(model, sizeof(uint32_t)); }));
+}
+
+void testPaths()
+{
+    CHECK(GetBakedModelPath("Models/Sponza/sponza.obj") == "Models/Sponza/sponza.vkbake");
+    CHECK(GetBakedModelPath("Models/v1.2/mesh") == "Models/v1.2/mesh.vkbake");
+    CHECK(IsBakedModelPath("sponza.vkbake"));
+    CHECK(!IsBakedModelPath("sponza.obj") && !IsBakedModelPath(".vkbake"));
+}
+
+} // namespace
+
+int main()
+{
+    testRoundTrip();
+    testInvalidFiles();
+    testInvalidRanges();
+    testPaths();
+    return VulkanCore::model::test::TestResult();
+}
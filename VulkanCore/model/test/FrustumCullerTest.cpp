@@ -0,0 +1,152 @@
+#include "FrustumCuller.h"
+#include "TestUtils.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+// FrustumCuller : the SIMD paths return the visible set of the scalar one, whatever the padding of the last lanes
+
+namespace
+{
+
+using namespace VulkanCore;
+
+glm::mat4 getViewProj()
+{
+    glm::mat4 projection = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, 1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    return projection * view;
+}
+
+void fillSpheres(FrustumCuller& culler, uint32_t numSpheres, uint32_t seed)
+{
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<float> position(-120.0f, 120.0f);
+    std::uniform_real_distribution<float> radius(0.0f, 10.0f);
+    culler.clear();
+    for (uint32_t i = 0; i < numSpheres; i++)
+    {
+        culler.addSphere(glm::vec4(position(generator), position(generator), position(generator), radius(generator)));
+    }
+}
+
+// Sphere against the planes, one at a time
+bool isVisible(const FrustumPlanes& planes, const glm::vec4& sphere)
+{
+    for (uint32_t plane = 0; plane < 6; plane++)
+    {
+        float distance = planes.mNormalX[plane] * sphere.x + planes.mNormalY[plane] * sphere.y +
+                         planes.mNormalZ[plane] * sphere.z + planes.mDistance[plane];
+        if (distance < -sphere.w)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void testPathsAgree()
+{
+    glm::mat4 viewProj = getViewProj();
+    FrustumPlanes planes = FrustumCuller::extractPlanes(viewProj);
+    for (uint32_t numSpheres : {0u, 1u, 7u, 8u, 9u, 1001u})
+    {
+        FrustumCuller culler;
+        fillSpheres(culler, numSpheres, numSpheres + 1);
+        CHECK(culler.getNumSpheres() == numSpheres);
+
+        std::vector<uint32_t> reference;
+        culler.cull(viewProj, CullPath_Scalar, reference);
+        CHECK(std::is_sorted(reference.begin(), reference.end()));
+
+        // Recomputed sphere by sphere
+        std::mt19937 generator(numSpheres + 1);
+        std::uniform_real_distribution<float> position(-120.0f, 120.0f);
+        std::uniform_real_distribution<float> radius(0.0f, 10.0f);
+        std::vector<uint32_t> expected;
+        for (uint32_t i = 0; i < numSpheres; i++)
+        {
+            glm::vec4 sphere(position(generator), position(generator), position(generator), radius(generator));
+            if (isVisible(planes, sphere))
+            {
+                expected.push_back(i);
+            }
+        }
+        CHECK(reference == expected);
+        CHECK(numSpheres < 1000 || (!reference.empty() && reference.size() < numSpheres));
+
+        for (CullPath path : {CullPath_SSE, CullPath_AVX2})
+        {
+            if (!FrustumCuller::isPathSupported(path))
+            {
+                continue;
+            }
+            std::vector<uint32_t> visible{12345}; // cleared by cull
+            culler.cull(viewProj, path, visible);
+            CHECK(visible == reference);
+        }
+
+        std::vector<uint32_t> all;
+        culler.cull(viewProj, CullPath_None, all);
+        CHECK(all.size() == numSpheres);
+    }
+}
+
+void testSpheres()
+{
+    glm::mat4 viewProj = getViewProj();
+    FrustumCuller culler;
+    uint32_t inside = culler.addSphere(glm::vec4(0.0f, 0.0f, 10.0f, 1.0f));
+    uint32_t behind = culler.addSphere(glm::vec4(0.0f, 0.0f, -10.0f, 1.0f));
+    culler.addSphere(glm::vec4(0.0f, 0.0f, 200.0f, 1.0f)); // past the far plane
+    uint32_t straddling = culler.addSphere(glm::vec4(0.0f, 0.0f, -1.0f, 2.0f)); // crosses the near plane
+
+    for (CullPath path : {CullPath_Scalar, CullPath_SSE, CullPath_AVX2})
+    {
+        if (!FrustumCuller::isPathSupported(path))
+        {
+            continue;
+        }
+        std::vector<uint32_t> visible;
+        culler.cull(viewProj, path, visible);
+        CHECK((visible == std::vector<uint32_t>{inside, straddling}));
+
+        // Moved spheres are culled where they are now
+        culler.setSphere(behind, glm::vec4(0.0f, 0.0f, 50.0f, 1.0f));
+        culler.cull(viewProj, path, visible);
+        CHECK((visible == std::vector<uint32_t>{inside, behind, straddling}));
+        culler.setSphere(behind, glm::vec4(0.0f, 0.0f, -10.0f, 1.0f));
+    }
+
+    bool thrown = false;
+    try
+    {
+        culler.setSphere(4, glm::vec4(0.0f));
+    }
+    catch (const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+
+    culler.clear();
+    std::vector<uint32_t> visible;
+    culler.cull(viewProj, CullPath_Scalar, visible);
+    CHECK(visible.empty() && culler.getNumSpheres() == 0);
+    CHECK(FrustumCuller::isPathSupported(FrustumCuller::getBestPath()));
+}
+
+} // namespace
+
+int main()
+{
+    testPathsAgree();
+    testSpheres();
+    return VulkanCore::model::test::TestResult();
+}
@@ -0,0 +1,295 @@
+#include "MeshBuffers.h"
+#include "Model.h"
+#include "TestUtils.h"
+
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// GPU buffers of a model : 16-bit index packing and its padding, range alignment and the position stream, built on
+// the heap by Model::buildMeshBuffers() and written through a MeshBufferWriter by Model::writeMeshBuffers()
+
+namespace
+{
+
+using namespace VulkanCore::model;
+
+// Model without a scene, its submeshes are added by hand
+class TestModel : public Model
+{
+  public:
+    using Model::Vertex;
+
+    // Submesh of numVertices random vertices, indices holding every LOD of which the first numIndices are LOD 0
+    void addMesh(std::mt19937& generator, uint32_t numVertices, const std::vector<uint32_t>& indices,
+                 uint32_t numIndices)
+    {
+        BasicMeshEntry mesh;
+        mesh.BaseVertex = static_cast<uint32_t>(mVertices.size());
+        mesh.BaseIndex = static_cast<uint32_t>(m_Indices.size());
+        mesh.NumVertices = numVertices;
+        mesh.NumIndices = numIndices;
+        mesh.NumLodIndices = static_cast<uint32_t>(indices.size());
+        mesh.BoundsMin = glm::vec3(-1.0f);
+        mesh.BoundsMax = glm::vec3(1.0f);
+
+        std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+        for (uint32_t i = 0; i < numVertices; i++)
+        {
+            Vertex vertex;
+            vertex.pos = glm::vec3(value(generator), value(generator), value(generator));
+            vertex.texCoord = glm::vec2(value(generator), value(generator));
+            vertex.normal = glm::vec3(0.0f, 0.0f, 1.0f);
+            vertex.tangent = glm::vec3(1.0f, 0.0f, 0.0f);
+            vertex.bitangent = glm::vec3(0.0f, 1.0f, 0.0f);
+            mVertices.push_back(vertex);
+        }
+        m_Indices.insert(m_Indices.end(), indices.begin(), indices.end());
+        m_Meshes.push_back(mesh);
+    }
+
+    MeshBuffers build(bool quantize, bool positionStream, uint64_t alignment) const
+    {
+        return buildMeshBuffers(mVertices, quantize, positionStream, alignment);
+    }
+    MeshBuffers write(bool quantize, bool positionStream, uint64_t alignment, MeshBufferWriter& writer) const
+    {
+        return writeMeshBuffers(mVertices, quantize, positionStream, alignment, writer);
+    }
+
+    const BasicMeshEntry& getMesh(uint32_t index) const
+    {
+        return m_Meshes[index];
+    }
+    const std::vector<uint32_t>& getIndices() const
+    {
+        return m_Indices;
+    }
+    const std::vector<Vertex>& getVertices() const
+    {
+        return mVertices;
+    }
+
+  protected:
+    VulkanCore::Texture* allocTexture2D() override
+    {
+        return nullptr;
+    }
+    void destroyTexture(VulkanCore::Texture* pTexture) override {}
+    void populateBuffer(std::vector<Vertex>& vertices) override {}
+    void populateBufferSkinned(std::vector<SkinnedVertex>& vertices) override {}
+
+  private:
+    std::vector<Vertex> mVertices;
+};
+
+// Writes the buffers to vectors filled with a pattern, so the bytes left alone by writeMeshBuffers() stand out
+class PatternWriter : public MeshBufferWriter
+{
+  public:
+    MeshBufferTargets map(uint64_t vertexBufferSize, uint64_t indexBufferSize, uint64_t positionBufferSize) override
+    {
+        mNumMaps++;
+        mVertices.assign(vertexBufferSize, kPattern);
+        mIndices.assign(indexBufferSize, kPattern);
+        mPositions.assign(positionBufferSize, kPattern);
+        return {mVertices.data(), mIndices.data(), mPositions.data()};
+    }
+
+    static constexpr uint8_t kPattern = 0xAB;
+    uint32_t mNumMaps{0};
+    std::vector<uint8_t> mVertices;
+    std::vector<uint8_t> mIndices;
+    std::vector<uint8_t> mPositions;
+};
+
+// Three submeshes : a small one with an odd number of indices over two LODs, one with exactly kMaxIndex16Vertices
+// vertices, still 16-bit, and one past the limit, 32-bit
+TestModel createModel()
+{
+    std::mt19937 generator(44);
+    TestModel model;
+    model.addMesh(generator, 5, {0, 1, 2, 2, 3, 4, 0, 2, 4}, 6);
+    model.addMesh(generator, kMaxIndex16Vertices, {0, 1, kMaxIndex16Vertices - 1, 2, 3, kMaxIndex16Vertices - 2}, 6);
+    model.addMesh(generator, kMaxIndex16Vertices + 1, {0, kMaxIndex16Vertices, 1}, 3);
+    return model;
+}
+
+bool isZero(const std::vector<uint8_t>& bytes, uint64_t begin, uint64_t end)
+{
+    for (uint64_t i = begin; i < end; i++)
+    {
+        if (bytes[i] != 0)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+void testIndex16()
+{
+    TestModel model = createModel();
+    MeshBuffers buffers = model.build(false, false, 16);
+    CHECK(buffers.Ranges.size() == 3);
+
+    // 9 indices of 2 bytes, rounded up to 20 bytes, the last 2 are zero
+    const MeshBufferRange& small = buffers.Ranges[0];
+    CHECK(small.IndexSize == sizeof(uint16_t));
+    CHECK(small.IndexBufferOffset == 0);
+    CHECK(small.IndexBufferRange == 20);
+    const uint16_t* pSmall = reinterpret_cast<const uint16_t*>(buffers.Indices.data());
+    for (uint32_t i = 0; i < 9; i++)
+    {
+        CHECK(pSmall[i] == model.getIndices()[i]);
+    }
+    CHECK(pSmall[9] == 0);
+
+    // kMaxIndex16Vertices - 1 is the largest 16-bit index
+    const MeshBufferRange& limit = buffers.Ranges[1];
+    CHECK(limit.IndexSize == sizeof(uint16_t));
+    CHECK(limit.IndexBufferOffset == 32);
+    CHECK(limit.IndexBufferRange == 12);
+    const uint16_t* pLimit = reinterpret_cast<const uint16_t*>(buffers.Indices.data() + limit.IndexBufferOffset);
+    CHECK(pLimit[2] == UINT16_MAX);
+    CHECK(pLimit[5] == UINT16_MAX - 1);
+
+    const MeshBufferRange& large = buffers.Ranges[2];
+    CHECK(large.IndexSize == sizeof(uint32_t));
+    CHECK(large.IndexBufferOffset == 48);
+    CHECK(large.IndexBufferRange == 12);
+    uint32_t largeIndices[3];
+    memcpy(largeIndices, buffers.Indices.data() + large.IndexBufferOffset, sizeof(largeIndices));
+    CHECK(largeIndices[0] == 0 && largeIndices[1] == kMaxIndex16Vertices && largeIndices[2] == 1);
+    CHECK(buffers.Indices.size() == 60);
+}
+
+void testAlignment()
+{
+    TestModel model = createModel();
+    const uint64_t alignment = 64;
+    for (bool quantize : {false, true})
+    {
+        MeshBuffers buffers = model.build(quantize, true, alignment);
+        CHECK(buffers.VertexSize == (quantize ? sizeof(QuantizedVertex) : sizeof(TestModel::Vertex)));
+        CHECK(buffers.PositionSize == (quantize ? 8 : 12));
+        CHECK(buffers.Dequantizations.size() == (quantize ? 3 : 0));
+
+        uint64_t vertexEnd = 0;
+        uint64_t indexEnd = 0;
+        uint64_t positionEnd = 0;
+        for (uint32_t meshIndex = 0; meshIndex < 3; meshIndex++)
+        {
+            const BasicMeshEntry& mesh = model.getMesh(meshIndex);
+            const MeshBufferRange& range = buffers.Ranges[meshIndex];
+
+            // Every range on the alignment and on a whole element, packed after the previous one, the gap zeroed
+            CHECK(range.VertexBufferOffset % alignment == 0 && range.VertexBufferOffset % buffers.VertexSize == 0);
+            CHECK(range.PositionBufferOffset % alignment == 0 &&
+                  range.PositionBufferOffset % buffers.PositionSize == 0);
+            CHECK(range.IndexBufferOffset % alignment == 0);
+            CHECK(range.VertexBufferOffset >= vertexEnd && range.VertexBufferOffset - vertexEnd < 448);
+            CHECK(range.PositionBufferOffset >= positionEnd && range.PositionBufferOffset - positionEnd < 192);
+            CHECK(range.IndexBufferOffset >= indexEnd && range.IndexBufferOffset - indexEnd < alignment);
+            CHECK(isZero(buffers.Vertices, vertexEnd, range.VertexBufferOffset));
+            CHECK(isZero(buffers.Positions, positionEnd, range.PositionBufferOffset));
+
+            CHECK(range.VertexBufferRange == uint64_t(mesh.NumVertices) * buffers.VertexSize);
+            CHECK(range.PositionBufferRange == uint64_t(mesh.NumVertices) * buffers.PositionSize);
+            vertexEnd = range.VertexBufferOffset + range.VertexBufferRange;
+            indexEnd = range.IndexBufferOffset + range.IndexBufferRange;
+            positionEnd = range.PositionBufferOffset + range.PositionBufferRange;
+
+            // The position stream repeats the position of every vertex, padded to 8 bytes when quantized
+            for (uint32_t i = 0; i < mesh.NumVertices; i += 997)
+            {
+                const uint8_t* pVertex = buffers.Vertices.data() + range.VertexBufferOffset + i * buffers.VertexSize;
+                const uint8_t* pPosition =
+                    buffers.Positions.data() + range.PositionBufferOffset + i * buffers.PositionSize;
+                if (quantize)
+                {
+                    CHECK(memcmp(pPosition, pVertex, 3 * sizeof(uint16_t)) == 0);
+                    CHECK(pPosition[6] == 0 && pPosition[7] == 0);
+                }
+                else
+                {
+                    const TestModel::Vertex& vertex = model.getVertices()[mesh.BaseVertex + i];
+                    CHECK(memcmp(pVertex, &vertex, sizeof(vertex)) == 0);
+                    CHECK(memcmp(pPosition, &vertex.pos, sizeof(glm::vec3)) == 0);
+                }
+            }
+        }
+        CHECK(buffers.Vertices.size() == vertexEnd);
+        CHECK(buffers.Indices.size() == indexEnd);
+        CHECK(buffers.Positions.size() == positionEnd);
+    }
+
+    // 56-byte vertices on 64 bytes : the second range starts on lcm(64, 56) = 448, positions on lcm(64, 12) = 192
+    MeshBuffers buffers = model.build(false, true, alignment);
+    CHECK(buffers.Ranges[1].VertexBufferOffset == 448);
+    CHECK(buffers.Ranges[1].PositionBufferOffset == 192);
+    CHECK(buffers.Ranges[1].IndexBufferOffset == 64);
+
+    // Without position stream
+    buffers = model.build(false, false, alignment);
+    CHECK(buffers.PositionSize == 0);
+    CHECK(buffers.Positions.empty());
+    CHECK(buffers.Ranges[2].PositionBufferRange == 0);
+}
+
+void testWriter()
+{
+    TestModel model = createModel();
+    for (bool quantize : {false, true})
+    {
+        MeshBuffers built = model.build(quantize, true, 64);
+        PatternWriter writer;
+        MeshBuffers written = model.write(quantize, true, 64, writer);
+
+        // Layout only, the bytes went to the writer, mapped once with the size of every buffer
+        CHECK(written.Vertices.empty() && written.Indices.empty() && written.Positions.empty());
+        CHECK(writer.mNumMaps == 1);
+        CHECK(writer.mVertices.size() == built.Vertices.size());
+        CHECK(writer.mIndices.size() == built.Indices.size());
+        CHECK(writer.mPositions.size() == built.Positions.size());
+
+        for (uint32_t meshIndex = 0; meshIndex < 3; meshIndex++)
+        {
+            const MeshBufferRange& range = written.Ranges[meshIndex];
+            const MeshBufferRange& builtRange = built.Ranges[meshIndex];
+            CHECK(range.VertexBufferOffset == builtRange.VertexBufferOffset);
+            CHECK(range.IndexBufferOffset == builtRange.IndexBufferOffset);
+            CHECK(range.PositionBufferOffset == builtRange.PositionBufferOffset);
+            CHECK(range.IndexSize == builtRange.IndexSize);
+
+            // Same bytes in the ranges, the padding of the 16-bit indices included
+            CHECK(memcmp(writer.mVertices.data() + range.VertexBufferOffset,
+                         built.Vertices.data() + range.VertexBufferOffset, range.VertexBufferRange) == 0);
+            CHECK(memcmp(writer.mIndices.data() + range.IndexBufferOffset,
+                         built.Indices.data() + range.IndexBufferOffset, range.IndexBufferRange) == 0);
+            // The 4th component of a quantized position is padding
+            uint32_t positionBytes = quantize ? 3 * sizeof(uint16_t) : written.PositionSize;
+            for (uint32_t i = 0; i < model.getMesh(meshIndex).NumVertices; i += 997)
+            {
+                uint64_t offset = range.PositionBufferOffset + uint64_t(i) * written.PositionSize;
+                CHECK(memcmp(writer.mPositions.data() + offset, built.Positions.data() + offset, positionBytes) == 0);
+            }
+        }
+
+        // The gap after the first index range is not written
+        CHECK(writer.mIndices[built.Ranges[0].IndexBufferRange] == PatternWriter::kPattern);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    testIndex16();
+    testAlignment();
+    testWriter();
+    return VulkanCore::model::test::TestResult();
+}
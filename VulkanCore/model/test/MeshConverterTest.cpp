@@ -0,0 +1,198 @@
+#include "MeshConverter.h"
+#include "TestUtils.h"
+
+#include <assimp/mesh.h>
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <vector>
+
+// aiMesh conversion : ConvertMeshes() on one and several threads vs a per vertex reference, for every combination of
+// attributes and for meshes split in chunks
+
+namespace
+{
+
+using namespace VulkanCore::model;
+
+// Model::Vertex
+struct Vertex
+{
+    glm::vec3 pos;
+    glm::vec2 texCoord;
+    glm::vec3 normal;
+    glm::vec3 tangent;
+    glm::vec3 bitangent;
+};
+
+// Bytes of the vertices before the conversion, every attribute must be written even when the mesh lacks it
+constexpr uint8_t kGarbage = 0xCD;
+constexpr uint32_t kGuardIndex = 0xDEADBEEF;
+
+std::unique_ptr<aiMesh> createMesh(std::mt19937& generator, uint32_t numVertices, bool normals, bool texCoords,
+                                   bool tangents)
+{
+    std::uniform_real_distribution<float> value(-1.0f, 1.0f);
+    auto randomVector = [&]() { return aiVector3D(value(generator), value(generator), value(generator)); };
+
+    auto pMesh = std::make_unique<aiMesh>();
+    pMesh->mPrimitiveTypes = aiPrimitiveType_TRIANGLE;
+    pMesh->mNumVertices = numVertices;
+    pMesh->mVertices = new aiVector3D[numVertices];
+    pMesh->mNormals = normals ? new aiVector3D[numVertices] : nullptr;
+    pMesh->mTextureCoords[0] = texCoords ? new aiVector3D[numVertices] : nullptr;
+    pMesh->mNumUVComponents[0] = texCoords ? 2 : 0;
+    pMesh->mTangents = tangents ? new aiVector3D[numVertices] : nullptr;
+    pMesh->mBitangents = tangents ? new aiVector3D[numVertices] : nullptr;
+    for (uint32_t i = 0; i < numVertices; i++)
+    {
+        pMesh->mVertices[i] = randomVector();
+        if (normals)
+        {
+            pMesh->mNormals[i] = randomVector();
+        }
+        if (texCoords)
+        {
+            pMesh->mTextureCoords[0][i] = randomVector();
+        }
+        if (tangents)
+        {
+            pMesh->mTangents[i] = randomVector();
+            pMesh->mBitangents[i] = randomVector();
+        }
+    }
+
+    std::uniform_int_distribution<uint32_t> index(0, numVertices - 1);
+    pMesh->mNumFaces = numVertices;
+    pMesh->mFaces = new aiFace[pMesh->mNumFaces];
+    for (uint32_t i = 0; i < pMesh->mNumFaces; i++)
+    {
+        aiFace& face = pMesh->mFaces[i];
+        face.mNumIndices = 3;
+        face.mIndices = new unsigned int[3]{index(generator), index(generator), index(generator)};
+    }
+    return pMesh;
+}
+
+// The loop ConvertMeshes() replaced, one presence check per attribute and vertex
+void convertReference(const std::vector<MeshConversionRange>& meshes, std::vector<Vertex>& vertices,
+                      std::vector<uint32_t>& indices)
+{
+    for (const MeshConversionRange& range : meshes)
+    {
+        const aiMesh* pMesh = range.pMesh;
+        for (uint32_t i = 0; i < pMesh->mNumVertices; i++)
+        {
+            const aiVector3D zero(0.0f, 0.0f, 0.0f);
+            const aiVector3D& pos = pMesh->mVertices[i];
+            const aiVector3D& normal = pMesh->HasNormals() ? pMesh->mNormals[i] : zero;
+            const aiVector3D& texCoord = pMesh->HasTextureCoords(0) ? pMesh->mTextureCoords[0][i] : zero;
+            const aiVector3D& tangent = pMesh->HasTangentsAndBitangents() ? pMesh->mTangents[i] : zero;
+            const aiVector3D& bitangent = pMesh->HasTangentsAndBitangents() ? pMesh->mBitangents[i] : zero;
+
+            Vertex& vertex = vertices[range.BaseVertex + i];
+            vertex.pos = glm::vec3(pos.x, pos.y, pos.z);
+            vertex.texCoord = glm::vec2(texCoord.x, texCoord.y);
+            vertex.normal = glm::vec3(normal.x, normal.y, normal.z);
+            vertex.tangent = glm::vec3(tangent.x, tangent.y, tangent.z);
+            vertex.bitangent = glm::vec3(bitangent.x, bitangent.y, bitangent.z);
+        }
+
+        uint32_t index = range.BaseIndex;
+        for (uint32_t i = 0; i < pMesh->mNumFaces; i++)
+        {
+            const aiFace& face = pMesh->mFaces[i];
+            for (uint32_t j = 0; j < face.mNumIndices; j++)
+            {
+                indices[index++] = face.mIndices[j];
+            }
+        }
+    }
+}
+
+void testThreadsAgree()
+{
+    std::mt19937 generator(43);
+
+    // Every combination of attributes, small meshes and meshes of several chunks, the last one partial
+    std::vector<std::unique_ptr<aiMesh>> scene;
+    const uint32_t sizes[] = {1, 7, 1000, kMeshConversionChunk, 2 * kMeshConversionChunk + 123};
+    for (uint32_t attributes = 0; attributes < 8; attributes++)
+    {
+        uint32_t numVertices = sizes[attributes % std::size(sizes)];
+        scene.push_back(createMesh(generator, numVertices, attributes & 1, attributes & 2, attributes & 4));
+    }
+
+    std::vector<MeshConversionRange> meshes;
+    uint32_t numVertices = 0;
+    uint32_t numIndices = 0;
+    for (const std::unique_ptr<aiMesh>& pMesh : scene)
+    {
+        meshes.push_back({pMesh.get(), numVertices, numIndices});
+        numVertices += pMesh->mNumVertices;
+        numIndices += pMesh->mNumFaces * 3;
+    }
+
+    std::vector<Vertex> reference(numVertices);
+    std::vector<uint32_t> referenceIndices(numIndices);
+    convertReference(meshes, reference, referenceIndices);
+
+    for (uint32_t numThreads : {1u, 4u, 0u})
+    {
+        // One extra vertex and index, the conversion must stay in its ranges
+        std::vector<Vertex> vertices(numVertices + 1);
+        memset(static_cast<void*>(vertices.data()), kGarbage, vertices.size() * sizeof(Vertex));
+        std::vector<uint32_t> indices(numIndices + 1, kGuardIndex);
+
+        ConvertMeshes<Vertex>(meshes, vertices.data(), indices.data(), numThreads);
+
+        CHECK(memcmp(vertices.data(), reference.data(), numVertices * sizeof(Vertex)) == 0);
+        CHECK(memcmp(indices.data(), referenceIndices.data(), numIndices * sizeof(uint32_t)) == 0);
+
+        Vertex guard;
+        memset(static_cast<void*>(&guard), kGarbage, sizeof(guard));
+        CHECK(memcmp(&vertices.back(), &guard, sizeof(Vertex)) == 0);
+        CHECK(indices.back() == kGuardIndex);
+    }
+}
+
+void testMissingAttributes()
+{
+    std::mt19937 generator(7);
+    std::unique_ptr<aiMesh> pMesh = createMesh(generator, 3, false, false, false);
+    std::vector<MeshConversionRange> meshes = {{pMesh.get(), 0, 0}};
+
+    std::vector<Vertex> vertices(3);
+    memset(static_cast<void*>(vertices.data()), kGarbage, vertices.size() * sizeof(Vertex));
+    std::vector<uint32_t> indices(pMesh->mNumFaces * 3);
+    ConvertMeshes<Vertex>(meshes, vertices.data(), indices.data(), 1);
+
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        CHECK(vertices[i].pos.x == pMesh->mVertices[i].x);
+        CHECK(vertices[i].pos.z == pMesh->mVertices[i].z);
+        CHECK(vertices[i].texCoord == glm::vec2(0.0f));
+        CHECK(vertices[i].normal == glm::vec3(0.0f));
+        CHECK(vertices[i].tangent == glm::vec3(0.0f));
+        CHECK(vertices[i].bitangent == glm::vec3(0.0f));
+    }
+    CHECK(indices[0] == pMesh->mFaces[0].mIndices[0]);
+    CHECK(indices[2] == pMesh->mFaces[0].mIndices[2]);
+    CHECK(indices[8] == pMesh->mFaces[2].mIndices[2]);
+
+    // No mesh, nothing to do
+    ConvertMeshes<Vertex>({}, vertices.data(), indices.data(), 4);
+}
+
+} // namespace
+
+int main()
+{
+    testThreadsAgree();
+    testMissingAttributes();
+    return VulkanCore::model::test::TestResult();
+}
@@ -0,0 +1,194 @@
+#include "MeshOptimizer.h"
+#include "TestUtils.h"
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+// Vertex deduplication, the vertex cache, overdraw and fetch stages : the triangles are kept and the simulated
+// costs never get worse
+
+namespace
+{
+
+using namespace VulkanCore::model;
+
+struct TestVertex
+{
+    float Position[3];
+    float Attribute;
+};
+
+constexpr uint32_t kVertexSize = sizeof(TestVertex);
+
+struct TestMesh
+{
+    std::vector<TestVertex> Vertices;
+    std::vector<uint32_t> Indices;
+
+    uint8_t* getBytes()
+    {
+        return reinterpret_cast<uint8_t*>(Vertices.data());
+    }
+    uint32_t getNumVertices() const
+    {
+        return static_cast<uint32_t>(Vertices.size());
+    }
+};
+
+// size x size quads in the XY plane, the triangles shuffled so the input order is cache hostile
+TestMesh createGrid(uint32_t size, bool shuffle)
+{
+    TestMesh mesh;
+    for (uint32_t y = 0; y <= size; y++)
+    {
+        for (uint32_t x = 0; x <= size; x++)
+        {
+            mesh.Vertices.push_back({{static_cast<float>(x), static_cast<float>(y), 0.0f}, 0.0f});
+        }
+    }
+    std::vector<std::array<uint32_t, 3>> triangles;
+    for (uint32_t y = 0; y < size; y++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            uint32_t corner = y * (size + 1) + x;
+            triangles.push_back({corner, corner + 1, corner + size + 1});
+            triangles.push_back({corner + 1, corner + size + 2, corner + size + 1});
+        }
+    }
+    if (shuffle)
+    {
+        std::mt19937 generator(7);
+        std::shuffle(triangles.begin(), triangles.end(), generator);
+    }
+    for (const std::array<uint32_t, 3>& triangle : triangles)
+    {
+        mesh.Indices.insert(mesh.Indices.end(), triangle.begin(), triangle.end());
+    }
+    return mesh;
+}
+
+// Triangles as position triples, sorted : equal when two meshes draw the same triangles in any order, whatever
+// their vertex numbering
+std::vector<std::array<float, 9>> getTriangles(const std::vector<uint32_t>& indices, const uint8_t* vertices)
+{
+    std::vector<std::array<float, 9>> triangles(indices.size() / 3);
+    for (size_t triangle = 0; triangle < triangles.size(); triangle++)
+    {
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            const uint8_t* pVertex = vertices + static_cast<size_t>(indices[triangle * 3 + corner]) * kVertexSize;
+            std::memcpy(&triangles[triangle][corner * 3], pVertex, sizeof(float) * 3);
+        }
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+void testDeduplicate()
+{
+    // Every corner of every triangle its own vertex, plus two unreferenced ones
+    TestMesh grid = createGrid(4, false);
+    TestMesh mesh;
+    for (uint32_t index : grid.Indices)
+    {
+        mesh.Indices.push_back(mesh.getNumVertices());
+        mesh.Vertices.push_back(grid.Vertices[index]);
+    }
+    mesh.Vertices.push_back({{100.0f, 0.0f, 0.0f}, 0.0f});
+    mesh.Vertices.push_back({{200.0f, 0.0f, 0.0f}, 0.0f});
+    std::vector<std::array<float, 9>> triangles = getTriangles(mesh.Indices, mesh.getBytes());
+
+    uint32_t numVertices = DeduplicateVertices(mesh.Indices, mesh.getBytes(), mesh.getNumVertices(), kVertexSize);
+    CHECK(numVertices == grid.getNumVertices());
+    CHECK(getTriangles(mesh.Indices, mesh.getBytes()) == triangles);
+    CHECK(*std::max_element(mesh.Indices.begin(), mesh.Indices.end()) < numVertices);
+
+    // Same position, another attribute : not a duplicate
+    TestMesh split;
+    split.Vertices = {{{0.0f, 0.0f, 0.0f}, 0.0f}, {{1.0f, 0.0f, 0.0f}, 0.0f}, {{0.0f, 1.0f, 0.0f}, 0.0f},
+                      {{0.0f, 0.0f, 0.0f}, 1.0f}};
+    split.Indices = {0, 1, 2, 3, 1, 2};
+    CHECK(DeduplicateVertices(split.Indices, split.getBytes(), split.getNumVertices(), kVertexSize) == 4);
+}
+
+void testVertexCache()
+{
+    TestMesh mesh = createGrid(64, true);
+    std::vector<std::array<float, 9>> triangles = getTriangles(mesh.Indices, mesh.getBytes());
+    float inputACMR = AnalyzeMesh(mesh.Indices, mesh.getNumVertices(), kVertexSize).getACMR();
+
+    OptimizeVertexCache(mesh.Indices, mesh.getNumVertices());
+    float optimizedACMR = AnalyzeMesh(mesh.Indices, mesh.getNumVertices(), kVertexSize).getACMR();
+    CHECK(getTriangles(mesh.Indices, mesh.getBytes()) == triangles);
+    CHECK(optimizedACMR < inputACMR);
+    CHECK(optimizedACMR < 0.8f); // 0.5 is the ideal grid, 16 entries of FIFO get close
+
+    // An already optimized order does not get worse
+    OptimizeVertexCache(mesh.Indices, mesh.getNumVertices());
+    CHECK(AnalyzeMesh(mesh.Indices, mesh.getNumVertices(), kVertexSize).getACMR() <= optimizedACMR + 0.01f);
+}
+
+void testDisjointTriangles()
+{
+    // Nothing is shared, every triangle is a dead end : each must still be emitted exactly once
+    TestMesh mesh;
+    for (uint32_t triangle = 0; triangle < 1000; triangle++)
+    {
+        float x = static_cast<float>(triangle);
+        mesh.Vertices.push_back({{x, 0.0f, 0.0f}, 0.0f});
+        mesh.Vertices.push_back({{x + 1.0f, 0.0f, 0.0f}, 0.0f});
+        mesh.Vertices.push_back({{x, 1.0f, 0.0f}, 0.0f});
+        mesh.Indices.insert(mesh.Indices.end(), {triangle * 3 + 2, triangle * 3 + 1, triangle * 3});
+    }
+    std::vector<std::array<float, 9>> triangles = getTriangles(mesh.Indices, mesh.getBytes());
+    OptimizeVertexCache(mesh.Indices, mesh.getNumVertices());
+    CHECK(getTriangles(mesh.Indices, mesh.getBytes()) == triangles);
+}
+
+void testOptimizeMesh()
+{
+    TestMesh mesh = createGrid(32, true);
+    std::vector<std::array<float, 9>> triangles = getTriangles(mesh.Indices, mesh.getBytes());
+
+    MeshOptimizerReport report;
+    uint32_t numVertices = OptimizeMesh(mesh.Indices, mesh.getBytes(), mesh.getNumVertices(), kVertexSize,
+                                        offsetof(TestVertex, Position), &report);
+    CHECK(numVertices == mesh.getNumVertices());
+    CHECK(getTriangles(mesh.Indices, mesh.getBytes()) == triangles);
+
+    const MeshOptimizerStats& input = report[MeshOptimizerStage_Input];
+    const MeshOptimizerStats& vertexCache = report[MeshOptimizerStage_VertexCache];
+    const MeshOptimizerStats& overdraw = report[MeshOptimizerStage_Overdraw];
+    const MeshOptimizerStats& output = report[MeshOptimizerStage_VertexFetch];
+    CHECK(vertexCache.getACMR() < input.getACMR());
+    CHECK(overdraw.getACMR() <= vertexCache.getACMR() * kOverdrawThreshold + 1e-4f);
+    CHECK(output.getACMR() == overdraw.getACMR()); // fetch order renumbers, the cache sees the same pattern
+    CHECK(output.getOverfetch() <= input.getOverfetch());
+
+    // Vertices are numbered by first use
+    uint32_t nextVertex = 0;
+    bool firstUseOrder = true;
+    for (uint32_t index : mesh.Indices)
+    {
+        firstUseOrder = firstUseOrder && index <= nextVertex;
+        nextVertex = std::max(nextVertex, index + 1);
+    }
+    CHECK(firstUseOrder);
+}
+
+} // namespace
+
+int main()
+{
+    testDeduplicate();
+    testVertexCache();
+    testDisjointTriangles();
+    testOptimizeMesh();
+    return VulkanCore::model::test::TestResult();
+}
@@ -0,0 +1,226 @@
+#include "MeshSimplifier.h"
+#include "TestUtils.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Quadric simplification : target counts, error bounds, open borders and seams kept in place, the LOD chain
+
+namespace
+{
+
+using namespace VulkanCore::model;
+
+struct TestVertex
+{
+    float Position[3];
+    float Attribute;
+};
+
+constexpr uint32_t kVertexSize = sizeof(TestVertex);
+constexpr uint32_t kPositionOffset = offsetof(TestVertex, Position);
+
+struct TestMesh
+{
+    std::vector<TestVertex> Vertices;
+    std::vector<uint32_t> Indices;
+
+    const uint8_t* getBytes() const
+    {
+        return reinterpret_cast<const uint8_t*>(Vertices.data());
+    }
+    uint32_t getNumVertices() const
+    {
+        return static_cast<uint32_t>(Vertices.size());
+    }
+};
+
+// size x size quads over [0, 1]^2, z = height(x, y). With seamColumn < size, the vertices of that column are
+// duplicated with another attribute and the quads right of it use the copies, as a UV seam would.
+template <typename Height> TestMesh createGrid(uint32_t size, Height height, uint32_t seamColumn = UINT32_MAX)
+{
+    TestMesh mesh;
+    auto addVertex = [&](uint32_t x, uint32_t y, float attribute)
+    {
+        float fx = static_cast<float>(x) / size;
+        float fy = static_cast<float>(y) / size;
+        mesh.Vertices.push_back({{fx, fy, height(fx, fy)}, attribute});
+        return mesh.getNumVertices() - 1;
+    };
+    std::vector<uint32_t> grid((size + 1) * (size + 1));
+    std::vector<uint32_t> seam(size + 1);
+    for (uint32_t y = 0; y <= size; y++)
+    {
+        for (uint32_t x = 0; x <= size; x++)
+        {
+            grid[y * (size + 1) + x] = addVertex(x, y, 0.0f);
+        }
+        if (seamColumn < size)
+        {
+            seam[y] = addVertex(seamColumn, y, 1.0f);
+        }
+    }
+    auto getVertex = [&](uint32_t x, uint32_t y, uint32_t quadX)
+    { return x == seamColumn && quadX >= seamColumn ? seam[y] : grid[y * (size + 1) + x]; };
+    for (uint32_t y = 0; y < size; y++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            uint32_t v00 = getVertex(x, y, x);
+            uint32_t v10 = getVertex(x + 1, y, x);
+            uint32_t v01 = getVertex(x, y + 1, x);
+            uint32_t v11 = getVertex(x + 1, y + 1, x);
+            mesh.Indices.insert(mesh.Indices.end(), {v00, v10, v01, v10, v11, v01});
+        }
+    }
+    return mesh;
+}
+
+float flat(float, float)
+{
+    return 0.0f;
+}
+
+float bumpy(float x, float y)
+{
+    return 0.1f * std::sin(x * 12.0f) * std::cos(y * 9.0f);
+}
+
+const float* getPosition(const TestMesh& mesh, uint32_t vertex)
+{
+    return mesh.Vertices[vertex].Position;
+}
+
+// Signed area of a flat mesh, in the XY plane
+float getArea(const TestMesh& mesh, const std::vector<uint32_t>& indices)
+{
+    float area = 0.0f;
+    for (size_t triangle = 0; triangle < indices.size() / 3; triangle++)
+    {
+        const float* p0 = getPosition(mesh, indices[triangle * 3]);
+        const float* p1 = getPosition(mesh, indices[triangle * 3 + 1]);
+        const float* p2 = getPosition(mesh, indices[triangle * 3 + 2]);
+        area += 0.5f * ((p1[0] - p0[0]) * (p2[1] - p0[1]) - (p2[0] - p0[0]) * (p1[1] - p0[1]));
+    }
+    return area;
+}
+
+void testTargetCount()
+{
+    // A plane collapses without error down to the target
+    TestMesh mesh = createGrid(16, flat);
+    uint32_t target = static_cast<uint32_t>(mesh.Indices.size() / 4) / 3 * 3;
+    float error = -1.0f;
+    std::vector<uint32_t> simplified = SimplifyMesh(mesh.Indices, mesh.getBytes(), mesh.getNumVertices(), kVertexSize,
+                                                    kPositionOffset, target, 1.0f, &error);
+    CHECK(simplified.size() % 3 == 0);
+    CHECK(!simplified.empty() && simplified.size() <= target);
+    CHECK_NEAR(error, 0.0f, 1e-4f);
+
+    // Nothing to do below the target
+    std::vector<uint32_t> unchanged = SimplifyMesh(mesh.Indices, mesh.getBytes(), mesh.getNumVertices(), kVertexSize,
+                                                   kPositionOffset, static_cast<uint32_t>(mesh.Indices.size()), 1.0f);
+    CHECK(unchanged == mesh.Indices);
+}
+
+void testErrorLimit()
+{
+    // A curved surface stops short of the target once the error limit is reached
+    TestMesh mesh = createGrid(32, bumpy);
+    float targetError = 0.01f;
+    float error = -1.0f;
+    std::vector<uint32_t> simplified = SimplifyMesh(mesh.Indices, mesh.getBytes(), mesh.getNumVertices(), kVertexSize,
+                                                    kPositionOffset, 0, targetError, &error);
+    CHECK(simplified.size() < mesh.Indices.size());
+    CHECK(simplified.size() > 3 * 2 * 4);
+    CHECK(error <= targetError * 1.0f + 1e-6f); // the extent of the grid is 1
+}
+
+void testBorderLocked()
+{
+    // The outline of an open plane stays : same area, no vertex moves off the unit square
+    TestMesh mesh = createGrid(16, flat);
+    std::vector<uint32_t> simplified = SimplifyMesh(mesh.Indices, mesh.getBytes(), mesh.getNumVertices(), kVertexSize,
+                                                    kPositionOffset, 6, 1.0f);
+    CHECK(simplified.size() < mesh.Indices.size());
+    CHECK_NEAR(getArea(mesh, simplified), getArea(mesh, mesh.Indices), 1e-4f);
+
+    // Corners are never collapsed away
+    for (float cornerX : {0.0f, 1.0f})
+    {
+        for (float cornerY : {0.0f, 1.0f})
+        {
+            bool found = std::any_of(simplified.begin(), simplified.end(),
+                                     [&](uint32_t vertex)
+                                     {
+                                         const float* pPosition = getPosition(mesh, vertex);
+                                         return pPosition[0] == cornerX && pPosition[1] == cornerY;
+                                     });
+            CHECK(found);
+        }
+    }
+}
+
+void testSeamLocked()
+{
+    // No triangle may cross the seam column, the attributes on both sides would be mixed
+    uint32_t seamColumn = 8;
+    TestMesh mesh = createGrid(16, flat, seamColumn);
+    std::vector<uint32_t> simplified = SimplifyMesh(mesh.Indices, mesh.getBytes(), mesh.getNumVertices(), kVertexSize,
+                                                    kPositionOffset, 6, 1.0f);
+    CHECK(simplified.size() < mesh.Indices.size());
+    float seamX = static_cast<float>(seamColumn) / 16;
+    for (size_t triangle = 0; triangle < simplified.size() / 3; triangle++)
+    {
+        float minX = 1.0f;
+        float maxX = 0.0f;
+        for (uint32_t corner = 0; corner < 3; corner++)
+        {
+            float x = getPosition(mesh, simplified[triangle * 3 + corner])[0];
+            minX = std::min(minX, x);
+            maxX = std::max(maxX, x);
+        }
+        CHECK(maxX <= seamX + 1e-6f || minX >= seamX - 1e-6f);
+    }
+    CHECK_NEAR(getArea(mesh, simplified), 1.0f, 1e-4f);
+}
+
+void testLodChain()
+{
+    TestMesh mesh = createGrid(32, bumpy);
+    std::vector<uint32_t> indices = mesh.Indices;
+    std::vector<MeshLod> lods =
+        GenerateLodChain(indices, mesh.getBytes(), mesh.getNumVertices(), kVertexSize, kPositionOffset);
+    CHECK(lods.size() > 1 && lods.size() <= kMaxMeshLods);
+    CHECK(lods[0].FirstIndex == 0 && lods[0].NumIndices == mesh.Indices.size() && lods[0].Error == 0.0f);
+    CHECK(std::equal(mesh.Indices.begin(), mesh.Indices.end(), indices.begin()));
+
+    uint32_t end = 0;
+    for (size_t lod = 0; lod < lods.size(); lod++)
+    {
+        CHECK(lods[lod].FirstIndex == end); // LODs follow each other in the index list
+        end += lods[lod].NumIndices;
+        if (lod > 0)
+        {
+            CHECK(lods[lod].NumIndices <= lods[lod - 1].NumIndices * kLodMinReduction);
+            CHECK(lods[lod].Error >= lods[lod - 1].Error);
+            CHECK(lods[lod].Error <= kLodMaxError + 1e-6f);
+        }
+    }
+    CHECK(end == indices.size());
+}
+
+} // namespace
+
+int main()
+{
+    testTargetCount();
+    testErrorLimit();
+    testBorderLocked();
+    testSeamLocked();
+    testLodChain();
+    return VulkanCore::model::test::TestResult();
+}
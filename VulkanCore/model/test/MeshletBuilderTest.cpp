@@ -0,0 +1,238 @@
+#include "MeshletBuilder.h"
+#include "TestUtils.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Meshlet clustering : output limits, the 8-bit triangle encoding, bounds and normal cones
+
+namespace
+{
+
+using namespace VulkanCore::model;
+
+using Triangle = std::array<uint32_t, 3>;
+
+struct TestMesh
+{
+    std::vector<glm::vec3> Positions;
+    std::vector<uint32_t> Indices;
+};
+
+// size x size quads in the z = 0 plane, facing +z
+TestMesh createGrid(uint32_t size)
+{
+    TestMesh mesh;
+    for (uint32_t y = 0; y <= size; y++)
+    {
+        for (uint32_t x = 0; x <= size; x++)
+        {
+            mesh.Positions.emplace_back(static_cast<float>(x), static_cast<float>(y), 0.0f);
+        }
+    }
+    for (uint32_t y = 0; y < size; y++)
+    {
+        for (uint32_t x = 0; x < size; x++)
+        {
+            uint32_t v00 = y * (size + 1) + x;
+            uint32_t v10 = v00 + 1;
+            uint32_t v01 = v00 + size + 1;
+            uint32_t v11 = v01 + 1;
+            mesh.Indices.insert(mesh.Indices.end(), {v00, v10, v01, v10, v11, v01});
+        }
+    }
+    return mesh;
+}
+
+// Closed cube of six grids, facing outwards
+TestMesh createCube(uint32_t size)
+{
+    TestMesh mesh;
+    TestMesh face = createGrid(size);
+    float half = 0.5f * size;
+    for (uint32_t axis = 0; axis < 3; axis++)
+    {
+        for (float side : {-1.0f, 1.0f})
+        {
+            uint32_t baseVertex = static_cast<uint32_t>(mesh.Positions.size());
+            for (const glm::vec3& position : face.Positions)
+            {
+                glm::vec3 p(0.0f);
+                p[axis] = side * half;
+                p[(axis + 1) % 3] = position.x - half;
+                p[(axis + 2) % 3] = position.y - half;
+                mesh.Positions.push_back(p);
+            }
+            for (size_t triangle = 0; triangle < face.Indices.size() / 3; triangle++)
+            {
+                uint32_t i0 = baseVertex + face.Indices[triangle * 3];
+                uint32_t i1 = baseVertex + face.Indices[triangle * 3 + 1];
+                uint32_t i2 = baseVertex + face.Indices[triangle * 3 + 2];
+                if (side > 0.0f)
+                {
+                    mesh.Indices.insert(mesh.Indices.end(), {i0, i1, i2});
+                }
+                else
+                {
+                    mesh.Indices.insert(mesh.Indices.end(), {i0, i2, i1});
+                }
+            }
+        }
+    }
+    return mesh;
+}
+
+std::vector<Triangle> getTriangles(const std::vector<uint32_t>& indices)
+{
+    std::vector<Triangle> triangles;
+    for (size_t triangle = 0; triangle < indices.size() / 3; triangle++)
+    {
+        triangles.push_back({indices[triangle * 3], indices[triangle * 3 + 1], indices[triangle * 3 + 2]});
+    }
+    std::sort(triangles.begin(), triangles.end());
+    return triangles;
+}
+
+struct BuildResult
+{
+    std::vector<uint32_t> Indices;
+    std::vector<Meshlet> Meshlets;
+    std::vector<uint32_t> MeshletVertices;
+    std::vector<uint32_t> MeshletTriangles;
+};
+
+BuildResult build(const TestMesh& mesh, uint32_t maxVertices = kMeshletMaxVertices,
+                  uint32_t maxTriangles = kMeshletMaxTriangles)
+{
+    BuildResult result;
+    result.Indices = mesh.Indices;
+    result.Meshlets = BuildMeshlets(result.Indices, reinterpret_cast<const uint8_t*>(mesh.Positions.data()),
+                                    static_cast<uint32_t>(mesh.Positions.size()), sizeof(glm::vec3), 0,
+                                    result.MeshletVertices, result.MeshletTriangles, maxVertices, maxTriangles);
+    return result;
+}
+
+// Every meshlet respects the limits, decodes back to its index range and covers the mesh exactly once
+void checkMeshlets(const TestMesh& mesh, const BuildResult& result, uint32_t maxVertices, uint32_t maxTriangles)
+{
+    CHECK(getTriangles(result.Indices) == getTriangles(mesh.Indices));
+
+    uint32_t nextIndex = 0;
+    uint32_t nextVertex = 0;
+    uint32_t nextTriangle = 0;
+    for (const Meshlet& meshlet : result.Meshlets)
+    {
+        CHECK(meshlet.VertexCount > 0 && meshlet.VertexCount <= maxVertices);
+        CHECK(meshlet.TriangleCount > 0 && meshlet.TriangleCount <= maxTriangles);
+        CHECK(meshlet.FirstIndex == nextIndex);
+        CHECK(meshlet.VertexOffset == nextVertex);
+        CHECK(meshlet.TriangleOffset == nextTriangle);
+        nextIndex += meshlet.TriangleCount * 3;
+        nextVertex += meshlet.VertexCount;
+        nextTriangle += meshlet.TriangleCount;
+
+        for (uint32_t triangle = 0; triangle < meshlet.TriangleCount; triangle++)
+        {
+            uint32_t packed = result.MeshletTriangles[meshlet.TriangleOffset + triangle];
+            CHECK((packed >> 24) == 0);
+            for (uint32_t corner = 0; corner < 3; corner++)
+            {
+                uint32_t local = (packed >> (corner * 8)) & 0xFF;
+                CHECK(local < meshlet.VertexCount);
+                uint32_t vertex = result.MeshletVertices[meshlet.VertexOffset + local];
+                CHECK(vertex == result.Indices[meshlet.FirstIndex + triangle * 3 + corner]);
+            }
+        }
+
+        glm::vec3 center(meshlet.BoundingSphere);
+        for (uint32_t local = 0; local < meshlet.VertexCount; local++)
+        {
+            const glm::vec3& position = mesh.Positions[result.MeshletVertices[meshlet.VertexOffset + local]];
+            CHECK(glm::all(glm::greaterThanEqual(position, meshlet.BoundsMin)));
+            CHECK(glm::all(glm::lessThanEqual(position, meshlet.BoundsMax)));
+            CHECK(glm::length(position - center) <= meshlet.BoundingSphere.w + 1e-4f);
+        }
+    }
+    CHECK(nextIndex == result.Indices.size());
+    CHECK(nextVertex == result.MeshletVertices.size());
+    CHECK(nextTriangle == result.MeshletTriangles.size());
+}
+
+void testLimits()
+{
+    TestMesh mesh = createGrid(32);
+    BuildResult result = build(mesh);
+    checkMeshlets(mesh, result, kMeshletMaxVertices, kMeshletMaxTriangles);
+    // A 2048 triangle grid needs at least 2048 / 124 meshlets, a good clustering stays close to the vertex bound
+    CHECK(result.Meshlets.size() >= (mesh.Indices.size() / 3 + kMeshletMaxTriangles - 1) / kMeshletMaxTriangles);
+    CHECK(result.Meshlets.size() <= 48);
+
+    // Tighter limits, the vertex one bounds first
+    BuildResult small = build(mesh, 16, 124);
+    checkMeshlets(mesh, small, 16, 124);
+    BuildResult fewTriangles = build(mesh, 64, 8);
+    checkMeshlets(mesh, fewTriangles, 64, 8);
+}
+
+void testCones()
+{
+    // Flat meshlets have a zero angle cone along the face normal
+    TestMesh grid = createGrid(16);
+    BuildResult flat = build(grid);
+    for (const Meshlet& meshlet : flat.Meshlets)
+    {
+        CHECK_NEAR(meshlet.Cone.z, 1.0f, 1e-5f);
+        CHECK_NEAR(meshlet.Cone.w, 0.0f, 1e-3f);
+        CHECK_NEAR(meshlet.BoundsMin.z, 0.0f, 1e-6f);
+        CHECK_NEAR(meshlet.BoundsMax.z, 0.0f, 1e-6f);
+    }
+
+    // Meshlets of a cube either stay on one face or cross an edge, where the normals are 90 degrees apart and the
+    // cone is not worth testing
+    TestMesh cube = createCube(8);
+    BuildResult result = build(cube);
+    checkMeshlets(cube, result, kMeshletMaxVertices, kMeshletMaxTriangles);
+    for (const Meshlet& meshlet : result.Meshlets)
+    {
+        CHECK_NEAR(glm::length(glm::vec3(meshlet.Cone)), 1.0f, 1e-4f);
+        CHECK(meshlet.Cone.w == 1.0f || meshlet.Cone.w < 1e-3f);
+        if (meshlet.Cone.w < 1.0f)
+        {
+            // A face meshlet can be culled from behind its plane
+            glm::vec3 axis(meshlet.Cone);
+            glm::vec3 center(meshlet.BoundingSphere);
+            glm::vec3 camera = center - axis * 100.0f;
+            glm::vec3 toCenter = center - camera;
+            CHECK(glm::dot(toCenter, axis) >= meshlet.Cone.w * glm::length(toCenter) + meshlet.BoundingSphere.w);
+        }
+    }
+}
+
+void testDegenerate()
+{
+    // Degenerate triangles still end up in a meshlet but have no normal
+    TestMesh mesh;
+    mesh.Positions = {glm::vec3(0.0f), glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(2.0f, 0.0f, 0.0f)};
+    mesh.Indices = {0, 1, 2};
+    BuildResult result = build(mesh);
+    checkMeshlets(mesh, result, kMeshletMaxVertices, kMeshletMaxTriangles);
+    CHECK(result.Meshlets.size() == 1 && result.Meshlets[0].Cone.w == 1.0f);
+
+    TestMesh empty;
+    CHECK(build(empty).Meshlets.empty());
+}
+
+} // namespace
+
+int main()
+{
+    testLimits();
+    testCones();
+    testDegenerate();
+    return VulkanCore::model::test::TestResult();
+}
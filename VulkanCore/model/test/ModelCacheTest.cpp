@@ -0,0 +1,180 @@
+#include "BakedModel.h"
+#include "ModelCache.h"
+#include "TestUtils.h"
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+#include <unistd.h>
+
+// Cache keys of the file contents and import options, entries found, inserted and removed, LRU trim
+
+namespace
+{
+
+using namespace VulkanCore::model;
+
+// Empty directory in the temporary directory, removed with the object
+class TempDirectory
+{
+  public:
+    explicit TempDirectory(const std::string& name)
+        : mPath(std::filesystem::temp_directory_path() / (name + "." + std::to_string(getpid())))
+    {
+        std::filesystem::remove_all(mPath);
+        std::filesystem::create_directories(mPath);
+    }
+    ~TempDirectory()
+    {
+        std::error_code error;
+        std::filesystem::remove_all(mPath, error);
+    }
+
+    const std::filesystem::path& getPath() const
+    {
+        return mPath;
+    }
+
+  private:
+    std::filesystem::path mPath;
+};
+
+void writeFile(const std::filesystem::path& path, const std::string& contents)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file << contents;
+}
+
+// An entry of size bytes
+bool insertEntry(const ModelCache& cache, uint64_t key, size_t size)
+{
+    return cache.insert(key, [&](const std::string& path) { writeFile(path, std::string(size, 'x')); });
+}
+
+size_t countFiles(const std::filesystem::path& directory)
+{
+    size_t count = 0;
+    for ([[maybe_unused]] const std::filesystem::directory_entry& file : std::filesystem::directory_iterator(directory))
+    {
+        count++;
+    }
+    return count;
+}
+
+void setLastUse(const std::string& path, std::chrono::hours age)
+{
+    std::filesystem::last_write_time(path, std::filesystem::file_time_type::clock::now() - age);
+}
+
+void testKeys()
+{
+    // FNV-1a reference values, chaining through the seed hashes the concatenation
+    CHECK(HashBytes(nullptr, 0) == kHashSeed);
+    CHECK(HashBytes("a", 1) == 0xAF63DC4C8601EC8Cull);
+    CHECK(HashBytes("ab", 2) == HashBytes("b", 1, HashBytes("a", 1)));
+
+    // A key follows the source contents and the import options, as Model::getCacheKey() builds it
+    TempDirectory directory("ModelCacheTestKeys");
+    std::filesystem::path modelPath = directory.getPath() / "model.obj";
+    writeFile(modelPath, "v 0 0 0\n");
+    uint64_t contentHash = HashFile(modelPath.string());
+    CHECK(contentHash == HashBytes("v 0 0 0\n", 8));
+
+    uint32_t options[] = {1, kBakedModelVersion};
+    uint64_t key = HashBytes(options, sizeof(options), contentHash);
+    options[0] = 0;
+    CHECK(HashBytes(options, sizeof(options), contentHash) != key);
+
+    writeFile(modelPath, "v 0 0 1\n");
+    CHECK(HashFile(modelPath.string()) != contentHash);
+
+    // Larger than the read buffer
+    std::string large((1 << 20) + 3, 'v');
+    writeFile(modelPath, large);
+    CHECK(HashFile(modelPath.string()) == HashBytes(large.data(), large.size()));
+
+    bool thrown = false;
+    try
+    {
+        HashFile((directory.getPath() / "missing.obj").string());
+    }
+    catch (const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+void testEntries()
+{
+    TempDirectory directory("ModelCacheTestEntries");
+    ModelCache cache(directory.getPath() / "models", 1024);
+    CHECK(cache.find(1).empty());
+
+    CHECK(insertEntry(cache, 1, 16));
+    std::string path = cache.find(1);
+    CHECK(!path.empty() && std::filesystem::file_size(path) == 16);
+    CHECK(std::filesystem::path(path).extension() == kBakedModelExtension);
+    CHECK(cache.find(2).empty());
+
+    // A hit makes the entry the most recently used
+    setLastUse(path, std::chrono::hours(1));
+    cache.find(1);
+    CHECK(std::filesystem::file_time_type::clock::now() - std::filesystem::last_write_time(path) <
+          std::chrono::minutes(1));
+
+    // Replaced in place
+    CHECK(insertEntry(cache, 1, 32));
+    CHECK(std::filesystem::file_size(cache.find(1)) == 32);
+
+    // A failed write leaves neither an entry nor its temporary file
+    CHECK(!cache.insert(2, [](const std::string&) { throw std::runtime_error("write failed"); }));
+    CHECK(cache.find(2).empty());
+    CHECK(countFiles(directory.getPath() / "models") == 1);
+
+    cache.remove(1);
+    CHECK(cache.find(1).empty());
+    cache.remove(1);
+}
+
+void testTrim()
+{
+    TempDirectory directory("ModelCacheTestTrim");
+    ModelCache cache(directory.getPath(), 250);
+    writeFile(directory.getPath() / "notes.txt", std::string(1000, 'n')); // not an entry, neither counted nor evicted
+
+    CHECK(insertEntry(cache, 1, 100));
+    CHECK(insertEntry(cache, 2, 100));
+    setLastUse(cache.find(1), std::chrono::hours(2));
+    setLastUse(cache.find(2), std::chrono::hours(1));
+    cache.find(1);
+
+    // 300 bytes : 2 is the least recently used
+    CHECK(insertEntry(cache, 3, 100));
+    CHECK(!cache.find(1).empty());
+    CHECK(cache.find(2).empty());
+    CHECK(!cache.find(3).empty());
+    CHECK(std::filesystem::exists(directory.getPath() / "notes.txt"));
+
+    // The newest entry stays even above the cap
+    setLastUse(cache.find(1), std::chrono::hours(1));
+    ModelCache small(directory.getPath(), 10);
+    small.trim();
+    CHECK(cache.find(1).empty());
+    CHECK(!cache.find(3).empty());
+    CHECK(countFiles(directory.getPath()) == 2);
+}
+
+} // namespace
+
+int main()
+{
+    testKeys();
+    testEntries();
+    testTrim();
+    return VulkanCore::model::test::TestResult();
+}
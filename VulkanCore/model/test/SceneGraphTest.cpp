@@ -0,0 +1,117 @@
+#include "SceneGraph.h"
+#include "TestUtils.h"
+
+#include <cstdint>
+
+#include <glm/glm.hpp>
+
+// Scene graph updates : a set node and its descendants are recomputed, nothing else
+
+namespace
+{
+
+using namespace VulkanCore::model;
+
+glm::mat4 translation(float x, float y, float z)
+{
+    glm::mat4 matrix(1.0f);
+    matrix[3] = glm::vec4(x, y, z, 1.0f);
+    return matrix;
+}
+
+bool isTranslation(const glm::mat4& matrix, float x, float y, float z)
+{
+    return matrix[3][0] == x && matrix[3][1] == y && matrix[3][2] == z;
+}
+
+// root - a - a1
+//      \ b - b1 - b2
+// other
+struct TestScene
+{
+    SceneGraph Graph;
+    uint32_t Root = Graph.addNode(-1, translation(1.0f, 0.0f, 0.0f), "root");
+    uint32_t A = Graph.addNode(static_cast<int32_t>(Root), translation(0.0f, 1.0f, 0.0f), "a");
+    uint32_t B = Graph.addNode(static_cast<int32_t>(Root), translation(0.0f, 2.0f, 0.0f), "b");
+    uint32_t A1 = Graph.addNode(static_cast<int32_t>(A), translation(0.0f, 0.0f, 1.0f), "a1");
+    uint32_t B1 = Graph.addNode(static_cast<int32_t>(B), translation(0.0f, 0.0f, 2.0f), "b1");
+    uint32_t B2 = Graph.addNode(static_cast<int32_t>(B1), translation(0.0f, 0.0f, 3.0f), "b2");
+    uint32_t Other = Graph.addNode(-1, translation(5.0f, 0.0f, 0.0f), "other");
+};
+
+void testAddNodes()
+{
+    TestScene scene;
+    SceneGraph& graph = scene.Graph;
+    CHECK(graph.getNumNodes() == 7);
+    CHECK(graph.getParent(scene.B2) == static_cast<int32_t>(scene.B1) && graph.getParent(scene.Other) == -1);
+    CHECK(graph.getName(scene.A1) == "a1");
+
+    // World transformations are valid as soon as the nodes are added
+    CHECK(isTranslation(graph.getWorldTransform(scene.A1), 1.0f, 1.0f, 1.0f));
+    CHECK(isTranslation(graph.getWorldTransform(scene.B2), 1.0f, 2.0f, 5.0f));
+    CHECK(isTranslation(graph.getWorldTransform(scene.Other), 5.0f, 0.0f, 0.0f));
+    CHECK(graph.update() == 0);
+
+    // The first node of a name is found
+    graph.addNode(-1, glm::mat4(1.0f), "a");
+    CHECK(graph.findNode("a") == static_cast<int32_t>(scene.A));
+    CHECK(graph.findNode("missing") == -1);
+
+    graph.clear();
+    CHECK(graph.getNumNodes() == 0 && graph.findNode("a") == -1);
+    uint32_t node = graph.addNode(-1, translation(3.0f, 0.0f, 0.0f), "node");
+    CHECK(node == 0 && graph.update() == 0);
+    CHECK(isTranslation(graph.getWorldTransform(node), 3.0f, 0.0f, 0.0f));
+}
+
+void testDirtyPropagation()
+{
+    TestScene scene;
+    SceneGraph& graph = scene.Graph;
+
+    // b and its descendants, not its sibling or the other root
+    graph.setLocalTransform(scene.B, translation(0.0f, 4.0f, 0.0f));
+    CHECK(isTranslation(graph.getWorldTransform(scene.B2), 1.0f, 2.0f, 5.0f)); // until the update
+    CHECK(graph.update() == 3);
+    CHECK(graph.isChanged(scene.B) && graph.isChanged(scene.B1) && graph.isChanged(scene.B2));
+    CHECK(!graph.isChanged(scene.Root) && !graph.isChanged(scene.A) && !graph.isChanged(scene.A1));
+    CHECK(!graph.isChanged(scene.Other));
+    CHECK(isTranslation(graph.getWorldTransform(scene.B), 1.0f, 4.0f, 0.0f));
+    CHECK(isTranslation(graph.getWorldTransform(scene.B2), 1.0f, 4.0f, 5.0f));
+    CHECK(isTranslation(graph.getWorldTransform(scene.A1), 1.0f, 1.0f, 1.0f));
+
+    // Nothing set, nothing changed
+    CHECK(graph.update() == 0);
+    CHECK(!graph.isChanged(scene.B));
+
+    // The root moves everything below it, once even when a descendant is set too
+    graph.setLocalTransform(scene.B1, translation(0.0f, 0.0f, 6.0f));
+    graph.setLocalTransform(scene.Root, translation(2.0f, 0.0f, 0.0f));
+    CHECK(graph.update() == 6);
+    CHECK(!graph.isChanged(scene.Other));
+    CHECK(isTranslation(graph.getWorldTransform(scene.A1), 2.0f, 1.0f, 1.0f));
+    CHECK(isTranslation(graph.getWorldTransform(scene.B2), 2.0f, 4.0f, 9.0f));
+
+    // A leaf alone
+    graph.setLocalTransform(scene.Other, translation(0.0f, 0.0f, 0.0f));
+    CHECK(graph.update() == 1);
+    CHECK(graph.isChanged(scene.Other) && !graph.isChanged(scene.Root));
+    CHECK(isTranslation(graph.getWorldTransform(scene.Other), 0.0f, 0.0f, 0.0f));
+
+    // A node added below a set parent follows it on the next update
+    graph.setLocalTransform(scene.A, translation(0.0f, 3.0f, 0.0f));
+    uint32_t child = graph.addNode(static_cast<int32_t>(scene.A), translation(0.0f, 0.0f, 1.0f), "child");
+    CHECK(graph.update() == 3);
+    CHECK(isTranslation(graph.getWorldTransform(child), 2.0f, 3.0f, 1.0f));
+    CHECK(isTranslation(graph.getWorldTransform(scene.A1), 2.0f, 3.0f, 1.0f));
+}
+
+} // namespace
+
+int main()
+{
+    testAddNodes();
+    testDirtyPropagation();
+    return VulkanCore::model::test::TestResult();
+}
@@ -0,0 +1,301 @@
+#include "ShaderReflection.h"
+#include "TestUtils.h"
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+// ReflectSpirv() on the committed shader binaries and on a hand assembled module with push constants and descriptor
+// arrays, MergeReflection() and the layout helpers
+
+namespace
+{
+
+using namespace VulkanCore;
+
+// Paths relative to the workspace root, the working directory of bazel test and of the data files
+std::vector<uint32_t> readSpirv(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    if (!file)
+    {
+        throw std::runtime_error("Failed to open " + path);
+    }
+    std::vector<uint32_t> code(static_cast<size_t>(file.tellg()) / sizeof(uint32_t));
+    file.seekg(0);
+    file.read(reinterpret_cast<char*>(code.data()), static_cast<std::streamsize>(code.size() * sizeof(uint32_t)));
+    return code;
+}
+
+bool isBinding(const ReflectedBinding& binding, uint32_t set, uint32_t index, VkDescriptorType type, uint32_t count,
+               VkShaderStageFlags stages)
+{
+    return binding.mSet == set && binding.mBinding == index && binding.mType == type && binding.mCount == count &&
+           binding.mStages == stages;
+}
+
+bool throws(const std::vector<uint32_t>& code)
+{
+    try
+    {
+        ReflectSpirv(code);
+    }
+    catch (const std::runtime_error&)
+    {
+        return true;
+    }
+    return false;
+}
+
+// Minimal SPIR-V writer, ids are given by the caller
+class SpirvModule
+{
+  public:
+    explicit SpirvModule(uint32_t idBound) : mCode{0x07230203, 0x00010000, 0, idBound, 0}
+    {
+    }
+
+    void add(uint32_t opcode, std::initializer_list<uint32_t> operands)
+    {
+        mCode.push_back(static_cast<uint32_t>(operands.size() + 1) << 16 | opcode);
+        mCode.insert(mCode.end(), operands);
+    }
+
+    // Operands followed by a NUL terminated string
+    void addWithString(uint32_t opcode, std::initializer_list<uint32_t> operands, const std::string& string)
+    {
+        std::vector<uint32_t> words((string.size() + sizeof(uint32_t)) / sizeof(uint32_t), 0);
+        memcpy(words.data(), string.data(), string.size());
+        mCode.push_back(static_cast<uint32_t>(operands.size() + words.size() + 1) << 16 | opcode);
+        mCode.insert(mCode.end(), operands);
+        mCode.insert(mCode.end(), words.begin(), words.end());
+    }
+
+    const std::vector<uint32_t>& getCode() const
+    {
+        return mCode;
+    }
+
+  private:
+    std::vector<uint32_t> mCode;
+};
+
+// Compute shader with
+//   layout(push_constant) uniform Constants { mat4 transform; uint index; };
+//   layout(set = 0, binding = 3, rgba8) uniform image2D target;
+//   layout(set = 1, binding = 0) uniform sampler2D textures[8];
+//   layout(set = 1, binding = 1) buffer Buffers { uint words[]; } buffers[];
+std::vector<uint32_t> createComputeModule()
+{
+    enum Op : uint32_t
+    {
+        Name = 5,
+        EntryPoint = 15,
+        TypeInt = 21,
+        TypeFloat = 22,
+        TypeVector = 23,
+        TypeMatrix = 24,
+        TypeImage = 25,
+        TypeSampledImage = 27,
+        TypeArray = 28,
+        TypeRuntimeArray = 29,
+        TypeStruct = 30,
+        TypePointer = 32,
+        Constant = 43,
+        Variable = 59,
+        Decorate = 71,
+        MemberDecorate = 72,
+    };
+    enum Id : uint32_t
+    {
+        Main = 1,
+        Float,
+        Vec4,
+        Mat4,
+        Uint,
+        ConstantsBlock,
+        ConstantsPointer,
+        Constants,
+        Image,
+        ImagePointer,
+        Target,
+        TextureImage,
+        SampledImage,
+        Eight,
+        SampledArray,
+        SampledArrayPointer,
+        Textures,
+        Words,
+        BuffersBlock,
+        BuffersArray,
+        BuffersPointer,
+        Buffers,
+        InputPointer,
+        Input,
+        Bound
+    };
+    constexpr uint32_t kUniformConstant = 0, kInput = 1, kPushConstant = 9, kStorageBuffer = 12;
+    constexpr uint32_t kBlock = 2, kMatrixStride = 7, kBinding = 33, kDescriptorSet = 34, kOffset = 35;
+
+    SpirvModule module(Bound);
+    module.addWithString(EntryPoint, {5, Main}, "main"); // GLCompute
+    module.addWithString(Name, {Textures}, "textures");
+    module.add(Decorate, {ConstantsBlock, kBlock});
+    module.add(MemberDecorate, {ConstantsBlock, 0, kOffset, 0});
+    module.add(MemberDecorate, {ConstantsBlock, 0, kMatrixStride, 16});
+    module.add(MemberDecorate, {ConstantsBlock, 1, kOffset, 64});
+    module.add(Decorate, {Target, kDescriptorSet, 0});
+    module.add(Decorate, {Target, kBinding, 3});
+    module.add(Decorate, {Textures, kDescriptorSet, 1});
+    module.add(Decorate, {Textures, kBinding, 0});
+    module.add(Decorate, {BuffersBlock, kBlock});
+    module.add(Decorate, {Buffers, kDescriptorSet, 1});
+    module.add(Decorate, {Buffers, kBinding, 1});
+
+    module.add(TypeFloat, {Float, 32});
+    module.add(TypeVector, {Vec4, Float, 4});
+    module.add(TypeMatrix, {Mat4, Vec4, 4});
+    module.add(TypeInt, {Uint, 32, 0});
+    module.add(TypeStruct, {ConstantsBlock, Mat4, Uint});
+    module.add(TypePointer, {ConstantsPointer, kPushConstant, ConstantsBlock});
+    module.add(Variable, {ConstantsPointer, Constants, kPushConstant});
+
+    module.add(TypeImage, {Image, Float, 1, 0, 0, 0, 2, 4}); // 2D, storage, rgba8
+    module.add(TypePointer, {ImagePointer, kUniformConstant, Image});
+    module.add(Variable, {ImagePointer, Target, kUniformConstant});
+
+    module.add(TypeImage, {TextureImage, Float, 1, 0, 0, 0, 1, 0});
+    module.add(TypeSampledImage, {SampledImage, TextureImage});
+    module.add(Constant, {Uint, Eight, 8});
+    module.add(TypeArray, {SampledArray, SampledImage, Eight});
+    module.add(TypePointer, {SampledArrayPointer, kUniformConstant, SampledArray});
+    module.add(Variable, {SampledArrayPointer, Textures, kUniformConstant});
+
+    module.add(TypeRuntimeArray, {Words, Uint});
+    module.add(TypeStruct, {BuffersBlock, Words});
+    module.add(TypeRuntimeArray, {BuffersArray, BuffersBlock});
+    module.add(TypePointer, {BuffersPointer, kStorageBuffer, BuffersArray});
+    module.add(Variable, {BuffersPointer, Buffers, kStorageBuffer});
+
+    // Not a resource
+    module.add(TypePointer, {InputPointer, kInput, Vec4});
+    module.add(Variable, {InputPointer, Input, kInput});
+    return module.getCode();
+}
+
+void testCommittedShaders()
+{
+    constexpr VkShaderStageFlags kVertex = VK_SHADER_STAGE_VERTEX_BIT;
+    constexpr VkShaderStageFlags kFragment = VK_SHADER_STAGE_FRAGMENT_BIT;
+
+    ShaderReflection skyboxVert = ReflectSpirv(readSpirv("VulkanCore/shaders/skybox.vert.spv"));
+    CHECK(skyboxVert.mStages == kVertex);
+    CHECK(skyboxVert.mBindings.size() == 1 &&
+          isBinding(skyboxVert.mBindings[0], 0, 2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, kVertex));
+    CHECK(skyboxVert.mPushConstants.size == 0);
+
+    ShaderReflection skyboxFrag = ReflectSpirv(readSpirv("VulkanCore/shaders/skybox.frag.spv"));
+    CHECK(skyboxFrag.mStages == kFragment);
+    CHECK(skyboxFrag.mBindings.size() == 1 &&
+          isBinding(skyboxFrag.mBindings[0], 0, 4, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, kFragment));
+
+    // Vertex pulling : both buffers are storage buffers, the transform a uniform buffer
+    ShaderReflection triangleVert = ReflectSpirv(readSpirv("VulkanDemo/shaders/triangle.vert.spv"));
+    CHECK(triangleVert.mStages == kVertex);
+    CHECK(triangleVert.mBindings.size() == 3);
+    if (triangleVert.mBindings.size() == 3)
+    {
+        CHECK(isBinding(triangleVert.mBindings[0], 0, 0, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, kVertex));
+        CHECK(isBinding(triangleVert.mBindings[1], 0, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, kVertex));
+        CHECK(isBinding(triangleVert.mBindings[2], 0, 2, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1, kVertex));
+    }
+
+    ShaderReflection triangleFrag = ReflectSpirv(readSpirv("VulkanDemo/shaders/triangle.frag.spv"));
+    CHECK(triangleFrag.mBindings.size() == 1 &&
+          isBinding(triangleFrag.mBindings[0], 0, 3, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1, kFragment));
+
+    // One pipeline
+    ShaderReflection merged = MergeReflection(triangleVert, triangleFrag);
+    CHECK(merged.mStages == (kVertex | kFragment));
+    CHECK(merged.mBindings.size() == 4 && merged.mBindings[3].mBinding == 3);
+
+    std::vector<VkDescriptorSetLayoutBinding> bindings = GetSetLayoutBindings(merged, 0);
+    CHECK(bindings.size() == 4 && bindings[0].binding == 0 && bindings[3].stageFlags == kFragment);
+    CHECK(GetSetLayoutBindings(merged, 1).empty());
+
+    std::vector<VkDescriptorPoolSize> poolSizes = GetPoolSizes(bindings, 3);
+    CHECK(poolSizes.size() == 3);
+    for (const VkDescriptorPoolSize& poolSize : poolSizes)
+    {
+        CHECK(poolSize.descriptorCount == (poolSize.type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER ? 6u : 3u));
+    }
+
+    // The same binding shared by two stages, and declared differently
+    ShaderReflection shared = MergeReflection(skyboxVert, triangleVert);
+    CHECK(shared.mBindings.size() == 3 && shared.mBindings[2].mStages == kVertex);
+    bool thrown = false;
+    try
+    {
+        ShaderReflection mismatch = skyboxFrag;
+        mismatch.mBindings[0].mBinding = 2;
+        MergeReflection(skyboxVert, mismatch);
+    }
+    catch (const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    CHECK(thrown);
+}
+
+void testComputeModule()
+{
+    constexpr VkShaderStageFlags kCompute = VK_SHADER_STAGE_COMPUTE_BIT;
+    std::vector<uint32_t> code = createComputeModule();
+    ShaderReflection reflection = ReflectSpirv(code);
+    CHECK(reflection.mStages == kCompute);
+
+    // mat4 with a 16 byte stride, then a uint
+    CHECK(reflection.mPushConstants.size == 68);
+    CHECK(reflection.mPushConstants.offset == 0 && reflection.mPushConstants.stageFlags == kCompute);
+
+    CHECK(reflection.mBindings.size() == 3);
+    if (reflection.mBindings.size() == 3)
+    {
+        CHECK(isBinding(reflection.mBindings[0], 0, 3, VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1, kCompute));
+        CHECK(isBinding(reflection.mBindings[1], 1, 0, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 8, kCompute));
+        CHECK(reflection.mBindings[1].mName == "textures");
+        CHECK(isBinding(reflection.mBindings[2], 1, 1, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 0, kCompute));
+    }
+
+    // A runtime array still needs one descriptor per set in the pool
+    std::vector<VkDescriptorPoolSize> poolSizes = GetPoolSizes(GetSetLayoutBindings(reflection, 1), 2);
+    CHECK(poolSizes.size() == 2);
+    if (poolSizes.size() == 2)
+    {
+        CHECK(poolSizes[0].type == VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER && poolSizes[0].descriptorCount == 16);
+        CHECK(poolSizes[1].type == VK_DESCRIPTOR_TYPE_STORAGE_BUFFER && poolSizes[1].descriptorCount == 2);
+    }
+
+    // Invalid modules throw instead of reading out of bounds
+    std::vector<uint32_t> invalid = code;
+    invalid[0] = 0;
+    CHECK(throws(invalid));
+    CHECK(throws(std::vector<uint32_t>(code.begin(), code.begin() + 3)));
+    CHECK(throws(std::vector<uint32_t>(code.begin(), code.end() - 1)));
+    invalid = code;
+    invalid[3] = 2; // id bound below the ids in use
+    CHECK(throws(invalid));
+}
+
+} // namespace
+
+int main()
+{
+    testCommittedShaders();
+    testComputeModule();
+    return VulkanCore::model::test::TestResult();
+}
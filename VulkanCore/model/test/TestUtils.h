@@ -0,0 +1,46 @@
+#ifndef MODEL_TEST_UTILS_H
+#define MODEL_TEST_UTILS_H
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+// Minimal checks for the unit tests of the CPU side of VulkanCore : a failed check is reported and the test goes on,
+// main() returns TestResult() so bazel test sees every failure at once.
+
+namespace VulkanCore::model::test
+{
+
+inline int& GetFailureCount()
+{
+    static int failures = 0;
+    return failures;
+}
+
+inline void Check(bool condition, const char* pExpression, const char* pFile, int line)
+{
+    if (!condition)
+    {
+        std::cout << pFile << ":" << line << ": check failed : " << pExpression << std::endl;
+        GetFailureCount()++;
+    }
+}
+
+inline int TestResult()
+{
+    if (GetFailureCount() > 0)
+    {
+        std::cout << GetFailureCount() << " checks failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "All checks passed" << std::endl;
+    return EXIT_SUCCESS;
+}
+
+} // namespace VulkanCore::model::test
+
+#define CHECK(expression) VulkanCore::model::test::Check((expression), #expression, __FILE__, __LINE__)
+#define CHECK_NEAR(a, b, tolerance)                                                                                    \
+    VulkanCore::model::test::Check(std::abs((a) - (b)) <= (tolerance), #a " ~ " #b, __FILE__, __LINE__)
+
+#endif // MODEL_TEST_UTILS_H
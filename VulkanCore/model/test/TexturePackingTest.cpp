@@ -0,0 +1,127 @@
+#include "TestUtils.h"
+#include "TexturePacking.h"
+
+#include <cstdint>
+#include <vector>
+
+// GetOrmSources() channel choice and PackTextureChannels() resampling
+
+namespace
+{
+
+using namespace VulkanCore::model;
+
+// RGBA texels, every channel a distinct function of the texel
+std::vector<uint8_t> createTexels(uint32_t width, uint32_t height, uint8_t base)
+{
+    std::vector<uint8_t> texels(static_cast<size_t>(width) * height * 4);
+    for (uint32_t texel = 0; texel < width * height; texel++)
+    {
+        for (uint32_t channel = 0; channel < 4; channel++)
+        {
+            texels[texel * 4 + channel] = static_cast<uint8_t>(base + channel * 50 + texel);
+        }
+    }
+    return texels;
+}
+
+std::vector<uint8_t> pack(const PackedTextureSources& sources, uint32_t& width, uint32_t& height)
+{
+    GetPackedTextureSize(sources, width, height);
+    std::vector<uint8_t> packed(static_cast<size_t>(width) * height * 4);
+    PackTextureChannels(sources, width, height, packed.data());
+    return packed;
+}
+
+void testMetallicRoughness()
+{
+    // glTF : roughness in G and metalness in B of one texture, occlusion in R of another
+    std::vector<uint8_t> metallicRoughnessTexels = createTexels(4, 4, 10);
+    std::vector<uint8_t> occlusionTexels = createTexels(4, 4, 20);
+    TextureImage metallicRoughness{metallicRoughnessTexels.data(), 4, 4};
+    TextureImage occlusion{occlusionTexels.data(), 4, 4};
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    PackedTextureSources sources = GetOrmSources(&occlusion, &metallicRoughness, &metallicRoughness);
+    std::vector<uint8_t> packed = pack(sources, width, height);
+    CHECK(width == 4 && height == 4);
+    for (uint32_t texel = 0; texel < 16; texel++)
+    {
+        CHECK(packed[texel * 4 + 0] == occlusionTexels[texel * 4 + 0]);
+        CHECK(packed[texel * 4 + 1] == metallicRoughnessTexels[texel * 4 + 1]);
+        CHECK(packed[texel * 4 + 2] == metallicRoughnessTexels[texel * 4 + 2]);
+        CHECK(packed[texel * 4 + 3] == 255);
+    }
+}
+
+void testSeparateMaps()
+{
+    // Grayscale maps, read from R even when they are identical copies
+    std::vector<uint8_t> roughnessTexels = createTexels(2, 2, 30);
+    std::vector<uint8_t> metalnessTexels = createTexels(2, 2, 40);
+    TextureImage roughness{roughnessTexels.data(), 2, 2};
+    TextureImage metalness{metalnessTexels.data(), 2, 2};
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> packed = pack(GetOrmSources(nullptr, &roughness, &metalness), width, height);
+    CHECK(width == 2 && height == 2);
+    for (uint32_t texel = 0; texel < 4; texel++)
+    {
+        CHECK(packed[texel * 4 + 0] == 255); // no occlusion
+        CHECK(packed[texel * 4 + 1] == roughnessTexels[texel * 4 + 0]);
+        CHECK(packed[texel * 4 + 2] == metalnessTexels[texel * 4 + 0]);
+    }
+}
+
+void testDefaults()
+{
+    std::vector<uint8_t> occlusionTexels = createTexels(2, 2, 50);
+    TextureImage occlusion{occlusionTexels.data(), 2, 2};
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> packed = pack(GetOrmSources(&occlusion, nullptr, nullptr), width, height);
+    for (uint32_t texel = 0; texel < 4; texel++)
+    {
+        CHECK(packed[texel * 4 + 1] == 255); // fully rough
+        CHECK(packed[texel * 4 + 2] == 0);   // dielectric
+    }
+
+    GetPackedTextureSize(GetOrmSources(nullptr, nullptr, nullptr), width, height);
+    CHECK(width == 0 && height == 0);
+}
+
+void testResampling()
+{
+    // A 2x2 map packed with a 4x4 one covers it with 2x2 blocks of its texels
+    std::vector<uint8_t> occlusionTexels = createTexels(4, 4, 0);
+    std::vector<uint8_t> roughnessTexels = createTexels(2, 2, 60);
+    TextureImage occlusion{occlusionTexels.data(), 4, 4};
+    TextureImage roughness{roughnessTexels.data(), 2, 2};
+
+    uint32_t width = 0;
+    uint32_t height = 0;
+    std::vector<uint8_t> packed = pack(GetOrmSources(&occlusion, &roughness, nullptr), width, height);
+    CHECK(width == 4 && height == 4);
+    for (uint32_t y = 0; y < 4; y++)
+    {
+        for (uint32_t x = 0; x < 4; x++)
+        {
+            uint32_t sourceTexel = (y / 2) * 2 + x / 2;
+            CHECK(packed[(y * 4 + x) * 4 + 1] == roughnessTexels[sourceTexel * 4]);
+        }
+    }
+}
+
+} // namespace
+
+int main()
+{
+    testMetallicRoughness();
+    testSeparateMaps();
+    testDefaults();
+    testResampling();
+    return VulkanCore::model::test::TestResult();
+}
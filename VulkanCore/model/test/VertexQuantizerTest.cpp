@@ -0,0 +1,140 @@
+#include "TestUtils.h"
+#include "VertexQuantizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <random>
+
+#include <glm/glm.hpp>
+#include <glm/packing.hpp>
+
+// Vertex quantization round trips : positions within half a step, octahedral directions, half float UVs
+
+namespace
+{
+
+using namespace VulkanCore::model;
+
+glm::vec3 dequantizePosition(const VertexDequantization& dequantization, const QuantizedVertex& vertex)
+{
+    glm::vec3 quantized(vertex.Position[0], vertex.Position[1], vertex.Position[2]);
+    return dequantization.Offset + quantized * dequantization.Scale;
+}
+
+glm::vec3 randomDirection(std::mt19937& random)
+{
+    std::normal_distribution<float> distribution;
+    glm::vec3 direction(distribution(random), distribution(random), distribution(random));
+    return glm::normalize(direction);
+}
+
+void testPositions()
+{
+    glm::vec3 boundsMin(-3.0f, 10.0f, -0.5f);
+    glm::vec3 boundsMax(5.0f, 12.0f, 0.5f);
+    VertexDequantization dequantization = ComputeVertexDequantization(boundsMin, boundsMax);
+    CHECK(dequantization.Offset.x == boundsMin.x && dequantization.Offset.y == boundsMin.y);
+    CHECK_NEAR(dequantization.Scale, 8.0f / 65535.0f, 1e-9f);
+
+    // Rounding to the nearest step : half a step on every axis, the scale is the same on all of them
+    std::mt19937 random(7);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    float maxError = 0.0f;
+    for (int sample = 0; sample < 10000; sample++)
+    {
+        glm::vec3 position(boundsMin.x + unit(random) * 8.0f, boundsMin.y + unit(random) * 2.0f,
+                           boundsMin.z + unit(random) * 1.0f);
+        QuantizedVertex vertex = QuantizeVertex(dequantization, position, glm::vec2(0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+                                                glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+        glm::vec3 error = glm::abs(dequantizePosition(dequantization, vertex) - position);
+        maxError = std::max({maxError, error.x, error.y, error.z});
+    }
+    CHECK(maxError <= dequantization.Scale * 0.5f + 1e-5f);
+
+    // The bounds map to the ends of the range, the smaller axes do not use all of it
+    QuantizedVertex low = QuantizeVertex(dequantization, boundsMin, glm::vec2(0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+                                         glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    QuantizedVertex high = QuantizeVertex(dequantization, boundsMax, glm::vec2(0.0f), glm::vec3(0.0f, 0.0f, 1.0f),
+                                          glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    CHECK(low.Position[0] == 0 && low.Position[1] == 0 && low.Position[2] == 0);
+    CHECK(high.Position[0] == 65535);
+    CHECK(high.Position[1] == 16384 && high.Position[2] == 8192);
+
+    // The matrix and the sphere follow the same mapping
+    glm::mat4 matrix = dequantization.toMatrix();
+    CHECK(matrix[0][0] == dequantization.Scale && matrix[1][1] == dequantization.Scale);
+    CHECK(matrix[2][2] == dequantization.Scale && matrix[3][3] == 1.0f);
+    CHECK(matrix[3][0] == boundsMin.x && matrix[3][1] == boundsMin.y && matrix[3][2] == boundsMin.z);
+    glm::vec4 sphere = dequantization.quantizeSphere(glm::vec4(boundsMax, 4.0f));
+    CHECK_NEAR(sphere.x, 65535.0f, 0.01f);
+    CHECK_NEAR(sphere.w, 4.0f / dequantization.Scale, 0.01f);
+
+    // A flat or single point mesh keeps a unit scale
+    VertexDequantization point = ComputeVertexDequantization(glm::vec3(1.0f), glm::vec3(1.0f));
+    CHECK(point.Scale == 1.0f);
+}
+
+void testOctahedral()
+{
+    // snorm16 on the octahedron : a few 1e-5 radians at worst
+    std::mt19937 random(11);
+    float minDot = 1.0f;
+    for (int sample = 0; sample < 10000; sample++)
+    {
+        glm::vec3 direction = randomDirection(random);
+        minDot = std::min(minDot, glm::dot(direction, DecodeOctahedral(EncodeOctahedral(direction))));
+    }
+    CHECK(minDot > 0.99999f);
+
+    // Axes and the folded lower hemisphere corners are exact
+    for (int axis = 0; axis < 3; axis++)
+    {
+        for (float side : {-1.0f, 1.0f})
+        {
+            glm::vec3 direction(0.0f);
+            direction[axis] = side;
+            glm::vec3 decoded = DecodeOctahedral(EncodeOctahedral(direction));
+            CHECK_NEAR(glm::dot(direction, decoded), 1.0f, 1e-6f);
+        }
+    }
+
+    // Unnormalized inputs decode to unit vectors, zero to +Z
+    glm::vec3 decoded = DecodeOctahedral(EncodeOctahedral(glm::vec3(0.0f, 3.0f, -4.0f)));
+    CHECK_NEAR(decoded.y, 0.6f, 1e-4f);
+    CHECK_NEAR(decoded.z, -0.8f, 1e-4f);
+    decoded = DecodeOctahedral(EncodeOctahedral(glm::vec3(0.0f)));
+    CHECK_NEAR(decoded.z, 1.0f, 1e-6f);
+}
+
+void testAttributes()
+{
+    VertexDequantization dequantization = ComputeVertexDequantization(glm::vec3(0.0f), glm::vec3(1.0f));
+    glm::vec3 normal(0.0f, 0.0f, 1.0f);
+    glm::vec3 tangent(1.0f, 0.0f, 0.0f);
+
+    // Half floats : 11 significant bits, UVs in [0, 4] within 2^-9
+    glm::vec2 texCoord(0.123456f, 3.987654f);
+    QuantizedVertex vertex =
+        QuantizeVertex(dequantization, glm::vec3(0.5f), texCoord, normal, tangent, glm::vec3(0.0f, 1.0f, 0.0f));
+    glm::vec2 decoded = glm::unpackHalf2x16(vertex.TexCoord);
+    CHECK_NEAR(decoded.x, texCoord.x, 1.0f / 8192.0f);
+    CHECK_NEAR(decoded.y, texCoord.y, 1.0f / 512.0f);
+    CHECK(vertex.BitangentSign == 0);
+    CHECK_NEAR(glm::dot(DecodeOctahedral(vertex.Normal), normal), 1.0f, 1e-6f);
+    CHECK_NEAR(glm::dot(DecodeOctahedral(vertex.Tangent), tangent), 1.0f, 1e-6f);
+
+    // Mirrored UVs flip the bitangent
+    vertex = QuantizeVertex(dequantization, glm::vec3(0.5f), texCoord, normal, tangent, glm::vec3(0.0f, -1.0f, 0.0f));
+    CHECK(vertex.BitangentSign == 1);
+}
+
+} // namespace
+
+int main()
+{
+    testPositions();
+    testOctahedral();
+    testAttributes();
+    return VulkanCore::model::test::TestResult();
+}
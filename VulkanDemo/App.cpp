@@ -1,5 +1,6 @@
 #include "App.h"
 
+#include "DescriptorAllocator.h"
 #include "Shader.h"
 #include "Texture.h"
 #include "Wrapper.h"
@@ -17,40 +18,97 @@
 #include <array>
 #include <cmath>
 #include <cstdint>
+#include <filesystem>
 #include <iostream>
+#include <string>
 #include <vector>
 
 namespace VulkanApp
 {
 
+constexpr int32_t kMaxInstanceGrid = 32; // instancing buffers sized for kMaxInstanceGrid^2 copies
+constexpr VulkanCore::VertexLayout kModelVertexLayout = VulkanCore::VertexLayout_Quantized; // 20 bytes per vertex
+
 App::App(int32_t width, int32_t height)
     : mWindow{nullptr}, mVulkanCore{}, mGraphicsQueue{nullptr}, mNumImages{0}, mCommandBuffers{},
-      mVSShaderModule{VK_NULL_HANDLE}, mFSShaderModule{VK_NULL_HANDLE}, mWindowWidth{width},
-      mWindowHeight{height}, mCamera{nullptr}, mGraphicsPipelineV2{nullptr}, mModel{nullptr},
+      mShaderPermutations{nullptr}, mBindless{nullptr}, mUsePushConstants{true}, mIndirectDraws{nullptr},
+      mMeshletDraws{nullptr}, mDepthPrepass{false}, mHiZ{nullptr}, mFrustumCulling{true}, mOcclusionCulling{true},
+      mBackfaceCulling{true}, mCullStats{}, mWindowWidth{width}, mWindowHeight{height}, mCamera{nullptr},
+      mGraphicsPipelineV2{nullptr}, mModel{nullptr}, mModelLoader{nullptr}, mModelLoad{nullptr},
       mImGuiRenderer{nullptr}, mSkybox{nullptr}, mImGuiWidth{100}, mImGuiHeight{500}, mShowImGui{true},
-      mClearColor{0.0f, 1.0f, 0.0f}, mPosition{0.0f, 0.0f, 0.0f}, mRotation{0.0f, 0.0f, 0.0f}, mScale{1.0f}
+      mClearColor{0.0f, 1.0f, 0.0f}, mPosition{0.0f, 0.0f, 0.0f}, mRotation{0.0f, 0.0f, 0.0f}, mScale{1.0f},
+      mInstanceGrid{1}, mInstanceSpacing{50.0f}, mSkinning{nullptr}, mAnimationPose{}, mAnimationIndex{0},
+      mAnimationTime{0.0f}, mAnimationSpeed{1.0f}
 {
 }
 
 App::~App()
 {
+    // 0. Stop the model loader, it waits for an import in progress
+    if (mModelLoader)
+    {
+        mModelLoader->destroy();
+        delete mModelLoader;
+        mModelLoader = nullptr;
+        mModelLoad = nullptr;
+    }
+
     // 1. Command buffers will be freed when command pool is destroyed
     mVulkanCore.freeCommandBuffers(mCommandBuffers.withGUI.data(), mCommandBuffers.withGUI.size());
     mVulkanCore.freeCommandBuffers(mCommandBuffers.withoutGUI.data(), mCommandBuffers.withoutGUI.size());
 
-    // 2. Destroy shader modules
-    vkDestroyShaderModule(mVulkanCore.getDevice(), mVSShaderModule, nullptr);
-    vkDestroyShaderModule(mVulkanCore.getDevice(), mFSShaderModule, nullptr);
+    // 2. Destroy shader modules of all permutations
+    if (mShaderPermutations)
+    {
+        delete mShaderPermutations;
+        mShaderPermutations = nullptr;
+    }
 
-    // 3. Destroy graphics pipeline
+    // 3. Destroy graphics pipelines, mGraphicsPipelineV2 is one of the model pipelines
     // if (mGraphicsPipeline) {
     //   delete mGraphicsPipeline;
     //   mGraphicsPipeline = nullptr;
     // }
-    if (mGraphicsPipelineV2)
+    for (auto& [key, pPipeline] : mModelPipelines)
+    {
+        delete pPipeline;
+    }
+    mModelPipelines.clear();
+    for (auto& [key, pPipeline] : mDepthPipelines)
+    {
+        delete pPipeline;
+    }
+    mDepthPipelines.clear();
+    mGraphicsPipelineV2 = nullptr;
+
+    if (mIndirectDraws)
+    {
+        delete mIndirectDraws;
+        mIndirectDraws = nullptr;
+    }
+
+    if (mMeshletDraws)
+    {
+        delete mMeshletDraws;
+        mMeshletDraws = nullptr;
+    }
+
+    if (mHiZ)
+    {
+        delete mHiZ;
+        mHiZ = nullptr;
+    }
+
+    if (mSkinning)
     {
-        delete mGraphicsPipelineV2;
-        mGraphicsPipelineV2 = nullptr;
+        delete mSkinning;
+        mSkinning = nullptr;
+    }
+
+    if (mBindless)
+    {
+        delete mBindless;
+        mBindless = nullptr;
     }
 
     // 4. Destroy vertex buffer
@@ -107,10 +165,9 @@ void App::init(std::string appName)
     mNumImages = mVulkanCore.getSwapchainImageCount();
     mGraphicsQueue = mVulkanCore.getGraphicsQueue();
     createShaders();
-    createMesh();
+    createMesh(); // the model pipelines are created once it is resident, see onModelResident()
     mSkybox = new VulkanCore::SkyBox(&mVulkanCore, "VulkanDemo/assets/skybox/piazza_bologni_1k.hdr");
     createUniformBuffers();
-    createPipeline();
     createCommandBuffers();
     recordCommandBuffer();
     defaultCreateCameraPers();
@@ -120,9 +177,41 @@ void App::init(std::string appName)
 
 void App::renderScene()
 {
+    // Uploads of the model are streamed along the frames, the skybox alone is drawn until it is resident
+    if (!mModel && !mModelLoad->isFailed())
+    {
+        mModelLoader->update();
+        if (mModelLoad->isResident())
+        {
+            onModelResident();
+        }
+    }
+
     // Main application loop here
     uint32_t imageIndex = mGraphicsQueue->acquireNextImage();
+    mVulkanCore.resetFrameDescriptors(imageIndex);
+    uint32_t cullFlags = (mFrustumCulling ? VulkanCore::CullFlag_Frustum : 0) |
+                         (mOcclusionCulling ? VulkanCore::CullFlag_Occlusion : 0) |
+                         (mBackfaceCulling ? VulkanCore::CullFlag_Backface : 0);
+    if (mModel && mMeshletDraws)
+    {
+        mCullStats = mMeshletDraws->updateCullData(imageIndex, cullFlags);
+    }
+    else if (mModel && mIndirectDraws)
+    {
+        mCullStats = mIndirectDraws->updateCullData(imageIndex, cullFlags);
+    }
     updateUniformBuffer(imageIndex);
+    updateAnimation(imageIndex);
+    if (mModel && (mModel->isPushConstantsEnabled() || mModel->isCpuCullingEnabled() ||
+                   mModel->isInstancingEnabled() || mModel->isLodEnabled()))
+    {
+        // The per-draw WVP, the visible submeshes, the instance count or the LODs live in the command buffer,
+        // re-record the one about to be submitted
+        VkCommandBuffer commandBuffer =
+            mShowImGui ? mCommandBuffers.withGUI[imageIndex] : mCommandBuffers.withoutGUI[imageIndex];
+        recordCommandBufferForImage(mShowImGui, commandBuffer, imageIndex);
+    }
     if (mShowImGui)
     {
         updateGUI();
@@ -151,6 +240,7 @@ void App::run()
 
         mCamera->setTick(deltaTime);
         mCamera->process();
+        mAnimationTime += deltaTime * mAnimationSpeed;
 
         renderScene();
         glfwPollEvents();
@@ -292,17 +382,68 @@ void App::createCommandBuffers()
 
 void App::recordCommandBuffer()
 {
-    mModel->createDescriptorSets(mGraphicsPipelineV2);
+    // Placeholder frames until the model is resident, onModelResident() records them again
+    if (mModel && mBindless)
+    {
+        mModel->registerBindless(mBindless);
+        if (mMeshletDraws)
+        {
+            mModel->registerMeshletDraws(mMeshletDraws);
+            mMeshletDraws->upload();
+        }
+        else if (mIndirectDraws)
+        {
+            // Without mesh shaders the meshlets are still culled one by one, as indirect draws
+            mModel->registerIndirectDraws(mIndirectDraws, true /* useMeshlets */);
+            mIndirectDraws->upload();
+        }
+    }
+    else if (mModel)
+    {
+        mModel->createDescriptorSets(mGraphicsPipelineV2);
+    }
     recordCommandBufferInteral(true, mCommandBuffers.withGUI);
     recordCommandBufferInteral(false, mCommandBuffers.withoutGUI);
 }
 
 void App::createShaders()
 {
-    mVSShaderModule =
-        VulkanCore::CreateShaderModuleFromText(mVulkanCore.getDevice(), "VulkanDemo/shaders/triangle.vert");
-    mFSShaderModule =
-        VulkanCore::CreateShaderModuleFromText(mVulkanCore.getDevice(), "VulkanDemo/shaders/triangle.frag");
+    // Bindless when the device supports descriptor indexing, per-submesh descriptor sets otherwise
+    if (mVulkanCore.isBindlessSupported())
+    {
+        mBindless = new VulkanCore::BindlessRegistry(&mVulkanCore);
+    }
+    // Meshlets culled in the task shader when mesh shaders are available. Otherwise GPU-driven submission on top of
+    // bindless when draw indirect count is available, culled on the GPU against the frustum and the depth pyramid of
+    // the previous frame
+    if (mBindless && mVulkanCore.isMeshShaderSupported())
+    {
+        mMeshletDraws = new VulkanCore::MeshletDrawList(&mVulkanCore, mBindless);
+    }
+    else if (mBindless && mVulkanCore.isGpuDrivenSupported())
+    {
+        mHiZ = new VulkanCore::HiZPyramid(&mVulkanCore);
+        mIndirectDraws = new VulkanCore::IndirectDrawList(&mVulkanCore, mBindless, mHiZ);
+    }
+    // The GPU paths cull against the depth pyramid instead, a prepass only pays off when the CPU submits the draws
+    mDepthPrepass = mBindless && !mIndirectDraws && !mMeshletDraws;
+
+    // Variants are compiled on demand in createPipeline() once the model materials are known
+    if (mMeshletDraws)
+    {
+        mShaderPermutations = new VulkanCore::ShaderPermutationCache(
+            mVulkanCore.getDevice(), "VulkanDemo/shaders/meshlet.mesh", "VulkanDemo/shaders/bindless.frag");
+    }
+    else if (mBindless)
+    {
+        mShaderPermutations = new VulkanCore::ShaderPermutationCache(
+            mVulkanCore.getDevice(), "VulkanDemo/shaders/bindless.vert", "VulkanDemo/shaders/bindless.frag");
+    }
+    else
+    {
+        mShaderPermutations = new VulkanCore::ShaderPermutationCache(
+            mVulkanCore.getDevice(), "VulkanDemo/shaders/triangle.vert", "VulkanDemo/shaders/triangle.frag");
+    }
     // std::cout << "Shader modules created successfully." << std::endl;
 }
 
@@ -317,10 +458,97 @@ void App::createPipeline()
     //     mFSShaderModule, &mMesh, mNumImages, mUniformBuffers, sizeof(UniformData),
     //     true /* enable depth buffer */);
 
-    VkFormat depthFormat = mVulkanCore.getDepthFormat();
-    VkFormat colorFormat = mVulkanCore.getSwapchainSurfaceFormat();
-    mGraphicsPipelineV2 = new VulkanCore::GraphicsPipelineV2(mVulkanCore.getDevice(), mWindow, nullptr, mVSShaderModule,
-                                                             mFSShaderModule, mNumImages, colorFormat, depthFormat);
+    VulkanCore::PipelineDesc pd;
+    pd.mDevice = mVulkanCore.getDevice();
+    pd.mWindow = mWindow;
+    pd.mNumSwapchainImages = mNumImages;
+    pd.mColorFormat = mVulkanCore.getSwapchainSurfaceFormat();
+    pd.mDepthFormat = mVulkanCore.getDepthFormat();
+
+    // Merged interface of all permutations. Bindless : checked against the registry set.
+    // Otherwise the layout is reflected from it, so every permutation shares one cached layout
+    // and the model descriptor sets work with all of them.
+    std::vector<VulkanCore::ShaderPermutationKey> keys = mModel->getPermutationKeys();
+    VulkanCore::ShaderReflection reflection;
+    for (const VulkanCore::ShaderPermutationKey& key : keys)
+    {
+        reflection = VulkanCore::MergeReflection(reflection, mShaderPermutations->getVariant(key).mReflection);
+    }
+    std::vector<VulkanCore::ShaderPermutationKey> depthKeys;
+    if (mDepthPrepass)
+    {
+        depthKeys = mModel->getDepthPermutationKeys();
+        for (const VulkanCore::ShaderPermutationKey& key : depthKeys)
+        {
+            reflection = VulkanCore::MergeReflection(reflection, mShaderPermutations->getVariant(key).mReflection);
+        }
+    }
+    if (mBindless)
+    {
+        mBindless->validateInterface(reflection, mIndirectDraws != nullptr || mMeshletDraws != nullptr);
+        pd.mExternalSetLayout = mBindless->getDescriptorSetLayout();
+        pd.mPushConstantRange = VulkanCore::BindlessRegistry::getPushConstantRange();
+        if (mMeshletDraws)
+        {
+            mMeshletDraws->validateInterface(reflection);
+            pd.mDrawSetLayout = mMeshletDraws->getDrawSetLayout();
+            pd.mPushConstantRange = VulkanCore::MeshletDrawList::getPushConstantRange();
+            pd.mTaskShaderModule = mMeshletDraws->getTaskShaderModule();
+        }
+        else if (mIndirectDraws)
+        {
+            mIndirectDraws->validateInterface(reflection);
+            pd.mDrawSetLayout = mIndirectDraws->getDrawSetLayout();
+        }
+    }
+    else
+    {
+        pd.mpReflection = &reflection;
+        pd.mpLayoutCache = mVulkanCore.getDescriptorSetLayoutCache();
+        pd.mpDescriptorAllocator = mVulkanCore.getDescriptorAllocator();
+    }
+
+    // After the prepass the main pass only keeps the fragments matching the prepass depth, exact since both vertex
+    // shaders write an invariant gl_Position
+    if (mDepthPrepass)
+    {
+        pd.mDepthCompareOp = VK_COMPARE_OP_LESS_OR_EQUAL;
+    }
+
+    // One pipeline per permutation actually used by the model materials
+    for (const VulkanCore::ShaderPermutationKey& key : keys)
+    {
+        const VulkanCore::ShaderVariant& variant = mShaderPermutations->getVariant(key);
+        if (mMeshletDraws)
+        {
+            pd.mMeshShaderModule = variant.mVertexModule;
+        }
+        else
+        {
+            pd.mVertexShaderModule = variant.mVertexModule;
+        }
+        pd.mFragmentShaderModule = variant.mFragmentModule;
+        pd.mpSpecializationInfo = &variant.mSpecializationInfo;
+        mModelPipelines[key.hash()] = new VulkanCore::GraphicsPipelineV2(pd);
+    }
+
+    mGraphicsPipelineV2 = mModelPipelines[keys.front().hash()];
+
+    // Depth prepass : vertex stage only, no color attachment
+    if (mDepthPrepass)
+    {
+        VulkanCore::PipelineDesc depthPd = pd;
+        depthPd.mColorFormat = VK_FORMAT_UNDEFINED;
+        depthPd.mFragmentShaderModule = VK_NULL_HANDLE;
+        depthPd.mDepthCompareOp = VK_COMPARE_OP_LESS;
+        for (const VulkanCore::ShaderPermutationKey& key : depthKeys)
+        {
+            const VulkanCore::ShaderVariant& variant = mShaderPermutations->getVariant(key);
+            depthPd.mVertexShaderModule = variant.mVertexModule;
+            depthPd.mpSpecializationInfo = &variant.mSpecializationInfo;
+            mDepthPipelines[key.hash()] = new VulkanCore::GraphicsPipelineV2(depthPd);
+        }
+    }
 }
 
 void App::createVertexBuffer()
@@ -368,7 +596,25 @@ void App::updateUniformBuffer(uint32_t currentImage)
 
     glm::mat4 modelMatrix = translation * rotation * scale;
     glm::mat4 vp = mCamera->getVPMatrix();
-    mModel->update(currentImage, vp * modelMatrix);
+    if (mModel && mModel->isInstancingEnabled())
+    {
+        std::vector<glm::mat4> instances;
+        instances.reserve(mInstanceGrid * mInstanceGrid);
+        float_t gridOrigin = -0.5f * mInstanceSpacing * (mInstanceGrid - 1);
+        for (int32_t z = 0; z < mInstanceGrid; z++)
+        {
+            for (int32_t x = 0; x < mInstanceGrid; x++)
+            {
+                glm::vec3 offset(gridOrigin + x * mInstanceSpacing, 0.0f, gridOrigin + z * mInstanceSpacing);
+                instances.push_back(glm::translate(glm::mat4(1.0f), offset) * modelMatrix);
+            }
+        }
+        mModel->updateInstances(currentImage, vp, instances);
+    }
+    else if (mModel)
+    {
+        mModel->update(currentImage, vp * modelMatrix);
+    }
 
     // For skybox: remove translation from view matrix (keep only rotation)
     glm::mat4 viewMatrix = mCamera->getCameraMatrix();
@@ -378,6 +624,20 @@ void App::updateUniformBuffer(uint32_t currentImage)
     mSkybox->update(currentImage, skyboxVP);
 }
 
+void App::updateAnimation(uint32_t currentImage)
+{
+    if (!mSkinning)
+    {
+        return;
+    }
+    const std::vector<VulkanCore::model::SoaAnimationClip>& clips = mModel->getSoaAnimations();
+    const VulkanCore::model::SoaAnimationClip* pClip =
+        mAnimationIndex >= 0 && mAnimationIndex < static_cast<int32_t>(clips.size()) ? &clips[mAnimationIndex]
+                                                                                     : nullptr;
+    VulkanCore::model::SampleAnimationSoa(mModel->getSkeleton(), pClip, mAnimationTime, mAnimationPose);
+    mModel->updatePose(currentImage, mAnimationPose);
+}
+
 void App::defaultCreateCameraPers()
 {
     mCamera =
@@ -396,7 +656,46 @@ void App::createMesh()
     // createVertexBuffer();
     // loadTexture();
 
-    mModel = new VulkanCore::VulkanModel("VulkanDemo/assets/Spider/spider.obj", &mVulkanCore);
+    // The baked model is used when present, see VulkanTools/ModelBake.cpp
+    std::string modelPath = "VulkanDemo/assets/Spider/spider.obj";
+    std::string bakedPath = VulkanCore::model::GetBakedModelPath(modelPath);
+    if (std::filesystem::exists(bakedPath))
+    {
+        modelPath = bakedPath;
+    }
+    // Imported on a worker thread and uploaded over the next frames, see renderScene()
+    mModelLoader = new VulkanCore::ModelLoader(&mVulkanCore);
+    mModelLoad = mModelLoader->load(modelPath, kModelVertexLayout, mDepthPrepass);
+}
+
+void App::onModelResident()
+{
+    mModel = mModelLoad->releaseModel();
+    if (!mBindless && mUsePushConstants)
+    {
+        mModel->enablePushConstants();
+    }
+    if (mIndirectDraws || mMeshletDraws)
+    {
+        mModel->enableGpuDriven();
+    }
+    else
+    {
+        // CPU submission : only the submeshes in the frustum are recorded, one draw per submesh for all copies
+        mModel->enableCpuCulling();
+        mModel->enableInstancing(kMaxInstanceGrid * kMaxInstanceGrid);
+        mModel->enableLods(static_cast<float>(mWindowHeight));
+    }
+    if (mModel->isSkinned())
+    {
+        mSkinning = new VulkanCore::SkinningPass(&mVulkanCore);
+        mModel->enableSkinning(mSkinning);
+    }
+
+    // The placeholder command buffers may still be executing
+    mGraphicsQueue->waitIdle();
+    createPipeline();
+    recordCommandBuffer();
 }
 
 void App::loadTexture()
@@ -406,43 +705,98 @@ void App::loadTexture()
 }
 
 void App::recordCommandBufferInteral(bool withSecondBarrier, std::vector<VkCommandBuffer>& commandBuffers)
+{
+    for (uint32_t i = 0; i < commandBuffers.size(); ++i)
+    {
+        recordCommandBufferForImage(withSecondBarrier, commandBuffers[i], i);
+    }
+
+    std::cout << "Recorded " << commandBuffers.size() << " command buffers." << std::endl;
+}
+
+void App::recordCommandBufferForImage(bool withSecondBarrier, VkCommandBuffer commandBuffer, uint32_t imageIndex)
 {
     VkClearValue clearColor = {.color = {{mClearColor.r, mClearColor.g, mClearColor.b, 1.0F}}};
     VkClearValue clearDepth = {.depthStencil = {1.0F, 0}};
-    for (uint32_t i = 0; i < commandBuffers.size(); ++i)
+
+    // Begin command buffer recording
+    VulkanCore::BeginCommandBuffer(commandBuffer, VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT);
+
+    // Placeholder frames : the clear and the skybox only
+    bool drawModel = mModel != nullptr;
+    bool depthPrepass = drawModel && mDepthPrepass;
+
+    // Skinned vertices first, every draw below reads them
+    if (drawModel)
+    {
+        mModel->recordSkinning(commandBuffer, imageIndex);
+    }
+
+    // Indirect commands are written by a compute pass, it must run outside of the rendering scope
+    if (drawModel && mIndirectDraws)
     {
-        // Begin command buffer recording
-        VulkanCore::BeginCommandBuffer(commandBuffers[i], VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT);
+        mIndirectDraws->recordBuild(commandBuffer, imageIndex);
+    }
+
+    // Transition from UNDEFINED (works for both first frame and subsequent frames)
+    // On first frame: actually UNDEFINED
+    // On subsequent frames: coming from PRESENT_SRC_KHR, but UNDEFINED transition is safe
+    VulkanCore::imageMemBarrier(commandBuffer, mVulkanCore.getSwapchainImage(imageIndex),
+                                mVulkanCore.getSwapchainSurfaceFormat(), VK_IMAGE_LAYOUT_UNDEFINED,
+                                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
+
+    if (depthPrepass)
+    {
+        mVulkanCore.beginDepthOnlyRendering(commandBuffer, imageIndex, &clearDepth);
+        mModel->recordDepthBindless(commandBuffer, mDepthPipelines, *mBindless, imageIndex);
+        mVulkanCore.endDepthOnlyRendering(commandBuffer);
+    }
 
-        // Transition from UNDEFINED (works for both first frame and subsequent frames)
-        // On first frame: actually UNDEFINED
-        // On subsequent frames: coming from PRESENT_SRC_KHR, but UNDEFINED transition is safe
-        VulkanCore::imageMemBarrier(commandBuffers[i], mVulkanCore.getSwapchainImage(i),
-                                    mVulkanCore.getSwapchainSurfaceFormat(), VK_IMAGE_LAYOUT_UNDEFINED,
-                                    VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, 1);
+    // Depth already cleared and written by the prepass
+    mVulkanCore.beginDynamicRendering(commandBuffer, imageIndex, &clearColor, depthPrepass ? nullptr : &clearDepth);
+    if (drawModel && mMeshletDraws)
+    {
+        mMeshletDraws->recordDraws(commandBuffer, mModelPipelines, imageIndex);
+    }
+    else if (drawModel && mIndirectDraws)
+    {
+        mIndirectDraws->recordDraws(commandBuffer, mModelPipelines, imageIndex);
+    }
+    else if (drawModel && mBindless)
+    {
+        mModel->recordCommandBufferBindless(commandBuffer, mModelPipelines, *mBindless, imageIndex);
+    }
+    else if (drawModel)
+    {
+        mModel->recordCommandBuffer(commandBuffer, mModelPipelines, imageIndex);
+    }
+    mSkybox->recordCommandBuffer(commandBuffer, imageIndex);
 
-        mVulkanCore.beginDynamicRendering(commandBuffers[i], i, &clearColor, &clearDepth);
-        mGraphicsPipelineV2->bind(commandBuffers[i]);
-        mModel->recordCommandBuffer(commandBuffers[i], mGraphicsPipelineV2, i);
-        mSkybox->recordCommandBuffer(commandBuffers[i], i);
+    vkCmdEndRendering(commandBuffer);
 
-        vkCmdEndRendering(commandBuffers[i]);
+    if (drawModel && mMeshletDraws)
+    {
+        mMeshletDraws->recordCullDataBarrier(commandBuffer, imageIndex);
+    }
 
-        if (!withSecondBarrier)
-        {
-            // For standalone rendering (no ImGui), do final transition to present
-            VulkanCore::imageMemBarrier(commandBuffers[i], mVulkanCore.getSwapchainImage(i),
-                                        mVulkanCore.getSwapchainSurfaceFormat(),
-                                        VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 1);
-        }
+    // Depth pyramid for the occlusion culling of the next frame
+    if (mHiZ)
+    {
+        mHiZ->recordBuild(commandBuffer, imageIndex);
+    }
 
-        if (vkEndCommandBuffer(commandBuffers[i]) != VK_SUCCESS)
-        {
-            throw std::runtime_error("Failed to record command buffer " + std::to_string(i));
-        }
+    if (!withSecondBarrier)
+    {
+        // For standalone rendering (no ImGui), do final transition to present
+        VulkanCore::imageMemBarrier(commandBuffer, mVulkanCore.getSwapchainImage(imageIndex),
+                                    mVulkanCore.getSwapchainSurfaceFormat(), VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                                    VK_IMAGE_LAYOUT_PRESENT_SRC_KHR, 1);
     }
 
-    std::cout << "Recorded " << commandBuffers.size() << " command buffers." << std::endl;
+    if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS)
+    {
+        throw std::runtime_error("Failed to record command buffer " + std::to_string(imageIndex));
+    }
 }
 
 void App::updateGUI()
@@ -568,6 +922,71 @@ void App::updateGUI()
         ImGui::PopStyleColor(2);
     }
 
+    if (ImGui::CollapsingHeader("📦 Model", ImGuiTreeNodeFlags_DefaultOpen))
+    {
+        VulkanCore::ModelLoadStage stage = mModelLoad->getStage();
+        ImGui::TextWrapped("%s", mModelLoad->getPath().c_str());
+        if (stage == VulkanCore::ModelLoadStage_Failed)
+        {
+            ImGui::TextColored(ImVec4(1.0f, 0.0f, 0.0f, 1.0f), "Failed: %s", mModelLoad->getError().c_str());
+        }
+        else if (stage != VulkanCore::ModelLoadStage_Resident)
+        {
+            ImGui::Text("Loading: %s, %.0f ms", VulkanCore::GetModelLoadStageName(stage),
+                        mModelLoad->getElapsedTime());
+        }
+        for (uint32_t loadStage = VulkanCore::ModelLoadStage_Import; loadStage < VulkanCore::ModelLoadStage_Resident;
+             loadStage++)
+        {
+            VulkanCore::ModelLoadStage pastStage = static_cast<VulkanCore::ModelLoadStage>(loadStage);
+            if (pastStage < stage)
+            {
+                ImGui::Text("%s: %.1f ms", VulkanCore::GetModelLoadStageName(pastStage),
+                            mModelLoad->getStageTime(pastStage));
+            }
+        }
+    }
+
+    if (mModel && mModel->isInstancingEnabled() && ImGui::CollapsingHeader("🕷️ Instances"))
+    {
+        ImGui::PushItemWidth(-1);
+        ImGui::Text("Grid:");
+        ImGui::SliderInt("##InstanceGrid", &mInstanceGrid, 1, kMaxInstanceGrid);
+        ImGui::Text("Spacing:");
+        ImGui::SliderFloat("##InstanceSpacing", &mInstanceSpacing, 1.0f, 200.0f, "%.1f");
+        ImGui::PopItemWidth();
+        ImGui::Text("Drawn instances: %u / %d", mModel->getNumInstances(), mInstanceGrid * mInstanceGrid);
+    }
+
+    if (mModel && mModel->isLodEnabled() && ImGui::CollapsingHeader("🔻 LOD"))
+    {
+        float_t lodThreshold = mModel->getLodThreshold();
+        ImGui::PushItemWidth(-1);
+        ImGui::Text("Max screen space error (pixels, 0 : full detail):");
+        ImGui::SliderFloat("##LodThreshold", &lodThreshold, 0.0f, 16.0f, "%.1f");
+        ImGui::PopItemWidth();
+        mModel->setLodThreshold(lodThreshold);
+
+        ImGui::Text("Drawn triangles: %llu / %llu", static_cast<unsigned long long>(mModel->getNumDrawnTriangles()),
+                    static_cast<unsigned long long>(mModel->getNumDrawnTriangles(true)));
+    }
+
+    if (mSkinning && ImGui::CollapsingHeader("🏃 Animation"))
+    {
+        const std::vector<VulkanCore::model::AnimationClip>& clips = mModel->getAnimations();
+        ImGui::PushItemWidth(-1);
+        ImGui::Text("Clip (-1 : bind pose):");
+        ImGui::SliderInt("##AnimationClip", &mAnimationIndex, -1, static_cast<int32_t>(clips.size()) - 1);
+        ImGui::Text("Speed:");
+        ImGui::SliderFloat("##AnimationSpeed", &mAnimationSpeed, 0.0f, 4.0f, "%.2fx");
+        ImGui::PopItemWidth();
+        if (mAnimationIndex >= 0 && mAnimationIndex < static_cast<int32_t>(clips.size()))
+        {
+            ImGui::Text("%s, %.2f s", clips[mAnimationIndex].Name.c_str(), clips[mAnimationIndex].Duration);
+        }
+        ImGui::Text("Bones: %zu", mModel->getSkeleton().BoneNodes.size());
+    }
+
     if (ImGui::CollapsingHeader("📷 Camera"))
     {
         float_t cameraSpeed = mCamera->getSpeed();
@@ -601,6 +1020,67 @@ void App::updateGUI()
         ImGui::PopStyleColor(2);
     }
 
+    if (ImGui::CollapsingHeader("🧮 Descriptors"))
+    {
+        VulkanCore::DescriptorAllocatorStats stats = mVulkanCore.getDescriptorAllocator()->getStats();
+        ImGui::Text("Pools: %u (%u full)", stats.mNumPools, stats.mNumFullPools);
+        ImGui::Text("Sets: %u / %u", stats.mSetsAllocated, stats.mSetCapacity);
+        for (const VulkanCore::DescriptorTypeUsage& usage : stats.mTypes)
+        {
+            float fraction = usage.mCapacity ? static_cast<float>(usage.mUsed) / usage.mCapacity : 0.0f;
+            ImGui::ProgressBar(fraction, ImVec2(-1, 0), VulkanCore::GetDescriptorTypeName(usage.mType));
+        }
+    }
+
+    if (mModel && mModel->isCpuCullingEnabled() && ImGui::CollapsingHeader("✂️ Culling"))
+    {
+        VulkanCore::FrustumCuller& culler = mModel->getCuller();
+        if (ImGui::BeginCombo("Path", VulkanCore::GetCullPathName(culler.getPath())))
+        {
+            for (uint32_t path = VulkanCore::CullPath_None; path < VulkanCore::CullPath_Count; path++)
+            {
+                VulkanCore::CullPath cullPath = static_cast<VulkanCore::CullPath>(path);
+                if (VulkanCore::FrustumCuller::isPathSupported(cullPath) &&
+                    ImGui::Selectable(VulkanCore::GetCullPathName(cullPath), culler.getPath() == cullPath))
+                {
+                    culler.setPath(cullPath);
+                }
+            }
+            ImGui::EndCombo();
+        }
+        ImGui::Text("Visible submeshes: %u / %u", mModel->getNumVisibleSubmeshes(), culler.getNumSpheres());
+        ImGui::Text("Cull time: %.1f us", mModel->getCullTimeUs());
+    }
+
+    if (mModel && (mIndirectDraws || mMeshletDraws) && ImGui::CollapsingHeader("✂️ Culling"))
+    {
+        if (mMeshletDraws)
+        {
+            ImGui::Text("Mesh shader meshlets: %u in %u batches", mMeshletDraws->getNumMeshlets(),
+                        mMeshletDraws->getNumBatches());
+        }
+        else
+        {
+            ImGui::Text("GPU-driven draws: %u in %u batches (%u meshlets)", mIndirectDraws->getNumDraws(),
+                        mIndirectDraws->getNumBatches(), mModel->getNumMeshlets());
+        }
+        ImGui::Checkbox("Frustum", &mFrustumCulling);
+        ImGui::SameLine();
+        ImGui::Checkbox("Backface (cone)", &mBackfaceCulling);
+        if (mIndirectDraws)
+        {
+            ImGui::SameLine();
+            ImGui::Checkbox("Occlusion (HiZ)", &mOcclusionCulling);
+        }
+        ImGui::Text("Visible: %u", mCullStats.mNumVisible);
+        ImGui::Text("Frustum culled: %u", mCullStats.mNumFrustumCulled);
+        ImGui::Text("Backface culled: %u", mCullStats.mNumBackfaceCulled);
+        if (mIndirectDraws)
+        {
+            ImGui::Text("Occlusion culled: %u", mCullStats.mNumOcclusionCulled);
+        }
+    }
+
     ImGui::Spacing();
     ImGui::Separator();
 
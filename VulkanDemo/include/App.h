@@ -8,14 +8,21 @@
 #include <vector>
 #include <vulkan/vulkan_core.h>
 
+#include "BindlessRegistry.h"
 #include "Camera.h"
 #include "Core.h"
 #include "GLFW.h"
 #include "GraphicsPipeline.h"
 #include "GraphicsPipelineV2.h"
+#include "HiZPyramid.h"
 #include "ImGuiRenderer.h"
+#include "IndirectDrawList.h"
+#include "MeshletDrawList.h"
+#include "ModelLoader.h"
 #include "Queue.h"
+#include "ShaderPermutation.h"
 #include "SimpleMesh.h"
+#include "SkinningPass.h"
 #include "SkyBox.h"
 #include "VulkanModel.h"
 
@@ -44,11 +51,14 @@ class App : public VulkanCore::GLFWCallbacks
     void createVertexBuffer();
     void createUniformBuffers();
     void updateUniformBuffer(uint32_t currentImage);
+    void updateAnimation(uint32_t currentImage);
     void defaultCreateCameraPers();
     void renderScene();
     void createMesh();
+    void onModelResident();
     void loadTexture();
     void recordCommandBufferInteral(bool withSecondBarrier, std::vector<VkCommandBuffer>& commandBuffers);
+    void recordCommandBufferForImage(bool withSecondBarrier, VkCommandBuffer commandBuffer, uint32_t imageIndex);
     void updateGUI();
 
     GLFWwindow* mWindow;
@@ -64,15 +74,30 @@ class App : public VulkanCore::GLFWCallbacks
         std::vector<VkCommandBuffer> withoutGUI;
     } mCommandBuffers;
 
-    VkShaderModule mVSShaderModule;
-    VkShaderModule mFSShaderModule;
+    VulkanCore::ShaderPermutationCache* mShaderPermutations;
+    VulkanCore::BindlessRegistry* mBindless; // nullptr when the device has no descriptor indexing
+    bool mUsePushConstants; // descriptor set path : per-draw WVP as push constants, see VulkanModel
+    VulkanCore::IndirectDrawList* mIndirectDraws; // bindless path : draws built on the GPU, nullptr when unsupported
+    VulkanCore::MeshletDrawList* mMeshletDraws;   // replaces mIndirectDraws when mesh shaders are supported
+    bool mDepthPrepass; // CPU-submitted bindless path : opaque submeshes drawn depth only from the position stream
+
+    // GPU culling of the indirect draws or meshlets, toggled from the GUI
+    VulkanCore::HiZPyramid* mHiZ;
+    bool mFrustumCulling;
+    bool mOcclusionCulling;
+    bool mBackfaceCulling;
+    VulkanCore::GpuCullData mCullStats; // of the last completed frame
 
     std::vector<VulkanCore::BufferAndMemory> mUniformBuffers;
     int32_t mWindowWidth, mWindowHeight;
     VulkanCore::Camera* mCamera;
 
-    VulkanCore::GraphicsPipelineV2* mGraphicsPipelineV2;
-    VulkanCore::VulkanModel* mModel;
+    VulkanCore::GraphicsPipelineV2* mGraphicsPipelineV2; // default permutation, also owns the model descriptor sets
+    VulkanCore::PipelineVariantMap mModelPipelines;      // one pipeline per material permutation of the model
+    VulkanCore::PipelineVariantMap mDepthPipelines;      // depth prepass, empty when mDepthPrepass is false
+    VulkanCore::VulkanModel* mModel;       // nullptr until mModelLoad is resident, the frames then draw the skybox
+    VulkanCore::ModelLoader* mModelLoader; // imports the model in the background
+    VulkanCore::ModelLoad* mModelLoad;     // owned by mModelLoader, kept for its stage timings
     VulkanCore::ImGuiRenderer* mImGuiRenderer;
     VulkanCore::SkyBox* mSkybox;
     int32_t mImGuiWidth, mImGuiHeight;
@@ -82,6 +107,17 @@ class App : public VulkanCore::GLFWCallbacks
     glm::vec3 mPosition;
     glm::vec3 mRotation;
     float_t mScale;
+
+    // Crowd of model copies on the XZ plane, drawn with instancing when the model supports it
+    int32_t mInstanceGrid; // mInstanceGrid x mInstanceGrid copies
+    float_t mInstanceSpacing;
+
+    // Skinned models only : the clip played by every copy
+    VulkanCore::SkinningPass* mSkinning;
+    VulkanCore::model::AnimationPose mAnimationPose;
+    int32_t mAnimationIndex; // -1 : bind pose
+    float_t mAnimationTime;  // in seconds, advanced by run()
+    float_t mAnimationSpeed;
 };
 
 } // namespace VulkanApp
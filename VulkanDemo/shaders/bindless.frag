@@ -0,0 +1,66 @@
+#version 460
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Specialization constants, see ShaderPermutation.h
+layout(constant_id = 0) const uint kFeatureMask = 0;
+layout(constant_id = 2) const float kAlphaCutoff = 0.5;
+
+const uint FEATURE_ALPHA_TEST = 2u; // ShaderFeature_AlphaTest
+
+// Bindless set, see BindlessRegistry.h
+layout(binding = 3) uniform sampler2D textures[];
+
+#ifdef GPU_DRIVEN
+// Indices of the draw record, forwarded by the vertex shader
+layout(location = 4) flat in uint inTextureIndex;
+layout(location = 5) flat in uint inNormalMapIndex;
+#else
+// BindlessDrawConstants
+layout(push_constant) uniform DrawConstants
+{
+    uint geometryIndex;
+    uint vertexOffset;
+    uint indexOffset;
+    uint transformIndex;
+    uint textureIndex;
+    uint normalMapIndex;
+} draw;
+#endif
+
+layout(location = 0) in vec2 texCoord;
+layout(location = 0) out vec4 outColor;
+
+#ifdef HAS_NORMAL_MAP
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec3 inTangent;
+layout(location = 3) in vec3 inBitangent;
+
+// Fixed directional light in model space
+const vec3 kLightDir = vec3(0.0, 0.0, -1.0);
+#endif
+
+void main()
+{
+#ifdef GPU_DRIVEN
+    uint textureIndex = inTextureIndex;
+    uint normalMapIndex = inNormalMapIndex;
+#else
+    uint textureIndex = draw.textureIndex;
+    uint normalMapIndex = draw.normalMapIndex;
+#endif
+
+    vec4 color = texture(textures[nonuniformEXT(textureIndex)], texCoord);
+
+    if ((kFeatureMask & FEATURE_ALPHA_TEST) != 0u && color.a < kAlphaCutoff)
+    {
+        discard;
+    }
+
+#ifdef HAS_NORMAL_MAP
+    mat3 TBN = mat3(normalize(inTangent), normalize(inBitangent), normalize(inNormal));
+    vec3 N = normalize(TBN * (texture(textures[nonuniformEXT(normalMapIndex)], texCoord).xyz * 2.0 - 1.0));
+    color.rgb *= 0.3 + 0.7 * max(dot(N, -kLightDir), 0.0);
+#endif
+
+    outColor = color;
+}
@@ -0,0 +1,195 @@
+#version 460
+#extension GL_EXT_nonuniform_qualifier : require
+
+// Specialization constants, see ShaderPermutation.h
+layout(constant_id = 0) const uint kFeatureMask = 0;
+layout(constant_id = 1) const uint kVertexLayout = 0; // VertexLayout
+
+const uint VertexLayout_Full = 0;      // Model::Vertex : pos, uv, normal, tangent, bitangent
+const uint VertexLayout_Quantized = 1; // model::QuantizedVertex
+const uint VertexLayout_Position = 2;  // position streams, depth only pipelines
+const uint VertexLayout_QuantizedPosition = 3;
+const uint kFullVertexWords = 14;
+const uint kQuantizedVertexWords = 5;
+
+const uint FEATURE_INDEX16 = 32u; // ShaderFeature_Index16
+
+// Bindless set, see BindlessRegistry.h
+layout(std430, binding = 0) readonly buffer VertexBuffers { uint words[]; } vertexBuffers[];
+layout(std430, binding = 1) readonly buffer IndexBuffers { uint indices[]; } indexBuffers[];
+layout(std430, binding = 2) readonly buffer TransformBuffers { mat4 wvp[]; } transformBuffers[];
+
+#ifdef GPU_DRIVEN
+// Draw set, see IndirectDrawList.h : gl_DrawID indexes the commands of the current batch
+struct DrawRecord
+{
+    uint indexCount;
+    uint batchIndex;
+    uint geometryIndex;
+    uint vertexOffset;
+    uint indexOffset;
+    uint transformIndex;
+    uint textureIndex;
+    uint normalMapIndex;
+    vec4 boundingSphere; // culling only
+    vec4 boundsMin;
+    vec4 boundsMax;
+    vec4 cone;
+};
+
+struct DrawCommand
+{
+    uint vertexCount;
+    uint instanceCount;
+    uint firstVertex;
+    uint firstInstance;
+    uint drawIndex;
+};
+
+layout(std430, set = 1, binding = 0) readonly buffer DrawRecords { DrawRecord records[]; };
+layout(std430, set = 1, binding = 1) readonly buffer DrawCommands { DrawCommand commands[]; };
+
+layout(push_constant) uniform DrawBatch
+{
+    uint firstCommand;
+} batch;
+
+DrawRecord draw;
+
+layout(location = 4) flat out uint outTextureIndex;
+layout(location = 5) flat out uint outNormalMapIndex;
+#else
+// BindlessDrawConstants
+layout(push_constant) uniform DrawConstants
+{
+    uint geometryIndex;
+    uint vertexOffset;
+    uint indexOffset;
+    uint transformIndex;
+    uint textureIndex;
+    uint normalMapIndex;
+} draw;
+#endif
+
+layout(location = 0) out vec2 texCoord;
+
+// The depth prepass computes the same positions from its position stream, see VulkanModel::recordDepthBindless
+invariant gl_Position;
+
+#ifdef HAS_NORMAL_MAP
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) out vec3 outTangent;
+layout(location = 3) out vec3 outBitangent;
+#endif
+
+uint fetchWord(uint word)
+{
+    return vertexBuffers[draw.geometryIndex].words[word];
+}
+
+float fetch(uint word)
+{
+    return uintBitsToFloat(fetchWord(word));
+}
+
+vec3 fetchVec3(uint word)
+{
+    return vec3(fetch(word), fetch(word + 1), fetch(word + 2));
+}
+
+// 16-bit indices are packed two per word, the low half first
+uint fetchIndex(uint index)
+{
+    if ((kFeatureMask & FEATURE_INDEX16) != 0u)
+    {
+        uint word = indexBuffers[draw.geometryIndex].indices[index >> 1];
+        return (word >> ((index & 1u) * 16u)) & 0xFFFFu;
+    }
+    return indexBuffers[draw.geometryIndex].indices[index];
+}
+
+// See model::EncodeOctahedral
+vec3 decodeOctahedral(uint encoded)
+{
+    vec2 e = unpackSnorm2x16(encoded);
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+
+struct Vertex
+{
+    vec3 pos; // quantized layout : in the mesh AABB, the dequantization is part of the transform
+    vec2 texCoord;
+    vec3 normal;
+    vec3 tangent;
+    vec3 bitangent;
+};
+
+Vertex fetchVertex(uint index)
+{
+    Vertex vertex;
+    if (kVertexLayout == VertexLayout_Position || kVertexLayout == VertexLayout_QuantizedPosition)
+    {
+        vertex = Vertex(vec3(0.0), vec2(0.0), vec3(0.0), vec3(0.0), vec3(0.0));
+        if (kVertexLayout == VertexLayout_Position)
+        {
+            vertex.pos = fetchVec3(draw.vertexOffset + index * 3);
+        }
+        else
+        {
+            uint xy = fetchWord(draw.vertexOffset + index * 2);
+            uint z = fetchWord(draw.vertexOffset + index * 2 + 1);
+            vertex.pos = vec3(xy & 0xFFFFu, xy >> 16, z & 0xFFFFu);
+        }
+    }
+    else if (kVertexLayout == VertexLayout_Quantized)
+    {
+        uint base = draw.vertexOffset + index * kQuantizedVertexWords;
+        uint xy = fetchWord(base);
+        uint zw = fetchWord(base + 1);
+        vertex.pos = vec3(xy & 0xFFFFu, xy >> 16, zw & 0xFFFFu);
+        vertex.texCoord = unpackHalf2x16(fetchWord(base + 2));
+        vertex.normal = decodeOctahedral(fetchWord(base + 3));
+        vertex.tangent = decodeOctahedral(fetchWord(base + 4));
+        vertex.bitangent = cross(vertex.normal, vertex.tangent) * ((zw >> 16) != 0u ? -1.0 : 1.0);
+    }
+    else
+    {
+        uint base = draw.vertexOffset + index * kFullVertexWords;
+        vertex.pos = fetchVec3(base);
+        vertex.texCoord = vec2(fetch(base + 3), fetch(base + 4));
+        vertex.normal = fetchVec3(base + 5);
+        vertex.tangent = fetchVec3(base + 8);
+        vertex.bitangent = fetchVec3(base + 11);
+    }
+    return vertex;
+}
+
+void main()
+{
+#ifdef GPU_DRIVEN
+    draw = records[commands[batch.firstCommand + gl_DrawID].drawIndex];
+    outTextureIndex = draw.textureIndex;
+    outNormalMapIndex = draw.normalMapIndex;
+#endif
+
+    uint index = fetchIndex(draw.indexOffset + gl_VertexIndex);
+    Vertex vertex = fetchVertex(index);
+
+    mat4 wvp = transformBuffers[draw.geometryIndex].wvp[draw.transformIndex];
+#ifdef INSTANCED
+    // The instance transforms follow the submesh ones, see VulkanModel::enableInstancing
+    wvp = transformBuffers[draw.geometryIndex].wvp[gl_InstanceIndex] * wvp;
+#endif
+    gl_Position = wvp * vec4(vertex.pos, 1.0);
+
+    texCoord = vertex.texCoord;
+
+#ifdef HAS_NORMAL_MAP
+    outNormal = vertex.normal;
+    outTangent = vertex.tangent;
+    outBitangent = vertex.bitangent;
+#endif
+}
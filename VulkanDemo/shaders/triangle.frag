@@ -1,11 +1,41 @@
 #version 460
 
+// Specialization constants, see ShaderPermutation.h
+layout(constant_id = 0) const uint kFeatureMask = 0;
+layout(constant_id = 2) const float kAlphaCutoff = 0.5;
+
+const uint FEATURE_ALPHA_TEST = 2u; // ShaderFeature_AlphaTest
+
 layout(location = 0) in vec2 texCoord;
 layout(location = 0) out vec4 outColor;
 
 layout(binding = 3) uniform sampler2D texSampler;
 
+#ifdef HAS_NORMAL_MAP
+layout(location = 1) in vec3 inNormal;
+layout(location = 2) in vec3 inTangent;
+layout(location = 3) in vec3 inBitangent;
+
+layout(binding = 5) uniform sampler2D normalMap;
+
+// Fixed directional light in model space
+const vec3 kLightDir = vec3(0.0, 0.0, -1.0);
+#endif
+
 void main()
 {
-    outColor = texture(texSampler, texCoord);
+    vec4 color = texture(texSampler, texCoord);
+
+    if ((kFeatureMask & FEATURE_ALPHA_TEST) != 0u && color.a < kAlphaCutoff)
+    {
+        discard;
+    }
+
+#ifdef HAS_NORMAL_MAP
+    mat3 TBN = mat3(normalize(inTangent), normalize(inBitangent), normalize(inNormal));
+    vec3 N = normalize(TBN * (texture(normalMap, texCoord).xyz * 2.0 - 1.0));
+    color.rgb *= 0.3 + 0.7 * max(dot(N, -kLightDir), 0.0);
+#endif
+
+    outColor = color;
 }
@@ -1,26 +1,130 @@
 #version 460
 
-struct VertexData {
-    float posX, posY, posZ;
-    float u, v;
+// Specialization constants, see ShaderPermutation.h
+layout(constant_id = 0) const uint kFeatureMask = 0;
+layout(constant_id = 1) const uint kVertexLayout = 0; // VertexLayout
 
-    float normalX, normalY, normalZ;
-    float tangentX, tangentY, tangentZ;
-    float bitangentX, bitangentY, bitangentZ;
-};
+const uint VertexLayout_Full = 0;      // Model::Vertex : pos, uv, normal, tangent, bitangent
+const uint VertexLayout_Quantized = 1; // model::QuantizedVertex
+const uint kFullVertexWords = 14;
+const uint kQuantizedVertexWords = 5;
+
+const uint FEATURE_INDEX16 = 32u; // ShaderFeature_Index16
 
-layout(std430, binding = 0) readonly buffer Vertices{ VertexData vertices[]; }  in_vertices;
-layout(binding = 1) readonly buffer Indices {int indices[]; } in_indices;
+// Read as words so both vertex layouts share the binding
+layout(std430, binding = 0) readonly buffer Vertices{ uint words[]; }  in_vertices;
+layout(binding = 1) readonly buffer Indices { uint words[]; } in_indices; // 32 or 16-bit indices
+#ifdef USE_PUSH_CONSTANTS
+// Per-draw data, see ModelDrawConstants. VB and IB are bound whole, the draw's firstVertex selects the
+// submesh indices and vertexOffset its vertices.
+layout(push_constant) uniform DrawConstants
+{
+    mat4 wvp;
+    uint materialIndex;
+    uint vertexOffset;
+} ubo;
+#else
 layout(binding = 2) readonly uniform UniformBuffer{ mat4 wvp;} ubo;
+#endif
+#ifdef INSTANCED
+// Whole transform buffer, see VulkanModel::enableInstancing : the draw's firstInstance skips the submesh
+// transforms, so gl_InstanceIndex indexes the view projection of the instance. ubo.wvp is then the submesh
+// transformation only.
+layout(std430, binding = 6) readonly buffer Instances { mat4 transforms[]; } in_instances;
+#endif
 layout(location = 0) out vec2 texCoord;
 
+#ifdef HAS_NORMAL_MAP
+layout(location = 1) out vec3 outNormal;
+layout(location = 2) out vec3 outTangent;
+layout(location = 3) out vec3 outBitangent;
+#endif
+
+float fetch(uint word)
+{
+    return uintBitsToFloat(in_vertices.words[word]);
+}
+
+vec3 fetchVec3(uint word)
+{
+    return vec3(fetch(word), fetch(word + 1), fetch(word + 2));
+}
+
+// See bindless.vert
+uint fetchIndex(uint index)
+{
+    if ((kFeatureMask & FEATURE_INDEX16) != 0u)
+    {
+        return (in_indices.words[index >> 1] >> ((index & 1u) * 16u)) & 0xFFFFu;
+    }
+    return in_indices.words[index];
+}
+
+// See bindless.vert
+vec3 decodeOctahedral(uint encoded)
+{
+    vec2 e = unpackSnorm2x16(encoded);
+    vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+    float t = max(-n.z, 0.0);
+    n.xy += mix(vec2(t), vec2(-t), greaterThanEqual(n.xy, vec2(0.0)));
+    return normalize(n);
+}
+
+struct Vertex
+{
+    vec3 pos;
+    vec2 texCoord;
+    vec3 normal;
+    vec3 tangent;
+    vec3 bitangent;
+};
+
+Vertex fetchVertex(uint index)
+{
+    Vertex vertex;
+    if (kVertexLayout == VertexLayout_Quantized)
+    {
+        uint base = index * kQuantizedVertexWords;
+        uint xy = in_vertices.words[base];
+        uint zw = in_vertices.words[base + 1];
+        vertex.pos = vec3(xy & 0xFFFFu, xy >> 16, zw & 0xFFFFu);
+        vertex.texCoord = unpackHalf2x16(in_vertices.words[base + 2]);
+        vertex.normal = decodeOctahedral(in_vertices.words[base + 3]);
+        vertex.tangent = decodeOctahedral(in_vertices.words[base + 4]);
+        vertex.bitangent = cross(vertex.normal, vertex.tangent) * ((zw >> 16) != 0u ? -1.0 : 1.0);
+    }
+    else
+    {
+        uint base = index * kFullVertexWords;
+        vertex.pos = fetchVec3(base);
+        vertex.texCoord = vec2(fetch(base + 3), fetch(base + 4));
+        vertex.normal = fetchVec3(base + 5);
+        vertex.tangent = fetchVec3(base + 8);
+        vertex.bitangent = fetchVec3(base + 11);
+    }
+    return vertex;
+}
+
 void main() {
 
-    int index = in_indices.indices[gl_VertexIndex];
-    VertexData vertex = in_vertices.vertices[index];
+    uint index = fetchIndex(uint(gl_VertexIndex));
+#ifdef USE_PUSH_CONSTANTS
+    index += ubo.vertexOffset;
+#endif
+    Vertex vertex = fetchVertex(index);
 
-    vec3 pos = vec3(vertex.posX, vertex.posY, vertex.posZ);
+    vec3 pos = vertex.pos;
+#ifdef INSTANCED
+    gl_Position = in_instances.transforms[gl_InstanceIndex] * ubo.wvp * vec4(pos, 1.0);
+#else
     gl_Position = ubo.wvp * vec4(pos, 1.0);
+#endif
+
+    texCoord = vertex.texCoord;
 
-    texCoord = vec2(vertex.u, vertex.v);
+#ifdef HAS_NORMAL_MAP
+    outNormal = vertex.normal;
+    outTangent = vertex.tangent;
+    outBitangent = vertex.bitangent;
+#endif
 }
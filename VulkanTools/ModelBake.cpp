@@ -0,0 +1,81 @@
+#include "BakedModel.h"
+#include "ModelBaker.h"
+
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+
+// Bakes a model for VulkanModel : ModelBake <model> [<output>] [--full]
+// The output defaults to the model path with kBakedModelExtension, next to the model so its texture paths resolve.
+// The vertices are quantized unless --full is given, the layout must match the VertexLayout of the VulkanModel.
+
+namespace
+{
+
+void printUsage()
+{
+    std::cout << "Usage : ModelBake <model> [<output>] [--full]\n"
+              << "  --full  Model::Vertex instead of the quantized vertices (VertexLayout_Full)" << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    std::string modelPath;
+    std::string bakedPath;
+    bool quantize = true;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--full") == 0)
+        {
+            quantize = false;
+        }
+        else if (modelPath.empty())
+        {
+            modelPath = argv[i];
+        }
+        else if (bakedPath.empty())
+        {
+            bakedPath = argv[i];
+        }
+        else
+        {
+            printUsage();
+            return 1;
+        }
+    }
+    if (modelPath.empty())
+    {
+        printUsage();
+        return 1;
+    }
+    if (bakedPath.empty())
+    {
+        bakedPath = VulkanCore::model::GetBakedModelPath(modelPath);
+    }
+
+    try
+    {
+        auto start = std::chrono::high_resolution_clock::now();
+        VulkanCore::model::ModelBaker baker(modelPath, quantize);
+        auto imported = std::chrono::high_resolution_clock::now();
+        baker.write(bakedPath);
+        auto end = std::chrono::high_resolution_clock::now();
+
+        const VulkanCore::model::MeshBuffers& buffers = baker.getBuffers();
+        std::cout << "Baked " << modelPath << " to " << bakedPath << " : "
+                  << (buffers.Vertices.size() + buffers.Indices.size() + buffers.Positions.size()) / 1024
+                  << " KB of buffers, import "
+                  << std::chrono::duration<float, std::milli>(imported - start).count() << " ms, write "
+                  << std::chrono::duration<float, std::milli>(end - imported).count() << " ms" << std::endl;
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << "ModelBake failed : " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}